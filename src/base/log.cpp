@@ -3,9 +3,13 @@
 #include "color.h"
 #include "system.h"
 
+#include <algorithm>
 #include <atomic>
+#include <condition_variable>
 #include <cstdio>
+#include <ctime>
 #include <memory>
+#include <thread>
 
 #if defined(CONF_FAMILY_WINDOWS)
 #define WIN32_LEAN_AND_MEAN
@@ -23,6 +27,9 @@
 std::atomic<ILogger *> global_logger = nullptr;
 thread_local ILogger *scope_logger = nullptr;
 thread_local bool in_logger = false;
+// the timestamp only changes once per second
+thread_local time_t timestamp_time = 0;
+thread_local char timestamp_buf[80] = "";
 
 void log_set_global_logger(ILogger *logger)
 {
@@ -84,7 +91,7 @@ void log_log_impl(LEVEL level, bool have_color, LOG_COLOR color, const char *sys
 	{
 		scope_logger = global_logger.load(std::memory_order_acquire);
 	}
-	if(!scope_logger)
+	if(!scope_logger || scope_logger->Filters(level))
 	{
 		in_logger = false;
 		return;
@@ -94,7 +101,13 @@ void log_log_impl(LEVEL level, bool have_color, LOG_COLOR color, const char *sys
 	Msg.m_Level = level;
 	Msg.m_HaveColor = have_color;
 	Msg.m_Color = color;
-	str_timestamp_format(Msg.m_aTimestamp, sizeof(Msg.m_aTimestamp), FORMAT_SPACE);
+	const time_t now = time(nullptr);
+	if(now != timestamp_time || timestamp_buf[0] == '\0')
+	{
+		str_timestamp_ex(now, timestamp_buf, sizeof(timestamp_buf), FORMAT_SPACE);
+		timestamp_time = now;
+	}
+	str_copy(Msg.m_aTimestamp, timestamp_buf);
 	Msg.m_TimestampLength = str_length(Msg.m_aTimestamp);
 	str_copy(Msg.m_aSystem, sys);
 	Msg.m_SystemLength = str_length(Msg.m_aSystem);
@@ -139,7 +152,12 @@ void log_log_color(LEVEL level, LOG_COLOR color, const char *sys, const char *fm
 
 bool CLogFilter::Filters(const CLogMessage *pMessage)
 {
-	return pMessage->m_Level > m_MaxLevel.load(std::memory_order_relaxed);
+	return Filters(pMessage->m_Level);
+}
+
+bool CLogFilter::Filters(LEVEL Level)
+{
+	return Level > m_MaxLevel.load(std::memory_order_relaxed);
 }
 
 #if defined(CONF_PLATFORM_ANDROID)
@@ -186,6 +204,10 @@ public:
 	{
 		m_Filter.m_MaxLevel.store(LEVEL_TRACE, std::memory_order_relaxed);
 	}
+	bool Filters(LEVEL Level) override
+	{
+		return m_Filter.Filters(Level) || std::all_of(m_vpLoggers.begin(), m_vpLoggers.end(), [Level](const std::shared_ptr<ILogger> &pLogger) { return pLogger->Filters(Level); });
+	}
 	void Log(const CLogMessage *pMessage) override
 	{
 		if(m_Filter.Filters(pMessage))
@@ -211,6 +233,265 @@ std::unique_ptr<ILogger> log_logger_collection(std::vector<std::shared_ptr<ILogg
 	return std::make_unique<CLoggerCollection>(std::move(vpLoggers));
 }
 
+class CLoggerThreaded : public ILogger
+{
+	enum
+	{
+		NUM_SHARDS = 8,
+		// per shard, about 4000 messages of average length
+		MAX_SHARD_SIZE = 512 * 1024,
+	};
+
+	// followed by the line, padded to keep the next record aligned
+	struct CRecord
+	{
+		uint64_t m_Sequence;
+		LEVEL m_Level;
+		bool m_HaveColor;
+		LOG_COLOR m_Color;
+		int m_TimestampLength;
+		int m_SystemLength;
+		int m_LineMessageOffset;
+		int m_LineLength;
+	};
+
+	struct CShard
+	{
+		std::mutex m_Lock;
+		std::vector<char> m_vData;
+		// only touched while draining
+		std::vector<char> m_vDraining;
+	};
+
+	std::shared_ptr<ILogger> m_pLogger;
+	CShard m_aShards[NUM_SHARDS];
+	std::atomic<uint64_t> m_Sequence{0};
+	std::atomic_int m_Dropped{0};
+	std::atomic_bool m_Finished{false};
+
+	std::mutex m_DrainLock;
+	std::vector<std::pair<uint64_t, const CRecord *>> m_vpDrained;
+	// records that must wait for the next drain, see Drain()
+	std::vector<char> m_vHeldBack;
+	std::vector<char> m_vHeldBackDraining;
+
+	// set while this thread forwards messages
+	static thread_local bool s_Draining;
+
+	std::mutex m_WakeupLock;
+	std::condition_variable m_Wakeup;
+	std::atomic_bool m_WakeupPending{false};
+	bool m_Stop = false;
+	std::thread m_Thread;
+
+	static size_t RecordSize(int LineLength)
+	{
+		return (sizeof(CRecord) + LineLength + alignof(CRecord) - 1) / alignof(CRecord) * alignof(CRecord);
+	}
+
+	static int ShardIndex()
+	{
+		static std::atomic_int s_NextShard{0};
+		thread_local int s_Shard = s_NextShard.fetch_add(1, std::memory_order_relaxed) % NUM_SHARDS;
+		return s_Shard;
+	}
+
+	void Run()
+	{
+		while(true)
+		{
+			{
+				std::unique_lock<std::mutex> Lock(m_WakeupLock);
+				m_Wakeup.wait(Lock, [this]() { return m_Stop || m_WakeupPending.load(std::memory_order_acquire); });
+				if(m_Stop)
+				{
+					return;
+				}
+			}
+			m_WakeupPending.store(false, std::memory_order_release);
+			Drain(false);
+		}
+	}
+
+	void Collect(const std::vector<char> &vData)
+	{
+		for(size_t Offset = 0; Offset < vData.size();)
+		{
+			const CRecord *pRecord = (const CRecord *)&vData[Offset];
+			m_vpDrained.emplace_back(pRecord->m_Sequence, pRecord);
+			Offset += RecordSize(pRecord->m_LineLength);
+		}
+	}
+
+	// With Final set, no more records can be added and all are forwarded.
+	void Drain(bool Final)
+	{
+		std::unique_lock<std::mutex> DrainLock(m_DrainLock);
+		s_Draining = true;
+		// Every record with a lower sequence number is complete once its
+		// shard has been swapped. Later ones can still be added to shards
+		// that were already swapped, so they are held back to keep the order.
+		const uint64_t Limit = Final ? UINT64_MAX : m_Sequence.load(std::memory_order_acquire);
+		m_vpDrained.clear();
+		std::swap(m_vHeldBack, m_vHeldBackDraining);
+		m_vHeldBack.clear();
+		Collect(m_vHeldBackDraining);
+		for(auto &Shard : m_aShards)
+		{
+			Shard.m_vDraining.clear();
+			{
+				std::unique_lock<std::mutex> Lock(Shard.m_Lock);
+				std::swap(Shard.m_vData, Shard.m_vDraining);
+			}
+			Collect(Shard.m_vDraining);
+		}
+		std::sort(m_vpDrained.begin(), m_vpDrained.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+
+		CLogMessage Msg;
+		for(const auto &Drained : m_vpDrained)
+		{
+			const CRecord *pRecord = Drained.second;
+			if(Drained.first >= Limit)
+			{
+				const size_t Size = RecordSize(pRecord->m_LineLength);
+				const size_t Offset = m_vHeldBack.size();
+				m_vHeldBack.resize(Offset + Size);
+				mem_copy(&m_vHeldBack[Offset], pRecord, Size);
+				continue;
+			}
+			const char *pLine = (const char *)(pRecord + 1);
+			Msg.m_Level = pRecord->m_Level;
+			Msg.m_HaveColor = pRecord->m_HaveColor;
+			Msg.m_Color = pRecord->m_Color;
+			Msg.m_TimestampLength = pRecord->m_TimestampLength;
+			Msg.m_SystemLength = pRecord->m_SystemLength;
+			Msg.m_LineMessageOffset = pRecord->m_LineMessageOffset;
+			Msg.m_LineLength = pRecord->m_LineLength;
+			mem_copy(Msg.m_aLine, pLine, pRecord->m_LineLength);
+			Msg.m_aLine[pRecord->m_LineLength] = '\0';
+			// "<timestamp> <level> <system>: "
+			str_truncate(Msg.m_aTimestamp, sizeof(Msg.m_aTimestamp), pLine, pRecord->m_TimestampLength);
+			str_truncate(Msg.m_aSystem, sizeof(Msg.m_aSystem), pLine + pRecord->m_TimestampLength + 3, pRecord->m_SystemLength);
+			m_pLogger->Log(&Msg);
+		}
+
+		const int Dropped = m_Dropped.exchange(0, std::memory_order_relaxed);
+		if(Dropped)
+		{
+			Msg.m_Level = LEVEL_WARN;
+			Msg.m_HaveColor = false;
+			str_timestamp_format(Msg.m_aTimestamp, sizeof(Msg.m_aTimestamp), FORMAT_SPACE);
+			Msg.m_TimestampLength = str_length(Msg.m_aTimestamp);
+			str_copy(Msg.m_aSystem, "log");
+			Msg.m_SystemLength = str_length(Msg.m_aSystem);
+			str_format(Msg.m_aLine, sizeof(Msg.m_aLine), "%s W log: ", Msg.m_aTimestamp);
+			Msg.m_LineMessageOffset = str_length(Msg.m_aLine);
+			str_format(Msg.m_aLine + Msg.m_LineMessageOffset, sizeof(Msg.m_aLine) - Msg.m_LineMessageOffset, "dropped %d messages, output is too slow", Dropped);
+			Msg.m_LineLength = str_length(Msg.m_aLine);
+			m_pLogger->Log(&Msg);
+		}
+		s_Draining = false;
+	}
+
+	void Stop()
+	{
+		{
+			std::unique_lock<std::mutex> Lock(m_WakeupLock);
+			if(m_Stop)
+			{
+				return;
+			}
+			m_Stop = true;
+		}
+		m_Wakeup.notify_one();
+		m_Thread.join();
+		// messages logged from now on are forwarded directly
+		m_Finished.store(true, std::memory_order_release);
+		Drain(true);
+	}
+
+public:
+	CLoggerThreaded(std::shared_ptr<ILogger> pLogger) :
+		m_pLogger(std::move(pLogger))
+	{
+		m_Filter.m_MaxLevel.store(LEVEL_TRACE, std::memory_order_relaxed);
+		m_Thread = std::thread([this]() { Run(); });
+	}
+	~CLoggerThreaded()
+	{
+		Stop();
+	}
+	bool Filters(LEVEL Level) override
+	{
+		return m_Filter.Filters(Level) || m_pLogger->Filters(Level);
+	}
+	void Log(const CLogMessage *pMessage) override
+	{
+		if(Filters(pMessage->m_Level))
+		{
+			return;
+		}
+		CShard &Shard = m_aShards[ShardIndex()];
+		{
+			std::unique_lock<std::mutex> Lock(Shard.m_Lock);
+			if(m_Finished.load(std::memory_order_acquire))
+			{
+				Lock.unlock();
+				m_pLogger->Log(pMessage);
+				return;
+			}
+			const size_t Size = RecordSize(pMessage->m_LineLength);
+			if(Shard.m_vData.size() + Size > MAX_SHARD_SIZE)
+			{
+				m_Dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			CRecord Record;
+			Record.m_Sequence = m_Sequence.fetch_add(1, std::memory_order_relaxed);
+			Record.m_Level = pMessage->m_Level;
+			Record.m_HaveColor = pMessage->m_HaveColor;
+			Record.m_Color = pMessage->m_Color;
+			Record.m_TimestampLength = pMessage->m_TimestampLength;
+			Record.m_SystemLength = pMessage->m_SystemLength;
+			Record.m_LineMessageOffset = pMessage->m_LineMessageOffset;
+			Record.m_LineLength = pMessage->m_LineLength;
+			const size_t Offset = Shard.m_vData.size();
+			Shard.m_vData.resize(Offset + Size);
+			mem_copy(&Shard.m_vData[Offset], &Record, sizeof(Record));
+			mem_copy(&Shard.m_vData[Offset + sizeof(Record)], pMessage->m_aLine, pMessage->m_LineLength);
+		}
+		// errors are forwarded before returning, the process may be about
+		// to crash
+		if(pMessage->m_Level <= LEVEL_ERROR && !s_Draining)
+		{
+			Drain(false);
+			return;
+		}
+		// only wake the thread up once per batch
+		if(!m_WakeupPending.exchange(true, std::memory_order_acq_rel))
+		{
+			std::unique_lock<std::mutex> Lock(m_WakeupLock);
+			m_Wakeup.notify_one();
+		}
+	}
+	void GlobalFinish() override
+	{
+		Stop();
+		m_pLogger->GlobalFinish();
+	}
+	void OnFilterChange() override
+	{
+		m_pLogger->SetFilter(m_Filter);
+	}
+};
+
+thread_local bool CLoggerThreaded::s_Draining = false;
+
+std::unique_ptr<ILogger> log_logger_threaded(std::shared_ptr<ILogger> pLogger)
+{
+	return std::make_unique<CLoggerThreaded>(std::move(pLogger));
+}
+
 class CLoggerAsync : public ILogger
 {
 	ASYNCIO *m_pAio;
@@ -464,6 +745,13 @@ void CFutureLogger::Set(std::shared_ptr<ILogger> pLogger)
 	m_PendingLock.unlock();
 }
 
+bool CFutureLogger::Filters(LEVEL Level)
+{
+	// messages are kept until the logger is set, it decides then
+	auto pLogger = std::atomic_load_explicit(&m_pLogger, std::memory_order_acquire);
+	return pLogger && pLogger->Filters(Level);
+}
+
 void CFutureLogger::Log(const CLogMessage *pMessage)
 {
 	auto pLogger = std::atomic_load_explicit(&m_pLogger, std::memory_order_acquire);
@@ -476,6 +764,7 @@ void CFutureLogger::Log(const CLogMessage *pMessage)
 	pLogger = std::atomic_load_explicit(&m_pLogger, std::memory_order_relaxed);
 	if(pLogger)
 	{
+		m_PendingLock.unlock();
 		pLogger->Log(pMessage);
 		return;
 	}
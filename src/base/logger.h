@@ -60,6 +60,7 @@ public:
 	std::atomic_int m_MaxLevel{LEVEL_INFO};
 
 	bool Filters(const CLogMessage *pMessage);
+	bool Filters(LEVEL Level);
 };
 
 class ILogger
@@ -80,6 +81,14 @@ public:
 		OnFilterChange();
 	}
 
+	/**
+	 * Whether messages of the given level are dropped by this logger.
+	 * Messages nobody wants aren't formatted at all. Loggers that forward
+	 * messages to other loggers must ask them too.
+	 *
+	 * @param Level Severity of the log message.
+	 */
+	virtual bool Filters(LEVEL Level) { return m_Filter.Filters(Level); }
 	/**
 	 * Send the specified message to the logging backend.
 	 *
@@ -200,6 +209,24 @@ std::unique_ptr<ILogger> log_logger_file(IOHANDLE file);
  */
 std::unique_ptr<ILogger> log_logger_stdout();
 
+/**
+ * @ingroup Log
+ *
+ * Logger forwarding messages to the given logger from a background thread.
+ *
+ * Logging threads only copy the message into a buffer of their own, so they
+ * never wait for slow outputs or for each other. The messages of all threads
+ * are forwarded in the order they were logged. Errors are forwarded along
+ * with everything before them before the logging call returns. If the
+ * background thread can't keep up, messages are dropped instead of blocking
+ * and the number of dropped messages is logged.
+ *
+ * The given logger must not depend on the thread it is called from.
+ *
+ * @param pLogger The logger to forward to.
+ */
+std::unique_ptr<ILogger> log_logger_threaded(std::shared_ptr<ILogger> pLogger);
+
 /**
  * @ingroup Log
  *
@@ -234,6 +261,7 @@ public:
 	 * receive all log messages sent to the `CFutureLogger` so far.
 	 */
 	void Set(std::shared_ptr<ILogger> pLogger);
+	bool Filters(LEVEL Level) override;
 	void Log(const CLogMessage *pMessage) override;
 	void GlobalFinish() override;
 	void OnFilterChange() override;
@@ -1,6 +1,33 @@
 #include "backend_null.h"
 
+#include <base/math.h>
+
 #include <engine/client/backend_sdl.h>
+#include <engine/shared/config.h>
+
+#if defined(CONF_VIDEORECORDER)
+#include <engine/shared/video.h>
+#endif
+
+#include <cmath>
+
+bool CCommandProcessorFragment_Null::IsRendering()
+{
+#if defined(CONF_VIDEORECORDER)
+	return IVideo::Current() != nullptr;
+#else
+	return false;
+#endif
+}
+
+bool CCommandProcessorFragment_Null::KeepTextures()
+{
+#if defined(CONF_VIDEORECORDER)
+	return g_Config.m_GfxHeadlessVideo != 0;
+#else
+	return false;
+#endif
+}
 
 ERunCommandReturnTypes CCommandProcessorFragment_Null::RunCommand(const CCommandBuffer::SCommand *pBaseCommand)
 {
@@ -12,12 +39,36 @@ ERunCommandReturnTypes CCommandProcessorFragment_Null::RunCommand(const CCommand
 	case CCommandBuffer::CMD_TEXTURE_CREATE:
 		Cmd_Texture_Create(static_cast<const CCommandBuffer::SCommand_Texture_Create *>(pBaseCommand));
 		break;
+	case CCommandBuffer::CMD_TEXTURE_UPDATE:
+		Cmd_Texture_Update(static_cast<const CCommandBuffer::SCommand_Texture_Update *>(pBaseCommand));
+		break;
+	case CCommandBuffer::CMD_TEXTURE_DESTROY:
+		Cmd_Texture_Destroy(static_cast<const CCommandBuffer::SCommand_Texture_Destroy *>(pBaseCommand));
+		break;
 	case CCommandBuffer::CMD_TEXT_TEXTURES_CREATE:
 		Cmd_TextTextures_Create(static_cast<const CCommandBuffer::SCommand_TextTextures_Create *>(pBaseCommand));
 		break;
+	case CCommandBuffer::CMD_TEXT_TEXTURES_DESTROY:
+		Cmd_TextTextures_Destroy(static_cast<const CCommandBuffer::SCommand_TextTextures_Destroy *>(pBaseCommand));
+		break;
 	case CCommandBuffer::CMD_TEXT_TEXTURE_UPDATE:
 		Cmd_TextTexture_Update(static_cast<const CCommandBuffer::SCommand_TextTexture_Update *>(pBaseCommand));
 		break;
+	case CCommandBuffer::CMD_CLEAR:
+		Cmd_Clear(static_cast<const CCommandBuffer::SCommand_Clear *>(pBaseCommand));
+		break;
+	case CCommandBuffer::CMD_RENDER:
+		Cmd_Render(static_cast<const CCommandBuffer::SCommand_Render *>(pBaseCommand));
+		break;
+	case CCommandBuffer::CMD_SWAP:
+		Cmd_Swap(static_cast<const CCommandBuffer::SCommand_Swap *>(pBaseCommand));
+		break;
+	case CCommandBuffer::CMD_UPDATE_VIEWPORT:
+		Cmd_Update_Viewport(static_cast<const CCommandBuffer::SCommand_Update_Viewport *>(pBaseCommand));
+		break;
+	case CCommandBuffer::CMD_TRY_SWAP_AND_SCREENSHOT:
+		Cmd_Screenshot(static_cast<const CCommandBuffer::SCommand_TrySwapAndScreenshot *>(pBaseCommand));
+		break;
 	}
 	return ERunCommandReturnTypes::RUN_COMMAND_COMMAND_HANDLED;
 }
@@ -41,21 +92,350 @@ bool CCommandProcessorFragment_Null::Cmd_Init(const SCommand_Init *pCommand)
 	pCommand->m_pCapabilities->m_ContextMajor = 0;
 	pCommand->m_pCapabilities->m_ContextMinor = 0;
 	pCommand->m_pCapabilities->m_ContextPatch = 0;
+
+	SetCanvasSize(pCommand->m_Width, pCommand->m_Height);
+	*pCommand->m_pReadPresentedImageDataFunc = [this](uint32_t &Width, uint32_t &Height, uint32_t &Format, std::vector<uint8_t> &vDstData, bool Flush) {
+		return !Flush && GetPresentedImageData(Width, Height, Format, vDstData);
+	};
 	return false;
 }
 
+void CCommandProcessorFragment_Null::SetCanvasSize(uint32_t Width, uint32_t Height)
+{
+	m_CanvasWidth = Width;
+	m_CanvasHeight = Height;
+	m_vBackBuffer.clear();
+	m_vFrontBuffer.clear();
+}
+
+bool CCommandProcessorFragment_Null::GetPresentedImageData(uint32_t &Width, uint32_t &Height, uint32_t &Format, std::vector<uint8_t> &vDstData)
+{
+	if(m_vFrontBuffer.empty())
+		return false;
+
+	Width = m_CanvasWidth;
+	Height = m_CanvasHeight;
+	Format = CImageInfo::FORMAT_RGBA;
+	vDstData = m_vFrontBuffer;
+	return true;
+}
+
+CCommandProcessorFragment_Null::STexture *CCommandProcessorFragment_Null::GetTexture(int Slot)
+{
+	if(Slot < 0 || (size_t)Slot >= m_vTextures.size() || m_vTextures[Slot].m_vData.empty())
+		return nullptr;
+	return &m_vTextures[Slot];
+}
+
 void CCommandProcessorFragment_Null::Cmd_Texture_Create(const CCommandBuffer::SCommand_Texture_Create *pCommand)
 {
+	// textures are kept in case a video is recorded later on
+	if(KeepTextures() && pCommand->m_Slot >= 0 && pCommand->m_PixelSize == 4 && (pCommand->m_Flags & CCommandBuffer::TEXFLAG_NO_2D_TEXTURE) == 0)
+	{
+		if((size_t)pCommand->m_Slot >= m_vTextures.size())
+			m_vTextures.resize(pCommand->m_Slot + 1);
+		STexture &Texture = m_vTextures[pCommand->m_Slot];
+		Texture.m_Width = pCommand->m_Width;
+		Texture.m_Height = pCommand->m_Height;
+		Texture.m_PixelSize = 4;
+		const uint8_t *pData = static_cast<const uint8_t *>(pCommand->m_pData);
+		Texture.m_vData.assign(pData, pData + (size_t)pCommand->m_Width * pCommand->m_Height * 4);
+	}
 	free(pCommand->m_pData);
 }
 
+void CCommandProcessorFragment_Null::Cmd_Texture_Update(const CCommandBuffer::SCommand_Texture_Update *pCommand)
+{
+	STexture *pTexture = GetTexture(pCommand->m_Slot);
+	if(pTexture && pTexture->m_PixelSize == 4 && pCommand->m_X >= 0 && pCommand->m_Y >= 0 && pCommand->m_X + pCommand->m_Width <= pTexture->m_Width && pCommand->m_Y + pCommand->m_Height <= pTexture->m_Height)
+	{
+		const uint8_t *pData = static_cast<const uint8_t *>(pCommand->m_pData);
+		for(size_t y = 0; y < pCommand->m_Height; y++)
+			mem_copy(&pTexture->m_vData[((pCommand->m_Y + y) * pTexture->m_Width + pCommand->m_X) * 4], pData + y * pCommand->m_Width * 4, pCommand->m_Width * 4);
+	}
+	free(pCommand->m_pData);
+}
+
+void CCommandProcessorFragment_Null::Cmd_Texture_Destroy(const CCommandBuffer::SCommand_Texture_Destroy *pCommand)
+{
+	if(pCommand->m_Slot >= 0 && (size_t)pCommand->m_Slot < m_vTextures.size())
+		m_vTextures[pCommand->m_Slot] = STexture();
+}
+
 void CCommandProcessorFragment_Null::Cmd_TextTextures_Create(const CCommandBuffer::SCommand_TextTextures_Create *pCommand)
 {
+	// text textures only hold alpha, they are sampled as white
+	const int aSlots[] = {pCommand->m_Slot, pCommand->m_SlotOutline};
+	const uint8_t *apData[] = {static_cast<const uint8_t *>(pCommand->m_pTextData), static_cast<const uint8_t *>(pCommand->m_pTextOutlineData)};
+	for(int i = 0; i < 2 && KeepTextures(); i++)
+	{
+		if(aSlots[i] < 0)
+			continue;
+		if((size_t)aSlots[i] >= m_vTextures.size())
+			m_vTextures.resize(aSlots[i] + 1);
+		STexture &Texture = m_vTextures[aSlots[i]];
+		Texture.m_Width = pCommand->m_Width;
+		Texture.m_Height = pCommand->m_Height;
+		Texture.m_PixelSize = 1;
+		Texture.m_vData.assign(apData[i], apData[i] + (size_t)pCommand->m_Width * pCommand->m_Height);
+	}
 	free(pCommand->m_pTextData);
 	free(pCommand->m_pTextOutlineData);
 }
 
+void CCommandProcessorFragment_Null::Cmd_TextTextures_Destroy(const CCommandBuffer::SCommand_TextTextures_Destroy *pCommand)
+{
+	for(int Slot : {pCommand->m_Slot, pCommand->m_SlotOutline})
+	{
+		if(Slot >= 0 && (size_t)Slot < m_vTextures.size())
+			m_vTextures[Slot] = STexture();
+	}
+}
+
 void CCommandProcessorFragment_Null::Cmd_TextTexture_Update(const CCommandBuffer::SCommand_TextTexture_Update *pCommand)
 {
+	STexture *pTexture = GetTexture(pCommand->m_Slot);
+	if(pTexture && pTexture->m_PixelSize == 1 && pCommand->m_X >= 0 && pCommand->m_Y >= 0 && pCommand->m_X + pCommand->m_Width <= pTexture->m_Width && pCommand->m_Y + pCommand->m_Height <= pTexture->m_Height)
+	{
+		const uint8_t *pData = static_cast<const uint8_t *>(pCommand->m_pData);
+		for(size_t y = 0; y < pCommand->m_Height; y++)
+			mem_copy(&pTexture->m_vData[(pCommand->m_Y + y) * pTexture->m_Width + pCommand->m_X], pData + y * pCommand->m_Width, pCommand->m_Width);
+	}
 	free(pCommand->m_pData);
 }
+
+void CCommandProcessorFragment_Null::Cmd_Clear(const CCommandBuffer::SCommand_Clear *pCommand)
+{
+	if(!IsRendering())
+		return;
+
+	m_vBackBuffer.resize((size_t)m_CanvasWidth * m_CanvasHeight * 4);
+	const uint8_t aColor[4] = {
+		(uint8_t)round_to_int(clamp(pCommand->m_Color.r, 0.0f, 1.0f) * 255.0f),
+		(uint8_t)round_to_int(clamp(pCommand->m_Color.g, 0.0f, 1.0f) * 255.0f),
+		(uint8_t)round_to_int(clamp(pCommand->m_Color.b, 0.0f, 1.0f) * 255.0f),
+		255};
+	for(size_t p = 0; p < m_vBackBuffer.size(); p += 4)
+		mem_copy(&m_vBackBuffer[p], aColor, sizeof(aColor));
+}
+
+CCommandProcessorFragment_Null::SClipRect CCommandProcessorFragment_Null::GetClipRect(const CCommandBuffer::SState &State) const
+{
+	SClipRect Clip = {0, 0, (int)m_CanvasWidth, (int)m_CanvasHeight};
+	if(State.m_ClipEnable)
+	{
+		// the clip rect uses the bottom left origin of the GL scissor
+		Clip.m_X0 = maximum(Clip.m_X0, State.m_ClipX);
+		Clip.m_X1 = minimum(Clip.m_X1, State.m_ClipX + State.m_ClipW);
+		Clip.m_Y0 = maximum(Clip.m_Y0, (int)m_CanvasHeight - (State.m_ClipY + State.m_ClipH));
+		Clip.m_Y1 = minimum(Clip.m_Y1, (int)m_CanvasHeight - State.m_ClipY);
+	}
+	return Clip;
+}
+
+void CCommandProcessorFragment_Null::BlendPixel(uint8_t *pDst, const float *pColor, int BlendMode) const
+{
+	const float Alpha = pColor[3] / 255.0f;
+	for(int c = 0; c < 3; c++)
+	{
+		float Value;
+		if(BlendMode == CCommandBuffer::BLEND_ALPHA)
+			Value = pColor[c] * Alpha + pDst[c] * (1.0f - Alpha);
+		else if(BlendMode == CCommandBuffer::BLEND_ADDITIVE)
+			Value = pColor[c] * Alpha + pDst[c];
+		else
+			Value = pColor[c];
+		pDst[c] = (uint8_t)minimum(Value + 0.5f, 255.0f);
+	}
+}
+
+void CCommandProcessorFragment_Null::RasterizeTriangle(const CCommandBuffer::SState &State, const SClipRect &Clip, const STexture *pTexture, const CCommandBuffer::SVertex *apVertices[3])
+{
+	const float ScaleX = m_CanvasWidth / (State.m_ScreenBR.x - State.m_ScreenTL.x);
+	const float ScaleY = m_CanvasHeight / (State.m_ScreenBR.y - State.m_ScreenTL.y);
+	vec2 aPos[3];
+	for(int i = 0; i < 3; i++)
+		aPos[i] = vec2((apVertices[i]->m_Pos.x - State.m_ScreenTL.x) * ScaleX, (apVertices[i]->m_Pos.y - State.m_ScreenTL.y) * ScaleY);
+
+	float Area = (aPos[1].x - aPos[0].x) * (aPos[2].y - aPos[0].y) - (aPos[1].y - aPos[0].y) * (aPos[2].x - aPos[0].x);
+	if(std::abs(Area) < 1e-6f)
+		return;
+	if(Area < 0.0f)
+	{
+		std::swap(aPos[1], aPos[2]);
+		std::swap(apVertices[1], apVertices[2]);
+		Area = -Area;
+	}
+
+	const int MinX = maximum(Clip.m_X0, (int)std::floor(minimum(aPos[0].x, minimum(aPos[1].x, aPos[2].x))));
+	const int MaxX = minimum(Clip.m_X1, (int)std::ceil(maximum(aPos[0].x, maximum(aPos[1].x, aPos[2].x))));
+	const int MinY = maximum(Clip.m_Y0, (int)std::floor(minimum(aPos[0].y, minimum(aPos[1].y, aPos[2].y))));
+	const int MaxY = minimum(Clip.m_Y1, (int)std::ceil(maximum(aPos[0].y, maximum(aPos[1].y, aPos[2].y))));
+	if(MinX >= MaxX || MinY >= MaxY)
+		return;
+
+	// edge i lies opposite of vertex i, pixels on an edge belong to one triangle only
+	float aEdgeDX[3], aEdgeDY[3];
+	bool aOwnsEdge[3];
+	for(int i = 0; i < 3; i++)
+	{
+		const vec2 &From = aPos[(i + 1) % 3];
+		const vec2 &To = aPos[(i + 2) % 3];
+		aEdgeDX[i] = To.x - From.x;
+		aEdgeDY[i] = To.y - From.y;
+		aOwnsEdge[i] = aEdgeDY[i] > 0.0f || (aEdgeDY[i] == 0.0f && aEdgeDX[i] < 0.0f);
+	}
+
+	float aaAttributes[3][6];
+	for(int i = 0; i < 3; i++)
+	{
+		aaAttributes[i][0] = apVertices[i]->m_Color.r;
+		aaAttributes[i][1] = apVertices[i]->m_Color.g;
+		aaAttributes[i][2] = apVertices[i]->m_Color.b;
+		aaAttributes[i][3] = apVertices[i]->m_Color.a;
+		aaAttributes[i][4] = apVertices[i]->m_Tex.x;
+		aaAttributes[i][5] = apVertices[i]->m_Tex.y;
+	}
+
+	for(int y = MinY; y < MaxY; y++)
+	{
+		const float PixelY = y + 0.5f;
+		for(int x = MinX; x < MaxX; x++)
+		{
+			const float PixelX = x + 0.5f;
+			float aWeights[3];
+			bool Inside = true;
+			for(int i = 0; i < 3 && Inside; i++)
+			{
+				const vec2 &From = aPos[(i + 1) % 3];
+				aWeights[i] = aEdgeDX[i] * (PixelY - From.y) - aEdgeDY[i] * (PixelX - From.x);
+				Inside = aWeights[i] > 0.0f || (aWeights[i] == 0.0f && aOwnsEdge[i]);
+			}
+			if(!Inside)
+				continue;
+
+			float aColor[4];
+			float aTexCoord[2];
+			for(int a = 0; a < 6; a++)
+			{
+				const float Value = (aWeights[0] * aaAttributes[0][a] + aWeights[1] * aaAttributes[1][a] + aWeights[2] * aaAttributes[2][a]) / Area;
+				if(a < 4)
+					aColor[a] = Value;
+				else
+					aTexCoord[a - 4] = Value;
+			}
+
+			if(pTexture)
+			{
+				int aTexel[2];
+				const uint32_t aSize[2] = {pTexture->m_Width, pTexture->m_Height};
+				for(int c = 0; c < 2; c++)
+				{
+					aTexel[c] = (int)std::floor(aTexCoord[c] * aSize[c]);
+					if(State.m_WrapMode == CCommandBuffer::WRAP_REPEAT)
+						aTexel[c] = ((aTexel[c] % (int)aSize[c]) + aSize[c]) % aSize[c];
+					else
+						aTexel[c] = clamp(aTexel[c], 0, (int)aSize[c] - 1);
+				}
+				const uint8_t *pTexel = &pTexture->m_vData[((size_t)aTexel[1] * pTexture->m_Width + aTexel[0]) * pTexture->m_PixelSize];
+				if(pTexture->m_PixelSize == 1)
+					aColor[3] = aColor[3] * pTexel[0] / 255.0f;
+				else
+				{
+					for(int c = 0; c < 4; c++)
+						aColor[c] = aColor[c] * pTexel[c] / 255.0f;
+				}
+			}
+
+			BlendPixel(&m_vBackBuffer[((size_t)y * m_CanvasWidth + x) * 4], aColor, State.m_BlendMode);
+		}
+	}
+}
+
+void CCommandProcessorFragment_Null::RasterizeLine(const CCommandBuffer::SState &State, const SClipRect &Clip, const CCommandBuffer::SVertex *apVertices[2])
+{
+	const float ScaleX = m_CanvasWidth / (State.m_ScreenBR.x - State.m_ScreenTL.x);
+	const float ScaleY = m_CanvasHeight / (State.m_ScreenBR.y - State.m_ScreenTL.y);
+	const vec2 From((apVertices[0]->m_Pos.x - State.m_ScreenTL.x) * ScaleX, (apVertices[0]->m_Pos.y - State.m_ScreenTL.y) * ScaleY);
+	const vec2 To((apVertices[1]->m_Pos.x - State.m_ScreenTL.x) * ScaleX, (apVertices[1]->m_Pos.y - State.m_ScreenTL.y) * ScaleY);
+	const float aColor[4] = {(float)apVertices[0]->m_Color.r, (float)apVertices[0]->m_Color.g, (float)apVertices[0]->m_Color.b, (float)apVertices[0]->m_Color.a};
+
+	const int Steps = maximum(1, round_to_int(maximum(std::abs(To.x - From.x), std::abs(To.y - From.y))));
+	for(int i = 0; i <= Steps; i++)
+	{
+		const vec2 Pos = mix(From, To, i / (float)Steps);
+		const int x = (int)std::floor(Pos.x);
+		const int y = (int)std::floor(Pos.y);
+		if(x >= Clip.m_X0 && x < Clip.m_X1 && y >= Clip.m_Y0 && y < Clip.m_Y1)
+			BlendPixel(&m_vBackBuffer[((size_t)y * m_CanvasWidth + x) * 4], aColor, State.m_BlendMode);
+	}
+}
+
+void CCommandProcessorFragment_Null::Cmd_Render(const CCommandBuffer::SCommand_Render *pCommand)
+{
+	if(!IsRendering() || m_vBackBuffer.empty())
+		return;
+
+	const CCommandBuffer::SState &State = pCommand->m_State;
+	if(State.m_ScreenBR.x == State.m_ScreenTL.x || State.m_ScreenBR.y == State.m_ScreenTL.y)
+		return;
+	const SClipRect Clip = GetClipRect(State);
+	if(Clip.m_X0 >= Clip.m_X1 || Clip.m_Y0 >= Clip.m_Y1)
+		return;
+	const STexture *pTexture = GetTexture(State.m_Texture);
+
+	const CCommandBuffer::SVertex *pVertices = pCommand->m_pVertices;
+	for(unsigned i = 0; i < pCommand->m_PrimCount; i++)
+	{
+		switch(pCommand->m_PrimType)
+		{
+		case CCommandBuffer::PRIMTYPE_LINES:
+		{
+			const CCommandBuffer::SVertex *apLine[2] = {&pVertices[i * 2], &pVertices[i * 2 + 1]};
+			RasterizeLine(State, Clip, apLine);
+			break;
+		}
+		case CCommandBuffer::PRIMTYPE_QUADS:
+		{
+			const CCommandBuffer::SVertex *apFirst[3] = {&pVertices[i * 4], &pVertices[i * 4 + 1], &pVertices[i * 4 + 2]};
+			const CCommandBuffer::SVertex *apSecond[3] = {&pVertices[i * 4], &pVertices[i * 4 + 2], &pVertices[i * 4 + 3]};
+			RasterizeTriangle(State, Clip, pTexture, apFirst);
+			RasterizeTriangle(State, Clip, pTexture, apSecond);
+			break;
+		}
+		case CCommandBuffer::PRIMTYPE_TRIANGLES:
+		{
+			const CCommandBuffer::SVertex *apTriangle[3] = {&pVertices[i * 3], &pVertices[i * 3 + 1], &pVertices[i * 3 + 2]};
+			RasterizeTriangle(State, Clip, pTexture, apTriangle);
+			break;
+		}
+		}
+	}
+}
+
+void CCommandProcessorFragment_Null::Cmd_Swap(const CCommandBuffer::SCommand_Swap *pCommand)
+{
+	if(!IsRendering() || m_vBackBuffer.empty())
+		return;
+	m_vFrontBuffer = m_vBackBuffer;
+}
+
+void CCommandProcessorFragment_Null::Cmd_Update_Viewport(const CCommandBuffer::SCommand_Update_Viewport *pCommand)
+{
+	if(pCommand->m_X == 0 && pCommand->m_Y == 0 && pCommand->m_Width > 0 && pCommand->m_Height > 0 && ((uint32_t)pCommand->m_Width != m_CanvasWidth || (uint32_t)pCommand->m_Height != m_CanvasHeight))
+		SetCanvasSize(pCommand->m_Width, pCommand->m_Height);
+}
+
+void CCommandProcessorFragment_Null::Cmd_Screenshot(const CCommandBuffer::SCommand_TrySwapAndScreenshot *pCommand)
+{
+	*pCommand->m_pSwapped = false;
+	if(m_vFrontBuffer.empty())
+		return;
+
+	unsigned char *pPixelData = (unsigned char *)malloc(m_vFrontBuffer.size());
+	mem_copy(pPixelData, m_vFrontBuffer.data(), m_vFrontBuffer.size());
+	pCommand->m_pImage->m_Width = m_CanvasWidth;
+	pCommand->m_pImage->m_Height = m_CanvasHeight;
+	pCommand->m_pImage->m_Format = CImageInfo::FORMAT_RGBA;
+	pCommand->m_pImage->m_pData = pPixelData;
+}
@@ -3,14 +3,59 @@
 
 #include <engine/client/backend/backend_base.h>
 
+#include <vector>
+
+// Discards all commands, unless a video is recorded: then the plain render
+// commands are drawn into a software framebuffer so demos can be rendered offscreen.
+// Textures are only kept with gfx_headless_video, text textures with one channel.
 class CCommandProcessorFragment_Null : public CCommandProcessorFragment_GLBase
 {
-	bool GetPresentedImageData(uint32_t &Width, uint32_t &Height, uint32_t &Format, std::vector<uint8_t> &vDstData) override { return false; };
+	struct STexture
+	{
+		uint32_t m_Width = 0;
+		uint32_t m_Height = 0;
+		// 4 for RGBA, 1 for the alpha of text textures
+		uint32_t m_PixelSize = 0;
+		std::vector<uint8_t> m_vData;
+	};
+	std::vector<STexture> m_vTextures;
+
+	uint32_t m_CanvasWidth = 0;
+	uint32_t m_CanvasHeight = 0;
+	std::vector<uint8_t> m_vBackBuffer;
+	std::vector<uint8_t> m_vFrontBuffer;
+
+	struct SClipRect
+	{
+		int m_X0;
+		int m_Y0;
+		int m_X1;
+		int m_Y1;
+	};
+
+	static bool IsRendering();
+	static bool KeepTextures();
+	void SetCanvasSize(uint32_t Width, uint32_t Height);
+	STexture *GetTexture(int Slot);
+	SClipRect GetClipRect(const CCommandBuffer::SState &State) const;
+	void BlendPixel(uint8_t *pDst, const float *pColor, int BlendMode) const;
+	void RasterizeTriangle(const CCommandBuffer::SState &State, const SClipRect &Clip, const STexture *pTexture, const CCommandBuffer::SVertex *apVertices[3]);
+	void RasterizeLine(const CCommandBuffer::SState &State, const SClipRect &Clip, const CCommandBuffer::SVertex *apVertices[2]);
+
+	bool GetPresentedImageData(uint32_t &Width, uint32_t &Height, uint32_t &Format, std::vector<uint8_t> &vDstData) override;
 	ERunCommandReturnTypes RunCommand(const CCommandBuffer::SCommand *pBaseCommand) override;
 	bool Cmd_Init(const SCommand_Init *pCommand);
 	virtual void Cmd_Texture_Create(const CCommandBuffer::SCommand_Texture_Create *pCommand);
+	virtual void Cmd_Texture_Update(const CCommandBuffer::SCommand_Texture_Update *pCommand);
+	virtual void Cmd_Texture_Destroy(const CCommandBuffer::SCommand_Texture_Destroy *pCommand);
 	virtual void Cmd_TextTextures_Create(const CCommandBuffer::SCommand_TextTextures_Create *pCommand);
+	virtual void Cmd_TextTextures_Destroy(const CCommandBuffer::SCommand_TextTextures_Destroy *pCommand);
 	virtual void Cmd_TextTexture_Update(const CCommandBuffer::SCommand_TextTexture_Update *pCommand);
+	virtual void Cmd_Clear(const CCommandBuffer::SCommand_Clear *pCommand);
+	virtual void Cmd_Render(const CCommandBuffer::SCommand_Render *pCommand);
+	virtual void Cmd_Swap(const CCommandBuffer::SCommand_Swap *pCommand);
+	virtual void Cmd_Update_Viewport(const CCommandBuffer::SCommand_Update_Viewport *pCommand);
+	virtual void Cmd_Screenshot(const CCommandBuffer::SCommand_TrySwapAndScreenshot *pCommand);
 };
 
 #endif
@@ -526,6 +526,8 @@ void CCommandProcessorFragment_OpenGL3_3::Cmd_Shutdown(const SCommand_Shutdown *
 	glDeleteVertexArrays(MAX_STREAM_BUFFER_COUNT, m_aPrimitiveDrawVertexID);
 	glDeleteBuffers(1, &m_PrimitiveDrawBufferIDTex3D);
 	glDeleteVertexArrays(1, &m_PrimitiveDrawVertexIDTex3D);
+	if(m_aReadbackBufferIDs[0] != 0)
+		glDeleteBuffers(2, m_aReadbackBufferIDs);
 
 	for(int i = 0; i < (int)m_vTextures.size(); ++i)
 	{
@@ -540,6 +542,96 @@ void CCommandProcessorFragment_OpenGL3_3::Cmd_Shutdown(const SCommand_Shutdown *
 	m_vBufferContainers.clear();
 }
 
+ERunCommandReturnTypes CCommandProcessorFragment_OpenGL3_3::RunCommand(const CCommandBuffer::SCommand *pBaseCommand)
+{
+	// the swap itself is done by the SDL fragment
+	if(pBaseCommand->m_Cmd == CCommandBuffer::CMD_SWAP)
+		++m_PresentedFrames;
+	return CCommandProcessorFragment_OpenGL::RunCommand(pBaseCommand);
+}
+
+bool CCommandProcessorFragment_OpenGL3_3::GetPresentedImageData(uint32_t &Width, uint32_t &Height, uint32_t &Format, std::vector<uint8_t> &vDstData)
+{
+	if(m_CanvasWidth == 0 || m_CanvasHeight == 0)
+		return false;
+
+	Width = m_CanvasWidth;
+	Height = m_CanvasHeight;
+	Format = CImageInfo::FORMAT_RGBA;
+	const size_t ImageSize = (size_t)Width * Height * 4;
+
+	if(m_aReadbackBufferIDs[0] == 0 || Width != m_ReadbackWidth || Height != m_ReadbackHeight)
+	{
+		if(m_aReadbackBufferIDs[0] == 0)
+			glGenBuffers(2, m_aReadbackBufferIDs);
+		for(int i = 0; i < 2; ++i)
+		{
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, m_aReadbackBufferIDs[i]);
+			glBufferData(GL_PIXEL_PACK_BUFFER, ImageSize, nullptr, GL_STREAM_READ);
+			m_aReadbackPending[i] = false;
+		}
+		m_ReadbackWidth = Width;
+		m_ReadbackHeight = Height;
+	}
+
+	// queue the read of the current frame, it is fetched on the next call
+	const size_t Current = m_ReadbackIndex;
+	const size_t Previous = 1 - Current;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, m_aReadbackBufferIDs[Current]);
+	glReadBuffer(GL_FRONT);
+	GLint Alignment;
+	glGetIntegerv(GL_PACK_ALIGNMENT, &Alignment);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, Width, Height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glPixelStorei(GL_PACK_ALIGNMENT, Alignment);
+	m_aReadbackPending[Current] = true;
+	m_aReadbackFrames[Current] = m_PresentedFrames;
+
+	// hand out the previous frame, only the first read of a recording waits for the GPU
+	size_t Source = Current;
+	if(m_aReadbackPending[Previous] && m_aReadbackFrames[Previous] + 1 == m_PresentedFrames)
+		Source = Previous;
+	m_aReadbackPending[Previous] = false;
+	m_ReadbackIndex = Previous;
+
+	return CopyReadbackBuffer(Source, Width, Height, vDstData);
+}
+
+bool CCommandProcessorFragment_OpenGL3_3::GetPendingPresentedImageData(uint32_t &Width, uint32_t &Height, uint32_t &Format, std::vector<uint8_t> &vDstData)
+{
+	// the slot written by the last call, only valid if no frame was presented since
+	const size_t Last = 1 - m_ReadbackIndex;
+	if(m_aReadbackBufferIDs[0] == 0 || !m_aReadbackPending[Last] || m_aReadbackFrames[Last] != m_PresentedFrames)
+		return false;
+	m_aReadbackPending[Last] = false;
+
+	Width = m_ReadbackWidth;
+	Height = m_ReadbackHeight;
+	Format = CImageInfo::FORMAT_RGBA;
+	return CopyReadbackBuffer(Last, Width, Height, vDstData);
+}
+
+bool CCommandProcessorFragment_OpenGL3_3::CopyReadbackBuffer(size_t Index, uint32_t Width, uint32_t Height, std::vector<uint8_t> &vDstData)
+{
+	const size_t ImageSize = (size_t)Width * Height * 4;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, m_aReadbackBufferIDs[Index]);
+	const uint8_t *pPixels = static_cast<const uint8_t *>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, ImageSize, GL_MAP_READ_BIT));
+	if(!pPixels)
+	{
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		return false;
+	}
+
+	// flip while copying, because opengl works from the bottom left corner
+	vDstData.resize(ImageSize);
+	for(uint32_t Y = 0; Y < Height; ++Y)
+		mem_copy(vDstData.data() + (size_t)Y * Width * 4, pPixels + (size_t)(Height - Y - 1) * Width * 4, (size_t)Width * 4);
+
+	glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	return true;
+}
+
 void CCommandProcessorFragment_OpenGL3_3::TextureUpdate(int Slot, int X, int Y, int Width, int Height, int GLFormat, void *pTexData)
 {
 	glBindTexture(GL_TEXTURE_2D, m_vTextures[Slot].m_Tex);
@@ -73,6 +73,19 @@ protected:
 
 	CCommandBuffer::SColorf m_ClearColor;
 
+	// two pixel pack buffers, so presented frames are read back without waiting for the GPU
+	TWGLuint m_aReadbackBufferIDs[2] = {0, 0};
+	uint64_t m_aReadbackFrames[2] = {0, 0};
+	bool m_aReadbackPending[2] = {false, false};
+	size_t m_ReadbackIndex = 0;
+	uint32_t m_ReadbackWidth = 0;
+	uint32_t m_ReadbackHeight = 0;
+	uint64_t m_PresentedFrames = 0;
+
+	bool GetPresentedImageData(uint32_t &Width, uint32_t &Height, uint32_t &Format, std::vector<uint8_t> &vDstData) override;
+	bool GetPendingPresentedImageData(uint32_t &Width, uint32_t &Height, uint32_t &Format, std::vector<uint8_t> &vDstData) override;
+	bool CopyReadbackBuffer(size_t Index, uint32_t Width, uint32_t Height, std::vector<uint8_t> &vDstData);
+
 	void InitPrimExProgram(CGLSLPrimitiveExProgram *pProgram, class CGLSLCompiler *pCompiler, class IStorage *pStorage, bool Textured, bool Rotationless);
 
 	static int TexFormatToNewOpenGLFormat(int TexFormat);
@@ -119,6 +132,8 @@ protected:
 
 public:
 	CCommandProcessorFragment_OpenGL3_3() = default;
+
+	ERunCommandReturnTypes RunCommand(const CCommandBuffer::SCommand *pBaseCommand) override;
 };
 
 #endif
@@ -62,14 +62,15 @@ void CGraphicsBackend_Threaded::ThreadFunc(void *pUser)
 #endif
 			pSelf->m_pProcessor->RunBuffer(pSelf->m_pBuffer);
 
-			pSelf->m_pBuffer = nullptr;
-			pSelf->m_BufferInProcess.store(false, std::memory_order_relaxed);
-			pSelf->m_BufferSwapCond.notify_all();
-
 #if defined(CONF_VIDEORECORDER)
+			// before going idle, so WaitForIdle also waits for the frame to be read
 			if(IVideo::Current())
 				IVideo::Current()->NextVideoFrameThread();
 #endif
+
+			pSelf->m_pBuffer = nullptr;
+			pSelf->m_BufferInProcess.store(false, std::memory_order_relaxed);
+			pSelf->m_BufferSwapCond.notify_all();
 		}
 	}
 }
@@ -1010,6 +1011,10 @@ int CGraphicsBackend_SDL_GL::Init(const char *pName, int *pScreen, int *pWidth,
 	int GlewPatch = 0;
 	IsVersionSupportedGlew(m_BackendType, g_Config.m_GfxGLMajor, g_Config.m_GfxGLMinor, g_Config.m_GfxGLPatch, GlewMajor, GlewMinor, GlewPatch);
 	BackendInitGlew(m_BackendType, GlewMajor, GlewMinor, GlewPatch);
+
+	// offscreen canvas, used when rendering videos
+	*pCurrentWidth = *pWidth > 0 ? *pWidth : 1280;
+	*pCurrentHeight = *pHeight > 0 ? *pHeight : 720;
 #else
 	// print sdl version
 	{
@@ -298,6 +298,7 @@ CClient::CClient() :
 	m_pInput = 0;
 	m_pGraphics = 0;
 	m_pSound = 0;
+	m_pTextRender = 0;
 	m_pGameClient = 0;
 	m_pMap = 0;
 	m_pConfigManager = 0;
@@ -1125,6 +1126,14 @@ void CClient::DebugRender()
 
 	str_format(aBuffer, sizeof(aBuffer), "pred: %d ms", GetPredictionTime());
 	Graphics()->QuadsText(2, 70, 16, aBuffer);
+
+	{
+		const STextLayoutCacheStats &Stats = TextRender()->LayoutCacheStats();
+		const uint64_t Lookups = maximum<uint64_t>(Stats.m_Hits + Stats.m_Misses, 1);
+		str_format(aBuffer, sizeof(aBuffer), "text layout cache: %" PRIzu " entries, hits: %" PRIu64 " misses: %" PRIu64 " (%d%%)",
+			Stats.m_Entries, Stats.m_Hits, Stats.m_Misses, (int)(Stats.m_Hits * 100 / Lookups));
+		Graphics()->QuadsText(2, 82, 16, aBuffer);
+	}
 	Graphics()->QuadsEnd();
 
 	// render graphs
@@ -2983,6 +2992,7 @@ void CClient::InitInterfaces()
 	m_pDiscord = Kernel()->RequestInterface<IDiscord>();
 	m_pSteam = Kernel()->RequestInterface<ISteam>();
 	m_pStorage = Kernel()->RequestInterface<IStorage>();
+	m_pTextRender = Kernel()->RequestInterface<IEngineTextRender>();
 
 	m_DemoEditor.Init(m_pGameClient->NetVersion(), &m_SnapshotDelta, m_pConsole, m_pStorage);
 
@@ -3359,17 +3369,23 @@ void CClient::Run()
 		auto Now = time_get_nanoseconds();
 		decltype(Now) SleepTimeInNanoSeconds{0};
 		bool Slept = false;
-		if(
+		bool Throttle = true;
+#if defined(CONF_VIDEORECORDER)
+		// video time is decoupled from real time, render as fast as possible
+		if(IVideo::Current())
+			Throttle = false;
+#endif
+		if(Throttle && (
 #ifdef CONF_DEBUG
-			g_Config.m_DbgStress ||
+			   g_Config.m_DbgStress ||
 #endif
-			(g_Config.m_ClRefreshRateInactive && !m_pGraphics->WindowActive()))
+			   (g_Config.m_ClRefreshRateInactive && !m_pGraphics->WindowActive())))
 		{
 			SleepTimeInNanoSeconds = (std::chrono::nanoseconds(1s) / (int64_t)g_Config.m_ClRefreshRateInactive) - (Now - LastTime);
 			std::this_thread::sleep_for(SleepTimeInNanoSeconds);
 			Slept = true;
 		}
-		else if(g_Config.m_ClRefreshRate)
+		else if(Throttle && g_Config.m_ClRefreshRate)
 		{
 			SleepTimeInNanoSeconds = (std::chrono::nanoseconds(1s) / (int64_t)g_Config.m_ClRefreshRate) - (Now - LastTime);
 			auto SleepTimeInNanoSecondsInner = SleepTimeInNanoSeconds;
@@ -3613,6 +3629,14 @@ void CClient::Con_Screenshot(IConsole::IResult *pResult, void *pUserData)
 
 #if defined(CONF_VIDEORECORDER)
 
+static void WarnHeadlessVideo(IConsole *pConsole)
+{
+#if defined(CONF_HEADLESS_CLIENT)
+	if(!g_Config.m_GfxHeadlessVideo)
+		pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "videorecorder", "gfx_headless_video was not set at startup, the video is rendered without textures");
+#endif
+}
+
 void CClient::Con_StartVideo(IConsole::IResult *pResult, void *pUserData)
 {
 	CClient *pSelf = (CClient *)pUserData;
@@ -3623,6 +3647,7 @@ void CClient::Con_StartVideo(IConsole::IResult *pResult, void *pUserData)
 		return;
 	}
 
+	WarnHeadlessVideo(pSelf->m_pConsole);
 	if(!IVideo::Current())
 	{
 		// wait for idle, so there is no data race
@@ -3644,6 +3669,8 @@ void CClient::StartVideo(IConsole::IResult *pResult, void *pUserData, const char
 {
 	CClient *pSelf = (CClient *)pUserData;
 
+	WarnHeadlessVideo(pSelf->m_pConsole);
+
 	if(pSelf->State() != IClient::STATE_DEMOPLAYBACK)
 		pSelf->m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "videorecorder", "Can not start videorecorder outside of demoplayer.");
 
@@ -3863,6 +3890,10 @@ void CClient::DemoSlice(const char *pDstPath, CLIENTFUNC_FILTER pfnFilter, void
 	{
 		const char *pDemoFileName = m_DemoPlayer.GetDemoFileName();
 		m_DemoEditor.Slice(pDemoFileName, pDstPath, g_Config.m_ClDemoSliceBegin, g_Config.m_ClDemoSliceEnd, pfnFilter, pUser);
+
+		// reset slice markers
+		g_Config.m_ClDemoSliceBegin = -1;
+		g_Config.m_ClDemoSliceEnd = -1;
 	}
 }
 
@@ -3879,10 +3910,15 @@ const char *CClient::DemoPlayer_Play(const char *pFilename, int StorageType)
 
 	// try to start playback
 	m_DemoPlayer.SetListener(this);
+	m_DemoPlayer.SetWriteIndex(true);
 
 	if(m_DemoPlayer.Load(Storage(), m_pConsole, pFilename, StorageType))
 		return "error loading demo";
 
+	// reset slice markers
+	g_Config.m_ClDemoSliceBegin = -1;
+	g_Config.m_ClDemoSliceEnd = -1;
+
 	// load map
 	const CMapInfo *pMapInfo = m_DemoPlayer.GetMapInfo();
 	int Crc = pMapInfo->m_Crc;
@@ -4579,12 +4615,15 @@ int main(int argc, const char **argv)
 		pStdoutLogger = std::shared_ptr<ILogger>(log_logger_stdout());
 	}
 #endif
+	// stdout and the log file are written from a background thread
+	std::vector<std::shared_ptr<ILogger>> vpOutputLoggers;
 	if(pStdoutLogger)
 	{
-		vpLoggers.push_back(pStdoutLogger);
+		vpOutputLoggers.push_back(pStdoutLogger);
 	}
 	std::shared_ptr<CFutureLogger> pFutureFileLogger = std::make_shared<CFutureLogger>();
-	vpLoggers.push_back(pFutureFileLogger);
+	vpOutputLoggers.push_back(pFutureFileLogger);
+	vpLoggers.push_back(log_logger_threaded(log_logger_collection(std::move(vpOutputLoggers))));
 	std::shared_ptr<CFutureLogger> pFutureConsoleLogger = std::make_shared<CFutureLogger>();
 	vpLoggers.push_back(pFutureConsoleLogger);
 	std::shared_ptr<CFutureLogger> pFutureAssertionLogger = std::make_shared<CFutureLogger>();
@@ -4745,8 +4784,8 @@ int main(int argc, const char **argv)
 	// init client's interfaces
 	pClient->InitInterfaces();
 
-	// execute config file
-	if(pStorage->FileExists(CONFIG_FILE, IStorage::TYPE_ALL))
+	// execute config file, the snapshot is faster as long as it's up to date
+	if(pStorage->FileExists(CONFIG_FILE, IStorage::TYPE_ALL) && !pConsole->ExecuteConfigSnapshot(CONFIG_SNAPSHOT_FILE, CONFIG_FILE))
 	{
 		if(!pConsole->ExecuteFile(CONFIG_FILE))
 		{
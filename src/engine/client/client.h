@@ -32,6 +32,7 @@ class IDiscord;
 class IEngineInput;
 class IEngineMap;
 class IEngineSound;
+class IEngineTextRender;
 class IFriends;
 class ISteam;
 class IStorage;
@@ -112,6 +113,7 @@ class CClient : public IClient, public CDemoPlayer::IListener
 	IEngineInput *m_pInput;
 	IEngineGraphics *m_pGraphics;
 	IEngineSound *m_pSound;
+	IEngineTextRender *m_pTextRender;
 	IFavorites *m_pFavorites;
 	IGameClient *m_pGameClient;
 	IEngineMap *m_pMap;
@@ -306,6 +308,7 @@ public:
 	IEngineGraphics *Graphics() { return m_pGraphics; }
 	IEngineInput *Input() { return m_pInput; }
 	IEngineSound *Sound() { return m_pSound; }
+	IEngineTextRender *TextRender() { return m_pTextRender; }
 	IGameClient *GameClient() { return m_pGameClient; }
 	IConfigManager *ConfigManager() { return m_pConfigManager; }
 	CConfig *Config() { return m_pConfig; }
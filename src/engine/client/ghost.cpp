@@ -7,15 +7,18 @@
 #include <engine/shared/network.h>
 #include <engine/storage.h>
 
+#include <algorithm>
+
 static const unsigned char gs_aHeaderMarker[8] = {'T', 'W', 'G', 'H', 'O', 'S', 'T', 0};
-static const unsigned char gs_CurVersion = 6;
-static const int gs_NumTicksOffset = 93;
+static const unsigned char gs_CurVersion = 7;
+static const int gs_IndexOffsetOffset = 89;
 
 static const ColorRGBA gs_GhostPrintColor{0.65f, 0.6f, 0.6f, 1.0f};
 
 CGhostRecorder::CGhostRecorder()
 {
 	m_File = 0;
+	m_NumItems = 0;
 	ResetBuffer();
 }
 
@@ -48,7 +51,10 @@ int CGhostRecorder::Start(const char *pFilename, const char *pMap, SHA256_DIGEST
 	io_write(m_File, &Header, sizeof(Header));
 
 	m_LastItem.Reset();
+	m_SecondLastItem.Reset();
 	ResetBuffer();
+	m_vIndex.clear();
+	m_NumItems = 0;
 
 	char aBuf[256];
 	str_format(aBuf, sizeof(aBuf), "ghost recording to '%s'", pFilename);
@@ -74,6 +80,20 @@ static void DiffItem(int *pPast, int *pCurrent, int *pOut, int Size)
 	}
 }
 
+// difference to the linear prediction from the two previous items, zero for steady movement
+static void DiffItemPredicted(int *pSecondPast, int *pPast, int *pCurrent, int *pOut, int Size)
+{
+	while(Size)
+	{
+		*pOut = (int)((unsigned)*pCurrent - 2u * (unsigned)*pPast + (unsigned)*pSecondPast);
+		pOut++;
+		pSecondPast++;
+		pPast++;
+		pCurrent++;
+		Size--;
+	}
+}
+
 void CGhostRecorder::WriteData(int Type, const void *pData, int Size)
 {
 	if(!m_File || (unsigned)Size > MAX_ITEM_SIZE || Size <= 0 || Type == -1)
@@ -82,7 +102,9 @@ void CGhostRecorder::WriteData(int Type, const void *pData, int Size)
 	CGhostItem Data(Type);
 	mem_copy(Data.m_aData, pData, Size);
 
-	if(m_LastItem.m_Type == Data.m_Type)
+	if(m_LastItem.m_Type == Data.m_Type && m_SecondLastItem.m_Type == Data.m_Type)
+		DiffItemPredicted((int *)m_SecondLastItem.m_aData, (int *)m_LastItem.m_aData, (int *)Data.m_aData, (int *)m_pBufferPos, Size / sizeof(int32_t));
+	else if(m_LastItem.m_Type == Data.m_Type)
 		DiffItem((int *)m_LastItem.m_aData, (int *)Data.m_aData, (int *)m_pBufferPos, Size / sizeof(int32_t));
 	else
 	{
@@ -90,9 +112,11 @@ void CGhostRecorder::WriteData(int Type, const void *pData, int Size)
 		mem_copy(m_pBufferPos, Data.m_aData, Size);
 	}
 
+	m_SecondLastItem = m_LastItem;
 	m_LastItem = Data;
 	m_pBufferPos += Size;
 	m_BufferNumItems++;
+	m_NumItems++;
 	if(m_BufferNumItems >= NUM_ITEMS_PER_CHUNK)
 		FlushChunk();
 }
@@ -125,13 +149,29 @@ void CGhostRecorder::FlushChunk()
 	aChunk[2] = (Size >> 8) & 0xff;
 	aChunk[3] = (Size)&0xff;
 
+	m_vIndex.push_back({(int)io_tell(m_File), m_NumItems - m_BufferNumItems});
 	io_write(m_File, aChunk, sizeof(aChunk));
 	io_write(m_File, s_aBuffer2, Size);
 
 	m_LastItem.Reset();
+	m_SecondLastItem.Reset();
 	ResetBuffer();
 }
 
+void CGhostRecorder::WriteIndex()
+{
+	unsigned char aBuf[sizeof(int32_t)];
+	uint_to_bytes_be(aBuf, m_vIndex.size());
+	io_write(m_File, aBuf, sizeof(aBuf));
+	for(const CGhostIndexEntry &Entry : m_vIndex)
+	{
+		uint_to_bytes_be(aBuf, Entry.m_Offset);
+		io_write(m_File, aBuf, sizeof(aBuf));
+		uint_to_bytes_be(aBuf, Entry.m_FirstItem);
+		io_write(m_File, aBuf, sizeof(aBuf));
+	}
+}
+
 int CGhostRecorder::Stop(int Ticks, int Time)
 {
 	if(!m_File)
@@ -141,8 +181,15 @@ int CGhostRecorder::Stop(int Ticks, int Time)
 
 	FlushChunk();
 
-	// write down num shots and time
-	io_seek(m_File, gs_NumTicksOffset, IOSEEK_START);
+	const int IndexOffset = io_tell(m_File);
+	WriteIndex();
+
+	// write down index offset, num shots and time
+	io_seek(m_File, gs_IndexOffsetOffset, IOSEEK_START);
+
+	unsigned char aIndexOffset[sizeof(int32_t)];
+	uint_to_bytes_be(aIndexOffset, IndexOffset);
+	io_write(m_File, aIndexOffset, sizeof(aIndexOffset));
 
 	unsigned char aNumTicks[sizeof(int32_t)];
 	uint_to_bytes_be(aNumTicks, Ticks);
@@ -160,6 +207,9 @@ int CGhostRecorder::Stop(int Ticks, int Time)
 CGhostLoader::CGhostLoader()
 {
 	m_File = 0;
+	m_pConsole = nullptr;
+	m_pStorage = nullptr;
+	m_aError[0] = '\0';
 	ResetBuffer();
 }
 
@@ -169,22 +219,31 @@ void CGhostLoader::Init()
 	m_pStorage = Kernel()->RequestInterface<IStorage>();
 }
 
+void CGhostLoader::OnError(const char *pSystem, const char *pMessage)
+{
+	str_copy(m_aError, pMessage);
+	if(m_pConsole)
+		m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, pSystem, pMessage);
+}
+
 void CGhostLoader::ResetBuffer()
 {
 	m_pBufferPos = m_aBuffer;
 	m_BufferNumItems = 0;
 	m_BufferCurItem = 0;
 	m_BufferPrevItem = -1;
+	m_BufferItemSize = 0;
 }
 
 int CGhostLoader::Load(const char *pFilename, const char *pMap, SHA256_DIGEST MapSha256, unsigned MapCrc)
 {
+	m_aError[0] = '\0';
 	m_File = m_pStorage->OpenFile(pFilename, IOFLAG_READ, IStorage::TYPE_SAVE);
 	if(!m_File)
 	{
 		char aBuf[256];
 		str_format(aBuf, sizeof(aBuf), "could not open '%s'", pFilename);
-		m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "ghost_loader", aBuf);
+		OnError("ghost_loader", aBuf);
 		return -1;
 	}
 
@@ -195,7 +254,7 @@ int CGhostLoader::Load(const char *pFilename, const char *pMap, SHA256_DIGEST Ma
 	{
 		char aBuf[256];
 		str_format(aBuf, sizeof(aBuf), "'%s' is not a ghost file", pFilename);
-		m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "ghost_loader", aBuf);
+		OnError("ghost_loader", aBuf);
 		io_close(m_File);
 		m_File = 0;
 		return -1;
@@ -205,7 +264,7 @@ int CGhostLoader::Load(const char *pFilename, const char *pMap, SHA256_DIGEST Ma
 	{
 		char aBuf[256];
 		str_format(aBuf, sizeof(aBuf), "ghost version %d is not supported", m_Header.m_Version);
-		m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "ghost_loader", aBuf);
+		OnError("ghost_loader", aBuf);
 		io_close(m_File);
 		m_File = 0;
 		return -1;
@@ -215,7 +274,7 @@ int CGhostLoader::Load(const char *pFilename, const char *pMap, SHA256_DIGEST Ma
 	{
 		char aBuf[256];
 		str_format(aBuf, sizeof(aBuf), "ghost map name '%s' does not match current map '%s'", m_Header.m_aMap, pMap);
-		m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "ghost_loader", aBuf);
+		OnError("ghost_loader", aBuf);
 		io_close(m_File);
 		m_File = 0;
 		return -1;
@@ -230,7 +289,7 @@ int CGhostLoader::Load(const char *pFilename, const char *pMap, SHA256_DIGEST Ma
 			sha256_str(MapSha256, aMapSha256, sizeof(aMapSha256));
 			char aBuf[256];
 			str_format(aBuf, sizeof(aBuf), "ghost map '%s' sha256 mismatch, wanted=%s ghost=%s", pMap, aMapSha256, aGhostSha256);
-			m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "ghost_loader", aBuf);
+			OnError("ghost_loader", aBuf);
 			io_close(m_File);
 			m_File = 0;
 			return -1;
@@ -244,28 +303,69 @@ int CGhostLoader::Load(const char *pFilename, const char *pMap, SHA256_DIGEST Ma
 		{
 			char aBuf[256];
 			str_format(aBuf, sizeof(aBuf), "ghost map '%s' crc mismatch, wanted=%08x ghost=%08x", pMap, MapCrc, GhostMapCrc);
-			m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "ghost_loader", aBuf);
+			OnError("ghost_loader", aBuf);
 			io_close(m_File);
 			m_File = 0;
 			return -1;
 		}
 	}
 
+	m_vIndex.clear();
+	if(m_Header.m_Version >= 7 && !ReadIndex())
+	{
+		char aBuf[256];
+		str_format(aBuf, sizeof(aBuf), "ghost '%s' has an invalid item index", pFilename);
+		OnError("ghost_loader", aBuf);
+		m_vIndex.clear();
+	}
+
 	m_Info = m_Header.ToGhostInfo();
 	m_LastItem.Reset();
+	m_SecondLastItem.Reset();
 	ResetBuffer();
 
 	return 0;
 }
 
+bool CGhostLoader::ReadIndex()
+{
+	// recordings that were not stopped properly have no index
+	const unsigned IndexOffset = bytes_be_to_uint(m_Header.m_aZeroes);
+	if(IndexOffset == 0)
+		return true;
+
+	const int64_t DataStart = io_tell(m_File);
+	bool Valid = io_seek(m_File, IndexOffset, IOSEEK_START) == 0;
+	unsigned char aBuf[sizeof(int32_t)];
+	Valid = Valid && io_read(m_File, aBuf, sizeof(aBuf)) == sizeof(aBuf);
+	const unsigned NumEntries = Valid ? bytes_be_to_uint(aBuf) : 0;
+	Valid = Valid && NumEntries <= (unsigned)(IndexOffset / 4);
+	for(unsigned i = 0; Valid && i < NumEntries; i++)
+	{
+		CGhostIndexEntry Entry;
+		Valid = io_read(m_File, aBuf, sizeof(aBuf)) == sizeof(aBuf);
+		Entry.m_Offset = bytes_be_to_uint(aBuf);
+		Valid = Valid && io_read(m_File, aBuf, sizeof(aBuf)) == sizeof(aBuf);
+		Entry.m_FirstItem = bytes_be_to_uint(aBuf);
+		Valid = Valid && Entry.m_Offset >= DataStart && (unsigned)Entry.m_Offset < IndexOffset && (m_vIndex.empty() || Entry.m_FirstItem > m_vIndex.back().m_FirstItem);
+		if(Valid)
+			m_vIndex.push_back(Entry);
+	}
+	io_seek(m_File, DataStart, IOSEEK_START);
+	return Valid;
+}
+
 int CGhostLoader::ReadChunk(int *pType)
 {
-	static char s_aCompresseddata[MAX_ITEM_SIZE * NUM_ITEMS_PER_CHUNK];
-	static char s_aDecompressed[MAX_ITEM_SIZE * NUM_ITEMS_PER_CHUNK];
+	char aCompressedData[MAX_ITEM_SIZE * NUM_ITEMS_PER_CHUNK];
+	char aDecompressed[MAX_ITEM_SIZE * NUM_ITEMS_PER_CHUNK];
 	unsigned char aChunk[4];
 
 	if(m_Header.m_Version != 4)
+	{
 		m_LastItem.Reset();
+		m_SecondLastItem.Reset();
+	}
 	ResetBuffer();
 
 	if(io_read(m_File, aChunk, sizeof(aChunk)) != sizeof(aChunk))
@@ -278,26 +378,29 @@ int CGhostLoader::ReadChunk(int *pType)
 	if(Size > MAX_ITEM_SIZE * NUM_ITEMS_PER_CHUNK || Size <= 0)
 		return -1;
 
-	if(io_read(m_File, s_aCompresseddata, Size) != (unsigned)Size)
+	if(io_read(m_File, aCompressedData, Size) != (unsigned)Size)
 	{
-		m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "ghost", "error reading chunk");
+		OnError("ghost", "error reading chunk");
 		return -1;
 	}
 
-	Size = CNetBase::Decompress(s_aCompresseddata, Size, s_aDecompressed, sizeof(s_aDecompressed));
+	Size = CNetBase::Decompress(aCompressedData, Size, aDecompressed, sizeof(aDecompressed));
 	if(Size < 0)
 	{
-		m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "ghost", "error during network decompression");
+		OnError("ghost", "error during network decompression");
 		return -1;
 	}
 
-	Size = CVariableInt::Decompress(s_aDecompressed, Size, m_aBuffer, sizeof(m_aBuffer));
+	Size = CVariableInt::Decompress(aDecompressed, Size, m_aBuffer, sizeof(m_aBuffer));
 	if(Size < 0)
 	{
-		m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "ghost", "error during intpack decompression");
+		OnError("ghost", "error during intpack decompression");
 		return -1;
 	}
 
+	if(m_BufferNumItems > 0)
+		m_BufferItemSize = Size / m_BufferNumItems;
+
 	return 0;
 }
 
@@ -333,6 +436,19 @@ static void UndiffItem(int *pPast, int *pDiff, int *pOut, int Size)
 	}
 }
 
+static void UndiffItemPredicted(int *pSecondPast, int *pPast, int *pDiff, int *pOut, int Size)
+{
+	while(Size)
+	{
+		*pOut = (int)(2u * (unsigned)*pPast - (unsigned)*pSecondPast + (unsigned)*pDiff);
+		pOut++;
+		pSecondPast++;
+		pPast++;
+		pDiff++;
+		Size--;
+	}
+}
+
 bool CGhostLoader::ReadData(int Type, void *pData, int Size)
 {
 	if(!m_File || Size > MAX_ITEM_SIZE || Size <= 0 || Type == -1)
@@ -340,25 +456,69 @@ bool CGhostLoader::ReadData(int Type, void *pData, int Size)
 
 	CGhostItem Data(Type);
 
-	if(m_LastItem.m_Type == Data.m_Type)
+	if(m_Header.m_Version >= 7 && m_LastItem.m_Type == Data.m_Type && m_SecondLastItem.m_Type == Data.m_Type)
+		UndiffItemPredicted((int *)m_SecondLastItem.m_aData, (int *)m_LastItem.m_aData, (int *)m_pBufferPos, (int *)Data.m_aData, Size / sizeof(int32_t));
+	else if(m_LastItem.m_Type == Data.m_Type)
 		UndiffItem((int *)m_LastItem.m_aData, (int *)m_pBufferPos, (int *)Data.m_aData, Size / sizeof(int32_t));
 	else
 		mem_copy(Data.m_aData, m_pBufferPos, Size);
 
 	mem_copy(pData, Data.m_aData, Size);
 
+	m_SecondLastItem = m_LastItem;
 	m_LastItem = Data;
 	m_pBufferPos += Size;
 	m_BufferCurItem++;
 	return true;
 }
 
+bool CGhostLoader::SeekToItem(int Index)
+{
+	if(!m_File || m_vIndex.empty() || Index < 0)
+		return false;
+
+	auto It = std::upper_bound(m_vIndex.begin(), m_vIndex.end(), Index, [](int Item, const CGhostIndexEntry &Entry) { return Item < Entry.m_FirstItem; });
+	if(It == m_vIndex.begin())
+		return false;
+	--It;
+
+	if(io_seek(m_File, It->m_Offset, IOSEEK_START) != 0)
+		return false;
+	m_LastItem.Reset();
+	m_SecondLastItem.Reset();
+	ResetBuffer();
+
+	// items are delta coded within their chunk, so decode the ones before
+	const int Skip = Index - It->m_FirstItem;
+	if(Skip == 0)
+		return true;
+	int Type;
+	if(!ReadNextType(&Type) || Skip >= m_BufferNumItems)
+		return false;
+	unsigned char aData[MAX_ITEM_SIZE];
+	for(int i = 0; i < Skip; i++)
+	{
+		if(!ReadData(Type, aData, m_BufferItemSize))
+			return false;
+	}
+	return true;
+}
+
+std::unique_ptr<IGhostLoader> CGhostLoader::CreateLoader() const
+{
+	auto pLoader = std::make_unique<CGhostLoader>();
+	// it may run on a job thread, errors are only kept
+	pLoader->m_pStorage = m_pStorage;
+	return pLoader;
+}
+
 void CGhostLoader::Close()
 {
 	if(!m_File)
 		return;
 	io_close(m_File);
 	m_File = 0;
+	m_vIndex.clear();
 }
 
 bool CGhostLoader::GetGhostInfo(const char *pFilename, CGhostInfo *pGhostInfo, const char *pMap, SHA256_DIGEST MapSha256, unsigned MapCrc)
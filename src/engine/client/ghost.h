@@ -3,20 +3,22 @@
 
 #include <engine/ghost.h>
 
+#include <vector>
+
 enum
 {
 	MAX_ITEM_SIZE = 128,
 	NUM_ITEMS_PER_CHUNK = 50,
 };
 
-// version 4-6
+// version 4-7
 struct CGhostHeader
 {
 	unsigned char m_aMarker[8];
 	unsigned char m_Version;
 	char m_aOwner[MAX_NAME_LENGTH];
 	char m_aMap[64];
-	unsigned char m_aZeroes[sizeof(int32_t)]; // Crc before version 6
+	unsigned char m_aZeroes[sizeof(int32_t)]; // Crc before version 6, item index offset since version 7
 	unsigned char m_aNumTicks[sizeof(int32_t)];
 	unsigned char m_aTime[sizeof(int32_t)];
 	SHA256_DIGEST m_MapSha256;
@@ -56,6 +58,13 @@ public:
 	void Reset() { m_Type = -1; }
 };
 
+// first item of each chunk, written at the end of the file since version 7
+struct CGhostIndexEntry
+{
+	int m_Offset;
+	int m_FirstItem;
+};
+
 class CGhostRecorder : public IGhostRecorder
 {
 	IOHANDLE m_File;
@@ -63,13 +72,18 @@ class CGhostRecorder : public IGhostRecorder
 	class IStorage *m_pStorage;
 
 	CGhostItem m_LastItem;
+	CGhostItem m_SecondLastItem;
 
 	char m_aBuffer[MAX_ITEM_SIZE * NUM_ITEMS_PER_CHUNK];
 	char *m_pBufferPos;
 	int m_BufferNumItems;
 
+	std::vector<CGhostIndexEntry> m_vIndex;
+	int m_NumItems;
+
 	void ResetBuffer();
 	void FlushChunk();
+	void WriteIndex();
 
 public:
 	CGhostRecorder();
@@ -93,15 +107,23 @@ class CGhostLoader : public IGhostLoader
 	CGhostInfo m_Info;
 
 	CGhostItem m_LastItem;
+	CGhostItem m_SecondLastItem;
 
 	char m_aBuffer[MAX_ITEM_SIZE * NUM_ITEMS_PER_CHUNK];
 	char *m_pBufferPos;
 	int m_BufferNumItems;
 	int m_BufferCurItem;
 	int m_BufferPrevItem;
+	int m_BufferItemSize;
 
+	std::vector<CGhostIndexEntry> m_vIndex;
+
+	char m_aError[256];
+
+	void OnError(const char *pSystem, const char *pMessage);
 	void ResetBuffer();
 	int ReadChunk(int *pType);
+	bool ReadIndex();
 
 public:
 	CGhostLoader();
@@ -111,10 +133,16 @@ public:
 	int Load(const char *pFilename, const char *pMap, SHA256_DIGEST MapSha256, unsigned MapCrc) override;
 	void Close() override;
 	const CGhostInfo *GetInfo() const override { return &m_Info; }
+	const char *Error() const override { return m_aError; }
 
 	bool ReadNextType(int *pType) override;
 	bool ReadData(int Type, void *pData, int Size) override;
 
+	bool HasItemIndex() const override { return !m_vIndex.empty(); }
+	bool SeekToItem(int Index) override;
+
+	std::unique_ptr<IGhostLoader> CreateLoader() const override;
+
 	bool GetGhostInfo(const char *pFilename, CGhostInfo *pGhostInfo, const char *pMap, SHA256_DIGEST MapSha256, unsigned MapCrc) override;
 };
 #endif
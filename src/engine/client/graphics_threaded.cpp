@@ -29,6 +29,8 @@
 
 #include "graphics_threaded.h"
 
+#include <algorithm>
+
 class CSemaphore;
 
 static CVideoMode g_aFakeModes[] = {
@@ -297,8 +299,11 @@ int CGraphics_Threaded::UnloadTexture(CTextureHandle *pIndex)
 	if(!pIndex->IsValid())
 		return 0;
 
+	const int Slot = pIndex->Id();
+	m_vPendingTextureUploads.erase(std::remove_if(m_vPendingTextureUploads.begin(), m_vPendingTextureUploads.end(), [Slot](const SPendingTextureUpload &Upload) { return Upload.m_Handle.Id() == Slot; }), m_vPendingTextureUploads.end());
+
 	CCommandBuffer::SCommand_Texture_Destroy Cmd;
-	Cmd.m_Slot = pIndex->Id();
+	Cmd.m_Slot = Slot;
 	AddCmd(Cmd);
 
 	FreeTextureIndex(pIndex);
@@ -446,6 +451,27 @@ IGraphics::CTextureHandle CGraphics_Threaded::LoadTextureRaw(size_t Width, size_
 		return m_InvalidTexture;
 #endif
 
+	CheckTextureDimensions(Width, Height, Flags, pTexName);
+
+	if(Width == 0 || Height == 0)
+		return IGraphics::CTextureHandle();
+
+	IGraphics::CTextureHandle TextureHandle = FindFreeTextureIndex();
+
+	// copy texture data
+	const size_t MemSize = Width * Height * 4;
+	void *pTmpData = malloc(MemSize);
+	if(!ConvertToRGBA((uint8_t *)pTmpData, (const uint8_t *)pData, Width, Height, Format))
+	{
+		dbg_msg("graphics", "converted image %s to RGBA, consider making its file format RGBA", pTexName ? pTexName : "(no name)");
+	}
+	AddTextureCreateCmd(TextureHandle.Id(), Width, Height, Flags, pTmpData);
+
+	return TextureHandle;
+}
+
+void CGraphics_Threaded::CheckTextureDimensions(size_t Width, size_t Height, int Flags, const char *pTexName)
+{
 	if((Flags & IGraphics::TEXLOAD_TO_2D_ARRAY_TEXTURE) != 0 || (Flags & IGraphics::TEXLOAD_TO_3D_TEXTURE) != 0)
 	{
 		if(Width == 0 || (Width % 16) != 0 || Height == 0 || (Height % 16) != 0)
@@ -462,14 +488,12 @@ IGraphics::CTextureHandle CGraphics_Threaded::LoadTextureRaw(size_t Width, size_
 			m_vWarnings.emplace_back(NewWarning);
 		}
 	}
+}
 
-	if(Width == 0 || Height == 0)
-		return IGraphics::CTextureHandle();
-
-	IGraphics::CTextureHandle TextureHandle = FindFreeTextureIndex();
-
+void CGraphics_Threaded::AddTextureCreateCmd(int Slot, size_t Width, size_t Height, int Flags, void *pRGBAData)
+{
 	CCommandBuffer::SCommand_Texture_Create Cmd;
-	Cmd.m_Slot = TextureHandle.Id();
+	Cmd.m_Slot = Slot;
 	Cmd.m_Width = Width;
 	Cmd.m_Height = Height;
 	Cmd.m_PixelSize = 4;
@@ -491,19 +515,122 @@ IGraphics::CTextureHandle CGraphics_Threaded::LoadTextureRaw(size_t Width, size_
 	if((Flags & IGraphics::TEXLOAD_NO_2D_TEXTURE) != 0)
 		Cmd.m_Flags |= CCommandBuffer::TEXFLAG_NO_2D_TEXTURE;
 
-	// copy texture data
-	const size_t MemSize = Width * Height * Cmd.m_PixelSize;
-	void *pTmpData = malloc(MemSize);
-	if(!ConvertToRGBA((uint8_t *)pTmpData, (const uint8_t *)pData, Width, Height, Format))
+	Cmd.m_pData = pRGBAData;
+	AddCmd(Cmd);
+}
+
+// 16x16 is divisible into 2D array/3D layers, so it is valid for all texture targets
+static const size_t INVALID_TEXTURE_DIMENSION = 16;
+
+static void FillInvalidTextureData(unsigned char *pData)
+{
+	const size_t PixelSize = 4;
+	const unsigned char aRed[] = {0xff, 0x00, 0x00, 0xff};
+	const unsigned char aGreen[] = {0x00, 0xff, 0x00, 0xff};
+	const unsigned char aBlue[] = {0x00, 0x00, 0xff, 0xff};
+	const unsigned char aYellow[] = {0xff, 0xff, 0x00, 0xff};
+	for(size_t y = 0; y < INVALID_TEXTURE_DIMENSION; ++y)
 	{
-		dbg_msg("graphics", "converted image %s to RGBA, consider making its file format RGBA", pTexName ? pTexName : "(no name)");
+		for(size_t x = 0; x < INVALID_TEXTURE_DIMENSION; ++x)
+		{
+			const unsigned char *pColor;
+			if(x < INVALID_TEXTURE_DIMENSION / 2 && y < INVALID_TEXTURE_DIMENSION / 2)
+				pColor = aRed;
+			else if(x >= INVALID_TEXTURE_DIMENSION / 2 && y < INVALID_TEXTURE_DIMENSION / 2)
+				pColor = aGreen;
+			else if(x < INVALID_TEXTURE_DIMENSION / 2 && y >= INVALID_TEXTURE_DIMENSION / 2)
+				pColor = aBlue;
+			else
+				pColor = aYellow;
+			mem_copy(&pData[(y * INVALID_TEXTURE_DIMENSION + x) * PixelSize], pColor, PixelSize);
+		}
 	}
-	Cmd.m_pData = pTmpData;
-	AddCmd(Cmd);
+}
 
-	return TextureHandle;
+static bool DecodePNGFile(IStorage *pStorage, CImageInfo *pImg, const char *pFilename, int StorageType, int &PngliteIncompatible)
+{
+	char aCompleteFilename[IO_MAX_PATH_LENGTH];
+	IOHANDLE File = pStorage->OpenFile(pFilename, IOFLAG_READ, StorageType, aCompleteFilename, sizeof(aCompleteFilename));
+	if(!File)
+	{
+		dbg_msg("game/png", "failed to open file. filename='%s'", pFilename);
+		return false;
+	}
+
+	io_seek(File, 0, IOSEEK_END);
+	unsigned int FileSize = io_tell(File);
+	io_seek(File, 0, IOSEEK_START);
+
+	TImageByteBuffer ByteBuffer;
+	SImageByteBuffer ImageByteBuffer(&ByteBuffer);
+
+	ByteBuffer.resize(FileSize);
+	io_read(File, &ByteBuffer.front(), FileSize);
+
+	io_close(File);
+
+	uint8_t *pImgBuffer = NULL;
+	EImageFormat ImageFormat;
+	if(!::LoadPNG(ImageByteBuffer, pFilename, PngliteIncompatible, pImg->m_Width, pImg->m_Height, pImgBuffer, ImageFormat))
+	{
+		dbg_msg("game/png", "image had unsupported image format. filename='%s'", pFilename);
+		return false;
+	}
+
+	pImg->m_pData = pImgBuffer;
+
+	if(ImageFormat == IMAGE_FORMAT_RGB) // ignore_convention
+		pImg->m_Format = CImageInfo::FORMAT_RGB;
+	else if(ImageFormat == IMAGE_FORMAT_RGBA) // ignore_convention
+		pImg->m_Format = CImageInfo::FORMAT_RGBA;
+	else
+	{
+		free(pImgBuffer);
+		return false;
+	}
+	return true;
 }
 
+class CTextureLoadJob : public IJob
+{
+	IStorage *m_pStorage;
+	char m_aFilename[IO_MAX_PATH_LENGTH];
+	int m_StorageType;
+
+	void Run() override
+	{
+		CImageInfo Img;
+		if(!DecodePNGFile(m_pStorage, &Img, m_aFilename, m_StorageType, m_PngliteIncompatible))
+			return;
+
+		m_Width = Img.m_Width;
+		m_Height = Img.m_Height;
+		m_pData = malloc(m_Width * m_Height * 4);
+		m_Converted = !ConvertToRGBA((uint8_t *)m_pData, (const uint8_t *)Img.m_pData, m_Width, m_Height, Img.m_Format);
+		free(Img.m_pData);
+		m_Success = true;
+	}
+
+public:
+	bool m_Success = false;
+	bool m_Converted = false;
+	int m_PngliteIncompatible = 0;
+	size_t m_Width = 0;
+	size_t m_Height = 0;
+	void *m_pData = nullptr;
+
+	CTextureLoadJob(IStorage *pStorage, const char *pFilename, int StorageType) :
+		m_pStorage(pStorage), m_StorageType(StorageType)
+	{
+		str_copy(m_aFilename, pFilename);
+	}
+
+	~CTextureLoadJob()
+	{
+		free(m_pData);
+	}
+};
+
 // simple uncompressed RGBA loaders
 IGraphics::CTextureHandle CGraphics_Threaded::LoadTexture(const char *pFilename, int StorageType, int StoreFormat, int Flags)
 {
@@ -525,6 +652,79 @@ IGraphics::CTextureHandle CGraphics_Threaded::LoadTexture(const char *pFilename,
 	return m_InvalidTexture;
 }
 
+IGraphics::CTextureHandle CGraphics_Threaded::LoadTextureAsync(const char *pFilename, int StorageType, int StoreFormat, int Flags)
+{
+	dbg_assert(pFilename[0] != '\0', "Cannot load texture from file with empty filename");
+
+#ifdef CONF_DEBUG
+	if(g_Config.m_DbgStress && m_InvalidTexture.IsValid())
+		return m_InvalidTexture;
+#endif
+
+	// the placeholder must be valid for all requested texture targets
+	IGraphics::CTextureHandle TextureHandle = FindFreeTextureIndex();
+	AddTextureCreateCmd(TextureHandle.Id(), INVALID_TEXTURE_DIMENSION, INVALID_TEXTURE_DIMENSION, Flags | IGraphics::TEXLOAD_NOMIPMAPS, calloc(INVALID_TEXTURE_DIMENSION * INVALID_TEXTURE_DIMENSION, 4));
+
+	SPendingTextureUpload Upload;
+	Upload.m_Handle = TextureHandle;
+	Upload.m_Flags = Flags;
+	str_copy(Upload.m_aFilename, pFilename);
+	Upload.m_pJob = std::make_shared<CTextureLoadJob>(m_pStorage, pFilename, StorageType);
+	m_pEngine->AddJob(Upload.m_pJob);
+	m_vPendingTextureUploads.push_back(Upload);
+
+	return TextureHandle;
+}
+
+void CGraphics_Threaded::UpdatePendingTextureUploads()
+{
+	// limit the uploaded bytes per frame, so that a map or skin refresh doesn't stall a single frame
+	const size_t Budget = (size_t)g_Config.m_GfxAsyncTextureUploadBudget * 1024;
+	size_t Uploaded = 0;
+	for(auto It = m_vPendingTextureUploads.begin(); It != m_vPendingTextureUploads.end();)
+	{
+		CTextureLoadJob *pJob = It->m_pJob.get();
+		if(pJob->Status() != IJob::STATE_DONE)
+		{
+			++It;
+			continue;
+		}
+
+		if(pJob->m_Success)
+		{
+			const size_t Size = pJob->m_Width * pJob->m_Height * 4;
+			if(Budget != 0 && Uploaded != 0 && Uploaded + Size > Budget)
+				break;
+			Uploaded += Size;
+
+			ReportPngliteIncompatible(It->m_aFilename, pJob->m_PngliteIncompatible);
+			CheckTextureDimensions(pJob->m_Width, pJob->m_Height, It->m_Flags, It->m_aFilename);
+			if(pJob->m_Converted)
+				dbg_msg("graphics", "converted image %s to RGBA, consider making its file format RGBA", It->m_aFilename);
+
+			CCommandBuffer::SCommand_Texture_Destroy Cmd;
+			Cmd.m_Slot = It->m_Handle.Id();
+			AddCmd(Cmd);
+			AddTextureCreateCmd(It->m_Handle.Id(), pJob->m_Width, pJob->m_Height, It->m_Flags, pJob->m_pData);
+			pJob->m_pData = nullptr;
+
+			if(g_Config.m_Debug)
+				dbg_msg("graphics/texture", "loaded %s", It->m_aFilename);
+		}
+		else
+		{
+			// show the same pattern as the invalid texture instead of nothing
+			CCommandBuffer::SCommand_Texture_Destroy Cmd;
+			Cmd.m_Slot = It->m_Handle.Id();
+			AddCmd(Cmd);
+			unsigned char *pData = (unsigned char *)malloc(INVALID_TEXTURE_DIMENSION * INVALID_TEXTURE_DIMENSION * 4);
+			FillInvalidTextureData(pData);
+			AddTextureCreateCmd(It->m_Handle.Id(), INVALID_TEXTURE_DIMENSION, INVALID_TEXTURE_DIMENSION, It->m_Flags | IGraphics::TEXLOAD_NOMIPMAPS, pData);
+		}
+		It = m_vPendingTextureUploads.erase(It);
+	}
+}
+
 IGraphics::CTextureHandle CGraphics_Threaded::InvalidTexture() const
 {
 	return m_InvalidTexture;
@@ -587,76 +787,48 @@ bool CGraphics_Threaded::UpdateTextTexture(CTextureHandle TextureID, int x, int
 
 int CGraphics_Threaded::LoadPNG(CImageInfo *pImg, const char *pFilename, int StorageType)
 {
-	char aCompleteFilename[IO_MAX_PATH_LENGTH];
-	IOHANDLE File = m_pStorage->OpenFile(pFilename, IOFLAG_READ, StorageType, aCompleteFilename, sizeof(aCompleteFilename));
-	if(File)
-	{
-		io_seek(File, 0, IOSEEK_END);
-		unsigned int FileSize = io_tell(File);
-		io_seek(File, 0, IOSEEK_START);
+	int PngliteIncompatible = 0;
+	if(!DecodePNGFile(m_pStorage, pImg, pFilename, StorageType, PngliteIncompatible))
+		return 0;
 
-		TImageByteBuffer ByteBuffer;
-		SImageByteBuffer ImageByteBuffer(&ByteBuffer);
+	ReportPngliteIncompatible(pFilename, PngliteIncompatible);
+	return 1;
+}
 
-		ByteBuffer.resize(FileSize);
-		io_read(File, &ByteBuffer.front(), FileSize);
+bool CGraphics_Threaded::DecodePNG(CImageInfo *pImg, const char *pFilename, int StorageType, int &PngliteIncompatible)
+{
+	PngliteIncompatible = 0;
+	return DecodePNGFile(m_pStorage, pImg, pFilename, StorageType, PngliteIncompatible);
+}
 
-		io_close(File);
+void CGraphics_Threaded::ReportPngliteIncompatible(const char *pFilename, int PngliteIncompatible)
+{
+	if(m_WarnPngliteIncompatibleImages && PngliteIncompatible != 0)
+		AddPngliteIncompatibleWarning(pFilename, PngliteIncompatible);
+}
 
-		uint8_t *pImgBuffer = NULL;
-		EImageFormat ImageFormat;
-		int PngliteIncompatible;
-		if(::LoadPNG(ImageByteBuffer, pFilename, PngliteIncompatible, pImg->m_Width, pImg->m_Height, pImgBuffer, ImageFormat))
-		{
-			pImg->m_pData = pImgBuffer;
+void CGraphics_Threaded::AddPngliteIncompatibleWarning(const char *pFilename, int PngliteIncompatible)
+{
+	SWarning Warning;
+	str_format(Warning.m_aWarningMsg, sizeof(Warning.m_aWarningMsg), Localize("\"%s\" is not compatible with pnglite and cannot be loaded by old DDNet versions: "), pFilename);
+	static const int FLAGS[] = {PNGLITE_COLOR_TYPE, PNGLITE_BIT_DEPTH, PNGLITE_INTERLACE_TYPE, PNGLITE_COMPRESSION_TYPE, PNGLITE_FILTER_TYPE};
+	static const char *EXPLANATION[] = {"color type", "bit depth", "interlace type", "compression type", "filter type"};
 
-			if(ImageFormat == IMAGE_FORMAT_RGB) // ignore_convention
-				pImg->m_Format = CImageInfo::FORMAT_RGB;
-			else if(ImageFormat == IMAGE_FORMAT_RGBA) // ignore_convention
-				pImg->m_Format = CImageInfo::FORMAT_RGBA;
-			else
+	bool First = true;
+	for(size_t i = 0; i < std::size(FLAGS); ++i)
+	{
+		if((PngliteIncompatible & FLAGS[i]) != 0)
+		{
+			if(!First)
 			{
-				free(pImgBuffer);
-				return 0;
+				str_append(Warning.m_aWarningMsg, ", ");
 			}
-
-			if(m_WarnPngliteIncompatibleImages && PngliteIncompatible != 0)
-			{
-				SWarning Warning;
-				str_format(Warning.m_aWarningMsg, sizeof(Warning.m_aWarningMsg), Localize("\"%s\" is not compatible with pnglite and cannot be loaded by old DDNet versions: "), pFilename);
-				static const int FLAGS[] = {PNGLITE_COLOR_TYPE, PNGLITE_BIT_DEPTH, PNGLITE_INTERLACE_TYPE, PNGLITE_COMPRESSION_TYPE, PNGLITE_FILTER_TYPE};
-				static const char *EXPLANATION[] = {"color type", "bit depth", "interlace type", "compression type", "filter type"};
-
-				bool First = true;
-				for(size_t i = 0; i < std::size(FLAGS); ++i)
-				{
-					if((PngliteIncompatible & FLAGS[i]) != 0)
-					{
-						if(!First)
-						{
-							str_append(Warning.m_aWarningMsg, ", ");
-						}
-						str_append(Warning.m_aWarningMsg, EXPLANATION[i]);
-						First = false;
-					}
-				}
-				str_append(Warning.m_aWarningMsg, " unsupported");
-				m_vWarnings.emplace_back(Warning);
-			}
-		}
-		else
-		{
-			dbg_msg("game/png", "image had unsupported image format. filename='%s'", pFilename);
-			return 0;
+			str_append(Warning.m_aWarningMsg, EXPLANATION[i]);
+			First = false;
 		}
 	}
-	else
-	{
-		dbg_msg("game/png", "failed to open file. filename='%s'", pFilename);
-		return 0;
-	}
-
-	return 1;
+	str_append(Warning.m_aWarningMsg, " unsupported");
+	m_vWarnings.emplace_back(Warning);
 }
 
 void CGraphics_Threaded::FreePNG(CImageInfo *pImg)
@@ -2646,32 +2818,11 @@ int CGraphics_Threaded::Init()
 
 	// create null texture, will get id=0
 	{
-		const size_t PixelSize = 4;
-		const unsigned char aRed[] = {0xff, 0x00, 0x00, 0xff};
-		const unsigned char aGreen[] = {0x00, 0xff, 0x00, 0xff};
-		const unsigned char aBlue[] = {0x00, 0x00, 0xff, 0xff};
-		const unsigned char aYellow[] = {0xff, 0xff, 0x00, 0xff};
-		constexpr size_t InvalidTextureDimension = 16;
-		unsigned char aNullTextureData[InvalidTextureDimension * InvalidTextureDimension * PixelSize];
-		for(size_t y = 0; y < InvalidTextureDimension; ++y)
-		{
-			for(size_t x = 0; x < InvalidTextureDimension; ++x)
-			{
-				const unsigned char *pColor;
-				if(x < InvalidTextureDimension / 2 && y < InvalidTextureDimension / 2)
-					pColor = aRed;
-				else if(x >= InvalidTextureDimension / 2 && y < InvalidTextureDimension / 2)
-					pColor = aGreen;
-				else if(x < InvalidTextureDimension / 2 && y >= InvalidTextureDimension / 2)
-					pColor = aBlue;
-				else
-					pColor = aYellow;
-				mem_copy(&aNullTextureData[(y * InvalidTextureDimension + x) * PixelSize], pColor, PixelSize);
-			}
-		}
+		unsigned char aNullTextureData[INVALID_TEXTURE_DIMENSION * INVALID_TEXTURE_DIMENSION * 4];
+		FillInvalidTextureData(aNullTextureData);
 		const int TextureLoadFlags = HasTextureArrays() ? IGraphics::TEXLOAD_TO_2D_ARRAY_TEXTURE : IGraphics::TEXLOAD_TO_3D_TEXTURE;
 		m_InvalidTexture.Invalidate();
-		m_InvalidTexture = LoadTextureRaw(InvalidTextureDimension, InvalidTextureDimension, CImageInfo::FORMAT_RGBA, aNullTextureData, CImageInfo::FORMAT_RGBA, TextureLoadFlags);
+		m_InvalidTexture = LoadTextureRaw(INVALID_TEXTURE_DIMENSION, INVALID_TEXTURE_DIMENSION, CImageInfo::FORMAT_RGBA, aNullTextureData, CImageInfo::FORMAT_RGBA, TextureLoadFlags);
 	}
 
 	ColorRGBA GPUInfoPrintColor{0.6f, 0.5f, 1.0f, 1.0f};
@@ -2693,6 +2844,8 @@ int CGraphics_Threaded::Init()
 
 void CGraphics_Threaded::Shutdown()
 {
+	m_vPendingTextureUploads.clear();
+
 	// shutdown the backend
 	m_pBackend->Shutdown();
 	delete m_pBackend;
@@ -2923,6 +3076,8 @@ void CGraphics_Threaded::Swap()
 		}
 	}
 
+	UpdatePendingTextureUploads();
+
 	bool TookScreenshotAndSwapped = false;
 
 	if(m_DoScreenshot)
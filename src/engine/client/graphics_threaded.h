@@ -5,6 +5,7 @@
 #include <engine/shared/config.h>
 
 #include <cstddef>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -836,6 +837,15 @@ class CGraphics_Threaded : public IEngineGraphics
 
 	std::vector<SWarning> m_vWarnings;
 
+	struct SPendingTextureUpload
+	{
+		CTextureHandle m_Handle;
+		int m_Flags;
+		char m_aFilename[IO_MAX_PATH_LENGTH];
+		std::shared_ptr<class CTextureLoadJob> m_pJob;
+	};
+	std::vector<SPendingTextureUpload> m_vPendingTextureUploads;
+
 	// is a non full windowed (in a sense that the viewport won't include the whole window),
 	// forced viewport, so that it justifies our UI ratio needs
 	bool m_IsForcedViewport = false;
@@ -935,8 +945,6 @@ class CGraphics_Threaded : public IEngineGraphics
 		}
 	}
 
-	void KickCommandBuffer();
-
 	void AddBackEndWarningIfExists();
 
 	void AdjustViewport(bool SendViewportChangeToBackend);
@@ -947,6 +955,8 @@ class CGraphics_Threaded : public IEngineGraphics
 public:
 	CGraphics_Threaded();
 
+	void KickCommandBuffer();
+
 	void ClipEnable(int x, int y, int w, int h) override;
 	void ClipDisable() override;
 
@@ -973,6 +983,10 @@ public:
 
 	IGraphics::CTextureHandle FindFreeTextureIndex();
 	void FreeTextureIndex(CTextureHandle *pIndex);
+	void AddTextureCreateCmd(int Slot, size_t Width, size_t Height, int Flags, void *pRGBAData);
+	void CheckTextureDimensions(size_t Width, size_t Height, int Flags, const char *pTexName);
+	void AddPngliteIncompatibleWarning(const char *pFilename, int PngliteIncompatible);
+	void UpdatePendingTextureUploads();
 	int UnloadTexture(IGraphics::CTextureHandle *pIndex) override;
 	IGraphics::CTextureHandle LoadTextureRaw(size_t Width, size_t Height, int Format, const void *pData, int StoreFormat, int Flags, const char *pTexName = NULL) override;
 	int LoadTextureRawSub(IGraphics::CTextureHandle TextureID, int x, int y, size_t Width, size_t Height, int Format, const void *pData) override;
@@ -991,7 +1005,10 @@ public:
 
 	// simple uncompressed RGBA loaders
 	IGraphics::CTextureHandle LoadTexture(const char *pFilename, int StorageType, int StoreFormat, int Flags) override;
+	IGraphics::CTextureHandle LoadTextureAsync(const char *pFilename, int StorageType, int StoreFormat, int Flags) override;
 	int LoadPNG(CImageInfo *pImg, const char *pFilename, int StorageType) override;
+	bool DecodePNG(CImageInfo *pImg, const char *pFilename, int StorageType, int &PngliteIncompatible) override;
+	void ReportPngliteIncompatible(const char *pFilename, int PngliteIncompatible) override;
 	void FreePNG(CImageInfo *pImg) override;
 
 	bool CheckImageDivisibility(const char *pFileName, CImageInfo &Img, int DivX, int DivY, bool AllowResize) override;
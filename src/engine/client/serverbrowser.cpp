@@ -7,12 +7,14 @@
 
 #include <algorithm>
 #include <climits>
+#include <thread>
 #include <unordered_set>
 #include <vector>
 
 #include <base/hash_ctxt.h>
 #include <base/math.h>
 #include <base/system.h>
+#include <base/tl/threading.h>
 
 #include <engine/shared/config.h>
 #include <engine/shared/json.h>
@@ -34,38 +36,88 @@
 
 #include <game/client/components/menus.h> // PAGE_DDNET
 
-class CSortWrap
+static void AppendLowercase(std::string &Out, const char *pStr)
 {
-	typedef bool (CServerBrowser::*SortFunc)(int, int) const;
-	SortFunc m_pfnSort;
-	CServerBrowser *m_pThis;
+	char aEncoded[4];
+	while(*pStr)
+	{
+		const int Code = str_utf8_decode(&pStr);
+		if(Code < 0)
+			continue;
+		Out.append(aEncoded, str_utf8_encode(aEncoded, str_utf8_tolower(Code)));
+	}
+}
 
-public:
-	CSortWrap(CServerBrowser *pServer, SortFunc Func) :
-		m_pfnSort(Func), m_pThis(pServer) {}
-	bool operator()(int a, int b) { return (g_Config.m_BrSortOrder ? (m_pThis->*m_pfnSort)(b, a) : (m_pThis->*m_pfnSort)(a, b)); }
-};
+static std::string Lowercase(const char *pStr)
+{
+	std::string Result;
+	AppendLowercase(Result, pStr);
+	return Result;
+}
 
-bool matchesPart(const char *a, const char *b)
+static void ParseSearchTokens(const char *pStr, std::vector<CServerBrowser::CFilterContext::CToken> &vTokens)
 {
-	return str_utf8_find_nocase(a, b) != nullptr;
+	char aToken[sizeof(g_Config.m_BrFilterString)];
+	while((pStr = str_next_token(pStr, IServerBrowser::SEARCH_EXCLUDE_TOKEN, aToken, sizeof(aToken))))
+	{
+		if(aToken[0] == '\0')
+			continue;
+		CServerBrowser::CFilterContext::CToken Token;
+		const int Length = str_length(aToken);
+		Token.m_Exact = aToken[0] == '"' && aToken[Length - 1] == '"';
+		if(Token.m_Exact)
+		{
+			aToken[Length - 1] = '\0';
+			str_copy(Token.m_aExact, &aToken[1]);
+		}
+		else
+		{
+			Token.m_aExact[0] = '\0';
+			Token.m_Lower = Lowercase(aToken);
+		}
+		vTokens.push_back(Token);
+	}
 }
 
-bool matchesExactly(const char *a, const char *b)
+void CServerBrowser::CFilterContext::Init(const char *pFilter, const char *pExclude, const char *pGameType)
 {
-	return str_comp(a, &b[1]) == 0;
+	m_HasFilter = pFilter[0] != '\0';
+	m_vFilter.clear();
+	m_vExclude.clear();
+	ParseSearchTokens(pFilter, m_vFilter);
+	ParseSearchTokens(pExclude, m_vExclude);
+	m_GameType = Lowercase(pGameType);
 }
 
+class CFilterJob : public IJob
+{
+	CServerBrowser *m_pBrowser;
+	const CServerBrowser::CFilterContext *m_pContext;
+	CSemaphore *m_pDone;
+	int m_Start;
+	int m_End;
+
+	void Run() override
+	{
+		for(int i = m_Start; i < m_End; i++)
+			m_pBrowser->m_vFilterVisible[i] = m_pBrowser->FilterEntry(i, *m_pContext);
+		m_pDone->Signal();
+	}
+
+public:
+	CFilterJob(CServerBrowser *pBrowser, const CServerBrowser::CFilterContext *pContext, CSemaphore *pDone, int Start, int End) :
+		m_pBrowser(pBrowser), m_pContext(pContext), m_pDone(pDone), m_Start(Start), m_End(End) {}
+};
+
 CServerBrowser::CServerBrowser()
 {
 	m_ppServerlist = nullptr;
 	m_pSortedServerlist = nullptr;
 
-	m_pFirstReqServer = nullptr; // request list
-	m_pLastReqServer = nullptr;
-	m_NumRequests = 0;
+	m_PingScheduler.Reset(g_Config.m_BrMaxRequests);
 
 	m_NeedResort = false;
+	m_NeedPingResort = false;
 
 	m_NumSortedServers = 0;
 	m_NumSortedServersCapacity = 0;
@@ -185,12 +237,17 @@ const CServerInfo *CServerBrowser::SortedGet(int Index) const
 	return &m_ppServerlist[m_pSortedServerlist[Index]]->m_Info;
 }
 
-int CServerBrowser::GenerateToken(const NETADDR &Addr) const
+int CServerBrowser::GenerateToken(const NETADDR &Addr, int Attempt) const
 {
 	SHA256_CTX Sha256;
 	sha256_init(&Sha256);
 	sha256_update(&Sha256, m_aTokenSeed, sizeof(m_aTokenSeed));
 	sha256_update(&Sha256, (unsigned char *)&Addr, sizeof(Addr));
+	if(Attempt)
+	{
+		const unsigned char AttemptByte = Attempt;
+		sha256_update(&Sha256, &AttemptByte, sizeof(AttemptByte));
+	}
 	SHA256_DIGEST Digest = sha256_finish(&Sha256);
 	return (Digest.data[0] << 16) | (Digest.data[1] << 8) | Digest.data[2];
 }
@@ -205,61 +262,108 @@ int CServerBrowser::GetExtraToken(int Token)
 	return Token >> 8;
 }
 
-bool CServerBrowser::SortCompareName(int Index1, int Index2) const
+bool CServerBrowser::FilterEntry(int Index, const CFilterContext &Context)
 {
-	CServerEntry *pIndex1 = m_ppServerlist[Index1];
-	CServerEntry *pIndex2 = m_ppServerlist[Index2];
-	//	make sure empty entries are listed last
-	return (pIndex1->m_GotInfo && pIndex2->m_GotInfo) || (!pIndex1->m_GotInfo && !pIndex2->m_GotInfo) ? str_comp(pIndex1->m_Info.m_aName, pIndex2->m_Info.m_aName) < 0 :
-													    pIndex1->m_GotInfo != 0;
-}
+	CServerInfo &Info = m_ppServerlist[Index]->m_Info;
+	const CSearchKeys &Keys = m_vSearchKeys[Index];
+	const int NumClients = minimum(Info.m_NumClients, (int)MAX_CLIENTS);
+
+	if(g_Config.m_BrFilterEmpty && Info.m_NumFilteredPlayers == 0)
+		return false;
+	else if(g_Config.m_BrFilterFull && Players(Info) == Max(Info))
+		return false;
+	else if(g_Config.m_BrFilterPw && Info.m_Flags & SERVER_FLAG_PASSWORD)
+		return false;
+	else if(g_Config.m_BrFilterServerAddress[0] && !str_find_nocase(Info.m_aAddress, g_Config.m_BrFilterServerAddress))
+		return false;
+	else if(g_Config.m_BrFilterGametypeStrict && g_Config.m_BrFilterGametype[0] && str_comp_nocase(Info.m_aGameType, g_Config.m_BrFilterGametype))
+		return false;
+	else if(!g_Config.m_BrFilterGametypeStrict && g_Config.m_BrFilterGametype[0] && !str_find(Keys.m_GameType.c_str(), Context.m_GameType.c_str()))
+		return false;
+	else if(g_Config.m_BrFilterUnfinishedMap && Info.m_HasRank == 1)
+		return false;
+
+	if(g_Config.m_BrFilterCountry)
+	{
+		// match against player country
+		bool Found = false;
+		for(int p = 0; p < NumClients && !Found; p++)
+			Found = Info.m_aClients[p].m_Country == g_Config.m_BrFilterCountryIndex;
+		if(!Found)
+			return false;
+	}
 
-bool CServerBrowser::SortCompareMap(int Index1, int Index2) const
-{
-	CServerEntry *pIndex1 = m_ppServerlist[Index1];
-	CServerEntry *pIndex2 = m_ppServerlist[Index2];
-	return str_comp(pIndex1->m_Info.m_aMap, pIndex2->m_Info.m_aMap) < 0;
-}
+	if(Context.m_HasFilter)
+	{
+		Info.m_QuickSearchHit = QuickSearchHit(Info, Keys, Context, g_Config.m_BrFilterConnectingPlayers);
+		if(!Info.m_QuickSearchHit)
+			return false;
+	}
 
-bool CServerBrowser::SortComparePing(int Index1, int Index2) const
-{
-	CServerEntry *pIndex1 = m_ppServerlist[Index1];
-	CServerEntry *pIndex2 = m_ppServerlist[Index2];
-	return pIndex1->m_Info.m_Latency < pIndex2->m_Info.m_Latency;
-}
+	if(Excluded(Info, Keys, Context))
+		return false;
 
-bool CServerBrowser::SortCompareGametype(int Index1, int Index2) const
-{
-	CServerEntry *pIndex1 = m_ppServerlist[Index1];
-	CServerEntry *pIndex2 = m_ppServerlist[Index2];
-	return str_comp(pIndex1->m_Info.m_aGameType, pIndex2->m_Info.m_aGameType) < 0;
-}
+	// check for friend
+	Info.m_FriendState = IFriends::FRIEND_NO;
+	for(int p = 0; p < NumClients; p++)
+	{
+		Info.m_aClients[p].m_FriendState = m_pFriends->GetFriendState(Info.m_aClients[p].m_aName, Info.m_aClients[p].m_aClan);
+		Info.m_FriendState = maximum(Info.m_FriendState, Info.m_aClients[p].m_FriendState);
+	}
 
-bool CServerBrowser::SortCompareNumPlayers(int Index1, int Index2) const
-{
-	CServerEntry *pIndex1 = m_ppServerlist[Index1];
-	CServerEntry *pIndex2 = m_ppServerlist[Index2];
-	return pIndex1->m_Info.m_NumFilteredPlayers > pIndex2->m_Info.m_NumFilteredPlayers;
+	return !g_Config.m_BrFilterFriends || Info.m_FriendState != IFriends::FRIEND_NO;
 }
 
-bool CServerBrowser::SortCompareNumClients(int Index1, int Index2) const
+int CServerBrowser::QuickSearchHit(const CServerInfo &Info, const CSearchKeys &Keys, const CFilterContext &Context, bool FilterConnectingPlayers)
 {
-	CServerEntry *pIndex1 = m_ppServerlist[Index1];
-	CServerEntry *pIndex2 = m_ppServerlist[Index2];
-	return pIndex1->m_Info.m_NumClients > pIndex2->m_Info.m_NumClients;
+	const int NumClients = minimum(Info.m_NumClients, (int)MAX_CLIENTS);
+	int Hit = 0;
+	for(const auto &Token : Context.m_vFilter)
+	{
+		// match against server name
+		if(Token.Matches(Info.m_aName, Keys.m_Name))
+			Hit |= IServerBrowser::QUICK_SERVERNAME;
+
+		// match against players
+		if(Token.m_Exact)
+		{
+			for(int p = 0; p < NumClients; p++)
+			{
+				if(str_comp(Info.m_aClients[p].m_aName, Token.m_aExact) == 0 || str_comp(Info.m_aClients[p].m_aClan, Token.m_aExact) == 0)
+				{
+					if(FilterConnectingPlayers &&
+						str_comp(Info.m_aClients[p].m_aName, "(connecting)") == 0 &&
+						Info.m_aClients[p].m_aClan[0] == '\0')
+					{
+						continue;
+					}
+					Hit |= IServerBrowser::QUICK_PLAYER;
+					break;
+				}
+			}
+		}
+		else if(str_find(Keys.m_Players.c_str(), Token.m_Lower.c_str()) ||
+			(!FilterConnectingPlayers && Keys.m_HasConnectingPlayers && str_find("(connecting)", Token.m_Lower.c_str())))
+		{
+			Hit |= IServerBrowser::QUICK_PLAYER;
+		}
+
+		// match against map
+		if(Token.Matches(Info.m_aMap, Keys.m_Map))
+			Hit |= IServerBrowser::QUICK_MAPNAME;
+	}
+	return Hit;
 }
 
-bool CServerBrowser::SortCompareNumPlayersAndPing(int Index1, int Index2) const
+bool CServerBrowser::Excluded(const CServerInfo &Info, const CSearchKeys &Keys, const CFilterContext &Context)
 {
-	CServerEntry *pIndex1 = m_ppServerlist[Index1];
-	CServerEntry *pIndex2 = m_ppServerlist[Index2];
-
-	if(pIndex1->m_Info.m_NumFilteredPlayers == pIndex2->m_Info.m_NumFilteredPlayers)
-		return pIndex1->m_Info.m_Latency > pIndex2->m_Info.m_Latency;
-	else if(pIndex1->m_Info.m_NumFilteredPlayers == 0 || pIndex2->m_Info.m_NumFilteredPlayers == 0 || pIndex1->m_Info.m_Latency / 100 == pIndex2->m_Info.m_Latency / 100)
-		return pIndex1->m_Info.m_NumFilteredPlayers < pIndex2->m_Info.m_NumFilteredPlayers;
-	else
-		return pIndex1->m_Info.m_Latency > pIndex2->m_Info.m_Latency;
+	for(const auto &Token : Context.m_vExclude)
+	{
+		// match against server name, map and gametype
+		if(Token.Matches(Info.m_aName, Keys.m_Name) || Token.Matches(Info.m_aMap, Keys.m_Map) || Token.Matches(Info.m_aGameType, Keys.m_GameType))
+			return true;
+	}
+	return false;
 }
 
 void CServerBrowser::Filter()
@@ -274,151 +378,65 @@ void CServerBrowser::Filter()
 		m_pSortedServerlist = (int *)calloc(m_NumSortedServersCapacity, sizeof(int));
 	}
 
-	// filter the servers
-	for(int i = 0; i < m_NumServers; i++)
+	CFilterContext Context;
+	Context.Init(g_Config.m_BrFilterString, g_Config.m_BrExcludeString, g_Config.m_BrFilterGametype);
+
+	// filter the servers, large lists are split across the filter threads
+	m_vFilterVisible.resize(m_NumServers);
+	CSemaphore JobsDone;
+	int NumJobs = 0;
+	int MainEnd = m_NumServers;
+	if(m_NumServers >= PARALLEL_FILTER_MIN_SERVERS)
 	{
-		bool Filtered = false;
-
-		if(g_Config.m_BrFilterEmpty && m_ppServerlist[i]->m_Info.m_NumFilteredPlayers == 0)
-			Filtered = true;
-		else if(g_Config.m_BrFilterFull && Players(m_ppServerlist[i]->m_Info) == Max(m_ppServerlist[i]->m_Info))
-			Filtered = true;
-		else if(g_Config.m_BrFilterPw && m_ppServerlist[i]->m_Info.m_Flags & SERVER_FLAG_PASSWORD)
-			Filtered = true;
-		else if(g_Config.m_BrFilterServerAddress[0] && !str_find_nocase(m_ppServerlist[i]->m_Info.m_aAddress, g_Config.m_BrFilterServerAddress))
-			Filtered = true;
-		else if(g_Config.m_BrFilterGametypeStrict && g_Config.m_BrFilterGametype[0] && str_comp_nocase(m_ppServerlist[i]->m_Info.m_aGameType, g_Config.m_BrFilterGametype))
-			Filtered = true;
-		else if(!g_Config.m_BrFilterGametypeStrict && g_Config.m_BrFilterGametype[0] && !str_utf8_find_nocase(m_ppServerlist[i]->m_Info.m_aGameType, g_Config.m_BrFilterGametype))
-			Filtered = true;
-		else if(g_Config.m_BrFilterUnfinishedMap && m_ppServerlist[i]->m_Info.m_HasRank == 1)
-			Filtered = true;
-		else
+		if(!m_NumFilterThreads)
 		{
-			if(g_Config.m_BrFilterCountry)
-			{
-				Filtered = true;
-				// match against player country
-				for(int p = 0; p < minimum(m_ppServerlist[i]->m_Info.m_NumClients, (int)MAX_CLIENTS); p++)
-				{
-					if(m_ppServerlist[i]->m_Info.m_aClients[p].m_Country == g_Config.m_BrFilterCountryIndex)
-					{
-						Filtered = false;
-						break;
-					}
-				}
-			}
-
-			if(!Filtered && g_Config.m_BrFilterString[0] != '\0')
-			{
-				m_ppServerlist[i]->m_Info.m_QuickSearchHit = 0;
-
-				const char *pStr = g_Config.m_BrFilterString;
-				char aFilterStr[sizeof(g_Config.m_BrFilterString)];
-				while((pStr = str_next_token(pStr, IServerBrowser::SEARCH_EXCLUDE_TOKEN, aFilterStr, sizeof(aFilterStr))))
-				{
-					if(aFilterStr[0] == '\0')
-					{
-						continue;
-					}
-					auto MatchesFn = matchesPart;
-					const int FilterLen = str_length(aFilterStr);
-					if(aFilterStr[0] == '"' && aFilterStr[FilterLen - 1] == '"')
-					{
-						aFilterStr[FilterLen - 1] = '\0';
-						MatchesFn = matchesExactly;
-					}
-
-					// match against server name
-					if(MatchesFn(m_ppServerlist[i]->m_Info.m_aName, aFilterStr))
-					{
-						m_ppServerlist[i]->m_Info.m_QuickSearchHit |= IServerBrowser::QUICK_SERVERNAME;
-					}
-
-					// match against players
-					for(int p = 0; p < minimum(m_ppServerlist[i]->m_Info.m_NumClients, (int)MAX_CLIENTS); p++)
-					{
-						if(MatchesFn(m_ppServerlist[i]->m_Info.m_aClients[p].m_aName, aFilterStr) ||
-							MatchesFn(m_ppServerlist[i]->m_Info.m_aClients[p].m_aClan, aFilterStr))
-						{
-							if(g_Config.m_BrFilterConnectingPlayers &&
-								str_comp(m_ppServerlist[i]->m_Info.m_aClients[p].m_aName, "(connecting)") == 0 &&
-								m_ppServerlist[i]->m_Info.m_aClients[p].m_aClan[0] == '\0')
-							{
-								continue;
-							}
-							m_ppServerlist[i]->m_Info.m_QuickSearchHit |= IServerBrowser::QUICK_PLAYER;
-							break;
-						}
-					}
-
-					// match against map
-					if(MatchesFn(m_ppServerlist[i]->m_Info.m_aMap, aFilterStr))
-					{
-						m_ppServerlist[i]->m_Info.m_QuickSearchHit |= IServerBrowser::QUICK_MAPNAME;
-					}
-				}
-
-				if(!m_ppServerlist[i]->m_Info.m_QuickSearchHit)
-					Filtered = true;
-			}
-
-			if(!Filtered && g_Config.m_BrExcludeString[0] != '\0')
-			{
-				const char *pStr = g_Config.m_BrExcludeString;
-				char aExcludeStr[sizeof(g_Config.m_BrExcludeString)];
-				while((pStr = str_next_token(pStr, IServerBrowser::SEARCH_EXCLUDE_TOKEN, aExcludeStr, sizeof(aExcludeStr))))
-				{
-					if(aExcludeStr[0] == '\0')
-					{
-						continue;
-					}
-					auto MatchesFn = matchesPart;
-					const int FilterLen = str_length(aExcludeStr);
-					if(aExcludeStr[0] == '"' && aExcludeStr[FilterLen - 1] == '"')
-					{
-						aExcludeStr[FilterLen - 1] = '\0';
-						MatchesFn = matchesExactly;
-					}
-
-					// match against server name
-					if(MatchesFn(m_ppServerlist[i]->m_Info.m_aName, aExcludeStr))
-					{
-						Filtered = true;
-						break;
-					}
+			m_NumFilterThreads = clamp((int)std::thread::hardware_concurrency() - 1, 1, (int)MAX_FILTER_THREADS);
+			m_FilterPool.Init(m_NumFilterThreads);
+		}
+		const int ChunkSize = (m_NumServers + m_NumFilterThreads) / (m_NumFilterThreads + 1);
+		MainEnd = ChunkSize;
+		for(int Start = ChunkSize; Start < m_NumServers; Start += ChunkSize)
+		{
+			m_FilterPool.Add(std::make_shared<CFilterJob>(this, &Context, &JobsDone, Start, minimum(Start + ChunkSize, m_NumServers)));
+			NumJobs++;
+		}
+	}
+	for(int i = 0; i < MainEnd; i++)
+		m_vFilterVisible[i] = FilterEntry(i, Context);
+	for(int i = 0; i < NumJobs; i++)
+		JobsDone.Wait();
 
-					// match against map
-					if(MatchesFn(m_ppServerlist[i]->m_Info.m_aMap, aExcludeStr))
-					{
-						Filtered = true;
-						break;
-					}
+	for(int i = 0; i < m_NumServers; i++)
+	{
+		if(m_vFilterVisible[i])
+			m_pSortedServerlist[m_NumSortedServers++] = i;
+	}
+}
 
-					// match against gametype
-					if(MatchesFn(m_ppServerlist[i]->m_Info.m_aGameType, aExcludeStr))
-					{
-						Filtered = true;
-						break;
-					}
-				}
-			}
-		}
+void CServerBrowser::UpdateSearchKeys(const CServerEntry *pEntry)
+{
+	FillSearchKeys(pEntry->m_Info, m_vSearchKeys[pEntry->m_Info.m_ServerIndex]);
+}
 
-		if(!Filtered)
+void CServerBrowser::FillSearchKeys(const CServerInfo &Info, CSearchKeys &Keys)
+{
+	Keys.m_Name = Lowercase(Info.m_aName);
+	Keys.m_Map = Lowercase(Info.m_aMap);
+	Keys.m_GameType = Lowercase(Info.m_aGameType);
+	Keys.m_Players.clear();
+	Keys.m_HasConnectingPlayers = false;
+	for(int p = 0; p < minimum(Info.m_NumClients, (int)MAX_CLIENTS); p++)
+	{
+		const CServerInfo::CClient &Client = Info.m_aClients[p];
+		if(str_comp(Client.m_aName, "(connecting)") == 0 && Client.m_aClan[0] == '\0')
 		{
-			// check for friend
-			m_ppServerlist[i]->m_Info.m_FriendState = IFriends::FRIEND_NO;
-			for(int p = 0; p < minimum(m_ppServerlist[i]->m_Info.m_NumClients, (int)MAX_CLIENTS); p++)
-			{
-				m_ppServerlist[i]->m_Info.m_aClients[p].m_FriendState = m_pFriends->GetFriendState(m_ppServerlist[i]->m_Info.m_aClients[p].m_aName,
-					m_ppServerlist[i]->m_Info.m_aClients[p].m_aClan);
-				m_ppServerlist[i]->m_Info.m_FriendState = maximum(m_ppServerlist[i]->m_Info.m_FriendState, m_ppServerlist[i]->m_Info.m_aClients[p].m_FriendState);
-			}
-
-			if(!g_Config.m_BrFilterFriends || m_ppServerlist[i]->m_Info.m_FriendState != IFriends::FRIEND_NO)
-				m_pSortedServerlist[m_NumSortedServers++] = i;
+			Keys.m_HasConnectingPlayers = true;
+			continue;
 		}
+		AppendLowercase(Keys.m_Players, Client.m_aName);
+		Keys.m_Players += '\n';
+		AppendLowercase(Keys.m_Players, Client.m_aClan);
+		Keys.m_Players += '\n';
 	}
 }
 
@@ -451,6 +469,98 @@ void SetFilteredPlayers(const CServerInfo &Item)
 	}
 }
 
+int CServerBrowser::FillSortKeys()
+{
+	const bool PlayersAndPing = g_Config.m_BrSortOrder == 2 && (g_Config.m_BrSort == IServerBrowser::SORT_NUMPLAYERS || g_Config.m_BrSort == IServerBrowser::SORT_PING);
+	// the keys are in the order of the sorted list since the last sort
+	const bool Compare = (int)m_vSortKeys.size() == m_NumSortedServers;
+	int NumChanged = Compare ? 0 : m_NumSortedServers;
+	m_vSortKeys.resize(m_NumSortedServers);
+	for(int i = 0; i < m_NumSortedServers; i++)
+	{
+		const CServerEntry *pEntry = m_ppServerlist[m_pSortedServerlist[i]];
+		const CServerInfo &Info = pEntry->m_Info;
+		CSortKey Key;
+		Key.m_Index = m_pSortedServerlist[i];
+		Key.m_Key1 = 0;
+		Key.m_Key2 = 0;
+		Key.m_pStr = nullptr;
+		if(PlayersAndPing)
+		{
+			Key.m_Key1 = Info.m_NumFilteredPlayers;
+			Key.m_Key2 = Info.m_Latency;
+		}
+		else if(g_Config.m_BrSort == IServerBrowser::SORT_NAME)
+		{
+			// make sure empty entries are listed last
+			Key.m_Key1 = pEntry->m_GotInfo ? 0 : 1;
+			Key.m_pStr = Info.m_aName;
+		}
+		else if(g_Config.m_BrSort == IServerBrowser::SORT_PING)
+			Key.m_Key1 = Info.m_Latency;
+		else if(g_Config.m_BrSort == IServerBrowser::SORT_MAP)
+			Key.m_pStr = Info.m_aMap;
+		else if(g_Config.m_BrSort == IServerBrowser::SORT_NUMPLAYERS)
+			Key.m_Key1 = -Info.m_NumFilteredPlayers;
+		else if(g_Config.m_BrSort == IServerBrowser::SORT_GAMETYPE)
+			Key.m_pStr = Info.m_aGameType;
+
+		const CSortKey &Old = m_vSortKeys[i];
+		if(Compare && (Old.m_Index != Key.m_Index || Old.m_Key1 != Key.m_Key1 || Old.m_Key2 != Key.m_Key2 || Old.m_pStr != Key.m_pStr))
+			NumChanged++;
+		m_vSortKeys[i] = Key;
+	}
+	return NumChanged;
+}
+
+static bool SortKeyLess(const CServerBrowser::CSortKey &Key1, const CServerBrowser::CSortKey &Key2)
+{
+	if(Key1.m_Key1 != Key2.m_Key1)
+		return Key1.m_Key1 < Key2.m_Key1;
+	return Key1.m_pStr && str_comp(Key1.m_pStr, Key2.m_pStr) < 0;
+}
+
+static bool SortKeyLessPlayersAndPing(const CServerBrowser::CSortKey &Key1, const CServerBrowser::CSortKey &Key2)
+{
+	// m_Key1 is the number of players, m_Key2 the latency
+	if(Key1.m_Key1 == Key2.m_Key1)
+		return Key1.m_Key2 > Key2.m_Key2;
+	else if(Key1.m_Key1 == 0 || Key2.m_Key1 == 0 || Key1.m_Key2 / 100 == Key2.m_Key2 / 100)
+		return Key1.m_Key1 < Key2.m_Key1;
+	else
+		return Key1.m_Key2 > Key2.m_Key2;
+}
+
+template<class F>
+static void InsertionSort(CServerBrowser::CSortKey *pKeys, int Num, F &&Less)
+{
+	for(int i = 1; i < Num; i++)
+	{
+		CServerBrowser::CSortKey Key = pKeys[i];
+		int j = i;
+		for(; j > 0 && Less(Key, pKeys[j - 1]); j--)
+			pKeys[j] = pKeys[j - 1];
+		pKeys[j] = Key;
+	}
+}
+
+void CServerBrowser::SortKeys(std::vector<CSortKey> &vKeys, int Sort, int SortOrder, int NumChanged)
+{
+	const bool PlayersAndPing = SortOrder == 2 && (Sort == IServerBrowser::SORT_NUMPLAYERS || Sort == IServerBrowser::SORT_PING);
+	auto &&Less = PlayersAndPing ? SortKeyLessPlayersAndPing : SortKeyLess;
+	auto &&Compare = [&](const CSortKey &Key1, const CSortKey &Key2) {
+		return SortOrder ? Less(Key2, Key1) : Less(Key1, Key2);
+	};
+
+	// with few changed keys the list is almost sorted, the insertion sort
+	// then moves each of them in one pass
+	const int Num = vKeys.size();
+	if(NumChanged >= 0 && NumChanged <= maximum(Num / (int)RESORT_CHANGED_DIVISOR, (int)RESORT_MIN_CHANGED))
+		InsertionSort(vKeys.data(), Num, Compare);
+	else
+		std::stable_sort(vKeys.begin(), vKeys.end(), Compare);
+}
+
 void CServerBrowser::Sort()
 {
 	// fill m_NumFilteredPlayers
@@ -463,42 +573,37 @@ void CServerBrowser::Sort()
 	Filter();
 
 	// sort
-	if(g_Config.m_BrSortOrder == 2 && (g_Config.m_BrSort == IServerBrowser::SORT_NUMPLAYERS || g_Config.m_BrSort == IServerBrowser::SORT_PING))
-		std::stable_sort(m_pSortedServerlist, m_pSortedServerlist + m_NumSortedServers, CSortWrap(this, &CServerBrowser::SortCompareNumPlayersAndPing));
-	else if(g_Config.m_BrSort == IServerBrowser::SORT_NAME)
-		std::stable_sort(m_pSortedServerlist, m_pSortedServerlist + m_NumSortedServers, CSortWrap(this, &CServerBrowser::SortCompareName));
-	else if(g_Config.m_BrSort == IServerBrowser::SORT_PING)
-		std::stable_sort(m_pSortedServerlist, m_pSortedServerlist + m_NumSortedServers, CSortWrap(this, &CServerBrowser::SortComparePing));
-	else if(g_Config.m_BrSort == IServerBrowser::SORT_MAP)
-		std::stable_sort(m_pSortedServerlist, m_pSortedServerlist + m_NumSortedServers, CSortWrap(this, &CServerBrowser::SortCompareMap));
-	else if(g_Config.m_BrSort == IServerBrowser::SORT_NUMPLAYERS)
-		std::stable_sort(m_pSortedServerlist, m_pSortedServerlist + m_NumSortedServers, CSortWrap(this, &CServerBrowser::SortCompareNumPlayers));
-	else if(g_Config.m_BrSort == IServerBrowser::SORT_GAMETYPE)
-		std::stable_sort(m_pSortedServerlist, m_pSortedServerlist + m_NumSortedServers, CSortWrap(this, &CServerBrowser::SortCompareGametype));
+	FillSortKeys();
+	SortKeys(m_vSortKeys, g_Config.m_BrSort, g_Config.m_BrSortOrder, -1);
+	for(int i = 0; i < m_NumSortedServers; i++)
+		m_pSortedServerlist[i] = m_vSortKeys[i].m_Index;
 
 	str_copy(m_aFilterGametypeString, g_Config.m_BrFilterGametype);
 	str_copy(m_aFilterString, g_Config.m_BrFilterString);
 	m_Sorthash = SortHash();
+	m_NeedPingResort = false;
+
+	// request the servers that are shown first
+	if(m_PingScheduler.NumPending())
+	{
+		for(int i = 0; i < m_NumSortedServers; i++)
+			m_PingScheduler.SetPriority(m_pSortedServerlist[i], CServerBrowserPingScheduler::PRIORITY_HIGH);
+	}
 }
 
-void CServerBrowser::RemoveRequest(CServerEntry *pEntry)
+void CServerBrowser::ResortPings()
 {
-	if(pEntry->m_pPrevReq || pEntry->m_pNextReq || m_pFirstReqServer == pEntry)
-	{
-		if(pEntry->m_pPrevReq)
-			pEntry->m_pPrevReq->m_pNextReq = pEntry->m_pNextReq;
-		else
-			m_pFirstReqServer = pEntry->m_pNextReq;
+	m_NeedPingResort = false;
 
-		if(pEntry->m_pNextReq)
-			pEntry->m_pNextReq->m_pPrevReq = pEntry->m_pPrevReq;
-		else
-			m_pLastReqServer = pEntry->m_pPrevReq;
+	// pings only change the order when sorting by them, the filters don't use them
+	const bool PlayersAndPing = g_Config.m_BrSortOrder == 2 && g_Config.m_BrSort == IServerBrowser::SORT_NUMPLAYERS;
+	if(g_Config.m_BrSort != IServerBrowser::SORT_PING && !PlayersAndPing)
+		return;
 
-		pEntry->m_pPrevReq = nullptr;
-		pEntry->m_pNextReq = nullptr;
-		m_NumRequests--;
-	}
+	const int NumChanged = FillSortKeys();
+	SortKeys(m_vSortKeys, g_Config.m_BrSort, g_Config.m_BrSortOrder, NumChanged);
+	for(int i = 0; i < m_NumSortedServers; i++)
+		m_pSortedServerlist[i] = m_vSortKeys[i].m_Index;
 }
 
 CServerBrowser::CServerEntry *CServerBrowser::Find(const NETADDR &Addr)
@@ -513,15 +618,20 @@ CServerBrowser::CServerEntry *CServerBrowser::Find(const NETADDR &Addr)
 
 void CServerBrowser::QueueRequest(CServerEntry *pEntry)
 {
-	// add it to the list of servers that we should request info from
-	pEntry->m_pPrevReq = m_pLastReqServer;
-	if(m_pLastReqServer)
-		m_pLastReqServer->m_pNextReq = pEntry;
-	else
-		m_pFirstReqServer = pEntry;
-	m_pLastReqServer = pEntry;
-	pEntry->m_pNextReq = nullptr;
-	m_NumRequests++;
+	// add it to the list of servers that we should request info from, favorites first
+	const bool Favorite = pEntry->m_Info.m_Favorite != TRISTATE::NONE;
+	// one ping answer sets the latency of all servers on the same ip, the
+	// first server on it stands for the group
+	int Group = CServerBrowserPingScheduler::NO_GROUP;
+	if(pEntry->m_RequestIgnoreInfo)
+	{
+		NETADDR Ip = pEntry->m_Info.m_aAddresses[0];
+		Ip.port = 0;
+		auto Servers = m_ByIp.find(Ip);
+		if(Servers != m_ByIp.end() && !Servers->second.empty())
+			Group = Servers->second.front();
+	}
+	m_PingScheduler.Queue(pEntry->m_Info.m_ServerIndex, Favorite ? CServerBrowserPingScheduler::PRIORITY_HIGH : CServerBrowserPingScheduler::PRIORITY_NORMAL, Group);
 }
 
 void ServerBrowserFormatAddresses(char *pBuffer, int BufferSize, NETADDR *pAddrs, int NumAddrs)
@@ -619,6 +729,7 @@ void CServerBrowser::SetInfo(CServerEntry *pEntry, const CServerInfo &Info)
 	std::sort(pEntry->m_Info.m_aClients, pEntry->m_Info.m_aClients + Info.m_NumReceivedClients, CPlayerScoreNameLess(pEntry->m_Info.m_ClientScoreKind));
 
 	pEntry->m_GotInfo = 1;
+	UpdateSearchKeys(pEntry);
 }
 
 void CServerBrowser::SetLatency(NETADDR Addr, int Latency)
@@ -626,27 +737,17 @@ void CServerBrowser::SetLatency(NETADDR Addr, int Latency)
 	m_pPingCache->CachePing(Addr, Latency);
 
 	Addr.port = 0;
-	for(int i = 0; i < m_NumServers; i++)
+	auto Servers = m_ByIp.find(Addr);
+	if(Servers == m_ByIp.end())
+	{
+		return;
+	}
+	for(int i : Servers->second)
 	{
 		if(!m_ppServerlist[i]->m_GotInfo)
 		{
 			continue;
 		}
-		bool Found = false;
-		for(int j = 0; j < m_ppServerlist[i]->m_Info.m_NumAddresses; j++)
-		{
-			NETADDR Other = m_ppServerlist[i]->m_Info.m_aAddresses[j];
-			Other.port = 0;
-			if(Addr == Other)
-			{
-				Found = true;
-				break;
-			}
-		}
-		if(!Found)
-		{
-			continue;
-		}
 		int Ping = m_pPingCache->GetPing(m_ppServerlist[i]->m_Info.m_aAddresses, m_ppServerlist[i]->m_Info.m_NumAddresses);
 		if(Ping == -1)
 		{
@@ -702,6 +803,11 @@ CServerBrowser::CServerEntry *CServerBrowser::Add(const NETADDR *pAddrs, int Num
 	for(int i = 0; i < NumAddrs; i++)
 	{
 		m_ByAddr[pAddrs[i]] = m_NumServers;
+		NETADDR Ip = pAddrs[i];
+		Ip.port = 0;
+		std::vector<int> &vServers = m_ByIp[Ip];
+		if(vServers.empty() || vServers.back() != m_NumServers)
+			vServers.push_back(m_NumServers);
 	}
 
 	if(m_NumServers == m_NumServerCapacity)
@@ -720,6 +826,10 @@ CServerBrowser::CServerEntry *CServerBrowser::Add(const NETADDR *pAddrs, int Num
 	pEntry->m_Info.m_ServerIndex = m_NumServers;
 	m_NumServers++;
 
+	if((int)m_vSearchKeys.size() < m_NumServers)
+		m_vSearchKeys.resize(m_NumServers);
+	UpdateSearchKeys(pEntry);
+
 	return pEntry;
 }
 
@@ -734,6 +844,8 @@ void CServerBrowser::OnServerInfoUpdate(const NETADDR &Addr, int Token, const CS
 	}
 
 	CServerEntry *pEntry = Find(Addr);
+	bool PingOnly = false;
+	int Attempt = 0;
 
 	if(m_ServerlistType == IServerBrowser::TYPE_LAN)
 	{
@@ -758,11 +870,17 @@ void CServerBrowser::OnServerInfoUpdate(const NETADDR &Addr, int Token, const CS
 		{
 			return;
 		}
-		int TokenAddr = GenerateToken(Addr);
-		bool Drop = false;
-		Drop = Drop || BasicToken != GetBasicToken(TokenAddr);
-		Drop = Drop || (pInfo->m_Type == SERVERINFO_EXTENDED && ExtraToken != GetExtraToken(TokenAddr));
-		if(Drop)
+		// find the attempt this answers, the latest if the basic tokens collide
+		for(Attempt = maximum(pEntry->m_NumAttempts, 1) - 1; Attempt >= 0; Attempt--)
+		{
+			int TokenAddr = GenerateToken(Addr, Attempt);
+			bool Drop = false;
+			Drop = Drop || BasicToken != GetBasicToken(TokenAddr);
+			Drop = Drop || (pInfo->m_Type == SERVERINFO_EXTENDED && ExtraToken != GetExtraToken(TokenAddr));
+			if(!Drop)
+				break;
+		}
+		if(Attempt < 0)
 		{
 			return;
 		}
@@ -779,8 +897,14 @@ void CServerBrowser::OnServerInfoUpdate(const NETADDR &Addr, int Token, const CS
 		{
 			SetInfo(pEntry, *pInfo);
 		}
+		else
+		{
+			// only the latency changed
+			PingOnly = true;
+		}
 
-		int Latency = minimum(static_cast<int>((time_get() - pEntry->m_RequestTime) * 1000 / time_freq()), 999);
+		const int64_t SendTime = Attempt < pEntry->m_NumAttempts ? pEntry->m_aAttemptTimes[Attempt] : pEntry->m_RequestTime;
+		int Latency = minimum(static_cast<int>((time_get() - SendTime) * 1000 / time_freq()), 999);
 		if(!pEntry->m_RequestIgnoreInfo)
 		{
 			pEntry->m_Info.m_Latency = Latency;
@@ -794,8 +918,11 @@ void CServerBrowser::OnServerInfoUpdate(const NETADDR &Addr, int Token, const CS
 		}
 		pEntry->m_RequestTime = -1; // Request has been answered
 	}
-	RemoveRequest(pEntry);
-	RequestResort();
+	m_PingScheduler.Answered(pEntry->m_Info.m_ServerIndex);
+	if(PingOnly)
+		RequestPingResort();
+	else
+		RequestResort();
 }
 
 void CServerBrowser::Refresh(int Type)
@@ -855,7 +982,16 @@ void CServerBrowser::Refresh(int Type)
 	}
 }
 
-void CServerBrowser::RequestImpl(const NETADDR &Addr, CServerEntry *pEntry, int *pBasicToken, int *pToken, bool RandomToken) const
+bool CServerBrowser::SendRequest(int Index, void *pUser)
+{
+	CServerBrowser *pThis = (CServerBrowser *)pUser;
+	CServerEntry *pEntry = pThis->m_ppServerlist[Index];
+	const int Attempt = clamp(pThis->m_PingScheduler.Attempts(Index) - 1, 0, (int)CServerBrowserPingScheduler::MAX_ATTEMPTS - 1);
+	pThis->RequestImpl(pEntry->m_Info.m_aAddresses[0], pEntry, nullptr, nullptr, false, Attempt);
+	return true;
+}
+
+void CServerBrowser::RequestImpl(const NETADDR &Addr, CServerEntry *pEntry, int *pBasicToken, int *pToken, bool RandomToken, int Attempt) const
 {
 	if(g_Config.m_Debug)
 	{
@@ -866,7 +1002,7 @@ void CServerBrowser::RequestImpl(const NETADDR &Addr, CServerEntry *pEntry, int
 		m_pConsole->Print(IConsole::OUTPUT_LEVEL_DEBUG, "serverbrowser", aBuf);
 	}
 
-	int Token = GenerateToken(Addr);
+	int Token = GenerateToken(Addr, Attempt);
 	if(RandomToken)
 	{
 		int AvoidBasicToken = GetBasicToken(Token);
@@ -902,17 +1038,21 @@ void CServerBrowser::RequestImpl(const NETADDR &Addr, CServerEntry *pEntry, int
 	m_pNetClient->Send(&Packet);
 
 	if(pEntry)
+	{
 		pEntry->m_RequestTime = time_get();
+		pEntry->m_aAttemptTimes[Attempt] = pEntry->m_RequestTime;
+		pEntry->m_NumAttempts = Attempt + 1;
+	}
 }
 
 void CServerBrowser::RequestCurrentServer(const NETADDR &Addr) const
 {
-	RequestImpl(Addr, nullptr, nullptr, nullptr, false);
+	RequestImpl(Addr, nullptr, nullptr, nullptr, false, 0);
 }
 
 void CServerBrowser::RequestCurrentServerWithRandomToken(const NETADDR &Addr, int *pBasicToken, int *pToken) const
 {
-	RequestImpl(Addr, nullptr, pBasicToken, pToken, true);
+	RequestImpl(Addr, nullptr, pBasicToken, pToken, true, 0);
 }
 
 void CServerBrowser::SetCurrentServerPing(const NETADDR &Addr, int Ping)
@@ -1079,11 +1219,10 @@ void CServerBrowser::CleanUp()
 	m_ServerlistHeap.Reset();
 	m_NumServers = 0;
 	m_NumSortedServers = 0;
+	m_vSearchKeys.clear();
 	m_ByAddr.clear();
-	m_pFirstReqServer = nullptr;
-	m_pLastReqServer = nullptr;
-	m_NumRequests = 0;
-	m_CurrentMaxRequests = g_Config.m_BrMaxRequests;
+	m_ByIp.clear();
+	m_PingScheduler.Reset(g_Config.m_BrMaxRequests);
 }
 
 void CServerBrowser::Update()
@@ -1110,58 +1249,13 @@ void CServerBrowser::Update()
 		return;
 	}
 
-	CServerEntry *pEntry = m_pFirstReqServer;
-	int Count = 0;
-	while(true)
-	{
-		if(!pEntry) // no more entries
-			break;
-		if(pEntry->m_RequestTime && pEntry->m_RequestTime + Timeout < Now)
-		{
-			pEntry = pEntry->m_pNextReq;
-			continue;
-		}
-		// no more than 10 concurrent requests
-		if(Count == m_CurrentMaxRequests)
-			break;
-
-		if(pEntry->m_RequestTime == 0)
-		{
-			RequestImpl(pEntry->m_Info.m_aAddresses[0], pEntry, nullptr, nullptr, false);
-		}
+	m_PingScheduler.Update(Now, Timeout, SendRequest, this);
 
-		Count++;
-		pEntry = pEntry->m_pNextReq;
-	}
-
-	if(m_pFirstReqServer && Count == 0 && m_CurrentMaxRequests > 1) //NO More current Server Requests
+	// write the received pings to disk in batches
+	if(m_PingCacheFlushTime + Timeout < Now || !m_PingScheduler.NumPending())
 	{
-		//reset old ones
-		pEntry = m_pFirstReqServer;
-		while(true)
-		{
-			if(!pEntry) // no more entries
-				break;
-			pEntry->m_RequestTime = 0;
-			pEntry = pEntry->m_pNextReq;
-		}
-
-		//update max-requests
-		m_CurrentMaxRequests = m_CurrentMaxRequests / 2;
-		if(m_CurrentMaxRequests < 1)
-			m_CurrentMaxRequests = 1;
-	}
-	else if(Count == 0 && m_CurrentMaxRequests == 1) //we reached the limit, just release all left requests. IF a server sends us a packet, a new request will be added automatically, so we can delete all
-	{
-		pEntry = m_pFirstReqServer;
-		while(true)
-		{
-			if(!pEntry) // no more entries
-				break;
-			CServerEntry *pNext = pEntry->m_pNextReq;
-			RemoveRequest(pEntry); //release request
-			pEntry = pNext;
-		}
+		m_pPingCache->Flush();
+		m_PingCacheFlushTime = Now;
 	}
 
 	// check if we need to resort
@@ -1176,6 +1270,10 @@ void CServerBrowser::Update()
 		Sort();
 		m_NeedResort = false;
 	}
+	else if(m_NeedPingResort)
+	{
+		ResortPings();
+	}
 }
 
 void CServerBrowser::LoadDDNetServers()
@@ -1397,7 +1495,7 @@ const json_value *CServerBrowser::LoadDDNetInfo()
 
 bool CServerBrowser::IsRefreshing() const
 {
-	return m_pFirstReqServer != nullptr;
+	return m_PingScheduler.NumPending() != 0;
 }
 
 bool CServerBrowser::IsGettingServerlist() const
@@ -1411,7 +1509,7 @@ int CServerBrowser::LoadingProgression() const
 		return 0;
 
 	int Servers = m_NumServers;
-	int Loaded = m_NumServers - m_NumRequests;
+	int Loaded = m_NumServers - m_PingScheduler.NumPending();
 	return 100.0f * Loaded / Servers;
 }
 
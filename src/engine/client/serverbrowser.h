@@ -3,16 +3,22 @@
 #ifndef ENGINE_CLIENT_SERVERBROWSER_H
 #define ENGINE_CLIENT_SERVERBROWSER_H
 
+#include "serverbrowser_ping_scheduler.h"
+
 #include <base/system.h>
 
 #include <engine/console.h>
 #include <engine/serverbrowser.h>
 #include <engine/shared/config.h>
 #include <engine/shared/http.h>
+#include <engine/shared/jobs.h>
 #include <engine/shared/memheap.h>
 
+#include <string>
 #include <unordered_map>
+#include <vector>
 
+class CFilterJob;
 class CNetClient;
 class IConfigManager;
 class IConsole;
@@ -29,13 +35,13 @@ public:
 	class CServerEntry
 	{
 	public:
-		int64_t m_RequestTime;
+		int64_t m_RequestTime; // of the last attempt, -1 once answered
+		// answers are matched to the attempt by their token
+		int64_t m_aAttemptTimes[CServerBrowserPingScheduler::MAX_ATTEMPTS];
+		int m_NumAttempts;
 		bool m_RequestIgnoreInfo;
 		int m_GotInfo;
 		CServerInfo m_Info;
-
-		CServerEntry *m_pPrevReq; // request list
-		CServerEntry *m_pNextReq;
 	};
 
 	struct CNetworkCountry
@@ -84,6 +90,7 @@ public:
 	bool IsGettingServerlist() const override;
 	int LoadingProgression() const override;
 	void RequestResort() { m_NeedResort = true; }
+	void RequestPingResort() { m_NeedPingResort = true; }
 
 	int NumServers() const override { return m_NumServers; }
 
@@ -136,7 +143,69 @@ public:
 	int GetCurrentType() override { return m_ServerlistType; }
 	bool IsRegistered(const NETADDR &Addr);
 
+	// lowercase copies of the searched fields, updated with the server info
+	struct CSearchKeys
+	{
+		std::string m_Name;
+		std::string m_Map;
+		std::string m_GameType;
+		std::string m_Players; // names and clans separated by newlines, without connecting players
+		bool m_HasConnectingPlayers = false;
+	};
+
+	struct CSortKey
+	{
+		int m_Index;
+		int m_Key1;
+		int m_Key2;
+		const char *m_pStr;
+	};
+
+	// search tokens are parsed and lowercased once per filter pass
+	struct CFilterContext
+	{
+		struct CToken
+		{
+			char m_aExact[sizeof(g_Config.m_BrFilterString)];
+			std::string m_Lower;
+			bool m_Exact;
+
+			bool Matches(const char *pStr, const std::string &Lower) const
+			{
+				return m_Exact ? str_comp(pStr, m_aExact) == 0 : str_find(Lower.c_str(), m_Lower.c_str()) != nullptr;
+			}
+		};
+
+		bool m_HasFilter;
+		std::vector<CToken> m_vFilter;
+		std::vector<CToken> m_vExclude;
+		std::string m_GameType;
+
+		void Init(const char *pFilter, const char *pExclude, const char *pGameType);
+	};
+
+	enum
+	{
+		// below this the filter runs on the calling thread only
+		PARALLEL_FILTER_MIN_SERVERS = 256,
+		MAX_FILTER_THREADS = 4,
+		// a resort after ping updates uses an insertion sort if at most
+		// 1/RESORT_CHANGED_DIVISOR of the keys changed, a full sort otherwise
+		RESORT_CHANGED_DIVISOR = 32,
+		RESORT_MIN_CHANGED = 8,
+	};
+
+	static void FillSearchKeys(const CServerInfo &Info, CSearchKeys &Keys);
+	// Returns the QUICK_* flags of the fields that match the filter tokens.
+	static int QuickSearchHit(const CServerInfo &Info, const CSearchKeys &Keys, const CFilterContext &Context, bool FilterConnectingPlayers);
+	static bool Excluded(const CServerInfo &Info, const CSearchKeys &Keys, const CFilterContext &Context);
+	// NumChanged is the number of keys that changed since the list was last
+	// sorted, or -1 for a list in any order.
+	static void SortKeys(std::vector<CSortKey> &vKeys, int Sort, int SortOrder, int NumChanged);
+
 private:
+	friend CFilterJob;
+
 	CNetClient *m_pNetClient = nullptr;
 	IConsole *m_pConsole = nullptr;
 	IEngine *m_pEngine = nullptr;
@@ -153,21 +222,24 @@ private:
 	CHeap m_ServerlistHeap;
 	CServerEntry **m_ppServerlist;
 	int *m_pSortedServerlist;
+	std::vector<CSearchKeys> m_vSearchKeys;
+	std::vector<CSortKey> m_vSortKeys;
+	std::vector<unsigned char> m_vFilterVisible;
+	CJobPool m_FilterPool; // started with the first large filter
+	int m_NumFilterThreads = 0;
 	std::unordered_map<NETADDR, int> m_ByAddr;
+	std::unordered_map<NETADDR, std::vector<int>> m_ByIp; // addresses without port
 
 	CNetwork m_aNetworks[NUM_NETWORKS];
 	int m_OwnLocation = CServerInfo::LOC_UNKNOWN;
 
 	json_value *m_pDDNetInfo;
 
-	CServerEntry *m_pFirstReqServer; // request list
-	CServerEntry *m_pLastReqServer;
-	int m_NumRequests;
+	CServerBrowserPingScheduler m_PingScheduler;
+	int64_t m_PingCacheFlushTime = 0;
 
 	bool m_NeedResort;
-
-	// used instead of g_Config.br_max_requests to get more servers
-	int m_CurrentMaxRequests;
+	bool m_NeedPingResort;
 
 	int m_NumSortedServers;
 	int m_NumSortedServersCapacity;
@@ -182,32 +254,26 @@ private:
 	int64_t m_BroadcastTime;
 	unsigned char m_aTokenSeed[16];
 
-	int GenerateToken(const NETADDR &Addr) const;
+	int GenerateToken(const NETADDR &Addr, int Attempt = 0) const;
 	static int GetBasicToken(int Token);
 	static int GetExtraToken(int Token);
 
-	// sorting criteria
-	bool SortCompareName(int Index1, int Index2) const;
-	bool SortCompareMap(int Index1, int Index2) const;
-	bool SortComparePing(int Index1, int Index2) const;
-	bool SortCompareGametype(int Index1, int Index2) const;
-	bool SortCompareNumPlayers(int Index1, int Index2) const;
-	bool SortCompareNumClients(int Index1, int Index2) const;
-	bool SortCompareNumPlayersAndPing(int Index1, int Index2) const;
-
 	//
+	bool FilterEntry(int Index, const CFilterContext &Context);
 	void Filter();
+	int FillSortKeys();
 	void Sort();
+	void ResortPings();
 	int SortHash() const;
+	void UpdateSearchKeys(const CServerEntry *pEntry);
 
 	void CleanUp();
 
 	void UpdateFromHttp();
 	CServerEntry *Add(const NETADDR *pAddrs, int NumAddrs);
 
-	void RemoveRequest(CServerEntry *pEntry);
-
-	void RequestImpl(const NETADDR &Addr, CServerEntry *pEntry, int *pBasicToken, int *pToken, bool RandomToken) const;
+	static bool SendRequest(int Index, void *pUser);
+	void RequestImpl(const NETADDR &Addr, CServerEntry *pEntry, int *pBasicToken, int *pToken, bool RandomToken, int Attempt) const;
 
 	void RegisterCommands();
 	static void Con_LeakIpAddress(IConsole::IResult *pResult, void *pUserData);
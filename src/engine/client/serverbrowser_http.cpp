@@ -20,16 +20,44 @@
 
 using namespace std::chrono_literals;
 
-class CChooseMaster
+// Parses the server list while it is being downloaded.
+class CServerListRequest : public CHttpRequest
 {
+	CServerListParser m_Parser;
+	bool m_ParseError = true;
+
+	bool OnResponseData(const char *pData, size_t DataSize) override
+	{
+		return !m_Parser.Feed(pData, DataSize);
+	}
+	int OnCompletion(int State) override
+	{
+		State = CHttpRequest::OnCompletion(State);
+		if(State == HTTP_DONE)
+			m_ParseError = m_Parser.Finish();
+		return State;
+	}
+
 public:
-	typedef bool (*VALIDATOR)(json_value *pJson);
+	CServerListRequest(const char *pUrl) :
+		CHttpRequest(pUrl)
+	{
+		StreamResponse();
+	}
 
+	// Only valid once the request is done.
+	bool ParseError() const { return m_ParseError; }
+	CServerListParser &Parser() { return m_Parser; }
+};
+
+class CChooseMaster
+{
+public:
 	enum
 	{
 		MAX_URLS = 16,
 	};
-	CChooseMaster(IEngine *pEngine, VALIDATOR pfnValidator, const char **ppUrls, int NumUrls, int PreviousBestIndex);
+	CChooseMaster(IEngine *pEngine, const char **ppUrls, int NumUrls, int PreviousBestIndex);
 	virtual ~CChooseMaster();
 
 	bool GetBestUrl(const char **pBestUrl) const;
@@ -45,7 +73,6 @@ private:
 	public:
 		std::atomic_int m_BestIndex{-1};
 		// Constant after construction.
-		VALIDATOR m_pfnValidator;
 		int m_NumUrls;
 		char m_aaUrls[MAX_URLS][256];
 	};
@@ -70,7 +97,7 @@ private:
 	std::shared_ptr<CJob> m_pJob;
 };
 
-CChooseMaster::CChooseMaster(IEngine *pEngine, VALIDATOR pfnValidator, const char **ppUrls, int NumUrls, int PreviousBestIndex) :
+CChooseMaster::CChooseMaster(IEngine *pEngine, const char **ppUrls, int NumUrls, int PreviousBestIndex) :
 	m_pEngine(pEngine),
 	m_PreviousBestIndex(PreviousBestIndex)
 {
@@ -79,7 +106,6 @@ CChooseMaster::CChooseMaster(IEngine *pEngine, VALIDATOR pfnValidator, const cha
 	dbg_assert(PreviousBestIndex >= -1, "previous best index negative and not -1");
 	dbg_assert(PreviousBestIndex < NumUrls, "previous best index too high");
 	m_pData = std::make_shared<CData>();
-	m_pData->m_pfnValidator = pfnValidator;
 	m_pData->m_NumUrls = NumUrls;
 	for(int i = 0; i < m_pData->m_NumUrls; i++)
 	{
@@ -190,7 +216,7 @@ void CChooseMaster::CJob::Run()
 			continue;
 		}
 		auto StartTime = time_get_nanoseconds();
-		CHttpRequest *pGet = HttpGet(pUrl).release();
+		CServerListRequest *pGet = new CServerListRequest(pUrl);
 		pGet->Timeout(Timeout);
 		pGet->LogProgress(HTTPLOG::FAILURE);
 		{
@@ -204,18 +230,7 @@ void CChooseMaster::CJob::Run()
 			dbg_msg("serverbrowse_http", "master chooser aborted");
 			return;
 		}
-		if(pGet->State() != HTTP_DONE)
-		{
-			continue;
-		}
-		json_value *pJson = pGet->ResultJson();
-		if(!pJson)
-		{
-			continue;
-		}
-		bool ParseFailure = m_pData->m_pfnValidator(pJson);
-		json_value_free(pJson);
-		if(ParseFailure)
+		if(pGet->State() != HTTP_DONE || pGet->ParseError())
 		{
 			continue;
 		}
@@ -282,14 +297,11 @@ private:
 		STATE_NO_MASTER,
 	};
 
-	static bool Validate(json_value *pJson);
-	static bool Parse(json_value *pJson, std::vector<CServerInfo> *pvServers, std::vector<NETADDR> *pvLegacyServers);
-
 	IEngine *m_pEngine;
 	IConsole *m_pConsole;
 
 	int m_State = STATE_DONE;
-	std::shared_ptr<CHttpRequest> m_pGetServers;
+	std::shared_ptr<CServerListRequest> m_pGetServers;
 	std::unique_ptr<CChooseMaster> m_pChooseMaster;
 
 	std::vector<CServerInfo> m_vServers;
@@ -299,7 +311,7 @@ private:
 CServerBrowserHttp::CServerBrowserHttp(IEngine *pEngine, IConsole *pConsole, const char **ppUrls, int NumUrls, int PreviousBestIndex) :
 	m_pEngine(pEngine),
 	m_pConsole(pConsole),
-	m_pChooseMaster(new CChooseMaster(pEngine, Validate, ppUrls, NumUrls, PreviousBestIndex))
+	m_pChooseMaster(new CChooseMaster(pEngine, ppUrls, NumUrls, PreviousBestIndex))
 {
 	m_pChooseMaster->Refresh();
 }
@@ -326,7 +338,7 @@ void CServerBrowserHttp::Update()
 			}
 			return;
 		}
-		m_pGetServers = HttpGet(pBestUrl);
+		m_pGetServers = std::make_shared<CServerListRequest>(pBestUrl);
 		// 10 seconds connection timeout, lower than 8KB/s for 10 seconds to fail.
 		m_pGetServers->Timeout(CTimeout{10000, 0, 8000, 10});
 		m_pEngine->AddJob(m_pGetServers);
@@ -339,15 +351,16 @@ void CServerBrowserHttp::Update()
 			return;
 		}
 		m_State = STATE_DONE;
-		std::shared_ptr<CHttpRequest> pGetServers = nullptr;
+		std::shared_ptr<CServerListRequest> pGetServers = nullptr;
 		std::swap(m_pGetServers, pGetServers);
 
-		bool Success = true;
-		json_value *pJson = pGetServers->ResultJson();
-		Success = Success && pJson;
-		Success = Success && !Parse(pJson, &m_vServers, &m_vLegacyServers);
-		json_value_free(pJson);
-		if(!Success)
+		// the list has been converted on the request thread already
+		if(pGetServers->State() == HTTP_DONE && !pGetServers->ParseError())
+		{
+			std::swap(m_vServers, pGetServers->Parser().m_vServers);
+			std::swap(m_vLegacyServers, pGetServers->Parser().m_vLegacyServers);
+		}
+		else
 		{
 			m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "serverbrowse_http", "failed getting serverlist, trying to find best URL");
 			m_pChooseMaster->Reset();
@@ -371,95 +384,106 @@ bool ServerbrowserParseUrl(NETADDR *pOut, const char *pUrl)
 {
 	return net_addr_from_url(pOut, pUrl, nullptr, 0) != 0;
 }
-bool CServerBrowserHttp::Validate(json_value *pJson)
+
+CServerListParser::CServerListParser() :
+	m_Stream(ElementCallback, this)
+{
+}
+
+bool CServerListParser::Feed(const char *pData, size_t DataSize)
 {
-	std::vector<CServerInfo> vServers;
-	std::vector<NETADDR> vLegacyServers;
-	return Parse(pJson, &vServers, &vLegacyServers);
+	return m_Stream.Feed(pData, DataSize) || m_Error;
 }
-bool CServerBrowserHttp::Parse(json_value *pJson, std::vector<CServerInfo> *pvServers, std::vector<NETADDR> *pvLegacyServers)
+
+bool CServerListParser::Finish()
 {
-	std::vector<CServerInfo> vServers;
-	std::vector<NETADDR> vLegacyServers;
+	if(m_Stream.Finish() || m_Error)
+		return true;
+	if(!m_Stream.IsArray("servers") || (m_Stream.HasKey("servers_legacy") && !m_Stream.IsArray("servers_legacy")))
+		return true;
+	return false;
+}
 
-	const json_value &Json = *pJson;
-	const json_value &Servers = Json["servers"];
-	const json_value &LegacyServers = Json["servers_legacy"];
-	if(Servers.type != json_array || (LegacyServers.type != json_array && LegacyServers.type != json_none))
+void CServerListParser::ElementCallback(const char *pKey, const char *pJson, size_t Length, void *pUser)
+{
+	CServerListParser *pSelf = (CServerListParser *)pUser;
+	const bool Servers = str_comp(pKey, "servers") == 0;
+	if(pSelf->m_Error || (!Servers && str_comp(pKey, "servers_legacy") != 0))
+		return;
+
+	json_value *pElement = json_parse(pJson, Length);
+	if(!pElement)
+	{
+		pSelf->m_Error = true;
+		return;
+	}
+	if(Servers)
+	{
+		pSelf->m_Error = pSelf->ParseServer(*pElement);
+	}
+	else
+	{
+		NETADDR ParsedAddr;
+		if(pElement->type != json_string || net_addr_from_str(&ParsedAddr, *pElement))
+			pSelf->m_Error = true;
+		else
+			pSelf->m_vLegacyServers.push_back(ParsedAddr);
+	}
+	json_value_free(pElement);
+}
+
+bool CServerListParser::ParseServer(const json_value &Server)
+{
+	const json_value &Addresses = Server["addresses"];
+	const json_value &Info = Server["info"];
+	const json_value &Location = Server["location"];
+	int ParsedLocation = CServerInfo::LOC_UNKNOWN;
+	CServerInfo2 ParsedInfo;
+	if(Addresses.type != json_array || (Location.type != json_string && Location.type != json_none))
 	{
 		return true;
 	}
-	for(unsigned int i = 0; i < Servers.u.array.length; i++)
+	if(Location.type == json_string)
 	{
-		const json_value &Server = Servers[i];
-		const json_value &Addresses = Server["addresses"];
-		const json_value &Info = Server["info"];
-		const json_value &Location = Server["location"];
-		int ParsedLocation = CServerInfo::LOC_UNKNOWN;
-		CServerInfo2 ParsedInfo;
-		if(Addresses.type != json_array || (Location.type != json_string && Location.type != json_none))
+		if(CServerInfo::ParseLocation(&ParsedLocation, Location))
 		{
 			return true;
 		}
-		if(Location.type == json_string)
+	}
+	if(CServerInfo2::FromJson(&ParsedInfo, &Info))
+	{
+		// Only skip the current server on parsing
+		// failure; the server info is "user input" by
+		// the game server and can be set to arbitrary
+		// values.
+		return false;
+	}
+	CServerInfo SetInfo = ParsedInfo;
+	SetInfo.m_Location = ParsedLocation;
+	SetInfo.m_NumAddresses = 0;
+	for(unsigned int a = 0; a < Addresses.u.array.length; a++)
+	{
+		const json_value &Address = Addresses[a];
+		if(Address.type != json_string)
 		{
-			if(CServerInfo::ParseLocation(&ParsedLocation, Location))
-			{
-				return true;
-			}
+			return true;
 		}
-		if(CServerInfo2::FromJson(&ParsedInfo, &Info))
+		NETADDR ParsedAddr;
+		if(ServerbrowserParseUrl(&ParsedAddr, Addresses[a]))
 		{
-			//dbg_msg("dbg/serverbrowser", "skipped due to info, i=%d", i);
-			// Only skip the current server on parsing
-			// failure; the server info is "user input" by
-			// the game server and can be set to arbitrary
-			// values.
+			// Skip unknown addresses.
 			continue;
 		}
-		CServerInfo SetInfo = ParsedInfo;
-		SetInfo.m_Location = ParsedLocation;
-		SetInfo.m_NumAddresses = 0;
-		for(unsigned int a = 0; a < Addresses.u.array.length; a++)
-		{
-			const json_value &Address = Addresses[a];
-			if(Address.type != json_string)
-			{
-				return true;
-			}
-			NETADDR ParsedAddr;
-			if(ServerbrowserParseUrl(&ParsedAddr, Addresses[a]))
-			{
-				//dbg_msg("dbg/serverbrowser", "unknown address, i=%d a=%d", i, a);
-				// Skip unknown addresses.
-				continue;
-			}
-			if(SetInfo.m_NumAddresses < (int)std::size(SetInfo.m_aAddresses))
-			{
-				SetInfo.m_aAddresses[SetInfo.m_NumAddresses] = ParsedAddr;
-				SetInfo.m_NumAddresses += 1;
-			}
-		}
-		if(SetInfo.m_NumAddresses > 0)
+		if(SetInfo.m_NumAddresses < (int)std::size(SetInfo.m_aAddresses))
 		{
-			vServers.push_back(SetInfo);
+			SetInfo.m_aAddresses[SetInfo.m_NumAddresses] = ParsedAddr;
+			SetInfo.m_NumAddresses += 1;
 		}
 	}
-	if(LegacyServers.type == json_array)
+	if(SetInfo.m_NumAddresses > 0)
 	{
-		for(unsigned int i = 0; i < LegacyServers.u.array.length; i++)
-		{
-			const json_value &Address = LegacyServers[i];
-			NETADDR ParsedAddr;
-			if(Address.type != json_string || net_addr_from_str(&ParsedAddr, Address))
-			{
-				return true;
-			}
-			vLegacyServers.push_back(ParsedAddr);
-		}
+		m_vServers.push_back(SetInfo);
 	}
-	*pvServers = vServers;
-	*pvLegacyServers = vLegacyServers;
 	return false;
 }
 
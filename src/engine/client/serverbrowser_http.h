@@ -1,8 +1,11 @@
 #ifndef ENGINE_CLIENT_SERVERBROWSER_HTTP_H
 #define ENGINE_CLIENT_SERVERBROWSER_HTTP_H
 #include <base/system.h>
+#include <engine/serverbrowser.h>
+#include <engine/shared/json.h>
+
+#include <vector>
 
-class CServerInfo;
 class IConsole;
 class IEngine;
 class IStorage;
@@ -25,5 +28,27 @@ public:
 	virtual const NETADDR &LegacyServer(int Index) const = 0;
 };
 
+// Converts the server list into server infos while it is being received,
+// one server at a time instead of parsing the whole document first.
+class CServerListParser
+{
+public:
+	CServerListParser();
+
+	// return true on error
+	bool Feed(const char *pData, size_t DataSize);
+	bool Finish();
+
+	std::vector<CServerInfo> m_vServers;
+	std::vector<NETADDR> m_vLegacyServers;
+
+private:
+	static void ElementCallback(const char *pKey, const char *pJson, size_t Length, void *pUser);
+	bool ParseServer(const json_value &Server);
+
+	CJsonArrayStream m_Stream;
+	bool m_Error = false;
+};
+
 IServerBrowserHttp *CreateServerBrowserHttp(IEngine *pEngine, IConsole *pConsole, IStorage *pStorage, const char *pPreviousBestUrl);
 #endif // ENGINE_CLIENT_SERVERBROWSER_HTTP_H
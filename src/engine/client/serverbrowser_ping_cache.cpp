@@ -19,12 +19,13 @@ public:
 	};
 
 	CServerBrowserPingCache(IConsole *pConsole, IStorage *pStorage);
-	virtual ~CServerBrowserPingCache() = default;
+	virtual ~CServerBrowserPingCache();
 
 	void Load() override;
 
 	int NumEntries() const override;
 	void CachePing(const NETADDR &Addr, int Ping) override;
+	void Flush() override;
 	int GetPing(const NETADDR *pAddrs, int NumAddrs) const override;
 
 private:
@@ -33,8 +34,11 @@ private:
 	CSqlite m_pDisk;
 	CSqliteStmt m_pLoadStmt;
 	CSqliteStmt m_pStoreStmt;
+	CSqliteStmt m_pBeginStmt;
+	CSqliteStmt m_pCommitStmt;
 
 	std::unordered_map<NETADDR, int> m_Entries;
+	std::unordered_map<NETADDR, int> m_PendingWrites;
 };
 
 CServerBrowserPingCache::CServerBrowserPingCache(IConsole *pConsole, IStorage *pStorage) :
@@ -56,6 +60,13 @@ CServerBrowserPingCache::CServerBrowserPingCache(IConsole *pConsole, IStorage *p
 	}
 	m_pLoadStmt = SqlitePrepare(pConsole, pSqlite, "SELECT ip_address, ping FROM server_pings");
 	m_pStoreStmt = SqlitePrepare(pConsole, pSqlite, "INSERT OR REPLACE INTO server_pings (ip_address, ping, utc_timestamp) VALUES (?, ?, datetime('now'))");
+	m_pBeginStmt = SqlitePrepare(pConsole, pSqlite, "BEGIN");
+	m_pCommitStmt = SqlitePrepare(pConsole, pSqlite, "COMMIT");
+}
+
+CServerBrowserPingCache::~CServerBrowserPingCache()
+{
+	Flush();
 }
 
 void CServerBrowserPingCache::Load()
@@ -123,22 +134,50 @@ void CServerBrowserPingCache::CachePing(const NETADDR &Addr, int Ping)
 	m_Entries[AddrWithoutPort] = Ping;
 	if(m_pDisk)
 	{
-		sqlite3 *pSqlite = m_pDisk.get();
-		IConsole *pConsole = m_pConsole;
-		char aAddr[NETADDR_MAXSTRSIZE];
-		net_addr_str(&AddrWithoutPort, aAddr, sizeof(aAddr), false);
+		m_PendingWrites[AddrWithoutPort] = Ping;
+	}
+}
 
-		bool Error = false;
-		Error = Error || !m_pStoreStmt;
+void CServerBrowserPingCache::Flush()
+{
+	if(!m_pDisk || m_PendingWrites.empty())
+	{
+		return;
+	}
+	sqlite3 *pSqlite = m_pDisk.get();
+	IConsole *pConsole = m_pConsole;
+
+	bool Error = false;
+	Error = Error || !m_pBeginStmt || !m_pCommitStmt || !m_pStoreStmt;
+	Error = Error || SQLITE_HANDLE_ERROR(sqlite3_reset(m_pBeginStmt.get())) != SQLITE_OK;
+	Error = Error || SQLITE_HANDLE_ERROR(sqlite3_step(m_pBeginStmt.get())) != SQLITE_DONE;
+	const bool InTransaction = !Error;
+	for(const auto &Entry : m_PendingWrites)
+	{
+		char aAddr[NETADDR_MAXSTRSIZE];
+		net_addr_str(&Entry.first, aAddr, sizeof(aAddr), false);
 		Error = Error || SQLITE_HANDLE_ERROR(sqlite3_reset(m_pStoreStmt.get())) != SQLITE_OK;
-		Error = Error || SQLITE_HANDLE_ERROR(sqlite3_bind_text(m_pStoreStmt.get(), 1, aAddr, -1, SQLITE_STATIC)) != SQLITE_OK;
-		Error = Error || SQLITE_HANDLE_ERROR(sqlite3_bind_int(m_pStoreStmt.get(), 2, Ping)) != SQLITE_OK;
+		Error = Error || SQLITE_HANDLE_ERROR(sqlite3_bind_text(m_pStoreStmt.get(), 1, aAddr, -1, SQLITE_TRANSIENT)) != SQLITE_OK;
+		Error = Error || SQLITE_HANDLE_ERROR(sqlite3_bind_int(m_pStoreStmt.get(), 2, Entry.second)) != SQLITE_OK;
 		Error = Error || SQLITE_HANDLE_ERROR(sqlite3_step(m_pStoreStmt.get())) != SQLITE_DONE;
-		if(Error)
+	}
+	if(InTransaction)
+	{
+		// commit the rows written so far even if one of them failed
+		bool CommitError = false;
+		CommitError = CommitError || SQLITE_HANDLE_ERROR(sqlite3_reset(m_pCommitStmt.get())) != SQLITE_OK;
+		CommitError = CommitError || SQLITE_HANDLE_ERROR(sqlite3_step(m_pCommitStmt.get())) != SQLITE_DONE;
+		if(CommitError)
 		{
-			pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "serverbrowse_ping_cache", "failed to store ping");
+			Error = true;
+			sqlite3_exec(pSqlite, "ROLLBACK", nullptr, nullptr, nullptr);
 		}
 	}
+	if(Error)
+	{
+		pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "serverbrowse_ping_cache", "failed to store pings");
+	}
+	m_PendingWrites.clear();
 }
 
 int CServerBrowserPingCache::GetPing(const NETADDR *pAddrs, int NumAddrs) const
@@ -13,7 +13,10 @@ public:
 	virtual void Load() = 0;
 
 	virtual int NumEntries() const = 0;
+	// The ping is written to disk with the next Flush().
 	virtual void CachePing(const NETADDR &Addr, int Ping) = 0;
+	// Writes all cached pings since the last flush in one transaction.
+	virtual void Flush() = 0;
 	// Returns -1 if the ping isn't cached.
 	virtual int GetPing(const NETADDR *pAddrs, int NumAddrs) const = 0;
 };
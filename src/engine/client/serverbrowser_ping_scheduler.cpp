@@ -0,0 +1,189 @@
+#include "serverbrowser_ping_scheduler.h"
+
+#include <base/math.h>
+
+void CServerBrowserPingScheduler::Reset(int MaxInFlight)
+{
+	m_vRequests.clear();
+	for(auto &Queue : m_aQueues)
+		Queue.clear();
+	m_vInFlight.clear();
+	m_Groups.clear();
+	m_MaxInFlight = maximum(1, MaxInFlight);
+	m_Window = m_MaxInFlight;
+	m_LastDecrease = 0;
+	m_NumPending = 0;
+	m_NumLost = 0;
+}
+
+void CServerBrowserPingScheduler::Queue(int Id, int Priority, int Group)
+{
+	if(Id >= (int)m_vRequests.size())
+		m_vRequests.resize(Id + 1);
+	CRequest &Request = m_vRequests[Id];
+	if(Request.m_State == STATE_QUEUED || Request.m_State == STATE_WAITING || Request.m_State == STATE_IN_FLIGHT)
+	{
+		SetPriority(Id, maximum(Priority, Request.m_Priority));
+		return;
+	}
+	// a new request wants a new answer
+	if(Group != NO_GROUP)
+		m_Groups[Group].m_Answered = false;
+	Request.m_State = STATE_QUEUED;
+	Request.m_Priority = Priority;
+	Request.m_Group = Group;
+	Request.m_Attempts = 0;
+	m_aQueues[Priority].push_back(Id);
+	m_NumPending++;
+}
+
+void CServerBrowserPingScheduler::SetPriority(int Id, int Priority)
+{
+	if(Id >= (int)m_vRequests.size())
+		return;
+	CRequest &Request = m_vRequests[Id];
+	if(Request.m_State != STATE_QUEUED || Request.m_Priority == Priority)
+		return;
+	Request.m_Priority = Priority;
+	m_aQueues[Priority].push_back(Id);
+}
+
+bool CServerBrowserPingScheduler::Answered(int Id)
+{
+	if(Id >= (int)m_vRequests.size())
+		return false;
+	CRequest &Request = m_vRequests[Id];
+	if(Request.m_State == STATE_IN_FLIGHT)
+	{
+		for(auto &InFlight : m_vInFlight)
+		{
+			if(InFlight == Id)
+			{
+				InFlight = m_vInFlight.back();
+				m_vInFlight.pop_back();
+				break;
+			}
+		}
+		m_Window = minimum(m_Window + 1, m_MaxInFlight);
+	}
+	else if(Request.m_State != STATE_QUEUED && Request.m_State != STATE_WAITING)
+	{
+		return false;
+	}
+	Request.m_State = STATE_DONE;
+	m_NumPending--;
+
+	// the answer is shared with the rest of the group
+	if(Request.m_Group != NO_GROUP)
+	{
+		CGroup &Group = m_Groups[Request.m_Group];
+		Group.m_Answered = true;
+		if(Group.m_Sender == Id)
+			Group.m_Sender = -1;
+		for(int Waiting : Group.m_vWaiting)
+		{
+			if(m_vRequests[Waiting].m_State == STATE_WAITING)
+			{
+				m_vRequests[Waiting].m_State = STATE_DONE;
+				m_NumPending--;
+			}
+		}
+		Group.m_vWaiting.clear();
+	}
+	return true;
+}
+
+void CServerBrowserPingScheduler::ReleaseGroup(int Id)
+{
+	const CRequest &Request = m_vRequests[Id];
+	if(Request.m_Group == NO_GROUP)
+		return;
+	CGroup &Group = m_Groups[Request.m_Group];
+	if(Group.m_Sender != Id)
+		return;
+	Group.m_Sender = -1;
+	for(int Waiting : Group.m_vWaiting)
+	{
+		CRequest &WaitingRequest = m_vRequests[Waiting];
+		if(WaitingRequest.m_State != STATE_WAITING)
+			continue;
+		WaitingRequest.m_State = STATE_QUEUED;
+		m_aQueues[WaitingRequest.m_Priority].push_front(Waiting);
+	}
+	Group.m_vWaiting.clear();
+}
+
+void CServerBrowserPingScheduler::Update(int64_t Now, int64_t Timeout, FSend pfnSend, void *pUser)
+{
+	for(size_t i = 0; i < m_vInFlight.size();)
+	{
+		const int Id = m_vInFlight[i];
+		CRequest &Request = m_vRequests[Id];
+		if(Request.m_SendTime + Timeout >= Now)
+		{
+			i++;
+			continue;
+		}
+		// back off once for all requests sent in the same round trip
+		if(Request.m_SendTime >= m_LastDecrease)
+		{
+			m_Window = maximum(1, m_Window / 2);
+			m_LastDecrease = Now;
+		}
+		if(Request.m_Attempts >= MAX_ATTEMPTS)
+		{
+			Request.m_State = STATE_NONE;
+			m_NumPending--;
+			m_NumLost++;
+			ReleaseGroup(Id);
+		}
+		else
+		{
+			Request.m_State = STATE_QUEUED;
+			m_aQueues[Request.m_Priority].push_front(Id);
+		}
+		m_vInFlight[i] = m_vInFlight.back();
+		m_vInFlight.pop_back();
+	}
+
+	for(int Priority = NUM_PRIORITIES - 1; Priority >= 0; Priority--)
+	{
+		std::deque<int> &Queue = m_aQueues[Priority];
+		while(!Queue.empty() && (int)m_vInFlight.size() < m_Window)
+		{
+			const int Id = Queue.front();
+			Queue.pop_front();
+			CRequest &Request = m_vRequests[Id];
+			if(Request.m_State != STATE_QUEUED || Request.m_Priority != Priority)
+				continue;
+			if(Request.m_Group != NO_GROUP)
+			{
+				CGroup &Group = m_Groups[Request.m_Group];
+				if(Group.m_Answered)
+				{
+					Request.m_State = STATE_DONE;
+					m_NumPending--;
+					continue;
+				}
+				if(Group.m_Sender != -1 && Group.m_Sender != Id)
+				{
+					Request.m_State = STATE_WAITING;
+					Group.m_vWaiting.push_back(Id);
+					continue;
+				}
+				Group.m_Sender = Id;
+			}
+			Request.m_Attempts++;
+			if(!pfnSend(Id, pUser))
+			{
+				Request.m_State = STATE_DONE;
+				m_NumPending--;
+				ReleaseGroup(Id);
+				continue;
+			}
+			Request.m_State = STATE_IN_FLIGHT;
+			Request.m_SendTime = Now;
+			m_vInFlight.push_back(Id);
+		}
+	}
+}
@@ -0,0 +1,94 @@
+#ifndef ENGINE_CLIENT_SERVERBROWSER_PING_SCHEDULER_H
+#define ENGINE_CLIENT_SERVERBROWSER_PING_SCHEDULER_H
+#include <base/system.h>
+
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+// Decides which servers to request info from and when. High priority
+// requests are sent first. The number of requests in flight adapts to the
+// answers: it grows by one with every answer and is halved at most once per
+// round trip when requests time out. Timed out requests are retried a few
+// times before they are given up.
+//
+// Requests of one group share their answer. Only one of them is sent at a
+// time, the others wait and are done once it is answered. If it is given
+// up, the waiting requests are queued again.
+class CServerBrowserPingScheduler
+{
+public:
+	// Returns false if the request was not sent, it is considered done then.
+	typedef bool (*FSend)(int Id, void *pUser);
+
+	enum
+	{
+		PRIORITY_NORMAL = 0,
+		PRIORITY_HIGH,
+		NUM_PRIORITIES,
+
+		MAX_ATTEMPTS = 3,
+
+		NO_GROUP = -1,
+	};
+
+	void Reset(int MaxInFlight);
+	void Queue(int Id, int Priority = PRIORITY_NORMAL, int Group = NO_GROUP);
+	// Only affects requests that have not been sent yet.
+	void SetPriority(int Id, int Priority);
+	// Returns true if a request for the id was pending.
+	bool Answered(int Id);
+	// Times out requests and sends as many queued ones as the window allows.
+	void Update(int64_t Now, int64_t Timeout, FSend pfnSend, void *pUser);
+
+	// Number of times the request has been sent since it was queued.
+	int Attempts(int Id) const { return Id < (int)m_vRequests.size() ? m_vRequests[Id].m_Attempts : 0; }
+	// queued, waiting for their group or in flight
+	int NumPending() const { return m_NumPending; }
+	int NumInFlight() const { return m_vInFlight.size(); }
+	int NumLost() const { return m_NumLost; }
+	int Window() const { return m_Window; }
+
+private:
+	enum
+	{
+		STATE_NONE = 0,
+		STATE_QUEUED,
+		STATE_WAITING,
+		STATE_IN_FLIGHT,
+		STATE_DONE,
+	};
+
+	struct CRequest
+	{
+		int m_State = STATE_NONE;
+		int m_Priority = PRIORITY_NORMAL;
+		int m_Group = NO_GROUP;
+		int m_Attempts = 0;
+		int64_t m_SendTime = 0;
+	};
+
+	struct CGroup
+	{
+		int m_Sender = -1;
+		bool m_Answered = false;
+		std::vector<int> m_vWaiting; // may contain requests that are done
+	};
+
+	// queues may contain stale ids, they are skipped when their state or
+	// priority doesn't match anymore
+	std::vector<CRequest> m_vRequests;
+	std::deque<int> m_aQueues[NUM_PRIORITIES];
+	std::vector<int> m_vInFlight;
+	std::unordered_map<int, CGroup> m_Groups;
+
+	int m_MaxInFlight = 1;
+	int m_Window = 1;
+	int64_t m_LastDecrease = 0;
+	int m_NumPending = 0;
+	int m_NumLost = 0;
+
+	void ReleaseGroup(int Id);
+};
+
+#endif // ENGINE_CLIENT_SERVERBROWSER_PING_SCHEDULER_H
@@ -1,5 +1,6 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/hash_ctxt.h>
 #include <base/log.h>
 #include <base/math.h>
 #include <base/system.h>
@@ -17,6 +18,8 @@
 #include <chrono>
 #include <cstddef>
 #include <limits>
+#include <list>
+#include <string>
 #include <tuple>
 #include <unordered_map>
 #include <vector>
@@ -56,6 +59,47 @@ struct SGlyph
 	float m_aUVs[4];
 };
 
+// On-disk representation of the glyph atlas, see CGlyphMap::LoadAtlasCache.
+// The cache is only read by the machine that wrote it, so native byte order is used.
+struct SAtlasCacheHeader
+{
+	char m_aMagic[4];
+	uint32_t m_Version;
+	SHA256_DIGEST m_Key;
+	uint32_t m_TextureDimension;
+	uint32_t m_NumGlyphs;
+	uint32_t m_NumSections;
+};
+
+struct SAtlasCacheGlyph
+{
+	// key in the glyph map, which can differ from the glyph data for replacement characters
+	int32_t m_KeyFace;
+	int32_t m_KeyChr;
+	int32_t m_KeyFontSize;
+
+	int32_t m_Face;
+	int32_t m_Chr;
+	int32_t m_FontSize;
+	uint32_t m_GlyphIndex;
+	float m_Width;
+	float m_Height;
+	float m_CharWidth;
+	float m_CharHeight;
+	float m_OffsetX;
+	float m_OffsetY;
+	float m_AdvanceX;
+	float m_aUVs[4];
+};
+
+struct SAtlasCacheSection
+{
+	uint32_t m_X;
+	uint32_t m_Y;
+	uint32_t m_W;
+	uint32_t m_H;
+};
+
 struct SGlyphKeyHash
 {
 	size_t operator()(const std::tuple<FT_Face, int, int> &Key) const
@@ -95,6 +139,7 @@ class CAtlas
 		}
 	};
 
+public:
 	struct SSection
 	{
 		size_t m_X;
@@ -110,6 +155,8 @@ class CAtlas
 		}
 	};
 
+private:
+
 	/**
 	 * Sections with a smaller width or height will not be created
 	 * when cutting larger sections, to prevent collecting many
@@ -180,6 +227,26 @@ public:
 		m_SectionsMap.clear();
 	}
 
+	/**
+	 * Restores the atlas from a list of free sections previously
+	 * retrieved with @link GetFreeSections @endlink.
+	 */
+	void Restore(size_t TextureDimension, const std::vector<SSection> &vFreeSections)
+	{
+		m_TextureDimension = TextureDimension;
+		m_vSections.clear();
+		m_SectionsMap.clear();
+		for(const SSection &Section : vFreeSections)
+			AddSection(Section.m_X, Section.m_Y, Section.m_W, Section.m_H);
+	}
+
+	void GetFreeSections(std::vector<SSection> &vFreeSections) const
+	{
+		vFreeSections.insert(vFreeSections.end(), m_vSections.begin(), m_vSections.end());
+		for(const auto &[Dimension, vSections] : m_SectionsMap)
+			vFreeSections.insert(vFreeSections.end(), vSections.begin(), vSections.end());
+	}
+
 	void IncreaseDimension(size_t NewTextureDimension)
 	{
 		dbg_assert(NewTextureDimension == m_TextureDimension * 2, "New atlas dimension must be twice the old one");
@@ -294,6 +361,18 @@ private:
 	 */
 	static constexpr int MAXIMUM_ATLAS_DIMENSION = 16 * 1024;
 
+	/**
+	 * The maximum dimension of the atlas textures that are stored in the atlas cache.
+	 * Results in 32 MB of cache file size.
+	 */
+	static constexpr size_t MAXIMUM_ATLAS_CACHE_DIMENSION = 4 * 1024;
+
+	/**
+	 * Must be increased whenever the atlas cache format or the way glyphs are rendered changes.
+	 */
+	static constexpr uint32_t ATLAS_CACHE_VERSION = 1;
+	static constexpr char ATLAS_CACHE_MAGIC[4] = {'T', 'W', 'G', 'A'};
+
 	/**
 	 * The minimum supported font size.
 	 */
@@ -320,6 +399,10 @@ private:
 	uint8_t *m_apTextureData[NUM_FONT_TEXTURES];
 	CAtlas m_TextureAtlas;
 	std::unordered_map<std::tuple<FT_Face, int, int>, SGlyph, SGlyphKeyHash, SGlyphKeyEquals> m_Glyphs;
+	// Whether the atlas changed since it was loaded from the atlas cache
+	bool m_AtlasCacheOutdated = false;
+	// Increased whenever previously returned glyphs become invalid
+	unsigned m_Generation = 0;
 
 	// Data used for rendering glyphs
 	uint8_t m_aaGlyphData[NUM_FONT_TEXTURES][64 * 1024];
@@ -359,6 +442,12 @@ private:
 		return FamilyNameMatch;
 	}
 
+	int FaceIndex(FT_Face Face) const
+	{
+		const auto It = std::find(m_vFtFaces.begin(), m_vFtFaces.end(), Face);
+		return It == m_vFtFaces.end() ? -1 : (int)(It - m_vFtFaces.begin());
+	}
+
 	bool IncreaseGlyphMapSize()
 	{
 		if(m_TextureDimension >= MAXIMUM_ATLAS_DIMENSION)
@@ -576,6 +665,7 @@ private:
 
 			Glyph.m_State = SGlyph::EState::RENDERED;
 		}
+		m_AtlasCacheOutdated = true;
 		return true;
 	}
 
@@ -671,6 +761,174 @@ public:
 
 		m_TextureAtlas.Clear(m_TextureDimension);
 		m_Glyphs.clear();
+		m_AtlasCacheOutdated = true;
+		++m_Generation;
+	}
+
+	unsigned Generation() const
+	{
+		return m_Generation;
+	}
+
+	/**
+	 * Identifies the atlas cache which is valid for the loaded font files
+	 * and the current glyph rendering settings.
+	 */
+	SHA256_DIGEST AtlasCacheKey(const SHA256_DIGEST &FontFilesHash) const
+	{
+		SHA256_CTX Ctxt;
+		sha256_init(&Ctxt);
+		sha256_update(&Ctxt, &FontFilesHash, sizeof(FontFilesHash));
+		sha256_update(&Ctxt, &ATLAS_CACHE_VERSION, sizeof(ATLAS_CACHE_VERSION));
+		for(int FontSize = MIN_FONT_SIZE; FontSize <= MAX_FONT_SIZE; ++FontSize)
+		{
+			const int32_t OutlineThickness = AdjustOutlineThicknessToFontSize(1, FontSize);
+			sha256_update(&Ctxt, &OutlineThickness, sizeof(OutlineThickness));
+		}
+		return sha256_finish(&Ctxt);
+	}
+
+	bool AtlasCacheOutdated() const
+	{
+		return m_AtlasCacheOutdated && m_TextureDimension <= MAXIMUM_ATLAS_CACHE_DIMENSION;
+	}
+
+	/**
+	 * Replaces the atlas with the contents of an atlas cache file.
+	 * The textures are uploaded at once, the atlas is left unchanged if the data is invalid.
+	 */
+	bool LoadAtlasCache(const unsigned char *pData, size_t DataSize, const SHA256_DIGEST &Key)
+	{
+		SAtlasCacheHeader Header;
+		if(DataSize < sizeof(Header))
+			return false;
+		mem_copy(&Header, pData, sizeof(Header));
+		if(mem_comp(Header.m_aMagic, ATLAS_CACHE_MAGIC, sizeof(Header.m_aMagic)) != 0 || Header.m_Version != ATLAS_CACHE_VERSION || Header.m_Key != Key)
+			return false;
+
+		const size_t Dimension = Header.m_TextureDimension;
+		if(Dimension < (size_t)INITIAL_ATLAS_DIMENSION || Dimension > MAXIMUM_ATLAS_CACHE_DIMENSION || (Dimension & (Dimension - 1)) != 0)
+			return false;
+		const size_t TextureSize = Dimension * Dimension;
+		const uint64_t ExpectedSize = sizeof(Header) + (uint64_t)Header.m_NumGlyphs * sizeof(SAtlasCacheGlyph) + (uint64_t)Header.m_NumSections * sizeof(SAtlasCacheSection) + NUM_FONT_TEXTURES * (uint64_t)TextureSize;
+		if(DataSize != ExpectedSize)
+			return false;
+		const unsigned char *pCurrent = pData + sizeof(Header);
+
+		const auto &&GetFace = [&](int32_t Index) {
+			return Index >= 0 && Index < (int32_t)m_vFtFaces.size() ? m_vFtFaces[Index] : nullptr;
+		};
+
+		std::unordered_map<std::tuple<FT_Face, int, int>, SGlyph, SGlyphKeyHash, SGlyphKeyEquals> Glyphs;
+		Glyphs.reserve(Header.m_NumGlyphs);
+		for(uint32_t i = 0; i < Header.m_NumGlyphs; ++i)
+		{
+			SAtlasCacheGlyph CachedGlyph;
+			mem_copy(&CachedGlyph, pCurrent, sizeof(CachedGlyph));
+			pCurrent += sizeof(CachedGlyph);
+
+			const FT_Face KeyFace = GetFace(CachedGlyph.m_KeyFace);
+			const FT_Face Face = GetFace(CachedGlyph.m_Face);
+			if(KeyFace == nullptr || Face == nullptr)
+				return false;
+
+			SGlyph &Glyph = Glyphs[std::make_tuple(KeyFace, (int)CachedGlyph.m_KeyChr, (int)CachedGlyph.m_KeyFontSize)];
+			Glyph.m_State = SGlyph::EState::RENDERED;
+			Glyph.m_FontSize = CachedGlyph.m_FontSize;
+			Glyph.m_Face = Face;
+			Glyph.m_Chr = CachedGlyph.m_Chr;
+			Glyph.m_GlyphIndex = CachedGlyph.m_GlyphIndex;
+			Glyph.m_Width = CachedGlyph.m_Width;
+			Glyph.m_Height = CachedGlyph.m_Height;
+			Glyph.m_CharWidth = CachedGlyph.m_CharWidth;
+			Glyph.m_CharHeight = CachedGlyph.m_CharHeight;
+			Glyph.m_OffsetX = CachedGlyph.m_OffsetX;
+			Glyph.m_OffsetY = CachedGlyph.m_OffsetY;
+			Glyph.m_AdvanceX = CachedGlyph.m_AdvanceX;
+			mem_copy(Glyph.m_aUVs, CachedGlyph.m_aUVs, sizeof(Glyph.m_aUVs));
+		}
+
+		std::vector<CAtlas::SSection> vFreeSections;
+		vFreeSections.reserve(Header.m_NumSections);
+		for(uint32_t i = 0; i < Header.m_NumSections; ++i)
+		{
+			SAtlasCacheSection CachedSection;
+			mem_copy(&CachedSection, pCurrent, sizeof(CachedSection));
+			pCurrent += sizeof(CachedSection);
+			if((size_t)CachedSection.m_X + CachedSection.m_W > Dimension || (size_t)CachedSection.m_Y + CachedSection.m_H > Dimension)
+				return false;
+			vFreeSections.emplace_back(CachedSection.m_X, CachedSection.m_Y, CachedSection.m_W, CachedSection.m_H);
+		}
+
+		UnloadTextures();
+		for(auto &pTextureData : m_apTextureData)
+		{
+			if(Dimension != m_TextureDimension)
+			{
+				delete[] pTextureData;
+				pTextureData = new uint8_t[TextureSize];
+			}
+			mem_copy(pTextureData, pCurrent, TextureSize);
+			pCurrent += TextureSize;
+		}
+		m_TextureDimension = Dimension;
+		m_TextureAtlas.Restore(Dimension, vFreeSections);
+		m_Glyphs = std::move(Glyphs);
+		m_AtlasCacheOutdated = false;
+		++m_Generation;
+		UploadTextures();
+		return true;
+	}
+
+	bool SaveAtlasCache(IOHANDLE File, const SHA256_DIGEST &Key) const
+	{
+		std::vector<SAtlasCacheGlyph> vCachedGlyphs;
+		vCachedGlyphs.reserve(m_Glyphs.size());
+		for(const auto &[GlyphKey, Glyph] : m_Glyphs)
+		{
+			if(Glyph.m_State != SGlyph::EState::RENDERED)
+				continue;
+
+			SAtlasCacheGlyph &CachedGlyph = vCachedGlyphs.emplace_back();
+			CachedGlyph.m_KeyFace = FaceIndex(std::get<0>(GlyphKey));
+			CachedGlyph.m_KeyChr = std::get<1>(GlyphKey);
+			CachedGlyph.m_KeyFontSize = std::get<2>(GlyphKey);
+			CachedGlyph.m_Face = FaceIndex(Glyph.m_Face);
+			CachedGlyph.m_Chr = Glyph.m_Chr;
+			CachedGlyph.m_FontSize = Glyph.m_FontSize;
+			CachedGlyph.m_GlyphIndex = Glyph.m_GlyphIndex;
+			CachedGlyph.m_Width = Glyph.m_Width;
+			CachedGlyph.m_Height = Glyph.m_Height;
+			CachedGlyph.m_CharWidth = Glyph.m_CharWidth;
+			CachedGlyph.m_CharHeight = Glyph.m_CharHeight;
+			CachedGlyph.m_OffsetX = Glyph.m_OffsetX;
+			CachedGlyph.m_OffsetY = Glyph.m_OffsetY;
+			CachedGlyph.m_AdvanceX = Glyph.m_AdvanceX;
+			mem_copy(CachedGlyph.m_aUVs, Glyph.m_aUVs, sizeof(CachedGlyph.m_aUVs));
+		}
+
+		std::vector<CAtlas::SSection> vFreeSections;
+		m_TextureAtlas.GetFreeSections(vFreeSections);
+		std::vector<SAtlasCacheSection> vCachedSections;
+		vCachedSections.reserve(vFreeSections.size());
+		for(const CAtlas::SSection &Section : vFreeSections)
+			vCachedSections.push_back({(uint32_t)Section.m_X, (uint32_t)Section.m_Y, (uint32_t)Section.m_W, (uint32_t)Section.m_H});
+
+		SAtlasCacheHeader Header;
+		mem_copy(Header.m_aMagic, ATLAS_CACHE_MAGIC, sizeof(Header.m_aMagic));
+		Header.m_Version = ATLAS_CACHE_VERSION;
+		Header.m_Key = Key;
+		Header.m_TextureDimension = m_TextureDimension;
+		Header.m_NumGlyphs = vCachedGlyphs.size();
+		Header.m_NumSections = vCachedSections.size();
+
+		const size_t TextureSize = m_TextureDimension * m_TextureDimension;
+		bool Success = io_write(File, &Header, sizeof(Header)) == sizeof(Header);
+		Success = Success && io_write(File, vCachedGlyphs.data(), vCachedGlyphs.size() * sizeof(SAtlasCacheGlyph)) == vCachedGlyphs.size() * sizeof(SAtlasCacheGlyph);
+		Success = Success && io_write(File, vCachedSections.data(), vCachedSections.size() * sizeof(SAtlasCacheSection)) == vCachedSections.size() * sizeof(SAtlasCacheSection);
+		for(const auto *pTextureData : m_apTextureData)
+			Success = Success && io_write(File, pTextureData, TextureSize) == TextureSize;
+		return Success;
 	}
 
 	const SGlyph *GetGlyph(int Chr, int FontSize)
@@ -901,6 +1159,132 @@ struct STextContainer
 	}
 };
 
+struct STextLayoutKey
+{
+	std::string m_Text;
+	int m_ActualSize;
+	vec2 m_FakeToScreen;
+	float m_FontSize;
+	float m_LineWidth;
+	int m_MaxLines;
+	int m_Flags;
+	unsigned m_RenderFlags;
+	EFontPreset m_FontPreset;
+
+	bool operator==(const STextLayoutKey &Other) const
+	{
+		return m_ActualSize == Other.m_ActualSize && m_FakeToScreen == Other.m_FakeToScreen && m_FontSize == Other.m_FontSize &&
+		       m_LineWidth == Other.m_LineWidth && m_MaxLines == Other.m_MaxLines && m_Flags == Other.m_Flags &&
+		       m_RenderFlags == Other.m_RenderFlags && m_FontPreset == Other.m_FontPreset && m_Text == Other.m_Text;
+	}
+};
+
+struct STextLayoutKeyHash
+{
+	size_t operator()(const STextLayoutKey &Key) const
+	{
+		size_t Hash = 17;
+		Hash = Hash * 31 + std::hash<std::string>()(Key.m_Text);
+		Hash = Hash * 31 + std::hash<int>()(Key.m_ActualSize);
+		Hash = Hash * 31 + std::hash<float>()(Key.m_FakeToScreen.x);
+		Hash = Hash * 31 + std::hash<float>()(Key.m_FakeToScreen.y);
+		Hash = Hash * 31 + std::hash<float>()(Key.m_FontSize);
+		Hash = Hash * 31 + std::hash<float>()(Key.m_LineWidth);
+		Hash = Hash * 31 + std::hash<int>()(Key.m_MaxLines);
+		Hash = Hash * 31 + std::hash<int>()(Key.m_Flags);
+		Hash = Hash * 31 + std::hash<unsigned>()(Key.m_RenderFlags);
+		Hash = Hash * 31 + std::hash<int>()((int)Key.m_FontPreset);
+		return Hash;
+	}
+};
+
+// Result of laying out a text with a fresh cursor. Positions are relative to
+// the (aligned) start of the cursor and the vertex colors are not used.
+struct STextLayout
+{
+	std::vector<STextCharQuad> m_vCharacterQuads;
+
+	int m_Flags;
+	int m_LineCount;
+	int m_GlyphCount;
+	int m_CharCount;
+	vec2 m_End;
+	bool m_GotNewLine;
+	float m_MaxCharacterHeight;
+	// relative to the start of the cursor, which can differ from the aligned start
+	float m_LongestLineWidth;
+	bool m_HasLongestLine;
+};
+
+/**
+ * Least recently used cache of text layouts, so texts that are created
+ * every frame with the same settings don't have to be laid out again.
+ */
+class CTextLayoutCache
+{
+	/**
+	 * The maximum number of layouts that are kept.
+	 */
+	static constexpr size_t MAX_ENTRIES = 1024;
+
+	using CEntry = std::pair<STextLayoutKey, STextLayout>;
+	std::list<CEntry> m_Entries;
+	std::unordered_map<STextLayoutKey, std::list<CEntry>::iterator, STextLayoutKeyHash> m_Lookup;
+	unsigned m_GlyphMapGeneration = 0;
+
+	STextLayoutCacheStats m_Stats = {0, 0, 0};
+
+public:
+	void Clear()
+	{
+		m_Entries.clear();
+		m_Lookup.clear();
+		m_Stats.m_Entries = 0;
+	}
+
+	// Layouts refer to glyphs in the atlas, so they are discarded when the glyphs change
+	void SetGlyphMapGeneration(unsigned Generation)
+	{
+		if(m_GlyphMapGeneration != Generation)
+		{
+			Clear();
+			m_GlyphMapGeneration = Generation;
+		}
+	}
+
+	const STextLayout *Find(const STextLayoutKey &Key)
+	{
+		const auto It = m_Lookup.find(Key);
+		if(It == m_Lookup.end())
+		{
+			++m_Stats.m_Misses;
+			return nullptr;
+		}
+		++m_Stats.m_Hits;
+		m_Entries.splice(m_Entries.begin(), m_Entries, It->second);
+		return &It->second->second;
+	}
+
+	void Add(STextLayoutKey &&Key, STextLayout &&Layout)
+	{
+		if(m_Lookup.find(Key) != m_Lookup.end())
+			return;
+		if(m_Entries.size() >= MAX_ENTRIES)
+		{
+			m_Lookup.erase(m_Entries.back().first);
+			m_Entries.pop_back();
+		}
+		m_Entries.emplace_front(std::move(Key), std::move(Layout));
+		m_Lookup.emplace(m_Entries.front().first, m_Entries.begin());
+		m_Stats.m_Entries = m_Entries.size();
+	}
+
+	const STextLayoutCacheStats &Stats() const
+	{
+		return m_Stats;
+	}
+};
+
 struct SFontLanguageVariant
 {
 	char m_aLanguageFile[IO_MAX_PATH_LENGTH];
@@ -919,6 +1303,12 @@ class CTextRender : public IEngineTextRender
 	CGlyphMap *m_pGlyphMap;
 	std::vector<void *> m_vpFontData;
 
+	// Rendered glyphs are kept on disk, so the atlas doesn't have to be rebuilt on every start
+	static constexpr const char *ATLAS_CACHE_FILENAME = "ddnet-text-atlas.bin";
+	SHA256_DIGEST m_AtlasCacheKey;
+	bool m_AtlasCacheKeyValid;
+	bool m_AtlasCacheLoaded;
+
 	std::vector<SFontLanguageVariant> m_vVariants;
 
 	unsigned m_RenderFlags;
@@ -937,6 +1327,9 @@ class CTextRender : public IEngineTextRender
 
 	std::chrono::nanoseconds m_CursorRenderTime;
 
+	EFontPreset m_FontPreset;
+	CTextLayoutCache m_LayoutCache;
+
 	int GetFreeTextContainerIndex()
 	{
 		if(m_FirstFreeTextContainerIndex == -1)
@@ -1043,6 +1436,41 @@ class CTextRender : public IEngineTextRender
 		return true;
 	}
 
+	void LoadAtlasCache()
+	{
+		void *pCacheData;
+		unsigned CacheDataSize;
+		if(!Storage()->ReadFile(ATLAS_CACHE_FILENAME, IStorage::TYPE_SAVE, &pCacheData, &CacheDataSize))
+			return;
+
+		const bool Loaded = m_pGlyphMap->LoadAtlasCache(static_cast<const unsigned char *>(pCacheData), CacheDataSize, m_AtlasCacheKey);
+		free(pCacheData);
+		if(Loaded)
+			log_debug("textrender", "Loaded glyph atlas cache '%s' (%" PRIzu "x%" PRIzu ")", ATLAS_CACHE_FILENAME, m_pGlyphMap->TextureDimension(), m_pGlyphMap->TextureDimension());
+		else
+			log_debug("textrender", "Ignoring outdated glyph atlas cache '%s'", ATLAS_CACHE_FILENAME);
+	}
+
+	void SaveAtlasCache()
+	{
+		if(!m_pGlyphMap->AtlasCacheOutdated())
+			return;
+
+		IOHANDLE File = Storage()->OpenFile(ATLAS_CACHE_FILENAME, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+		if(!File)
+		{
+			log_error("textrender", "Failed to open glyph atlas cache '%s' for writing", ATLAS_CACHE_FILENAME);
+			return;
+		}
+		const bool Saved = m_pGlyphMap->SaveAtlasCache(File, m_AtlasCacheKey);
+		io_close(File);
+		if(!Saved)
+		{
+			log_error("textrender", "Failed to write glyph atlas cache '%s'", ATLAS_CACHE_FILENAME);
+			Storage()->RemoveFile(ATLAS_CACHE_FILENAME, IStorage::TYPE_SAVE);
+		}
+	}
+
 	void SetRenderFlags(unsigned Flags) override
 	{
 		m_RenderFlags = Flags;
@@ -1067,8 +1495,13 @@ public:
 
 		m_FTLibrary = nullptr;
 
+		m_AtlasCacheKeyValid = false;
+		m_AtlasCacheLoaded = false;
+
 		m_RenderFlags = 0;
 		m_CursorRenderTime = time_get_nanoseconds();
+
+		m_FontPreset = EFontPreset::DEFAULT_FONT;
 	}
 
 	void Init() override
@@ -1123,7 +1556,10 @@ public:
 		for(auto *pTextCont : m_vpTextContainers)
 			delete pTextCont;
 		m_vpTextContainers.clear();
+		m_LayoutCache.Clear();
 
+		if(m_AtlasCacheKeyValid)
+			SaveAtlasCache();
 		delete m_pGlyphMap;
 		m_pGlyphMap = nullptr;
 
@@ -1169,7 +1605,9 @@ public:
 			return;
 		}
 
-		// extract font file definitions
+		// extract font file definitions, the atlas cache is only valid for the same font files
+		SHA256_CTX FontFilesHash;
+		sha256_init(&FontFilesHash);
 		const json_value &FontFiles = (*pJsonData)["font files"];
 		if(FontFiles.type == json_array)
 		{
@@ -1186,6 +1624,7 @@ public:
 				{
 					if(LoadFontCollection(aFontName, static_cast<FT_Byte *>(pFontData), (FT_Long)FontDataSize))
 					{
+						sha256_update(&FontFilesHash, pFontData, FontDataSize);
 						m_vpFontData.push_back(pFontData);
 					}
 					else
@@ -1195,6 +1634,8 @@ public:
 				}
 			}
 		}
+		m_AtlasCacheKey = m_pGlyphMap->AtlasCacheKey(sha256_finish(&FontFilesHash));
+		m_AtlasCacheKeyValid = true;
 
 		// extract default family name
 		const json_value &DefaultFace = (*pJsonData)["default"];
@@ -1245,20 +1686,29 @@ public:
 
 	void SetFontPreset(EFontPreset FontPreset) override
 	{
+		m_FontPreset = FontPreset;
 		m_pGlyphMap->SetFontPreset(FontPreset);
 	}
 
 	void SetFontLanguageVariant(const char *pLanguageFile) override
 	{
+		const char *pFamilyName = nullptr;
 		for(const auto &Variant : m_vVariants)
 		{
 			if(str_comp(pLanguageFile, Variant.m_aLanguageFile) == 0)
 			{
-				m_pGlyphMap->SetVariantFaceByName(Variant.m_aFamilyName);
-				return;
+				pFamilyName = Variant.m_aFamilyName;
+				break;
 			}
 		}
-		m_pGlyphMap->SetVariantFaceByName(nullptr);
+		m_pGlyphMap->SetVariantFaceByName(pFamilyName);
+
+		// changing the variant clears the atlas, so the cache is loaded afterwards
+		if(!m_AtlasCacheLoaded && m_AtlasCacheKeyValid)
+		{
+			LoadAtlasCache();
+			m_AtlasCacheLoaded = true;
+		}
 	}
 
 	void SetCursor(CTextCursor *pCursor, float x, float y, float FontSize, int Flags) const override
@@ -1393,6 +1843,11 @@ public:
 		return m_SelectionColor;
 	}
 
+	const STextLayoutCacheStats &LayoutCacheStats() const override
+	{
+		return m_LayoutCache.Stats();
+	}
+
 	void TextEx(CTextCursor *pCursor, const char *pText, int Length = -1) override
 	{
 		const unsigned OldRenderFlags = m_RenderFlags;
@@ -1464,6 +1919,68 @@ public:
 		}
 	}
 
+	void UpdateTextContainerBuffer(STextContainer &TextContainer)
+	{
+		// setup the buffers
+		if(!TextContainer.m_StringInfo.m_vCharacterQuads.empty() && Graphics()->IsTextBufferingEnabled())
+		{
+			const size_t DataSize = TextContainer.m_StringInfo.m_vCharacterQuads.size() * sizeof(STextCharQuad);
+			void *pUploadData = TextContainer.m_StringInfo.m_vCharacterQuads.data();
+
+			if(TextContainer.m_StringInfo.m_QuadBufferObjectIndex != -1 && (TextContainer.m_RenderFlags & TEXT_RENDER_FLAG_NO_AUTOMATIC_QUAD_UPLOAD) == 0)
+			{
+				Graphics()->RecreateBufferObject(TextContainer.m_StringInfo.m_QuadBufferObjectIndex, DataSize, pUploadData, TextContainer.m_SingleTimeUse ? IGraphics::EBufferObjectCreateFlags::BUFFER_OBJECT_CREATE_FLAGS_ONE_TIME_USE_BIT : 0);
+				Graphics()->IndicesNumRequiredNotify(TextContainer.m_StringInfo.m_vCharacterQuads.size() * 6);
+			}
+		}
+	}
+
+	// Only texts laid out from the start of a fresh cursor without selection or cursor calculation are cached
+	bool IsLayoutCacheable(const CTextCursor *pCursor) const
+	{
+		return pCursor->m_CalculateSelectionMode == TEXT_CURSOR_SELECTION_MODE_NONE && pCursor->m_CursorMode == TEXT_CURSOR_CURSOR_MODE_NONE &&
+		       pCursor->m_X == pCursor->m_StartX && pCursor->m_LineCount == 1 && pCursor->m_GlyphCount == 0 && pCursor->m_CharCount == 0 &&
+		       pCursor->m_MaxCharacterHeight == 0.0f && pCursor->m_LongestLineWidth == 0.0f;
+	}
+
+	void ApplyTextLayout(STextContainer &TextContainer, CTextCursor *pCursor, const STextLayout &Layout, vec2 Origin)
+	{
+		if((pCursor->m_Flags & TEXTFLAG_RENDER) != 0 && m_Color.a != 0.f)
+		{
+			STextCharQuadVertexColor Color;
+			Color.r = (unsigned char)(m_Color.r * 255.f);
+			Color.g = (unsigned char)(m_Color.g * 255.f);
+			Color.b = (unsigned char)(m_Color.b * 255.f);
+			Color.a = (unsigned char)(m_Color.a * 255.f);
+
+			std::vector<STextCharQuad> &vCharacterQuads = TextContainer.m_StringInfo.m_vCharacterQuads;
+			const size_t FirstQuad = vCharacterQuads.size();
+			vCharacterQuads.insert(vCharacterQuads.end(), Layout.m_vCharacterQuads.begin(), Layout.m_vCharacterQuads.end());
+			for(size_t QuadIndex = FirstQuad; QuadIndex < vCharacterQuads.size(); ++QuadIndex)
+			{
+				for(STextCharQuadVertex &Vertex : vCharacterQuads[QuadIndex].m_aVertices)
+				{
+					Vertex.m_X += Origin.x;
+					Vertex.m_Y += Origin.y;
+					Vertex.m_Color = Color;
+				}
+			}
+			UpdateTextContainerBuffer(TextContainer);
+		}
+
+		pCursor->m_Flags = Layout.m_Flags;
+		pCursor->m_GlyphCount = Layout.m_GlyphCount;
+		pCursor->m_CharCount = Layout.m_CharCount;
+		pCursor->m_MaxCharacterHeight = Layout.m_MaxCharacterHeight;
+		pCursor->m_LongestLineWidth = Layout.m_HasLongestLine ? maximum(0.0f, Layout.m_LongestLineWidth + (Origin.x - pCursor->m_StartX)) : 0.0f;
+		pCursor->m_X = Origin.x + Layout.m_End.x;
+		pCursor->m_LineCount = Layout.m_LineCount;
+		if(Layout.m_GotNewLine)
+			pCursor->m_Y = Origin.y + Layout.m_End.y;
+
+		TextContainer.m_BoundingBox = pCursor->BoundingBox();
+	}
+
 	void AppendTextContainer(STextContainerIndex TextContainerIndex, CTextCursor *pCursor, const char *pText, int Length = -1) override
 	{
 		STextContainer &TextContainer = GetTextContainer(TextContainerIndex);
@@ -1484,6 +2001,31 @@ public:
 		else
 			Length = minimum(Length, str_length(pText));
 
+		const vec2 LayoutOrigin = (TextContainer.m_RenderFlags & TEXT_RENDER_FLAG_NO_PIXEL_ALIGMENT) != 0 ? vec2(pCursor->m_X, pCursor->m_Y) : vec2(CursorX, CursorY);
+		const bool LayoutCacheable = IsLayoutCacheable(pCursor);
+		STextLayoutKey LayoutKey;
+		if(LayoutCacheable)
+		{
+			LayoutKey.m_Text.assign(pText, Length);
+			LayoutKey.m_ActualSize = ActualSize;
+			LayoutKey.m_FakeToScreen = FakeToScreen;
+			LayoutKey.m_FontSize = pCursor->m_FontSize;
+			LayoutKey.m_LineWidth = pCursor->m_LineWidth;
+			LayoutKey.m_MaxLines = pCursor->m_MaxLines;
+			LayoutKey.m_Flags = pCursor->m_Flags;
+			LayoutKey.m_RenderFlags = TextContainer.m_RenderFlags;
+			LayoutKey.m_FontPreset = m_FontPreset;
+
+			m_LayoutCache.SetGlyphMapGeneration(m_pGlyphMap->Generation());
+			const STextLayout *pLayout = m_LayoutCache.Find(LayoutKey);
+			if(pLayout != nullptr)
+			{
+				ApplyTextLayout(TextContainer, pCursor, *pLayout, LayoutOrigin);
+				return;
+			}
+		}
+		const size_t FirstQuad = TextContainer.m_StringInfo.m_vCharacterQuads.size();
+
 		const char *pCurrent = pText;
 		const char *pEnd = pCurrent + Length;
 		const char *pEllipsis = "…";
@@ -1867,20 +2409,31 @@ public:
 				GotNewLineLast = false;
 		}
 
-		if(!TextContainer.m_StringInfo.m_vCharacterQuads.empty() && IsRendered)
+		if(IsRendered)
+			UpdateTextContainerBuffer(TextContainer);
+
+		if(LayoutCacheable && !(IsRendered && m_Color.a == 0.f))
 		{
-			// setup the buffers
-			if(Graphics()->IsTextBufferingEnabled())
+			STextLayout Layout;
+			Layout.m_vCharacterQuads.assign(TextContainer.m_StringInfo.m_vCharacterQuads.begin() + FirstQuad, TextContainer.m_StringInfo.m_vCharacterQuads.end());
+			for(STextCharQuad &Quad : Layout.m_vCharacterQuads)
 			{
-				const size_t DataSize = TextContainer.m_StringInfo.m_vCharacterQuads.size() * sizeof(STextCharQuad);
-				void *pUploadData = TextContainer.m_StringInfo.m_vCharacterQuads.data();
-
-				if(TextContainer.m_StringInfo.m_QuadBufferObjectIndex != -1 && (TextContainer.m_RenderFlags & TEXT_RENDER_FLAG_NO_AUTOMATIC_QUAD_UPLOAD) == 0)
+				for(STextCharQuadVertex &Vertex : Quad.m_aVertices)
 				{
-					Graphics()->RecreateBufferObject(TextContainer.m_StringInfo.m_QuadBufferObjectIndex, DataSize, pUploadData, TextContainer.m_SingleTimeUse ? IGraphics::EBufferObjectCreateFlags::BUFFER_OBJECT_CREATE_FLAGS_ONE_TIME_USE_BIT : 0);
-					Graphics()->IndicesNumRequiredNotify(TextContainer.m_StringInfo.m_vCharacterQuads.size() * 6);
+					Vertex.m_X -= LayoutOrigin.x;
+					Vertex.m_Y -= LayoutOrigin.y;
 				}
 			}
+			Layout.m_Flags = pCursor->m_Flags;
+			Layout.m_LineCount = LineCount;
+			Layout.m_GlyphCount = pCursor->m_GlyphCount;
+			Layout.m_CharCount = pCursor->m_CharCount;
+			Layout.m_End = vec2(DrawX, DrawY) - LayoutOrigin;
+			Layout.m_GotNewLine = GotNewLine;
+			Layout.m_MaxCharacterHeight = pCursor->m_MaxCharacterHeight;
+			Layout.m_LongestLineWidth = pCursor->m_LongestLineWidth - (LayoutOrigin.x - pCursor->m_StartX);
+			Layout.m_HasLongestLine = pCursor->m_LongestLineWidth > 0.0f;
+			m_LayoutCache.Add(std::move(LayoutKey), std::move(Layout));
 		}
 
 		if(pCursor->m_CalculateSelectionMode == TEXT_CURSOR_SELECTION_MODE_CALCULATE)
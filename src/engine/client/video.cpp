@@ -4,6 +4,7 @@
 #include <engine/storage.h>
 
 #include <base/lock_scope.h>
+#include <base/math.h>
 #include <engine/client/graphics_threaded.h>
 #include <engine/sound.h>
 
@@ -11,7 +12,6 @@ extern "C" {
 #include <libavutil/avutil.h>
 #include <libavutil/opt.h>
 #include <libswresample/swresample.h>
-#include <libswscale/swscale.h>
 };
 
 #include <memory>
@@ -22,6 +22,11 @@ extern "C" {
 #include <chrono>
 #include <thread>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VIDEO_USE_SSE2
+#include <emmintrin.h>
+#endif
+
 using namespace std::chrono_literals;
 
 // This code is mostly stolen from https://github.com/FFmpeg/FFmpeg/blob/master/doc/examples/muxing.c
@@ -37,6 +42,111 @@ using namespace std::chrono_literals;
 const size_t FORMAT_GL_NCHANNELS = 4;
 LOCK g_WriteLock = 0;
 
+// BT.601 limited range, the same as the swscale default for YUV420P
+static inline uint8_t RgbToY(int R, int G, int B) { return (uint8_t)(((66 * R + 129 * G + 25 * B + 128) >> 8) + 16); }
+static inline uint8_t RgbToU(int R, int G, int B) { return (uint8_t)(((-38 * R - 74 * G + 112 * B + 128) >> 8) + 128); }
+static inline uint8_t RgbToV(int R, int G, int B) { return (uint8_t)(((112 * R - 94 * G - 18 * B + 128) >> 8) + 128); }
+
+// converts two rows starting at column X, the second row equals the first on odd heights
+static void ConvertRowPairScalar(const uint8_t *pRow0, const uint8_t *pRow1, int Width, int X, uint8_t *pY0, uint8_t *pY1, uint8_t *pU, uint8_t *pV)
+{
+	for(; X < Width; X += 2)
+	{
+		const int X1 = X + 1 < Width ? X + 1 : X;
+		const uint8_t *apPixels[4] = {pRow0 + X * 4, pRow0 + X1 * 4, pRow1 + X * 4, pRow1 + X1 * 4};
+		pY0[X] = RgbToY(apPixels[0][0], apPixels[0][1], apPixels[0][2]);
+		pY1[X] = RgbToY(apPixels[2][0], apPixels[2][1], apPixels[2][2]);
+		if(X1 != X)
+		{
+			pY0[X1] = RgbToY(apPixels[1][0], apPixels[1][1], apPixels[1][2]);
+			pY1[X1] = RgbToY(apPixels[3][0], apPixels[3][1], apPixels[3][2]);
+		}
+		int aSum[3] = {0, 0, 0};
+		for(const uint8_t *pPixel : apPixels)
+			for(int c = 0; c < 3; c++)
+				aSum[c] += pPixel[c];
+		pU[X / 2] = RgbToU((aSum[0] + 2) >> 2, (aSum[1] + 2) >> 2, (aSum[2] + 2) >> 2);
+		pV[X / 2] = RgbToV((aSum[0] + 2) >> 2, (aSum[1] + 2) >> 2, (aSum[2] + 2) >> 2);
+	}
+}
+
+#if defined(VIDEO_USE_SSE2)
+// splits 8 RGBA pixels into 16-bit R, G and B vectors
+static inline void LoadPixels8(const uint8_t *pPixels, __m128i &R, __m128i &G, __m128i &B)
+{
+	const __m128i Mask = _mm_set1_epi32(0xff);
+	const __m128i Lo = _mm_loadu_si128((const __m128i *)pPixels);
+	const __m128i Hi = _mm_loadu_si128((const __m128i *)(pPixels + 16));
+	R = _mm_packs_epi32(_mm_and_si128(Lo, Mask), _mm_and_si128(Hi, Mask));
+	G = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(Lo, 8), Mask), _mm_and_si128(_mm_srli_epi32(Hi, 8), Mask));
+	B = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(Lo, 16), Mask), _mm_and_si128(_mm_srli_epi32(Hi, 16), Mask));
+}
+
+static inline __m128i LumaFromRgb8(__m128i R, __m128i G, __m128i B)
+{
+	// the sum fits into 16 unsigned bits, so wrapping adds and a logical shift are exact
+	__m128i Sum = _mm_add_epi16(_mm_mullo_epi16(R, _mm_set1_epi16(66)), _mm_mullo_epi16(G, _mm_set1_epi16(129)));
+	Sum = _mm_add_epi16(Sum, _mm_mullo_epi16(B, _mm_set1_epi16(25)));
+	Sum = _mm_add_epi16(Sum, _mm_set1_epi16(128));
+	return _mm_add_epi16(_mm_srli_epi16(Sum, 8), _mm_set1_epi16(16));
+}
+
+static inline __m128i ChromaFromRgb8(__m128i R, __m128i G, __m128i B, short CoeffR, short CoeffG, short CoeffB)
+{
+	__m128i Sum = _mm_add_epi16(_mm_mullo_epi16(R, _mm_set1_epi16(CoeffR)), _mm_mullo_epi16(G, _mm_set1_epi16(CoeffG)));
+	Sum = _mm_add_epi16(Sum, _mm_mullo_epi16(B, _mm_set1_epi16(CoeffB)));
+	Sum = _mm_add_epi16(Sum, _mm_set1_epi16(128));
+	return _mm_add_epi16(_mm_srai_epi16(Sum, 8), _mm_set1_epi16(128));
+}
+
+// averages 2x2 blocks of two rows of 8 values into the lower 4 lanes
+static inline __m128i Average2x2(__m128i Row0, __m128i Row1)
+{
+	const __m128i Sum = _mm_madd_epi16(_mm_add_epi16(Row0, Row1), _mm_set1_epi16(1));
+	const __m128i Avg = _mm_srli_epi32(_mm_add_epi32(Sum, _mm_set1_epi32(2)), 2);
+	return _mm_packs_epi32(Avg, Avg);
+}
+#endif
+
+static void ConvertRgbaToYuv420(const uint8_t *pRgba, int Width, int Height, uint8_t *const apPlanes[3], const int aLineSizes[3])
+{
+	for(int Y = 0; Y < Height; Y += 2)
+	{
+		const uint8_t *pRow0 = pRgba + (size_t)Y * Width * 4;
+		const uint8_t *pRow1 = Y + 1 < Height ? pRow0 + (size_t)Width * 4 : pRow0;
+		uint8_t *pY0 = apPlanes[0] + (size_t)Y * aLineSizes[0];
+		uint8_t *pY1 = Y + 1 < Height ? pY0 + aLineSizes[0] : pY0;
+		uint8_t *pU = apPlanes[1] + (size_t)(Y / 2) * aLineSizes[1];
+		uint8_t *pV = apPlanes[2] + (size_t)(Y / 2) * aLineSizes[2];
+
+		int X = 0;
+#if defined(VIDEO_USE_SSE2)
+		for(; X + 8 <= Width; X += 8)
+		{
+			__m128i R0, G0, B0, R1, G1, B1;
+			LoadPixels8(pRow0 + X * 4, R0, G0, B0);
+			LoadPixels8(pRow1 + X * 4, R1, G1, B1);
+
+			const __m128i Luma0 = LumaFromRgb8(R0, G0, B0);
+			const __m128i Luma1 = LumaFromRgb8(R1, G1, B1);
+			_mm_storel_epi64((__m128i *)(pY0 + X), _mm_packus_epi16(Luma0, Luma0));
+			_mm_storel_epi64((__m128i *)(pY1 + X), _mm_packus_epi16(Luma1, Luma1));
+
+			const __m128i R = Average2x2(R0, R1);
+			const __m128i G = Average2x2(G0, G1);
+			const __m128i B = Average2x2(B0, B1);
+			const __m128i U = ChromaFromRgb8(R, G, B, -38, -74, 112);
+			const __m128i V = ChromaFromRgb8(R, G, B, 112, -94, -18);
+			const int PackedU = _mm_cvtsi128_si32(_mm_packus_epi16(U, U));
+			const int PackedV = _mm_cvtsi128_si32(_mm_packus_epi16(V, V));
+			mem_copy(pU + X / 2, &PackedU, sizeof(PackedU));
+			mem_copy(pV + X / 2, &PackedV, sizeof(PackedV));
+		}
+#endif
+		ConvertRowPairScalar(pRow0, pRow1, Width, X, pY0, pY1, pU, pV);
+	}
+}
+
 CVideo::CVideo(CGraphics_Threaded *pGraphics, ISound *pSound, IStorage *pStorage, int Width, int Height, const char *pName) :
 	m_pGraphics(pGraphics),
 	m_pStorage(pStorage),
@@ -206,23 +316,6 @@ void CVideo::Start()
 		}
 	}
 
-	m_VideoStream.m_vpSwsCtxs.reserve(m_VideoThreads);
-
-	for(size_t i = 0; i < m_VideoThreads; ++i)
-	{
-		if(m_VideoStream.m_vpSwsCtxs.size() <= i)
-			m_VideoStream.m_vpSwsCtxs.emplace_back(nullptr);
-
-		if(!m_VideoStream.m_vpSwsCtxs[i])
-		{
-			m_VideoStream.m_vpSwsCtxs[i] = sws_getCachedContext(
-				m_VideoStream.m_vpSwsCtxs[i],
-				m_VideoStream.pEnc->width, m_VideoStream.pEnc->height, AV_PIX_FMT_RGBA,
-				m_VideoStream.pEnc->width, m_VideoStream.pEnc->height, AV_PIX_FMT_YUV420P,
-				0, 0, 0, 0);
-		}
-	}
-
 	/* Write the stream header, if any. */
 	int Ret = avformat_write_header(m_pFormatContext, &m_pOptDict);
 	if(Ret < 0)
@@ -236,6 +329,10 @@ void CVideo::Start()
 	m_Started = true;
 	ms_Time = time_get();
 	m_Vframe = 0;
+	m_RecordStartTime = time_get();
+	m_ReadbackTime = 0;
+	m_ReadbackCount = 0;
+	m_FlushReadback = false;
 }
 
 void CVideo::Pause(bool Pause)
@@ -248,6 +345,14 @@ void CVideo::Stop()
 {
 	m_pGraphics->WaitForIdle();
 
+	// frames are read back one frame late, run an empty command buffer to encode the last one
+	if(m_Recording)
+	{
+		m_FlushReadback = true;
+		m_pGraphics->KickCommandBuffer();
+		m_pGraphics->WaitForIdle();
+	}
+
 	for(size_t i = 0; i < m_VideoThreads; ++i)
 	{
 		{
@@ -282,6 +387,11 @@ void CVideo::Stop()
 	if(m_HasAudio)
 		FinishFrames(&m_AudioStream);
 
+	const double Seconds = (time_get() - m_RecordStartTime) / (double)time_freq();
+	const int64_t NumFrames = m_VideoStream.pEnc->FRAME_NUM;
+	dbg_msg("video_recorder", "recorded %" PRId64 " frames in %.2f s (%.1f fps), reading a frame took %.3f ms on average",
+		NumFrames, Seconds, NumFrames / maximum(Seconds, 0.001), m_ReadbackCount ? m_ReadbackTime * 1000.0 / time_freq() / m_ReadbackCount : 0.0);
+
 	av_write_trailer(m_pFormatContext);
 
 	CloseStream(&m_VideoStream);
@@ -343,7 +453,13 @@ void CVideo::NextVideoFrameThread()
 					pVideoThread->m_Cond.wait(Lock, [&pVideoThread]() -> bool { return !pVideoThread->m_HasVideoFrame; });
 				}
 
-				ReadRGBFromGL(m_CurVideoThreadIndex);
+				if(!ReadRGBFromGL(m_CurVideoThreadIndex, m_FlushReadback) && m_FlushReadback)
+				{
+					// no read was queued, the last frame is already encoded
+					m_VSeq -= 1;
+					m_ProcessingVideoFrame.fetch_sub(1);
+					return;
+				}
 
 				pVideoThread->m_HasVideoFrame = true;
 				{
@@ -575,18 +691,24 @@ void CVideo::RunVideoThread(size_t ParentThreadIndex, size_t ThreadIndex)
 
 void CVideo::FillVideoFrame(size_t ThreadIndex)
 {
-	const int InLineSize = 4 * m_VideoStream.pEnc->width;
-	auto *pRGBAData = m_vPixelHelper[ThreadIndex].data();
-	sws_scale(m_VideoStream.m_vpSwsCtxs[ThreadIndex], (const uint8_t *const *)&pRGBAData, &InLineSize, 0,
-		m_VideoStream.pEnc->height, m_VideoStream.m_vpFrames[ThreadIndex]->data, m_VideoStream.m_vpFrames[ThreadIndex]->linesize);
+	const int Width = m_VideoStream.pEnc->width;
+	const int Height = m_VideoStream.pEnc->height;
+	if(m_vPixelHelper[ThreadIndex].size() < (size_t)Width * Height * FORMAT_GL_NCHANNELS)
+		return;
+	AVFrame *pFrame = m_VideoStream.m_vpFrames[ThreadIndex];
+	ConvertRgbaToYuv420(m_vPixelHelper[ThreadIndex].data(), Width, Height, pFrame->data, pFrame->linesize);
 }
 
-void CVideo::ReadRGBFromGL(size_t ThreadIndex)
+bool CVideo::ReadRGBFromGL(size_t ThreadIndex, bool Flush)
 {
 	uint32_t Width;
 	uint32_t Height;
 	uint32_t Format;
-	m_pGraphics->GetReadPresentedImageDataFuncUnsafe()(Width, Height, Format, m_vPixelHelper[ThreadIndex]);
+	const int64_t StartTime = time_get();
+	const bool Read = m_pGraphics->GetReadPresentedImageDataFuncUnsafe()(Width, Height, Format, m_vPixelHelper[ThreadIndex], Flush);
+	m_ReadbackTime += time_get() - StartTime;
+	m_ReadbackCount++;
+	return Read;
 }
 
 AVFrame *CVideo::AllocPicture(enum AVPixelFormat PixFmt, int Width, int Height)
@@ -1022,10 +1144,6 @@ void CVideo::CloseStream(OutputStream *pStream)
 		av_frame_free(&pFrame);
 	pStream->m_vpTmpFrames.clear();
 
-	for(auto *pSwsContext : pStream->m_vpSwsCtxs)
-		sws_freeContext(pSwsContext);
-	pStream->m_vpSwsCtxs.clear();
-
 	for(auto *pSwrContext : pStream->m_vpSwrCtxs)
 		swr_free(&pSwrContext);
 	pStream->m_vpSwrCtxs.clear();
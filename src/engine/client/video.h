@@ -37,7 +37,6 @@ struct OutputStream
 	std::vector<AVFrame *> m_vpFrames;
 	std::vector<AVFrame *> m_vpTmpFrames;
 
-	std::vector<struct SwsContext *> m_vpSwsCtxs;
 	std::vector<struct SwrContext *> m_vpSwrCtxs;
 };
 
@@ -65,7 +64,7 @@ public:
 private:
 	void RunVideoThread(size_t ParentThreadIndex, size_t ThreadIndex) REQUIRES(!g_WriteLock);
 	void FillVideoFrame(size_t ThreadIndex) REQUIRES(!g_WriteLock);
-	void ReadRGBFromGL(size_t ThreadIndex);
+	bool ReadRGBFromGL(size_t ThreadIndex, bool Flush);
 
 	void RunAudioThread(size_t ParentThreadIndex, size_t ThreadIndex) REQUIRES(!g_WriteLock);
 	void FillAudioFrame(size_t ThreadIndex);
@@ -98,6 +97,13 @@ private:
 	bool m_Started;
 	bool m_Recording;
 
+	int64_t m_RecordStartTime = 0;
+	// written by the backend thread
+	std::atomic<int64_t> m_ReadbackTime{0};
+	std::atomic<int64_t> m_ReadbackCount{0};
+	// set when stopping, to fetch the frame whose read is still queued
+	std::atomic<bool> m_FlushReadback{false};
+
 	size_t m_VideoThreads = 2;
 	size_t m_CurVideoThreadIndex = 0;
 	size_t m_AudioThreads = 2;
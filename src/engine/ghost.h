@@ -6,6 +6,8 @@
 
 #include "kernel.h"
 
+#include <memory>
+
 class CGhostInfo
 {
 public:
@@ -38,10 +40,20 @@ public:
 	virtual void Close() = 0;
 
 	virtual const CGhostInfo *GetInfo() const = 0;
+	// the last error of Load or a read, empty if there was none
+	virtual const char *Error() const = 0;
 
 	virtual bool ReadNextType(int *pType) = 0;
 	virtual bool ReadData(int Type, void *pData, int Size) = 0;
 
+	// only ghosts with an item index (version 7+) can seek, the next read then returns item Index
+	virtual bool HasItemIndex() const = 0;
+	virtual bool SeekToItem(int Index) = 0;
+
+	// a loader of its own, e.g. to read a ghost on a job thread. It doesn't
+	// print errors to the console, see Error
+	virtual std::unique_ptr<IGhostLoader> CreateLoader() const = 0;
+
 	virtual bool GetGhostInfo(const char *pFilename, CGhostInfo *pInfo, const char *pMap, SHA256_DIGEST MapSha256, unsigned MapCrc) = 0;
 };
 
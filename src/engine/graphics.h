@@ -207,7 +207,8 @@ namespace client_data7 {
 struct CDataSprite; // NOLINT(bugprone-forward-declaration-namespace)
 }
 
-typedef std::function<bool(uint32_t &Width, uint32_t &Height, uint32_t &Format, std::vector<uint8_t> &vDstData)> TGLBackendReadPresentedImageData;
+// With Flush set, only a frame whose read is still queued in the backend is returned.
+typedef std::function<bool(uint32_t &Width, uint32_t &Height, uint32_t &Format, std::vector<uint8_t> &vDstData, bool Flush)> TGLBackendReadPresentedImageData;
 
 class IGraphics : public IInterface
 {
@@ -301,6 +302,10 @@ public:
 	virtual const TTWGraphicsGPUList &GetGPUs() const = 0;
 
 	virtual int LoadPNG(CImageInfo *pImg, const char *pFilename, int StorageType) = 0;
+	// Thread safe part of LoadPNG, the returned pnglite incompatibilities
+	// must be passed to ReportPngliteIncompatible on the main thread.
+	virtual bool DecodePNG(CImageInfo *pImg, const char *pFilename, int StorageType, int &PngliteIncompatible) = 0;
+	virtual void ReportPngliteIncompatible(const char *pFilename, int PngliteIncompatible) = 0;
 	virtual void FreePNG(CImageInfo *pImg) = 0;
 
 	virtual bool CheckImageDivisibility(const char *pFileName, CImageInfo &Img, int DivX, int DivY, bool AllowResize) = 0;
@@ -316,6 +321,9 @@ public:
 	virtual CTextureHandle LoadTextureRaw(size_t Width, size_t Height, int Format, const void *pData, int StoreFormat, int Flags, const char *pTexName = nullptr) = 0;
 	virtual int LoadTextureRawSub(CTextureHandle TextureID, int x, int y, size_t Width, size_t Height, int Format, const void *pData) = 0;
 	virtual CTextureHandle LoadTexture(const char *pFilename, int StorageType, int StoreFormat, int Flags) = 0;
+	// decodes the image on the job pool, the returned texture is transparent until the upload is done
+	// and shows the invalid texture if the image can't be loaded
+	virtual CTextureHandle LoadTextureAsync(const char *pFilename, int StorageType, int StoreFormat, int Flags) = 0;
 	virtual CTextureHandle InvalidTexture() const = 0;
 	virtual void TextureSet(CTextureHandle Texture) = 0;
 	void TextureClear() { TextureSet(CTextureHandle()); }
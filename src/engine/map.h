@@ -33,6 +33,8 @@ class IEngineMap : public IMap
 	MACRO_INTERFACE("enginemap", 0)
 public:
 	virtual bool Load(const char *pMapName) = 0;
+	// takes ownership of the map data, which must have been allocated with malloc
+	virtual bool LoadData(void *pData, unsigned Size) = 0;
 	virtual void Unload() = 0;
 	virtual bool IsLoaded() const = 0;
 	virtual IOHANDLE File() const = 0;
@@ -17,6 +17,8 @@
 #include <game/generated/protocolglue.h>
 
 struct CAntibotRoundData;
+class CJsonWriter;
+class CTickProfiler;
 
 // When recording a demo on the server, the ClientID -1 is used
 enum
@@ -237,6 +239,15 @@ public:
 	virtual void RedirectClient(int ClientID, int Port, bool Verbose = false) = 0;
 	virtual void ChangeMap(const char *pMap) = 0;
 
+	// Structured events for econ clients, see ECON_EVENT_* in engine/shared/econ.h.
+	// Returns nullptr if nobody is subscribed, otherwise attributes can be
+	// written before calling EconEndEvent.
+	virtual CJsonWriter *EconBeginEvent(int Event) = 0;
+	virtual void EconEndEvent() = 0;
+
+	// Time spent in tick phases, see engine/shared/tick_profiler.h.
+	virtual CTickProfiler *TickProfiler() = 0;
+
 	virtual void DemoRecorder_HandleAutoStart() = 0;
 
 	// DDRace
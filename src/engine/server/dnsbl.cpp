@@ -0,0 +1,159 @@
+#include "dnsbl.h"
+
+class CDnsblLookupJob : public IJob
+{
+	CDnsbl::FLookup m_pfnLookup;
+
+	void Run() override
+	{
+		m_Listed = m_pfnLookup(m_aHostname);
+	}
+
+public:
+	CDnsblLookupJob(CDnsbl::FLookup pfnLookup, unsigned Generation, unsigned Key) :
+		m_pfnLookup(pfnLookup), m_Generation(Generation), m_Key(Key), m_Listed(false)
+	{
+		m_aHostname[0] = '\0';
+	}
+
+	unsigned m_Generation;
+	unsigned m_Key;
+	char m_aHostname[256];
+	bool m_Listed;
+};
+
+static bool HostLookup(const char *pHostname)
+{
+	NETADDR Addr;
+	return net_host_lookup(pHostname, &Addr, NETTYPE_IPV4) == 0;
+}
+
+CDnsbl::CDnsbl(FLookup pfnLookup) :
+	m_pfnLookup(pfnLookup ? pfnLookup : HostLookup)
+{
+	m_aHost[0] = '\0';
+	m_aKey[0] = '\0';
+}
+
+unsigned CDnsbl::Key(const NETADDR *pAddr)
+{
+	return (pAddr->ip[0] << 24) | (pAddr->ip[1] << 16) | (pAddr->ip[2] << 8) | pAddr->ip[3];
+}
+
+int CDnsbl::Query(const NETADDR *pAddr, const char *pHost, const char *pKey)
+{
+	//TODO: support ipv6
+	if(pAddr->type != NETTYPE_IPV4 && pAddr->type != NETTYPE_WEBSOCKET_IPV4)
+		return STATE_NONE;
+
+	// the cached results belong to the old provider
+	if(str_comp(m_aHost, pHost) != 0 || str_comp(m_aKey, pKey) != 0)
+	{
+		Clear();
+		str_copy(m_aHost, pHost);
+		str_copy(m_aKey, pKey);
+	}
+
+	m_Stats.m_Queries++;
+	const unsigned Key = CDnsbl::Key(pAddr);
+	auto Entry = m_Entries.find(Key);
+	if(Entry != m_Entries.end())
+	{
+		if(Entry->second.m_State == STATE_PENDING)
+			m_Stats.m_Coalesced++;
+		else
+			m_Stats.m_CacheHits++;
+		return Entry->second.m_State;
+	}
+
+	m_Entries[Key] = {STATE_PENDING, 0};
+	m_vQueued.push_back(Key);
+	m_NumPending++;
+	return STATE_PENDING;
+}
+
+int CDnsbl::State(const NETADDR *pAddr) const
+{
+	if(pAddr->type != NETTYPE_IPV4 && pAddr->type != NETTYPE_WEBSOCKET_IPV4)
+		return STATE_NONE;
+	auto Entry = m_Entries.find(Key(pAddr));
+	return Entry == m_Entries.end() ? STATE_NONE : Entry->second.m_State;
+}
+
+bool CDnsbl::Update(int64_t Now, int64_t ListedTtl, int64_t NotListedTtl)
+{
+	// collect finished lookups
+	bool Resolved = m_Cleared;
+	m_Cleared = false;
+	for(auto It = m_vpJobs.begin(); It != m_vpJobs.end();)
+	{
+		CDnsblLookupJob *pJob = It->get();
+		if(pJob->Status() != IJob::STATE_DONE)
+		{
+			++It;
+			continue;
+		}
+		auto Entry = m_Entries.find(pJob->m_Key);
+		if(pJob->m_Generation == m_Generation && Entry != m_Entries.end() && Entry->second.m_State == STATE_PENDING)
+		{
+			Entry->second.m_State = pJob->m_Listed ? STATE_LISTED : STATE_NOT_LISTED;
+			Entry->second.m_Expires = Now + (pJob->m_Listed ? ListedTtl : NotListedTtl);
+			m_Expiries.emplace(Entry->second.m_Expires, pJob->m_Key);
+			if(pJob->m_Listed)
+				m_Stats.m_Listed++;
+			else
+				m_Stats.m_NotListed++;
+			m_NumPending--;
+			Resolved = true;
+		}
+		It = m_vpJobs.erase(It);
+	}
+
+	// drop expired results, pending entries stay until their lookup is done
+	while(!m_Expiries.empty() && m_Expiries.top().first < Now)
+	{
+		auto Entry = m_Entries.find(m_Expiries.top().second);
+		if(Entry != m_Entries.end() && Entry->second.m_State != STATE_PENDING && Entry->second.m_Expires == m_Expiries.top().first)
+		{
+			m_Entries.erase(Entry);
+			m_Stats.m_Expired++;
+		}
+		m_Expiries.pop();
+	}
+
+	// start the lookups queued since the last update as one batch
+	if(m_vQueued.empty())
+		return Resolved;
+	if(!m_JobPoolStarted)
+	{
+		m_JobPool.Init(NUM_THREADS);
+		m_JobPoolStarted = true;
+	}
+	for(const unsigned Key : m_vQueued)
+	{
+		auto pJob = std::make_shared<CDnsblLookupJob>(m_pfnLookup, m_Generation, Key);
+		const unsigned char aIp[4] = {(unsigned char)(Key >> 24), (unsigned char)(Key >> 16), (unsigned char)(Key >> 8), (unsigned char)Key};
+		if(m_aKey[0] == '\0')
+			str_format(pJob->m_aHostname, sizeof(pJob->m_aHostname), "%d.%d.%d.%d.%s", aIp[3], aIp[2], aIp[1], aIp[0], m_aHost);
+		else
+			str_format(pJob->m_aHostname, sizeof(pJob->m_aHostname), "%s.%d.%d.%d.%d.%s", m_aKey, aIp[3], aIp[2], aIp[1], aIp[0], m_aHost);
+		m_vpJobs.push_back(pJob);
+		m_JobPool.Add(std::move(pJob));
+	}
+	m_Stats.m_Lookups += m_vQueued.size();
+	m_Stats.m_Batches++;
+	m_vQueued.clear();
+
+	return Resolved;
+}
+
+void CDnsbl::Clear()
+{
+	// lookups still running are ignored when they finish
+	m_Generation++;
+	m_Entries.clear();
+	m_Expiries = {};
+	m_vQueued.clear();
+	m_NumPending = 0;
+	m_Cleared = true;
+}
@@ -0,0 +1,97 @@
+#ifndef ENGINE_SERVER_DNSBL_H
+#define ENGINE_SERVER_DNSBL_H
+
+#include <base/system.h>
+#include <engine/shared/jobs.h>
+
+#include <functional>
+#include <memory>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+class CDnsblLookupJob;
+
+// Resolves DNSBL queries on its own job pool. Results are cached per address
+// so clients from the same address share one lookup, finished lookups are
+// collected once per tick instead of being polled per client. The lookups
+// queued during a tick are started together, each on its own job because
+// they block on the resolver.
+class CDnsbl
+{
+public:
+	// returns true if the hostname resolves, i.e. the address is listed
+	typedef bool (*FLookup)(const char *pHostname);
+
+	enum
+	{
+		STATE_NONE = 0,
+		STATE_PENDING,
+		STATE_LISTED,
+		STATE_NOT_LISTED,
+	};
+
+	enum
+	{
+		// lookups resolved concurrently
+		NUM_THREADS = 16,
+	};
+
+	struct SStats
+	{
+		int64_t m_Queries = 0;
+		int64_t m_CacheHits = 0;
+		int64_t m_Coalesced = 0;
+		int64_t m_Lookups = 0;
+		int64_t m_Batches = 0;
+		int64_t m_Listed = 0;
+		int64_t m_NotListed = 0;
+		int64_t m_Expired = 0;
+	};
+
+	CDnsbl(FLookup pfnLookup = nullptr);
+
+	// Returns the cached state or STATE_PENDING if a lookup has been queued.
+	// Only IPv4 is supported, STATE_NONE is returned for other addresses.
+	int Query(const NETADDR *pAddr, const char *pHost, const char *pKey);
+	int State(const NETADDR *pAddr) const;
+	// Collects finished lookups, drops expired entries and starts queued
+	// lookups. Now and the TTLs share one unit. Returns true if any pending
+	// entry got its result or the cache was cleared.
+	bool Update(int64_t Now, int64_t ListedTtl, int64_t NotListedTtl);
+	void Clear();
+
+	int NumEntries() const { return m_Entries.size(); }
+	int NumPending() const { return m_NumPending; }
+	const SStats &Stats() const { return m_Stats; }
+
+private:
+	struct SEntry
+	{
+		int m_State;
+		int64_t m_Expires;
+	};
+
+	FLookup m_pfnLookup;
+	CJobPool m_JobPool; // started with the first lookup
+	bool m_JobPoolStarted = false;
+
+	char m_aHost[128];
+	char m_aKey[128];
+	unsigned m_Generation = 0;
+	bool m_Cleared = false;
+
+	std::unordered_map<unsigned, SEntry> m_Entries;
+	// expiry time and key of the resolved entries, the earliest first. Items
+	// whose entry was dropped or replaced are skipped.
+	typedef std::pair<int64_t, unsigned> CExpiry;
+	std::priority_queue<CExpiry, std::vector<CExpiry>, std::greater<CExpiry>> m_Expiries;
+	std::vector<unsigned> m_vQueued;
+	std::vector<std::shared_ptr<CDnsblLookupJob>> m_vpJobs;
+	int m_NumPending = 0;
+	SStats m_Stats;
+
+	static unsigned Key(const NETADDR *pAddr);
+};
+
+#endif // ENGINE_SERVER_DNSBL_H
@@ -76,12 +76,15 @@ int main(int argc, const char **argv)
 		pStdoutLogger = std::shared_ptr<ILogger>(log_logger_stdout());
 	}
 #endif
+	// stdout and the log file are written from a background thread
+	std::vector<std::shared_ptr<ILogger>> vpOutputLoggers;
 	if(pStdoutLogger)
 	{
-		vpLoggers.push_back(pStdoutLogger);
+		vpOutputLoggers.push_back(pStdoutLogger);
 	}
 	std::shared_ptr<CFutureLogger> pFutureFileLogger = std::make_shared<CFutureLogger>();
-	vpLoggers.push_back(pFutureFileLogger);
+	vpOutputLoggers.push_back(pFutureFileLogger);
+	vpLoggers.push_back(log_logger_threaded(log_logger_collection(std::move(vpOutputLoggers))));
 	std::shared_ptr<CFutureLogger> pFutureConsoleLogger = std::make_shared<CFutureLogger>();
 	vpLoggers.push_back(pFutureConsoleLogger);
 	std::shared_ptr<CFutureLogger> pFutureAssertionLogger = std::make_shared<CFutureLogger>();
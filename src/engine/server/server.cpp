@@ -23,6 +23,8 @@
 #include <engine/shared/filecollection.h>
 #include <engine/shared/http.h>
 #include <engine/shared/json.h>
+#include <engine/shared/jsonwriter.h>
+#include <engine/shared/mapstore.h>
 #include <engine/shared/masterserver.h>
 #include <engine/shared/netban.h>
 #include <engine/shared/network.h>
@@ -32,6 +34,7 @@
 #include <engine/shared/protocol_ex.h>
 #include <engine/shared/rust_version.h>
 #include <engine/shared/snapshot.h>
+#include <engine/shared/tick_profiler.h>
 
 #include <game/version.h>
 
@@ -149,7 +152,7 @@ void CServerBan::InitServerBan(IConsole *pConsole, IStorage *pStorage, CServer *
 }
 
 template<class T>
-int CServerBan::BanExt(T *pBanPool, const typename T::CDataType *pData, int Seconds, const char *pReason)
+int CServerBan::BanExt(T *pBanPool, const typename T::CDataType *pData, int Seconds, const char *pReason, bool Verbose)
 {
 	// validate address
 	if(Server()->m_RconClientID >= 0 && Server()->m_RconClientID < MAX_CLIENTS &&
@@ -157,7 +160,8 @@ int CServerBan::BanExt(T *pBanPool, const typename T::CDataType *pData, int Seco
 	{
 		if(NetMatch(pData, Server()->m_NetServer.ClientAddr(Server()->m_RconClientID)))
 		{
-			Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", "ban error (you can't ban yourself)");
+			if(Verbose)
+				Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", "ban error (you can't ban yourself)");
 			return -1;
 		}
 
@@ -168,7 +172,8 @@ int CServerBan::BanExt(T *pBanPool, const typename T::CDataType *pData, int Seco
 
 			if(Server()->m_aClients[i].m_Authed >= Server()->m_RconAuthLevel && NetMatch(pData, Server()->m_NetServer.ClientAddr(i)))
 			{
-				Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", "ban error (command denied)");
+				if(Verbose)
+					Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", "ban error (command denied)");
 				return -1;
 			}
 		}
@@ -182,13 +187,14 @@ int CServerBan::BanExt(T *pBanPool, const typename T::CDataType *pData, int Seco
 
 			if(Server()->m_aClients[i].m_Authed != AUTHED_NO && NetMatch(pData, Server()->m_NetServer.ClientAddr(i)))
 			{
-				Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", "ban error (command denied)");
+				if(Verbose)
+					Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", "ban error (command denied)");
 				return -1;
 			}
 		}
 	}
 
-	int Result = Ban(pBanPool, pData, Seconds, pReason);
+	int Result = Ban(pBanPool, pData, Seconds, pReason, Verbose);
 	if(Result != 0)
 		return Result;
 
@@ -211,17 +217,18 @@ int CServerBan::BanExt(T *pBanPool, const typename T::CDataType *pData, int Seco
 	return Result;
 }
 
-int CServerBan::BanAddr(const NETADDR *pAddr, int Seconds, const char *pReason)
+int CServerBan::BanAddr(const NETADDR *pAddr, int Seconds, const char *pReason, bool Verbose)
 {
-	return BanExt(&m_BanAddrPool, pAddr, Seconds, pReason);
+	return BanExt(&m_BanAddrPool, pAddr, Seconds, pReason, Verbose);
 }
 
-int CServerBan::BanRange(const CNetRange *pRange, int Seconds, const char *pReason)
+int CServerBan::BanRange(const CNetRange *pRange, int Seconds, const char *pReason, bool Verbose)
 {
 	if(pRange->IsValid())
-		return BanExt(&m_BanRangePool, pRange, Seconds, pReason);
+		return BanExt(&m_BanRangePool, pRange, Seconds, pReason, Verbose);
 
-	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", "ban failed (invalid range)");
+	if(Verbose)
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", "ban failed (invalid range)");
 	return -1;
 }
 
@@ -594,10 +601,46 @@ void CServer::SendLogLine(const CLogMessage *pMessage)
 	}
 	if(pMessage->m_Level <= IConsole::ToLogLevelFilter(g_Config.m_EcOutputLevel))
 	{
-		m_Econ.Send(-1, pMessage->m_aLine);
+		m_Econ.SendLog(pMessage);
+	}
+}
+
+void CServer::SendTickEvent()
+{
+	const CTickProfiler::CInterval &Ticks = m_TickProfiler.Interval(PROFILE_TICK);
+	if(Ticks.m_Count == 0)
+		return;
+
+	if(CJsonWriter *pJson = EconBeginEvent(ECON_EVENT_TICK))
+	{
+		pJson->WriteAttribute("ticks");
+		pJson->WriteIntValue((int)Ticks.m_Count);
+		pJson->WriteAttribute("avg_us");
+		pJson->WriteIntValue((int)(Ticks.m_TimeSum / Ticks.m_Count));
+		pJson->WriteAttribute("max_us");
+		pJson->WriteIntValue((int)Ticks.m_TimeMax);
+		pJson->WriteAttribute("players");
+		pJson->WriteIntValue(ClientCount());
+		EconEndEvent();
 	}
 }
 
+CJsonWriter *CServer::EconBeginEvent(int Event)
+{
+	CJsonWriter *pJson = m_Econ.BeginEvent(Event);
+	if(pJson)
+	{
+		pJson->WriteAttribute("tick");
+		pJson->WriteIntValue(m_CurrentGameTick);
+	}
+	return pJson;
+}
+
+void CServer::EconEndEvent()
+{
+	m_Econ.EndEvent();
+}
+
 void CServer::SetRconCID(int ClientID)
 {
 	m_RconClientID = ClientID;
@@ -1129,28 +1172,42 @@ int CServer::NewClientCallback(int ClientID, void *pUser, bool Sixup)
 
 void CServer::InitDnsbl(int ClientID)
 {
-	NETADDR Addr = *m_NetServer.ClientAddr(ClientID);
-
-	//TODO: support ipv6
-	if(Addr.type != NETTYPE_IPV4)
-		return;
+	// clients from the same address share one cached lookup
+	m_Dnsbl.Query(m_NetServer.ClientAddr(ClientID), Config()->m_SvDnsblHost, Config()->m_SvDnsblKey);
+	UpdateDnsbl(ClientID);
+}
 
-	// build dnsbl host lookup
-	char aBuf[256];
-	if(Config()->m_SvDnsblKey[0] == '\0')
+void CServer::UpdateDnsbl(int ClientID)
+{
+	switch(m_Dnsbl.State(m_NetServer.ClientAddr(ClientID)))
 	{
-		// without key
-		str_format(aBuf, sizeof(aBuf), "%d.%d.%d.%d.%s", Addr.ip[3], Addr.ip[2], Addr.ip[1], Addr.ip[0], Config()->m_SvDnsblHost);
-	}
-	else
+	case CDnsbl::STATE_NONE:
+		// the cache was cleared, query again
+		m_aClients[ClientID].m_DnsblState = CClient::DNSBL_STATE_NONE;
+		break;
+	case CDnsbl::STATE_PENDING:
+		m_aClients[ClientID].m_DnsblState = CClient::DNSBL_STATE_PENDING;
+		break;
+	case CDnsbl::STATE_NOT_LISTED:
+		// entry not found -> whitelisted
+		m_aClients[ClientID].m_DnsblState = CClient::DNSBL_STATE_WHITELISTED;
+		break;
+	case CDnsbl::STATE_LISTED:
 	{
-		// with key
-		str_format(aBuf, sizeof(aBuf), "%s.%d.%d.%d.%d.%s", Config()->m_SvDnsblKey, Addr.ip[3], Addr.ip[2], Addr.ip[1], Addr.ip[0], Config()->m_SvDnsblHost);
-	}
+		// entry found -> blacklisted
+		m_aClients[ClientID].m_DnsblState = CClient::DNSBL_STATE_BLACKLISTED;
 
-	IEngine *pEngine = Kernel()->RequestInterface<IEngine>();
-	pEngine->AddJob(m_aClients[ClientID].m_pDnsblLookup = std::make_shared<CHostLookup>(aBuf, NETTYPE_IPV4));
-	m_aClients[ClientID].m_DnsblState = CClient::DNSBL_STATE_PENDING;
+		// console output
+		char aAddrStr[NETADDR_MAXSTRSIZE];
+		net_addr_str(m_NetServer.ClientAddr(ClientID), aAddrStr, sizeof(aAddrStr), true);
+
+		char aBuf[256];
+		str_format(aBuf, sizeof(aBuf), "ClientID=%d addr=<{%s}> secure=%s blacklisted", ClientID, aAddrStr, m_NetServer.HasSecurityToken(ClientID) ? "yes" : "no");
+
+		Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "dnsbl", aBuf);
+		break;
+	}
+	}
 }
 
 #ifdef CONF_FAMILY_UNIX
@@ -2527,10 +2584,26 @@ int CServer::LoadMap(const char *pMapName)
 
 	char aBuf[IO_MAX_PATH_LENGTH];
 	str_format(aBuf, sizeof(aBuf), "maps/%s.map", pMapName);
-	GameServer()->OnMapChange(aBuf, sizeof(aBuf));
 
-	if(!m_pMap->Load(aBuf))
-		return 0;
+	// maps that are not on disk are loaded from the map store in memory
+	void *pStoredMap = nullptr;
+	unsigned StoredMapSize = 0;
+	if(Config()->m_SvMapStore[0] && !Storage()->FileExists(aBuf, IStorage::TYPE_ALL) && ReadStoredMap(pMapName, &pStoredMap, &StoredMapSize))
+	{
+		void *pMapData = malloc(StoredMapSize);
+		mem_copy(pMapData, pStoredMap, StoredMapSize);
+		if(!m_pMap->LoadData(pMapData, StoredMapSize))
+		{
+			free(pStoredMap);
+			return 0;
+		}
+	}
+	else
+	{
+		GameServer()->OnMapChange(aBuf, sizeof(aBuf));
+		if(!m_pMap->Load(aBuf))
+			return 0;
+	}
 
 	// stop recording when we change map
 	for(int i = 0; i < MAX_CLIENTS + 1; i++)
@@ -2566,8 +2639,11 @@ int CServer::LoadMap(const char *pMapName)
 	// load complete map into memory for download
 	{
 		free(m_apCurrentMapData[MAP_TYPE_SIX]);
-		void *pData;
-		Storage()->ReadFile(aBuf, IStorage::TYPE_ALL, &pData, &m_aCurrentMapSize[MAP_TYPE_SIX]);
+		void *pData = pStoredMap;
+		if(pData)
+			m_aCurrentMapSize[MAP_TYPE_SIX] = StoredMapSize;
+		else
+			Storage()->ReadFile(aBuf, IStorage::TYPE_ALL, &pData, &m_aCurrentMapSize[MAP_TYPE_SIX]);
 		m_apCurrentMapData[MAP_TYPE_SIX] = (unsigned char *)pData;
 	}
 
@@ -2611,6 +2687,18 @@ int CServer::LoadMap(const char *pMapName)
 	return 1;
 }
 
+bool CServer::ReadStoredMap(const char *pMapName, void **ppData, unsigned *pSize)
+{
+	CMapStore Store(Storage(), Config()->m_SvMapStore, IStorage::TYPE_ALL);
+	if(!Store.HasMap(pMapName) || !Store.ReadMap(pMapName, ppData, pSize))
+		return false;
+
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "loaded map '%s' from map store '%s'", pMapName, Config()->m_SvMapStore);
+	Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "server", aBuf);
+	return true;
+}
+
 int CServer::Run()
 {
 	if(m_RunServer == UNINITIALIZED)
@@ -2732,8 +2820,14 @@ int CServer::Run()
 		UpdateServerInfo();
 		while(m_RunServer < STOPPING)
 		{
+			// the tick event is built from the profiler
+			m_TickProfiler.SetEnabled(Config()->m_SvTickProfile || m_Econ.Subscribed(ECON_EVENT_TICK));
+
 			if(NonActive)
+			{
+				CProfileScope Profile(&m_TickProfiler, PROFILE_NETWORK);
 				PumpNetwork(PacketWaiting);
+			}
 
 			set_new_tick();
 
@@ -2793,6 +2887,8 @@ int CServer::Run()
 			// handle dnsbl
 			if(Config()->m_SvDnsbl)
 			{
+				CProfileScope Profile(&m_TickProfiler, PROFILE_DNSBL);
+				const bool DnsblResolved = m_Dnsbl.Update(t, Config()->m_SvDnsblCacheTtl * time_freq(), Config()->m_SvDnsblCacheNegativeTtl * time_freq());
 				for(int ClientID = 0; ClientID < MAX_CLIENTS; ClientID++)
 				{
 					if(m_aClients[ClientID].m_State == CClient::STATE_EMPTY)
@@ -2803,27 +2899,9 @@ int CServer::Run()
 						// initiate dnsbl lookup
 						InitDnsbl(ClientID);
 					}
-					else if(m_aClients[ClientID].m_DnsblState == CClient::DNSBL_STATE_PENDING &&
-						m_aClients[ClientID].m_pDnsblLookup->Status() == IJob::STATE_DONE)
+					else if(m_aClients[ClientID].m_DnsblState == CClient::DNSBL_STATE_PENDING && DnsblResolved)
 					{
-						if(m_aClients[ClientID].m_pDnsblLookup->m_Result != 0)
-						{
-							// entry not found -> whitelisted
-							m_aClients[ClientID].m_DnsblState = CClient::DNSBL_STATE_WHITELISTED;
-						}
-						else
-						{
-							// entry found -> blacklisted
-							m_aClients[ClientID].m_DnsblState = CClient::DNSBL_STATE_BLACKLISTED;
-
-							// console output
-							char aAddrStr[NETADDR_MAXSTRSIZE];
-							net_addr_str(m_NetServer.ClientAddr(ClientID), aAddrStr, sizeof(aAddrStr), true);
-
-							str_format(aBuf, sizeof(aBuf), "ClientID=%d addr=<{%s}> secure=%s blacklisted", ClientID, aAddrStr, m_NetServer.HasSecurityToken(ClientID) ? "yes" : "no");
-
-							Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "dnsbl", aBuf);
-						}
+						UpdateDnsbl(ClientID);
 					}
 
 					if(m_aClients[ClientID].m_DnsblState == CClient::DNSBL_STATE_BLACKLISTED &&
@@ -2834,6 +2912,7 @@ int CServer::Run()
 
 			while(t > TickStartTime(m_CurrentGameTick + 1))
 			{
+				CProfileScope Profile(&m_TickProfiler, PROFILE_TICK);
 				GameServer()->OnPreTickTeehistorian();
 
 				for(int c = 0; c < MAX_CLIENTS; c++)
@@ -2875,18 +2954,35 @@ int CServer::Run()
 						GameServer()->OnClientPredictedInput(c, nullptr);
 				}
 
-				GameServer()->OnTick();
+				{
+					CProfileScope GameProfile(&m_TickProfiler, PROFILE_GAME);
+					GameServer()->OnTick();
+				}
 				if(ErrorShutdown())
 				{
 					break;
 				}
+				if(m_CurrentGameTick % TickSpeed() == 0)
+				{
+					SendTickEvent();
+					if(Config()->m_SvTickProfile)
+						m_TickProfiler.WriteCsvRow(Storage(), Config()->m_SvTickProfileCsv, Config()->m_SvTickProfileCsvRows, m_CurrentGameTick);
+					else
+					{
+						m_TickProfiler.CloseCsv();
+						m_TickProfiler.ResetInterval();
+					}
+				}
 			}
 
 			// snap game
 			if(NewTicks)
 			{
 				if(Config()->m_SvHighBandwidth || (m_CurrentGameTick % 2) == 0)
+				{
+					CProfileScope Profile(&m_TickProfiler, PROFILE_SNAPSHOT);
 					DoSnapshot();
+				}
 
 				UpdateClientRconCommands();
 
@@ -2902,7 +2998,10 @@ int CServer::Run()
 			Antibot()->OnEngineTick();
 
 			if(!NonActive)
+			{
+				CProfileScope Profile(&m_TickProfiler, PROFILE_NETWORK);
 				PumpNetwork(PacketWaiting);
+			}
 
 			NonActive = true;
 
@@ -3342,6 +3441,43 @@ void CServer::ConNameBans(IConsole::IResult *pResult, void *pUser)
 	}
 }
 
+void CServer::ConDnsblStats(IConsole::IResult *pResult, void *pUser)
+{
+	CServer *pThis = (CServer *)pUser;
+	const CDnsbl::SStats &Stats = pThis->m_Dnsbl.Stats();
+
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "queries=%" PRId64 " cache_hits=%" PRId64 " coalesced=%" PRId64 " lookups=%" PRId64 " batches=%" PRId64,
+		Stats.m_Queries, Stats.m_CacheHits, Stats.m_Coalesced, Stats.m_Lookups, Stats.m_Batches);
+	pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "dnsbl", aBuf);
+	str_format(aBuf, sizeof(aBuf), "listed=%" PRId64 " not_listed=%" PRId64 " expired=%" PRId64 " cached=%d pending=%d",
+		Stats.m_Listed, Stats.m_NotListed, Stats.m_Expired, pThis->m_Dnsbl.NumEntries(), pThis->m_Dnsbl.NumPending());
+	pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "dnsbl", aBuf);
+}
+
+void CServer::ConTickProfile(IConsole::IResult *pResult, void *pUser)
+{
+	CServer *pThis = (CServer *)pUser;
+	if(!pThis->Config()->m_SvTickProfile)
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "profile", "tick profiling is disabled, enable it with sv_tick_profile 1");
+
+	char aBuf[256];
+	for(int Phase = 0; Phase < NUM_PROFILE_PHASES; Phase++)
+	{
+		const CTickProfiler::CPhase &Stats = pThis->m_TickProfiler.Phase(Phase);
+		str_format(aBuf, sizeof(aBuf), "%s count=%" PRId64 " avg_us=%" PRId64 " p50_us<=%" PRId64 " p99_us<=%" PRId64 " max_us=%" PRId64,
+			CTickProfiler::PhaseName(Phase), Stats.m_Count, Stats.m_Count ? Stats.m_TimeSum / Stats.m_Count : 0,
+			pThis->m_TickProfiler.Percentile(Phase, 50), pThis->m_TickProfiler.Percentile(Phase, 99), Stats.m_TimeMax);
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "profile", aBuf);
+	}
+}
+
+void CServer::ConTickProfileReset(IConsole::IResult *pResult, void *pUser)
+{
+	CServer *pThis = (CServer *)pUser;
+	pThis->m_TickProfiler.Reset();
+}
+
 void CServer::ConShutdown(IConsole::IResult *pResult, void *pUser)
 {
 	CServer *pThis = static_cast<CServer *>(pUser);
@@ -3788,6 +3924,9 @@ void CServer::RegisterCommands()
 	Console()->Register("name_ban", "s[name] ?i[distance] ?i[is_substring] ?r[reason]", CFGFLAG_SERVER, ConNameBan, this, "Ban a certain nickname");
 	Console()->Register("name_unban", "s[name]", CFGFLAG_SERVER, ConNameUnban, this, "Unban a certain nickname");
 	Console()->Register("name_bans", "", CFGFLAG_SERVER, ConNameBans, this, "List all name bans");
+	Console()->Register("dnsbl_stats", "", CFGFLAG_SERVER, ConDnsblStats, this, "Show DNSBL lookup and cache counters");
+	Console()->Register("tick_profile", "", CFGFLAG_SERVER, ConTickProfile, this, "Show the time spent in the phases of server ticks (needs sv_tick_profile 1)");
+	Console()->Register("tick_profile_reset", "", CFGFLAG_SERVER, ConTickProfileReset, this, "Reset the tick profile");
 
 	RustVersionRegister(*Console());
 
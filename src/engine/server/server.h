@@ -15,6 +15,7 @@
 #include <engine/shared/network.h>
 #include <engine/shared/protocol.h>
 #include <engine/shared/snapshot.h>
+#include <engine/shared/tick_profiler.h>
 #include <engine/shared/uuid_manager.h>
 
 #include <list>
@@ -24,6 +25,7 @@
 
 #include "antibot.h"
 #include "authmanager.h"
+#include "dnsbl.h"
 #include "name_ban.h"
 
 #if defined(CONF_UPNP)
@@ -31,7 +33,6 @@
 #endif
 
 class CConfig;
-class CHostLookup;
 class CLogMessage;
 class CMsgPacker;
 class CPacker;
@@ -84,15 +85,15 @@ class CServerBan : public CNetBan
 	class CServer *m_pServer;
 
 	template<class T>
-	int BanExt(T *pBanPool, const typename T::CDataType *pData, int Seconds, const char *pReason);
+	int BanExt(T *pBanPool, const typename T::CDataType *pData, int Seconds, const char *pReason, bool Verbose);
 
 public:
 	class CServer *Server() const { return m_pServer; }
 
 	void InitServerBan(class IConsole *pConsole, class IStorage *pStorage, class CServer *pServer);
 
-	int BanAddr(const NETADDR *pAddr, int Seconds, const char *pReason) override;
-	int BanRange(const CNetRange *pRange, int Seconds, const char *pReason) override;
+	int BanAddr(const NETADDR *pAddr, int Seconds, const char *pReason, bool Verbose = true) override;
+	int BanRange(const CNetRange *pRange, int Seconds, const char *pReason, bool Verbose = true) override;
 
 	static void ConBanExt(class IConsole::IResult *pResult, void *pUser);
 	static void ConBanRegion(class IConsole::IResult *pResult, void *pUser);
@@ -212,7 +213,6 @@ public:
 
 		// DNSBL
 		int m_DnsblState;
-		std::shared_ptr<CHostLookup> m_pDnsblLookup;
 
 		bool m_Sixup;
 	};
@@ -225,6 +225,7 @@ public:
 	CSnapIDPool m_IDPool;
 	CNetServer m_NetServer;
 	CEcon m_Econ;
+	CTickProfiler m_TickProfiler;
 	CFifo m_Fifo;
 	CServerBan m_ServerBan;
 
@@ -272,6 +273,8 @@ public:
 
 	std::vector<CNameBan> m_vNameBans;
 
+	CDnsbl m_Dnsbl;
+
 	size_t m_AnnouncementLastLine;
 	std::vector<std::string> m_vAnnouncements;
 	char m_aAnnouncementFile[IO_MAX_PATH_LENGTH];
@@ -305,6 +308,10 @@ public:
 	int Init();
 
 	void SendLogLine(const CLogMessage *pMessage);
+	void SendTickEvent();
+	CJsonWriter *EconBeginEvent(int Event) override;
+	CTickProfiler *TickProfiler() override { return &m_TickProfiler; }
+	void EconEndEvent() override;
 	void SetRconCID(int ClientID) override;
 	int GetAuthedState(int ClientID) const override;
 	const char *GetAuthName(int ClientID) const override;
@@ -391,6 +398,7 @@ public:
 	void ChangeMap(const char *pMap) override;
 	const char *GetMapName() const override;
 	int LoadMap(const char *pMapName);
+	bool ReadStoredMap(const char *pMapName, void **ppData, unsigned *pSize);
 
 	void SaveDemo(int ClientID, float Time) override;
 	void StartRecord(int ClientID) override;
@@ -420,6 +428,9 @@ public:
 	static void ConNameBan(IConsole::IResult *pResult, void *pUser);
 	static void ConNameUnban(IConsole::IResult *pResult, void *pUser);
 	static void ConNameBans(IConsole::IResult *pResult, void *pUser);
+	static void ConDnsblStats(IConsole::IResult *pResult, void *pUser);
+	static void ConTickProfile(IConsole::IResult *pResult, void *pUser);
+	static void ConTickProfileReset(IConsole::IResult *pResult, void *pUser);
 
 	// console commands for sqlmasters
 	static void ConAddSqlServer(IConsole::IResult *pResult, void *pUserData);
@@ -461,6 +472,7 @@ public:
 	int *GetIdMap(int ClientID) override;
 
 	void InitDnsbl(int ClientID);
+	void UpdateDnsbl(int ClientID);
 	bool DnsblWhite(int ClientID) override
 	{
 		return m_aClients[ClientID].m_DnsblState == CClient::DNSBL_STATE_NONE ||
@@ -2,6 +2,7 @@
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #include <engine/config.h>
 #include <engine/shared/config.h>
+#include <engine/shared/config_snapshot.h>
 #include <engine/shared/protocol.h>
 #include <engine/storage.h>
 
@@ -18,6 +19,8 @@ CConfigManager::CConfigManager()
 	m_ConfigFile = 0;
 	m_NumCallbacks = 0;
 	m_Failed = false;
+	m_pSnapshot = nullptr;
+	m_SnapshotLines = false;
 }
 
 void CConfigManager::Init()
@@ -77,6 +80,8 @@ bool CConfigManager::Save()
 	}
 
 	m_Failed = false;
+	CConfigSnapshot Snapshot;
+	m_pSnapshot = &Snapshot;
 
 	char aLineBuf[1024 * 2];
 	char aEscapeBuf[1024 * 2];
@@ -86,12 +91,14 @@ bool CConfigManager::Save()
 	{ \
 		str_format(aLineBuf, sizeof(aLineBuf), "%s %i", #ScriptName, g_Config.m_##Name); \
 		WriteLine(aLineBuf); \
+		Snapshot.AddInt(#ScriptName, g_Config.m_##Name); \
 	}
 #define MACRO_CONFIG_COL(Name, ScriptName, def, flags, desc) \
 	if((flags)&CFGFLAG_SAVE && g_Config.m_##Name != (def)) \
 	{ \
 		str_format(aLineBuf, sizeof(aLineBuf), "%s %u", #ScriptName, g_Config.m_##Name); \
 		WriteLine(aLineBuf); \
+		Snapshot.AddColor(#ScriptName, g_Config.m_##Name); \
 	}
 #define MACRO_CONFIG_STR(Name, ScriptName, len, def, flags, desc) \
 	if((flags)&CFGFLAG_SAVE && str_comp(g_Config.m_##Name, def) != 0) \
@@ -99,6 +106,7 @@ bool CConfigManager::Save()
 		EscapeParam(aEscapeBuf, g_Config.m_##Name, sizeof(aEscapeBuf)); \
 		str_format(aLineBuf, sizeof(aLineBuf), "%s \"%s\"", #ScriptName, aEscapeBuf); \
 		WriteLine(aLineBuf); \
+		Snapshot.AddStr(#ScriptName, g_Config.m_##Name); \
 	}
 
 #include "config_variables.h"
@@ -107,8 +115,12 @@ bool CConfigManager::Save()
 #undef MACRO_CONFIG_COL
 #undef MACRO_CONFIG_STR
 
+	// the callbacks write commands, the snapshot keeps them as they are
+	m_SnapshotLines = true;
 	for(int i = 0; i < m_NumCallbacks; i++)
 		m_aCallbacks[i].m_pfnFunc(this, m_aCallbacks[i].m_pUserData);
+	m_SnapshotLines = false;
+	m_pSnapshot = nullptr;
 
 	if(io_sync(m_ConfigFile) != 0)
 	{
@@ -132,6 +144,13 @@ bool CConfigManager::Save()
 		return false;
 	}
 
+	// only speeds up the next start, the text config is always complete
+	if(!Snapshot.Save(m_pStorage, CONFIG_SNAPSHOT_FILE))
+	{
+		dbg_msg("config", "ERROR: writing " CONFIG_SNAPSHOT_FILE " failed");
+		m_pStorage->RemoveFile(CONFIG_SNAPSHOT_FILE, IStorage::TYPE_SAVE);
+	}
+
 	return true;
 }
 
@@ -151,6 +170,12 @@ void CConfigManager::WriteLine(const char *pLine)
 	{
 		m_Failed = true;
 	}
+	if(m_pSnapshot)
+	{
+		m_pSnapshot->HashLine(pLine);
+		if(m_SnapshotLines)
+			m_pSnapshot->AddLine(pLine);
+	}
 }
 
 IConfigManager *CreateConfigManager() { return new CConfigManager; }
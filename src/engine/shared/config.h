@@ -10,6 +10,7 @@
 #include <engine/shared/protocol.h>
 
 #define CONFIG_FILE "settings_ddnet.cfg"
+#define CONFIG_SNAPSHOT_FILE "settings_ddnet.cfg.snapshot"
 #define AUTOEXEC_FILE "autoexec.cfg"
 #define AUTOEXEC_CLIENT_FILE "autoexec_client.cfg"
 #define AUTOEXEC_SERVER_FILE "autoexec_server.cfg"
@@ -69,6 +70,9 @@ class CConfigManager : public IConfigManager
 	class IStorage *m_pStorage;
 	IOHANDLE m_ConfigFile;
 	bool m_Failed;
+	// collects what is written while saving
+	class CConfigSnapshot *m_pSnapshot;
+	bool m_SnapshotLines;
 	CCallback m_aCallbacks[MAX_CALLBACKS];
 	int m_NumCallbacks;
 
@@ -0,0 +1,160 @@
+#include "config_snapshot.h"
+
+#include <engine/shared/linereader.h>
+#include <engine/storage.h>
+
+#include <cstdlib>
+
+static const unsigned char gs_aSnapshotMagic[4] = {'C', 'F', 'G', 'S'};
+static const unsigned gs_SnapshotVersion = 1;
+
+// magic, version, hash of the text config, hash of the entries
+static const unsigned gs_HeaderSize = sizeof(gs_aSnapshotMagic) + 4 + 2 * SHA256_DIGEST_LENGTH;
+
+CConfigSnapshot::CConfigSnapshot()
+{
+	sha256_init(&m_TextHash);
+}
+
+void CConfigSnapshot::HashLine(const char *pLine)
+{
+	sha256_update(&m_TextHash, pLine, str_length(pLine));
+	sha256_update(&m_TextHash, "\n", 1);
+}
+
+void CConfigSnapshot::AddInt(const char *pName, int Value)
+{
+	m_vEntries.push_back({TYPE_INT, pName, (unsigned)Value, ""});
+}
+
+void CConfigSnapshot::AddColor(const char *pName, unsigned Value)
+{
+	m_vEntries.push_back({TYPE_COL, pName, Value, ""});
+}
+
+void CConfigSnapshot::AddStr(const char *pName, const char *pValue)
+{
+	m_vEntries.push_back({TYPE_STR, pName, 0, pValue});
+}
+
+void CConfigSnapshot::AddLine(const char *pLine)
+{
+	m_vEntries.push_back({TYPE_LINE, "", 0, pLine});
+}
+
+bool CConfigSnapshot::Save(IStorage *pStorage, const char *pFilename)
+{
+	std::vector<unsigned char> vData(gs_HeaderSize);
+	for(const auto &Entry : m_vEntries)
+	{
+		vData.push_back(Entry.m_Type);
+		if(Entry.m_Type != TYPE_LINE)
+			vData.insert(vData.end(), Entry.m_Name.c_str(), Entry.m_Name.c_str() + Entry.m_Name.size() + 1);
+		if(Entry.m_Type == TYPE_INT || Entry.m_Type == TYPE_COL)
+		{
+			unsigned char aValue[4];
+			uint_to_bytes_be(aValue, Entry.m_Value);
+			vData.insert(vData.end(), aValue, aValue + sizeof(aValue));
+		}
+		else
+			vData.insert(vData.end(), Entry.m_Str.c_str(), Entry.m_Str.c_str() + Entry.m_Str.size() + 1);
+	}
+
+	SHA256_CTX TextHash = m_TextHash;
+	const SHA256_DIGEST TextDigest = sha256_finish(&TextHash);
+	const SHA256_DIGEST DataDigest = sha256(vData.data() + gs_HeaderSize, vData.size() - gs_HeaderSize);
+	unsigned char *pHeader = vData.data();
+	mem_copy(pHeader, gs_aSnapshotMagic, sizeof(gs_aSnapshotMagic));
+	uint_to_bytes_be(pHeader + sizeof(gs_aSnapshotMagic), gs_SnapshotVersion);
+	mem_copy(pHeader + sizeof(gs_aSnapshotMagic) + 4, TextDigest.data, SHA256_DIGEST_LENGTH);
+	mem_copy(pHeader + sizeof(gs_aSnapshotMagic) + 4 + SHA256_DIGEST_LENGTH, DataDigest.data, SHA256_DIGEST_LENGTH);
+
+	char aFilenameTmp[IO_MAX_PATH_LENGTH];
+	IStorage::FormatTmpPath(aFilenameTmp, sizeof(aFilenameTmp), pFilename);
+	IOHANDLE File = pStorage->OpenFile(aFilenameTmp, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	if(!File)
+		return false;
+	bool Failed = io_write(File, vData.data(), vData.size()) != vData.size();
+	Failed |= io_close(File) != 0;
+	if(Failed)
+	{
+		pStorage->RemoveFile(aFilenameTmp, IStorage::TYPE_SAVE);
+		return false;
+	}
+	return pStorage->RenameFile(aFilenameTmp, pFilename, IStorage::TYPE_SAVE);
+}
+
+bool CConfigSnapshot::Load(IStorage *pStorage, const char *pFilename, const char *pConfigFilename, int ConfigStorageType)
+{
+	m_vEntries.clear();
+	sha256_init(&m_TextHash);
+
+	IOHANDLE ConfigFile = pStorage->OpenFile(pConfigFilename, IOFLAG_READ | IOFLAG_SKIP_BOM, ConfigStorageType);
+	if(!ConfigFile)
+		return false;
+	CLineReader Reader;
+	Reader.Init(ConfigFile);
+	while(const char *pLine = Reader.Get())
+		HashLine(pLine);
+	io_close(ConfigFile);
+	SHA256_CTX TextHash = m_TextHash;
+	const SHA256_DIGEST TextDigest = sha256_finish(&TextHash);
+
+	void *pData;
+	unsigned DataSize;
+	if(!pStorage->ReadFile(pFilename, IStorage::TYPE_SAVE, &pData, &DataSize))
+		return false;
+	const unsigned char *pBytes = (const unsigned char *)pData;
+	bool Valid = DataSize >= gs_HeaderSize &&
+		     mem_comp(pBytes, gs_aSnapshotMagic, sizeof(gs_aSnapshotMagic)) == 0 &&
+		     bytes_be_to_uint(pBytes + sizeof(gs_aSnapshotMagic)) == gs_SnapshotVersion &&
+		     mem_comp(pBytes + sizeof(gs_aSnapshotMagic) + 4, TextDigest.data, SHA256_DIGEST_LENGTH) == 0;
+	if(Valid)
+	{
+		const SHA256_DIGEST DataDigest = sha256(pBytes + gs_HeaderSize, DataSize - gs_HeaderSize);
+		Valid = mem_comp(pBytes + sizeof(gs_aSnapshotMagic) + 4 + SHA256_DIGEST_LENGTH, DataDigest.data, SHA256_DIGEST_LENGTH) == 0;
+	}
+
+	// the hash was checked, but don't trust the contents blindly
+	const unsigned char *pCur = pBytes + gs_HeaderSize;
+	const unsigned char *pEnd = pBytes + DataSize;
+	auto ReadString = [&](std::string *pStr) {
+		const unsigned char *pStrEnd = pCur;
+		while(pStrEnd < pEnd && *pStrEnd)
+			pStrEnd++;
+		if(pStrEnd == pEnd)
+			return false;
+		pStr->assign((const char *)pCur, pStrEnd - pCur);
+		pCur = pStrEnd + 1;
+		return true;
+	};
+	while(Valid && pCur < pEnd)
+	{
+		CEntry Entry;
+		Entry.m_Type = *pCur++;
+		Entry.m_Value = 0;
+		if(Entry.m_Type >= NUM_TYPES)
+			Valid = false;
+		else if(Entry.m_Type != TYPE_LINE && !ReadString(&Entry.m_Name))
+			Valid = false;
+		else if(Entry.m_Type == TYPE_INT || Entry.m_Type == TYPE_COL)
+		{
+			if(pEnd - pCur < 4)
+				Valid = false;
+			else
+			{
+				Entry.m_Value = bytes_be_to_uint(pCur);
+				pCur += 4;
+			}
+		}
+		else if(!ReadString(&Entry.m_Str))
+			Valid = false;
+		if(Valid)
+			m_vEntries.push_back(std::move(Entry));
+	}
+	free(pData);
+
+	if(!Valid)
+		m_vEntries.clear();
+	return Valid;
+}
@@ -0,0 +1,56 @@
+#ifndef ENGINE_SHARED_CONFIG_SNAPSHOT_H
+#define ENGINE_SHARED_CONFIG_SNAPSHOT_H
+
+#include <base/hash_ctxt.h>
+
+#include <string>
+#include <vector>
+
+class IStorage;
+
+// Binary copy of the saved config. It is written next to the text config and
+// only used as long as the text config wasn't changed, which is checked by
+// hashing its lines.
+class CConfigSnapshot
+{
+public:
+	enum
+	{
+		TYPE_INT = 0,
+		TYPE_COL,
+		TYPE_STR,
+		// any other command, e.g. written by a save callback
+		TYPE_LINE,
+		NUM_TYPES,
+	};
+
+	struct CEntry
+	{
+		int m_Type;
+		std::string m_Name;
+		unsigned m_Value;
+		// string value or the whole command line
+		std::string m_Str;
+	};
+
+	CConfigSnapshot();
+
+	// every line written to the text config must be passed here
+	void HashLine(const char *pLine);
+	void AddInt(const char *pName, int Value);
+	void AddColor(const char *pName, unsigned Value);
+	void AddStr(const char *pName, const char *pValue);
+	void AddLine(const char *pLine);
+
+	const std::vector<CEntry> &Entries() const { return m_vEntries; }
+
+	bool Save(IStorage *pStorage, const char *pFilename);
+	// Fails if the snapshot is missing, damaged or doesn't match the text config.
+	bool Load(IStorage *pStorage, const char *pFilename, const char *pConfigFilename, int ConfigStorageType);
+
+private:
+	SHA256_CTX m_TextHash;
+	std::vector<CEntry> m_vEntries;
+};
+
+#endif
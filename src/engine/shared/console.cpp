@@ -11,6 +11,7 @@
 #include <engine/storage.h>
 
 #include "config.h"
+#include "config_snapshot.h"
 #include "console.h"
 #include "linereader.h"
 
@@ -572,7 +573,11 @@ int CConsole::PossibleCommands(const char *pStr, int FlagMask, bool Temp, FPossi
 
 CConsole::CCommand *CConsole::FindCommand(const char *pName, int FlagMask)
 {
-	for(CCommand *pCommand = m_pFirstCommand; pCommand; pCommand = pCommand->m_pNext)
+	if(m_vpCommandBuckets.empty())
+		return 0x0;
+
+	const unsigned Bucket = CommandHash(pName) & (m_vpCommandBuckets.size() - 1);
+	for(CCommand *pCommand = m_vpCommandBuckets[Bucket]; pCommand; pCommand = pCommand->m_pNextHash)
 	{
 		if(pCommand->m_Flags & FlagMask)
 		{
@@ -584,6 +589,69 @@ CConsole::CCommand *CConsole::FindCommand(const char *pName, int FlagMask)
 	return 0x0;
 }
 
+unsigned CConsole::CommandHash(const char *pName)
+{
+	// fnv-1a over the lowercase name, matches str_comp_nocase
+	unsigned Hash = 2166136261u;
+	for(; *pName; pName++)
+	{
+		unsigned char c = *pName;
+		if(c >= 'A' && c <= 'Z')
+			c += 'a' - 'A';
+		Hash = (Hash ^ c) * 16777619u;
+	}
+	return Hash;
+}
+
+void CConsole::AddCommandHash(CCommand *pCommand)
+{
+	// called before the command is added to the list, a rebuild doesn't add it twice
+	if(m_NumHashedCommands >= (int)m_vpCommandBuckets.size())
+		RebuildCommandHash(maximum(256, (int)m_vpCommandBuckets.size() * 2));
+
+	// newer commands shadow older ones with the same name, like in the sorted list
+	CCommand *&pBucket = m_vpCommandBuckets[CommandHash(pCommand->m_pName) & (m_vpCommandBuckets.size() - 1)];
+	pCommand->m_pNextHash = pBucket;
+	pBucket = pCommand;
+	m_NumHashedCommands++;
+}
+
+void CConsole::RemoveCommandHash(CCommand *pCommand)
+{
+	if(m_vpCommandBuckets.empty())
+		return;
+
+	for(CCommand **ppCommand = &m_vpCommandBuckets[CommandHash(pCommand->m_pName) & (m_vpCommandBuckets.size() - 1)]; *ppCommand; ppCommand = &(*ppCommand)->m_pNextHash)
+	{
+		if(*ppCommand == pCommand)
+		{
+			*ppCommand = pCommand->m_pNextHash;
+			pCommand->m_pNextHash = nullptr;
+			m_NumHashedCommands--;
+			return;
+		}
+	}
+}
+
+void CConsole::RebuildCommandHash(int NumBuckets)
+{
+	m_vpCommandBuckets.assign(NumBuckets, nullptr);
+	m_NumHashedCommands = 0;
+
+	// append in list order so lookups return the same command as a list walk would
+	std::vector<CCommand **> vppTails(NumBuckets);
+	for(int i = 0; i < NumBuckets; i++)
+		vppTails[i] = &m_vpCommandBuckets[i];
+	for(CCommand *pCommand = m_pFirstCommand; pCommand; pCommand = pCommand->m_pNext)
+	{
+		const unsigned Bucket = CommandHash(pCommand->m_pName) & (NumBuckets - 1);
+		pCommand->m_pNextHash = nullptr;
+		*vppTails[Bucket] = pCommand;
+		vppTails[Bucket] = &pCommand->m_pNextHash;
+		m_NumHashedCommands++;
+	}
+}
+
 void CConsole::ExecuteLine(const char *pStr, int ClientID, bool InterpretSemicolons)
 {
 	CConsole::ExecuteLineStroked(1, pStr, ClientID, InterpretSemicolons); // press it
@@ -878,6 +946,101 @@ void CConsole::TraverseChain(FCommandCallback *ppfnCallback, void **ppUserData)
 	}
 }
 
+bool CConsole::ExecuteConfigSnapshot(const char *pSnapshotFilename, const char *pConfigFilename)
+{
+	if(!m_pStorage)
+		return false;
+
+	CConfigSnapshot Snapshot;
+	if(!Snapshot.Load(m_pStorage, pSnapshotFilename, pConfigFilename, IStorage::TYPE_ALL))
+		return false;
+
+	// check all variables before changing any, a snapshot from another
+	// version may contain variables that don't exist anymore
+	static const FCommandCallback s_apfnVariableCallbacks[] = {IntVariableCommand, ColVariableCommand, StrVariableCommand};
+	std::vector<CCommand *> vpCommands;
+	vpCommands.reserve(Snapshot.Entries().size());
+	for(const auto &Entry : Snapshot.Entries())
+	{
+		if(Entry.m_Type == CConfigSnapshot::TYPE_LINE)
+		{
+			vpCommands.push_back(nullptr);
+			continue;
+		}
+		CCommand *pCommand = FindCommand(Entry.m_Name.c_str(), m_FlagMask);
+		if(!pCommand)
+			return false;
+		FCommandCallback pfnCallback = pCommand->m_pfnCallback;
+		void *pUserData = pCommand->m_pUserData;
+		TraverseChain(&pfnCallback, &pUserData);
+		if(pfnCallback != s_apfnVariableCallbacks[Entry.m_Type])
+			return false;
+		vpCommands.push_back(pCommand);
+	}
+
+	char aBuf[32 + IO_MAX_PATH_LENGTH];
+	str_format(aBuf, sizeof(aBuf), "restoring '%s' from '%s'", pConfigFilename, pSnapshotFilename);
+	Print(IConsole::OUTPUT_LEVEL_STANDARD, "console", aBuf);
+
+	char aLine[1024 * 2];
+	char aEscaped[1024 * 2];
+	for(size_t i = 0; i < vpCommands.size(); i++)
+	{
+		const CConfigSnapshot::CEntry &Entry = Snapshot.Entries()[i];
+		CCommand *pCommand = vpCommands[i];
+		if(Entry.m_Type == CConfigSnapshot::TYPE_LINE)
+		{
+			ExecuteLine(Entry.m_Str.c_str());
+			continue;
+		}
+
+		// chained variables must see the change, run them as commands
+		if(pCommand->m_pfnCallback == Con_Chain)
+		{
+			if(Entry.m_Type == CConfigSnapshot::TYPE_INT)
+				str_format(aLine, sizeof(aLine), "%s %i", Entry.m_Name.c_str(), (int)Entry.m_Value);
+			else if(Entry.m_Type == CConfigSnapshot::TYPE_COL)
+				str_format(aLine, sizeof(aLine), "%s %u", Entry.m_Name.c_str(), Entry.m_Value);
+			else
+			{
+				char *pDst = aEscaped;
+				str_escape(&pDst, Entry.m_Str.c_str(), aEscaped + sizeof(aEscaped));
+				str_format(aLine, sizeof(aLine), "%s \"%s\"", Entry.m_Name.c_str(), aEscaped);
+			}
+			ExecuteLine(aLine);
+			continue;
+		}
+
+		if(Entry.m_Type == CConfigSnapshot::TYPE_INT)
+		{
+			CIntVariableData *pData = static_cast<CIntVariableData *>(pCommand->m_pUserData);
+			int Val = Entry.m_Value;
+			if(pData->m_Min != pData->m_Max)
+			{
+				if(Val < pData->m_Min)
+					Val = pData->m_Min;
+				if(pData->m_Max != 0 && Val > pData->m_Max)
+					Val = pData->m_Max;
+			}
+			*pData->m_pVariable = Val;
+			pData->m_OldValue = Val;
+		}
+		else if(Entry.m_Type == CConfigSnapshot::TYPE_COL)
+		{
+			CColVariableData *pData = static_cast<CColVariableData *>(pCommand->m_pUserData);
+			*pData->m_pVariable = Entry.m_Value;
+			pData->m_OldValue = Entry.m_Value;
+		}
+		else
+		{
+			CStrVariableData *pData = static_cast<CStrVariableData *>(pCommand->m_pUserData);
+			str_copy(pData->m_pStr, Entry.m_Str.c_str(), pData->m_MaxSize);
+			str_copy(pData->m_pOldValue, pData->m_pStr, pData->m_MaxSize);
+		}
+	}
+	return true;
+}
+
 void CConsole::ConToggle(IConsole::IResult *pResult, void *pUser)
 {
 	CConsole *pConsole = static_cast<CConsole *>(pUser);
@@ -1077,12 +1240,11 @@ void CConsole::ParseArguments(int NumArgs, const char **ppArguments)
 
 void CConsole::AddCommandSorted(CCommand *pCommand)
 {
+	AddCommandHash(pCommand);
+
 	if(!m_pFirstCommand || str_comp(pCommand->m_pName, m_pFirstCommand->m_pName) <= 0)
 	{
-		if(m_pFirstCommand && m_pFirstCommand->m_pNext)
-			pCommand->m_pNext = m_pFirstCommand;
-		else
-			pCommand->m_pNext = 0;
+		pCommand->m_pNext = m_pFirstCommand;
 		m_pFirstCommand = pCommand;
 	}
 	else
@@ -1187,6 +1349,7 @@ void CConsole::DeregisterTemp(const char *pName)
 	// add to recycle list
 	if(pRemoved)
 	{
+		RemoveCommandHash(pRemoved);
 		pRemoved->m_pNext = m_pRecycleList;
 		m_pRecycleList = pRemoved;
 	}
@@ -1212,6 +1375,8 @@ void CConsole::DeregisterTempAll()
 
 	m_TempCommands.Reset();
 	m_pRecycleList = 0;
+	if(!m_vpCommandBuckets.empty())
+		RebuildCommandHash(m_vpCommandBuckets.size());
 }
 
 void CConsole::Con_Chain(IResult *pResult, void *pUserData)
@@ -1258,7 +1423,11 @@ void CConsole::StoreCommands(bool Store)
 
 const IConsole::CCommandInfo *CConsole::GetCommandInfo(const char *pName, int FlagMask, bool Temp)
 {
-	for(CCommand *pCommand = m_pFirstCommand; pCommand; pCommand = pCommand->m_pNext)
+	if(m_vpCommandBuckets.empty())
+		return 0;
+
+	const unsigned Bucket = CommandHash(pName) & (m_vpCommandBuckets.size() - 1);
+	for(CCommand *pCommand = m_vpCommandBuckets[Bucket]; pCommand; pCommand = pCommand->m_pNextHash)
 	{
 		if(pCommand->m_Flags & FlagMask && pCommand->m_Temp == Temp)
 		{
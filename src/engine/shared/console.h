@@ -8,12 +8,15 @@
 #include <engine/console.h>
 #include <engine/storage.h>
 
+#include <vector>
+
 class CConsole : public IConsole
 {
 	class CCommand : public CCommandInfo
 	{
 	public:
 		CCommand *m_pNext;
+		CCommand *m_pNextHash; // next command in the same hash bucket
 		int m_Flags;
 		bool m_Temp;
 		FCommandCallback m_pfnCallback;
@@ -37,6 +40,9 @@ class CConsole : public IConsole
 	bool m_StoreCommands;
 	const char *m_apStrokeStr[2];
 	CCommand *m_pFirstCommand;
+	// case insensitive hash of the command names, chained through m_pNextHash
+	std::vector<CCommand *> m_vpCommandBuckets;
+	int m_NumHashedCommands = 0;
 
 	class CExecFile
 	{
@@ -191,6 +197,11 @@ class CConsole : public IConsole
 	void AddCommandSorted(CCommand *pCommand);
 	CCommand *FindCommand(const char *pName, int FlagMask);
 
+	static unsigned CommandHash(const char *pName);
+	void AddCommandHash(CCommand *pCommand);
+	void RemoveCommandHash(CCommand *pCommand);
+	void RebuildCommandHash(int NumBuckets);
+
 public:
 	IConfigManager *ConfigManager() { return m_pConfigManager; }
 	CConfig *Config() { return m_pConfig; }
@@ -215,6 +226,7 @@ public:
 	void ExecuteLine(const char *pStr, int ClientID = -1, bool InterpretSemicolons = true) override;
 	void ExecuteLineFlag(const char *pStr, int FlagMask, int ClientID = -1, bool InterpretSemicolons = true) override;
 	bool ExecuteFile(const char *pFilename, int ClientID = -1, bool LogFailure = false, int StorageType = IStorage::TYPE_ALL) override;
+	bool ExecuteConfigSnapshot(const char *pSnapshotFilename, const char *pConfigFilename) override;
 
 	char *Format(char *pBuf, int Size, const char *pFrom, const char *pStr) override;
 	void Print(int Level, const char *pFrom, const char *pStr, ColorRGBA PrintColor = gs_ConsoleDefaultColor) const override;
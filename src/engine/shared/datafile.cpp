@@ -81,6 +81,9 @@ struct CDatafileInfo
 struct CDatafile
 {
 	IOHANDLE m_File;
+	// the whole datafile, if it was opened from memory
+	unsigned char *m_pFileData;
+	unsigned m_FileDataSize;
 	SHA256_DIGEST m_Sha256;
 	unsigned m_Crc;
 	CDatafileInfo m_Info;
@@ -91,6 +94,18 @@ struct CDatafile
 	char *m_pData;
 };
 
+// reads from the file, or from the data of a datafile opened from memory
+static unsigned ReadAt(IOHANDLE File, const unsigned char *pFileData, unsigned FileDataSize, int64_t Offset, void *pBuf, unsigned Size)
+{
+	if(!pFileData)
+		return io_seek(File, Offset, IOSEEK_START) == 0 ? io_read(File, pBuf, Size) : 0;
+	if(Offset < 0 || Offset >= FileDataSize)
+		return 0;
+	Size = minimum(Size, (unsigned)(FileDataSize - Offset));
+	mem_copy(pBuf, pFileData + Offset, Size);
+	return Size;
+}
+
 bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int StorageType)
 {
 	log_trace("datafile", "loading. filename='%s'", pFilename);
@@ -124,15 +139,31 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 			sha256_update(&Sha256Ctxt, aBuffer, Bytes);
 		}
 		Sha256 = sha256_finish(&Sha256Ctxt);
-
-		io_seek(File, 0, IOSEEK_START);
 	}
 
+	return OpenImpl(File, nullptr, 0, Sha256, Crc, pFilename);
+}
+
+bool CDataFileReader::OpenData(void *pData, unsigned Size)
+{
+	log_trace("datafile", "loading from memory. size=%u", Size);
+	return OpenImpl(nullptr, static_cast<unsigned char *>(pData), Size, sha256(pData, Size), crc32(0, static_cast<const unsigned char *>(pData), Size), "<memory>");
+}
+
+bool CDataFileReader::OpenImpl(IOHANDLE File, unsigned char *pFileData, unsigned FileDataSize, SHA256_DIGEST Sha256, unsigned Crc, const char *pFilename)
+{
+	auto CloseSource = [&]() {
+		if(File)
+			io_close(File);
+		free(pFileData);
+	};
+
 	// TODO: change this header
 	CDatafileHeader Header;
-	if(sizeof(Header) != io_read(File, &Header, sizeof(Header)))
+	if(sizeof(Header) != ReadAt(File, pFileData, FileDataSize, 0, &Header, sizeof(Header)))
 	{
 		dbg_msg("datafile", "couldn't load header");
+		CloseSource();
 		return false;
 	}
 	if(Header.m_aID[0] != 'A' || Header.m_aID[1] != 'T' || Header.m_aID[2] != 'A' || Header.m_aID[3] != 'D')
@@ -140,6 +171,7 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 		if(Header.m_aID[0] != 'D' || Header.m_aID[1] != 'A' || Header.m_aID[2] != 'T' || Header.m_aID[3] != 'A')
 		{
 			dbg_msg("datafile", "wrong signature. %x %x %x %x", Header.m_aID[0], Header.m_aID[1], Header.m_aID[2], Header.m_aID[3]);
+			CloseSource();
 			return false;
 		}
 	}
@@ -150,6 +182,7 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 	if(Header.m_Version != 3 && Header.m_Version != 4)
 	{
 		dbg_msg("datafile", "wrong version. version=%x", Header.m_Version);
+		CloseSource();
 		return false;
 	}
 
@@ -167,7 +200,7 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 	AllocSize += Header.m_NumRawData * sizeof(int); // add space for data sizes
 	if(Size > (((int64_t)1) << 31) || Header.m_NumItemTypes < 0 || Header.m_NumItems < 0 || Header.m_NumRawData < 0 || Header.m_ItemSize < 0)
 	{
-		io_close(File);
+		CloseSource();
 		dbg_msg("datafile", "unable to load file, invalid file information");
 		return false;
 	}
@@ -179,6 +212,8 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 	pTmpDataFile->m_pDataSizes = (int *)(pTmpDataFile->m_ppDataPtrs + Header.m_NumRawData);
 	pTmpDataFile->m_pData = (char *)(pTmpDataFile->m_pDataSizes + Header.m_NumRawData);
 	pTmpDataFile->m_File = File;
+	pTmpDataFile->m_pFileData = pFileData;
+	pTmpDataFile->m_FileDataSize = FileDataSize;
 	pTmpDataFile->m_Sha256 = Sha256;
 	pTmpDataFile->m_Crc = Crc;
 
@@ -187,10 +222,10 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 	mem_zero(pTmpDataFile->m_pDataSizes, Header.m_NumRawData * sizeof(int));
 
 	// read types, offsets, sizes and item data
-	unsigned ReadSize = io_read(File, pTmpDataFile->m_pData, Size);
+	unsigned ReadSize = ReadAt(File, pFileData, FileDataSize, sizeof(CDatafileHeader), pTmpDataFile->m_pData, Size);
 	if(ReadSize != Size)
 	{
-		io_close(pTmpDataFile->m_File);
+		CloseSource();
 		free(pTmpDataFile);
 		dbg_msg("datafile", "couldn't load the whole thing, wanted=%d got=%d", Size, ReadSize);
 		return false;
@@ -240,7 +275,9 @@ bool CDataFileReader::Close()
 		m_pDataFile->m_pDataSizes[i] = 0;
 	}
 
-	io_close(m_pDataFile->m_File);
+	if(m_pDataFile->m_File)
+		io_close(m_pDataFile->m_File);
+	free(m_pDataFile->m_pFileData);
 	free(m_pDataFile);
 	m_pDataFile = nullptr;
 	return true;
@@ -276,6 +313,15 @@ int CDataFileReader::GetFileDataSize(int Index) const
 	return m_pDataFile->m_Info.m_pDataOffsets[Index + 1] - m_pDataFile->m_Info.m_pDataOffsets[Index];
 }
 
+bool CDataFileReader::GetDataFileRange(int Index, int *pOffset, int *pSize) const
+{
+	if(!m_pDataFile || Index < 0 || Index >= m_pDataFile->m_Header.m_NumRawData)
+		return false;
+	*pOffset = m_pDataFile->m_DataStartOffset + m_pDataFile->m_Info.m_pDataOffsets[Index];
+	*pSize = GetFileDataSize(Index);
+	return true;
+}
+
 // returns the size of the resulting data
 int CDataFileReader::GetDataSize(int Index) const
 {
@@ -334,9 +380,7 @@ void *CDataFileReader::GetDataImpl(int Index, int Swap)
 
 			// read the compressed data
 			void *pCompressedData = malloc(DataSize);
-			unsigned ActualDataSize = 0;
-			if(io_seek(m_pDataFile->m_File, m_pDataFile->m_DataStartOffset + m_pDataFile->m_Info.m_pDataOffsets[Index], IOSEEK_START) == 0)
-				ActualDataSize = io_read(m_pDataFile->m_File, pCompressedData, DataSize);
+			const unsigned ActualDataSize = ReadAt(m_pDataFile->m_File, m_pDataFile->m_pFileData, m_pDataFile->m_FileDataSize, m_pDataFile->m_DataStartOffset + m_pDataFile->m_Info.m_pDataOffsets[Index], pCompressedData, DataSize);
 			if(DataSize != ActualDataSize)
 			{
 				log_error("datafile", "truncation error, could not read all data. index=%d wanted=%u got=%u", Index, DataSize, ActualDataSize);
@@ -370,9 +414,7 @@ void *CDataFileReader::GetDataImpl(int Index, int Swap)
 			log_trace("datafile", "loading data. index=%d size=%d", Index, DataSize);
 			m_pDataFile->m_ppDataPtrs[Index] = static_cast<char *>(malloc(DataSize));
 			m_pDataFile->m_pDataSizes[Index] = DataSize;
-			unsigned ActualDataSize = 0;
-			if(io_seek(m_pDataFile->m_File, m_pDataFile->m_DataStartOffset + m_pDataFile->m_Info.m_pDataOffsets[Index], IOSEEK_START) == 0)
-				ActualDataSize = io_read(m_pDataFile->m_File, m_pDataFile->m_ppDataPtrs[Index], DataSize);
+			const unsigned ActualDataSize = ReadAt(m_pDataFile->m_File, m_pDataFile->m_pFileData, m_pDataFile->m_FileDataSize, m_pDataFile->m_DataStartOffset + m_pDataFile->m_Info.m_pDataOffsets[Index], m_pDataFile->m_ppDataPtrs[Index], DataSize);
 			if(DataSize != ActualDataSize)
 			{
 				log_error("datafile", "truncation error, could not read all data. index=%d wanted=%u got=%u", Index, DataSize, ActualDataSize);
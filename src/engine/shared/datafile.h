@@ -21,6 +21,7 @@ class CDataFileReader
 	struct CDatafile *m_pDataFile;
 	void *GetDataImpl(int Index, int Swap);
 	int GetFileDataSize(int Index) const;
+	bool OpenImpl(IOHANDLE File, unsigned char *pFileData, unsigned FileDataSize, SHA256_DIGEST Sha256, unsigned Crc, const char *pFilename);
 
 	int GetExternalItemType(int InternalType);
 	int GetInternalItemType(int ExternalType);
@@ -31,6 +32,8 @@ public:
 	~CDataFileReader() { Close(); }
 
 	bool Open(class IStorage *pStorage, const char *pFilename, int StorageType);
+	// takes ownership of the data, which must have been allocated with malloc
+	bool OpenData(void *pData, unsigned Size);
 	bool Close();
 	bool IsOpen() const { return m_pDataFile != nullptr; }
 	IOHANDLE File() const;
@@ -38,6 +41,7 @@ public:
 	void *GetData(int Index);
 	void *GetDataSwapped(int Index); // makes sure that the data is 32bit LE ints when saved
 	int GetDataSize(int Index) const;
+	bool GetDataFileRange(int Index, int *pOffset, int *pSize) const; // where the stored data is in the file
 	void ReplaceData(int Index, char *pData, size_t Size); // memory for data must have been allocated with malloc
 	void UnloadData(int Index);
 	int NumData() const;
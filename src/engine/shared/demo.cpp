@@ -1,5 +1,6 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/hash_ctxt.h>
 #include <base/math.h>
 #include <base/system.h>
 
@@ -18,6 +19,11 @@
 #include "network.h"
 #include "snapshot.h"
 
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
 const double g_aSpeeds[g_DemoSpeeds] = {0.1, 0.25, 0.5, 0.75, 1.0, 1.25, 1.5, 2.0, 3.0, 4.0, 6.0, 8.0, 12.0, 16.0, 20.0, 24.0, 28.0, 32.0, 40.0, 48.0, 56.0, 64.0};
 const CUuid SHA256_EXTENSION =
 	{{0x6b, 0xe6, 0xda, 0x4a, 0xce, 0xbd, 0x38, 0x0c,
@@ -31,8 +37,90 @@ static const unsigned char gs_VersionTickCompression = 5; // demo files with thi
 static const int gs_LengthOffset = 152;
 static const int gs_NumMarkersOffset = 176;
 
+static const unsigned char gs_aIndexMarker[8] = {'T', 'W', 'D', 'E', 'M', 'O', 'I', 'X'};
+static const int gs_IndexVersion = 1;
+static const int gs_MaxIndexFiles = 256;
+static const int gs_SnapshotCacheInterval = SERVER_TICK_SPEED / 5;
+
 static const ColorRGBA gs_DemoPrintColor{0.75f, 0.7f, 0.7f, 1.0f};
 
+// The keyframe index of a demo is stored in demoindex/, named after a hash of the demo header and size,
+// so that it stays valid when the demo is renamed or moved and is ignored when the demo changes.
+static void DemoIndexFilename(const CDemoHeader *pHeader, const CTimelineMarkers *pTimelineMarkers, int64_t DemoSize, char *pBuf, int BufSize)
+{
+	unsigned char aDemoSize[2 * sizeof(int32_t)];
+	uint_to_bytes_be(aDemoSize, (unsigned)(DemoSize >> 32));
+	uint_to_bytes_be(aDemoSize + sizeof(int32_t), (unsigned)DemoSize);
+
+	SHA256_CTX Sha256Ctxt;
+	sha256_init(&Sha256Ctxt);
+	sha256_update(&Sha256Ctxt, pHeader, sizeof(*pHeader));
+	sha256_update(&Sha256Ctxt, pTimelineMarkers, sizeof(*pTimelineMarkers));
+	sha256_update(&Sha256Ctxt, aDemoSize, sizeof(aDemoSize));
+	char aSha256[SHA256_MAXSTRSIZE];
+	sha256_str(sha256_finish(&Sha256Ctxt), aSha256, sizeof(aSha256));
+	str_format(pBuf, BufSize, "demoindex/%s.idx", aSha256);
+}
+
+static bool WriteDemoIndex(IStorage *pStorage, const char *pIndexFilename, int FirstTick, int LastTick, const CDemoKeyFrame *pKeyFrames, int NumKeyFrames)
+{
+	IOHANDLE File = pStorage->OpenFile(pIndexFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	if(!File)
+		return false;
+
+	unsigned char aHeader[sizeof(gs_aIndexMarker) + 4 * sizeof(int32_t)];
+	mem_copy(aHeader, gs_aIndexMarker, sizeof(gs_aIndexMarker));
+	uint_to_bytes_be(aHeader + sizeof(gs_aIndexMarker), gs_IndexVersion);
+	uint_to_bytes_be(aHeader + sizeof(gs_aIndexMarker) + sizeof(int32_t), FirstTick);
+	uint_to_bytes_be(aHeader + sizeof(gs_aIndexMarker) + 2 * sizeof(int32_t), LastTick);
+	uint_to_bytes_be(aHeader + sizeof(gs_aIndexMarker) + 3 * sizeof(int32_t), NumKeyFrames);
+	bool Success = io_write(File, aHeader, sizeof(aHeader)) == sizeof(aHeader);
+
+	for(int i = 0; i < NumKeyFrames && Success; i++)
+	{
+		unsigned char aKeyFrame[2 * sizeof(int32_t)];
+		uint_to_bytes_be(aKeyFrame, pKeyFrames[i].m_Filepos);
+		uint_to_bytes_be(aKeyFrame + sizeof(int32_t), pKeyFrames[i].m_Tick);
+		Success = io_write(File, aKeyFrame, sizeof(aKeyFrame)) == sizeof(aKeyFrame);
+	}
+	Success &= io_close(File) == 0;
+
+	// a partial index would only be rejected on every load
+	if(!Success)
+		pStorage->RemoveFile(pIndexFilename, IStorage::TYPE_SAVE);
+	return Success;
+}
+
+static int CollectDemoIndex(const CFsFileInfo *pInfo, int IsDir, int StorageType, void *pUser)
+{
+	if(!IsDir && str_endswith(pInfo->m_pName, ".idx"))
+		((std::vector<std::pair<time_t, std::string>> *)pUser)->emplace_back(pInfo->m_TimeModified, pInfo->m_pName);
+	return 0;
+}
+
+// Removes the least recently written index files, except the given one, once there are too many.
+static void PruneDemoIndex(IStorage *pStorage, const char *pKeepFilename)
+{
+	std::vector<std::pair<time_t, std::string>> vIndexFiles;
+	pStorage->ListDirectoryInfo(IStorage::TYPE_SAVE, "demoindex", CollectDemoIndex, &vIndexFiles);
+	if((int)vIndexFiles.size() <= gs_MaxIndexFiles)
+		return;
+
+	std::sort(vIndexFiles.begin(), vIndexFiles.end());
+	int NumRemove = vIndexFiles.size() - gs_MaxIndexFiles;
+	for(const auto &[TimeModified, Name] : vIndexFiles)
+	{
+		if(NumRemove <= 0)
+			break;
+		char aFilename[IO_MAX_PATH_LENGTH];
+		str_format(aFilename, sizeof(aFilename), "demoindex/%s", Name.c_str());
+		if(str_comp(aFilename, pKeepFilename) == 0)
+			continue;
+		pStorage->RemoveFile(aFilename, IStorage::TYPE_SAVE);
+		NumRemove--;
+	}
+}
+
 CDemoRecorder::CDemoRecorder(class CSnapshotDelta *pSnapshotDelta, bool NoMapData)
 {
 	m_File = 0;
@@ -80,7 +168,7 @@ int CDemoRecorder::Start(class IStorage *pStorage, class IConsole *pConsole, con
 	if(pSha256)
 		sha256_str(*pSha256, aSha256, sizeof(aSha256));
 
-	if(!pMapData && !MapFile)
+	if(!m_NoMapData && !pMapData && !MapFile)
 	{
 		// open mapfile
 		char aMapFilename[128];
@@ -415,9 +503,11 @@ void CDemoPlayer::Construct(class CSnapshotDelta *pSnapshotDelta)
 	m_File = 0;
 	m_pKeyFrames = 0;
 	m_SpeedIndex = 4;
+	m_WriteIndex = false;
 
 	m_pSnapshotDelta = pSnapshotDelta;
 	m_LastSnapshotDataSize = -1;
+	m_SnapshotCacheSize = 0;
 }
 
 void CDemoPlayer::SetListener(IListener *pListener)
@@ -533,7 +623,7 @@ void CDemoPlayer::ScanFile()
 
 	// copy all the frames to an array instead for fast access
 	int i;
-	m_pKeyFrames = (CKeyFrame *)calloc(maximum(m_Info.m_SeekablePoints, 1), sizeof(CKeyFrame));
+	m_pKeyFrames = (CDemoKeyFrame *)calloc(maximum(m_Info.m_SeekablePoints, 1), sizeof(CDemoKeyFrame));
 	for(pCurrentKey = pFirstKey, i = 0; pCurrentKey; pCurrentKey = pCurrentKey->m_pNext, i++)
 		m_pKeyFrames[i] = pCurrentKey->m_Frame;
 
@@ -541,6 +631,81 @@ void CDemoPlayer::ScanFile()
 	io_seek(m_File, StartPos, IOSEEK_START);
 }
 
+bool CDemoPlayer::LoadIndex(class IStorage *pStorage, const char *pIndexFilename)
+{
+	IOHANDLE File = pStorage->OpenFile(pIndexFilename, IOFLAG_READ, IStorage::TYPE_SAVE);
+	if(!File)
+		return false;
+
+	unsigned char aHeader[sizeof(gs_aIndexMarker) + 4 * sizeof(int32_t)];
+	if(io_read(File, aHeader, sizeof(aHeader)) != sizeof(aHeader) ||
+		mem_comp(aHeader, gs_aIndexMarker, sizeof(gs_aIndexMarker)) != 0 ||
+		bytes_be_to_uint(aHeader + sizeof(gs_aIndexMarker)) != (unsigned)gs_IndexVersion)
+	{
+		io_close(File);
+		return false;
+	}
+
+	const int FirstTick = bytes_be_to_uint(aHeader + sizeof(gs_aIndexMarker) + sizeof(int32_t));
+	const int LastTick = bytes_be_to_uint(aHeader + sizeof(gs_aIndexMarker) + 2 * sizeof(int32_t));
+	const int NumKeyFrames = bytes_be_to_uint(aHeader + sizeof(gs_aIndexMarker) + 3 * sizeof(int32_t));
+	if(NumKeyFrames < 0 || io_length(File) != (long)(sizeof(aHeader) + NumKeyFrames * 2 * sizeof(int32_t)))
+	{
+		io_close(File);
+		return false;
+	}
+
+	io_seek(File, sizeof(aHeader), IOSEEK_START);
+	CDemoKeyFrame *pKeyFrames = (CDemoKeyFrame *)calloc(maximum(NumKeyFrames, 1), sizeof(CDemoKeyFrame));
+	for(int i = 0; i < NumKeyFrames; i++)
+	{
+		unsigned char aKeyFrame[2 * sizeof(int32_t)];
+		io_read(File, aKeyFrame, sizeof(aKeyFrame));
+		pKeyFrames[i].m_Filepos = bytes_be_to_uint(aKeyFrame);
+		pKeyFrames[i].m_Tick = bytes_be_to_uint(aKeyFrame + sizeof(int32_t));
+	}
+	io_close(File);
+
+	m_pKeyFrames = pKeyFrames;
+	m_Info.m_SeekablePoints = NumKeyFrames;
+	m_Info.m_Info.m_FirstTick = FirstTick;
+	m_Info.m_Info.m_LastTick = LastTick;
+	return true;
+}
+
+void CDemoPlayer::CacheSnapshot(long Filepos, int Tick)
+{
+	const size_t MaxSize = (size_t)g_Config.m_ClDemoSeekCacheSize * 1024 * 1024;
+	if(m_LastSnapshotDataSize <= 0 || (size_t)m_LastSnapshotDataSize > MaxSize)
+		return;
+
+	// keep one snapshot per interval
+	auto Next = m_SnapshotCache.upper_bound(Tick);
+	if(Next != m_SnapshotCache.begin() && std::prev(Next)->first > Tick - gs_SnapshotCacheInterval)
+		return;
+	if(Next != m_SnapshotCache.end() && Next->first < Tick + gs_SnapshotCacheInterval)
+		return;
+
+	// evict the snapshots furthest away from the current position
+	while(!m_SnapshotCache.empty() && m_SnapshotCacheSize + m_LastSnapshotDataSize > MaxSize)
+	{
+		auto Evict = Tick - m_SnapshotCache.begin()->first > m_SnapshotCache.rbegin()->first - Tick ? m_SnapshotCache.begin() : std::prev(m_SnapshotCache.end());
+		m_SnapshotCacheSize -= Evict->second.m_vSnapshotData.size();
+		m_SnapshotCache.erase(Evict);
+	}
+
+	CSnapshotCacheEntry &Entry = m_SnapshotCache[Tick];
+	Entry.m_Filepos = Filepos;
+	Entry.m_vSnapshotData.assign(m_aLastSnapshotData, m_aLastSnapshotData + m_LastSnapshotDataSize);
+	m_SnapshotCacheSize += m_LastSnapshotDataSize;
+}
+
+void CDemoPlayer::ClearSnapshotCache()
+{
+	m_SnapshotCache.clear();
+	m_SnapshotCacheSize = 0;
+}
+
 void CDemoPlayer::DoTick()
 {
 	// update ticks
@@ -583,11 +748,9 @@ void CDemoPlayer::DoTick()
 
 		// read the chunk
 		int DataSize = 0;
-		static char s_aData[CSnapshot::MAX_SIZE];
 		if(ChunkSize)
 		{
-			static char s_aCompresseddata[CSnapshot::MAX_SIZE];
-			if(io_read(m_File, s_aCompresseddata, ChunkSize) != (unsigned)ChunkSize)
+			if(io_read(m_File, m_aCompressedSnapshotData, ChunkSize) != (unsigned)ChunkSize)
 			{
 				// stop on error or eof
 				if(m_pConsole)
@@ -596,8 +759,7 @@ void CDemoPlayer::DoTick()
 				break;
 			}
 
-			static char s_aDecompressed[CSnapshot::MAX_SIZE];
-			DataSize = CNetBase::Decompress(s_aCompresseddata, ChunkSize, s_aDecompressed, sizeof(s_aDecompressed));
+			DataSize = CNetBase::Decompress(m_aCompressedSnapshotData, ChunkSize, m_aDecompressedSnapshotData, sizeof(m_aDecompressedSnapshotData));
 			if(DataSize < 0)
 			{
 				// stop on error or eof
@@ -607,7 +769,7 @@ void CDemoPlayer::DoTick()
 				break;
 			}
 
-			DataSize = CVariableInt::Decompress(s_aDecompressed, DataSize, s_aData, sizeof(s_aData));
+			DataSize = CVariableInt::Decompress(m_aDecompressedSnapshotData, DataSize, m_aCurrentSnapshotData, sizeof(m_aCurrentSnapshotData));
 
 			if(DataSize < 0)
 			{
@@ -621,9 +783,8 @@ void CDemoPlayer::DoTick()
 		if(ChunkType == CHUNKTYPE_DELTA)
 		{
 			// process delta snapshot
-			static char s_aNewsnap[CSnapshot::MAX_SIZE];
-			CSnapshot *pNewsnap = (CSnapshot *)s_aNewsnap;
-			DataSize = m_pSnapshotDelta->UnpackDelta((CSnapshot *)m_aLastSnapshotData, pNewsnap, s_aData, DataSize);
+			CSnapshot *pNewsnap = (CSnapshot *)m_aDeltaSnapshotData;
+			DataSize = m_pSnapshotDelta->UnpackDelta((CSnapshot *)m_aLastSnapshotData, pNewsnap, m_aCurrentSnapshotData, DataSize);
 
 			if(DataSize < 0)
 			{
@@ -646,17 +807,17 @@ void CDemoPlayer::DoTick()
 			else
 			{
 				if(m_pListener)
-					m_pListener->OnDemoPlayerSnapshot(s_aNewsnap, DataSize);
+					m_pListener->OnDemoPlayerSnapshot(m_aDeltaSnapshotData, DataSize);
 
 				m_LastSnapshotDataSize = DataSize;
-				mem_copy(m_aLastSnapshotData, s_aNewsnap, DataSize);
+				mem_copy(m_aLastSnapshotData, m_aDeltaSnapshotData, DataSize);
 				GotSnapshot = true;
 			}
 		}
 		else if(ChunkType == CHUNKTYPE_SNAPSHOT)
 		{
 			// process full snapshot
-			CSnapshot *pSnap = (CSnapshot *)s_aData;
+			CSnapshot *pSnap = (CSnapshot *)m_aCurrentSnapshotData;
 			if(!pSnap->IsValid(DataSize))
 			{
 				if(m_pConsole)
@@ -671,9 +832,9 @@ void CDemoPlayer::DoTick()
 				GotSnapshot = true;
 
 				m_LastSnapshotDataSize = DataSize;
-				mem_copy(m_aLastSnapshotData, s_aData, DataSize);
+				mem_copy(m_aLastSnapshotData, m_aCurrentSnapshotData, DataSize);
 				if(m_pListener)
-					m_pListener->OnDemoPlayerSnapshot(s_aData, DataSize);
+					m_pListener->OnDemoPlayerSnapshot(m_aCurrentSnapshotData, DataSize);
 			}
 		}
 		else
@@ -688,13 +849,16 @@ void CDemoPlayer::DoTick()
 			// check the remaining types
 			if(ChunkType & CHUNKTYPEFLAG_TICKMARKER)
 			{
+				// remember the delta base of this tick, keyframes are seekable anyway
+				if(!(ChunkType & CHUNKTICKFLAG_KEYFRAME))
+					CacheSnapshot(io_tell(m_File), ChunkTick);
 				m_Info.m_NextTick = ChunkTick;
 				break;
 			}
 			else if(ChunkType == CHUNKTYPE_MESSAGE)
 			{
 				if(m_pListener)
-					m_pListener->OnDemoPlayerMessage(s_aData, DataSize);
+					m_pListener->OnDemoPlayerMessage(m_aCurrentSnapshotData, DataSize);
 			}
 		}
 	}
@@ -747,6 +911,7 @@ int CDemoPlayer::Load(class IStorage *pStorage, class IConsole *pConsole, const
 	m_SpeedIndex = 4;
 
 	m_LastSnapshotDataSize = -1;
+	ClearSnapshotCache();
 
 	// read the header
 	io_read(m_File, &m_Info.m_Header, sizeof(m_Info.m_Header));
@@ -832,12 +997,25 @@ int CDemoPlayer::Load(class IStorage *pStorage, class IConsole *pConsole, const
 		}
 	}
 
-	// scan the file for interesting points
-	ScanFile();
-
-	// reset slice markers
-	g_Config.m_ClDemoSliceBegin = -1;
-	g_Config.m_ClDemoSliceEnd = -1;
+	// use the keyframe index of this demo if there is one, otherwise scan the file
+	// for interesting points and save the index, if enabled, to make the next load instant
+	const long DataStart = io_tell(m_File);
+	io_seek(m_File, 0, IOSEEK_END);
+	const int64_t DemoSize = io_tell(m_File);
+	io_seek(m_File, DataStart, IOSEEK_START);
+	char aIndexFilename[IO_MAX_PATH_LENGTH];
+	DemoIndexFilename(&m_Info.m_Header, &m_Info.m_TimelineMarkers, DemoSize, aIndexFilename, sizeof(aIndexFilename));
+	if(!LoadIndex(pStorage, aIndexFilename))
+	{
+		ScanFile();
+		if(m_WriteIndex)
+		{
+			if(WriteDemoIndex(pStorage, aIndexFilename, m_Info.m_Info.m_FirstTick, m_Info.m_Info.m_LastTick, m_pKeyFrames, m_Info.m_SeekablePoints))
+				PruneDemoIndex(pStorage, aIndexFilename);
+			else
+				dbg_msg("demo", "failed to write keyframe index '%s'", aIndexFilename);
+		}
+	}
 
 	// ready for playback
 	return 0;
@@ -988,13 +1166,26 @@ int CDemoPlayer::SetPos(int WantedTick)
 	while(KeyFrame > 0 && m_pKeyFrames[KeyFrame].m_Tick > KeyFrameWantedTick)
 		KeyFrame--;
 
-	// seek to the correct key frame
-	io_seek(m_File, m_pKeyFrames[KeyFrame].m_Filepos, IOSEEK_START);
-
 	m_Info.m_NextTick = -1;
 	m_Info.m_Info.m_CurrentTick = -1;
 	m_Info.m_PreviousTick = -1;
 
+	// resume right after the tick marker of a cached snapshot if it is closer than the key frame
+	auto CachedSnapshot = m_SnapshotCache.upper_bound(KeyFrameWantedTick);
+	if(CachedSnapshot != m_SnapshotCache.begin() && std::prev(CachedSnapshot)->first > m_pKeyFrames[KeyFrame].m_Tick)
+	{
+		--CachedSnapshot;
+		io_seek(m_File, CachedSnapshot->second.m_Filepos, IOSEEK_START);
+		m_Info.m_NextTick = CachedSnapshot->first;
+		m_LastSnapshotDataSize = CachedSnapshot->second.m_vSnapshotData.size();
+		mem_copy(m_aLastSnapshotData, CachedSnapshot->second.m_vSnapshotData.data(), m_LastSnapshotDataSize);
+	}
+	else
+	{
+		// seek to the correct key frame
+		io_seek(m_File, m_pKeyFrames[KeyFrame].m_Filepos, IOSEEK_START);
+	}
+
 	// playback everything until we hit our tick
 	while(m_Info.m_NextTick < WantedTick)
 		DoTick();
@@ -1089,6 +1280,7 @@ int CDemoPlayer::Stop()
 	m_File = 0;
 	free(m_pKeyFrames);
 	m_pKeyFrames = 0;
+	ClearSnapshotCache();
 	str_copy(m_aFilename, "");
 	return 0;
 }
@@ -1170,11 +1362,12 @@ void CDemoEditor::Init(const char *pNetVersion, class CSnapshotDelta *pSnapshotD
 
 void CDemoEditor::Slice(const char *pDemo, const char *pDst, int StartTick, int EndTick, DEMOFUNC_FILTER pfnFilter, void *pUser)
 {
-	class CDemoPlayer DemoPlayer(m_pSnapshotDelta);
-	class CDemoRecorder DemoRecorder(m_pSnapshotDelta);
+	// the player is too large for the stack
+	std::unique_ptr<CDemoPlayer> pDemoPlayer = std::make_unique<CDemoPlayer>(m_pSnapshotDelta);
+	std::unique_ptr<CDemoRecorder> pDemoRecorder = std::make_unique<CDemoRecorder>(m_pSnapshotDelta);
 
-	m_pDemoPlayer = &DemoPlayer;
-	m_pDemoRecorder = &DemoRecorder;
+	m_pDemoPlayer = pDemoPlayer.get();
+	m_pDemoRecorder = pDemoRecorder.get();
 
 	m_pDemoPlayer->SetListener(this);
 
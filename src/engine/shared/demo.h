@@ -8,11 +8,19 @@
 #include <engine/demo.h>
 #include <engine/shared/protocol.h>
 #include <functional>
+#include <map>
+#include <vector>
 
 #include "snapshot.h"
 
 typedef std::function<void()> TUpdateIntraTimesFunc;
 
+struct CDemoKeyFrame
+{
+	long m_Filepos;
+	int m_Tick;
+};
+
 class CDemoRecorder : public IDemoRecorder
 {
 	class IConsole *m_pConsole;
@@ -91,15 +99,9 @@ private:
 	TUpdateIntraTimesFunc m_UpdateIntraTimesFunc;
 
 	// Playback
-	struct CKeyFrame
-	{
-		long m_Filepos;
-		int m_Tick;
-	};
-
 	struct CKeyFrameSearch
 	{
-		CKeyFrame m_Frame;
+		CDemoKeyFrame m_Frame;
 		CKeyFrameSearch *m_pNext;
 	};
 
@@ -107,7 +109,7 @@ private:
 	IOHANDLE m_File;
 	long m_MapOffset;
 	char m_aFilename[IO_MAX_PATH_LENGTH];
-	CKeyFrame *m_pKeyFrames;
+	CDemoKeyFrame *m_pKeyFrames;
 	CMapInfo m_MapInfo;
 	int m_SpeedIndex;
 
@@ -117,9 +119,28 @@ private:
 	int m_LastSnapshotDataSize;
 	class CSnapshotDelta *m_pSnapshotDelta;
 
+	// chunk buffers, per player so that several demos can be played on different threads
+	unsigned char m_aCompressedSnapshotData[CSnapshot::MAX_SIZE];
+	unsigned char m_aDecompressedSnapshotData[CSnapshot::MAX_SIZE];
+	unsigned char m_aCurrentSnapshotData[CSnapshot::MAX_SIZE];
+	unsigned char m_aDeltaSnapshotData[CSnapshot::MAX_SIZE];
+
+	// reconstructed snapshots that seeking can resume from like from a keyframe
+	struct CSnapshotCacheEntry
+	{
+		long m_Filepos;
+		std::vector<unsigned char> m_vSnapshotData;
+	};
+	std::map<int, CSnapshotCacheEntry> m_SnapshotCache;
+	size_t m_SnapshotCacheSize;
+
 	int ReadChunkHeader(int *pType, int *pSize, int *pTick);
+	void CacheSnapshot(long Filepos, int Tick);
+	void ClearSnapshotCache();
 	void DoTick();
 	void ScanFile();
+	bool m_WriteIndex;
+	bool LoadIndex(class IStorage *pStorage, const char *pIndexFilename);
 
 	int64_t Time();
 
@@ -130,6 +151,8 @@ public:
 	void Construct(class CSnapshotDelta *pSnapshotDelta);
 
 	void SetListener(IListener *pListener);
+	// Saves the keyframe index of scanned demos to demoindex/, so the next load doesn't scan them.
+	void SetWriteIndex(bool WriteIndex) { m_WriteIndex = WriteIndex; }
 
 	int Load(class IStorage *pStorage, class IConsole *pConsole, const char *pFilename, int StorageType);
 	unsigned char *GetMapData(class IStorage *pStorage);
@@ -1,14 +1,48 @@
+#include <base/logger.h>
+#include <base/math.h>
 #include <engine/console.h>
 #include <engine/shared/config.h>
 
 #include "econ.h"
 #include "netban.h"
 
+#include <iterator>
+
+static const char *const gs_apEventNames[NUM_ECON_EVENTS] = {"log", "join", "leave", "chat", "kill", "finish", "tick"};
+static const char *const gs_apLevelNames[] = {"error", "warn", "info", "debug", "trace"};
+
 CEcon::CEcon() :
 	m_Ready(false)
 {
 }
 
+bool CEcon::ParseEvents(const char *pList, unsigned *pEvents)
+{
+	unsigned Events = 0;
+	char aName[32];
+	while((pList = str_next_token(pList, ", ", aName, sizeof(aName))))
+	{
+		if(str_comp(aName, "all") == 0)
+		{
+			Events = (1u << NUM_ECON_EVENTS) - 1;
+			continue;
+		}
+		if(str_comp(aName, "none") == 0)
+		{
+			Events = 0;
+			continue;
+		}
+		int Event = 0;
+		while(Event < NUM_ECON_EVENTS && str_comp(aName, gs_apEventNames[Event]) != 0)
+			Event++;
+		if(Event == NUM_ECON_EVENTS)
+			return false;
+		Events |= 1u << Event;
+	}
+	*pEvents = Events;
+	return true;
+}
+
 int CEcon::NewClientCallback(int ClientID, void *pUser)
 {
 	CEcon *pThis = (CEcon *)pUser;
@@ -22,6 +56,8 @@ int CEcon::NewClientCallback(int ClientID, void *pUser)
 	pThis->m_aClients[ClientID].m_State = CClient::STATE_CONNECTED;
 	pThis->m_aClients[ClientID].m_TimeConnected = time_get();
 	pThis->m_aClients[ClientID].m_AuthTries = 0;
+	pThis->m_aClients[ClientID].m_Format = FORMAT_TEXT;
+	pThis->m_aClients[ClientID].m_Events = (1u << NUM_ECON_EVENTS) - 1;
 
 	pThis->m_NetConsole.Send(ClientID, "Enter password:");
 	return 0;
@@ -38,9 +74,30 @@ int CEcon::DelClientCallback(int ClientID, const char *pReason, void *pUser)
 	pThis->Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "econ", aBuf);
 
 	pThis->m_aClients[ClientID].m_State = CClient::STATE_EMPTY;
+	pThis->UpdateSubscribers();
 	return 0;
 }
 
+CEcon::CClient *CEcon::UserClient()
+{
+	if(m_UserClientID < 0 || m_UserClientID >= NET_MAX_CONSOLE_CLIENTS || m_aClients[m_UserClientID].m_State != CClient::STATE_AUTHED)
+		return nullptr;
+	return &m_aClients[m_UserClientID];
+}
+
+void CEcon::UpdateSubscribers()
+{
+	for(int Event = 0; Event < NUM_ECON_EVENTS; Event++)
+	{
+		m_aNumSubscribers[Event] = 0;
+		for(const auto &Client : m_aClients)
+		{
+			if(Client.m_State == CClient::STATE_AUTHED && Client.m_Format == FORMAT_JSON && Client.m_Events & (1u << Event))
+				m_aNumSubscribers[Event]++;
+		}
+	}
+}
+
 void CEcon::ConLogout(IConsole::IResult *pResult, void *pUserData)
 {
 	CEcon *pThis = static_cast<CEcon *>(pUserData);
@@ -49,6 +106,40 @@ void CEcon::ConLogout(IConsole::IResult *pResult, void *pUserData)
 		pThis->m_NetConsole.Drop(pThis->m_UserClientID, "Logout");
 }
 
+void CEcon::ConFormat(IConsole::IResult *pResult, void *pUserData)
+{
+	CEcon *pThis = static_cast<CEcon *>(pUserData);
+	CClient *pClient = pThis->UserClient();
+	if(!pClient)
+		return;
+
+	if(str_comp(pResult->GetString(0), "text") == 0)
+		pClient->m_Format = FORMAT_TEXT;
+	else if(str_comp(pResult->GetString(0), "json") == 0)
+		pClient->m_Format = FORMAT_JSON;
+	else
+	{
+		pThis->m_NetConsole.Send(pThis->m_UserClientID, "Unknown format, use text or json.");
+		return;
+	}
+	pThis->UpdateSubscribers();
+}
+
+void CEcon::ConEvents(IConsole::IResult *pResult, void *pUserData)
+{
+	CEcon *pThis = static_cast<CEcon *>(pUserData);
+	CClient *pClient = pThis->UserClient();
+	if(!pClient)
+		return;
+
+	if(!ParseEvents(pResult->GetString(0), &pClient->m_Events))
+	{
+		pThis->m_NetConsole.Send(pThis->m_UserClientID, "Unknown event, use all, none or a list of log, join, leave, chat, kill, finish, tick.");
+		return;
+	}
+	pThis->UpdateSubscribers();
+}
+
 void CEcon::Init(CConfig *pConfig, IConsole *pConsole, CNetBan *pNetBan)
 {
 	m_pConfig = pConfig;
@@ -59,6 +150,7 @@ void CEcon::Init(CConfig *pConfig, IConsole *pConsole, CNetBan *pNetBan)
 
 	m_Ready = false;
 	m_UserClientID = -1;
+	UpdateSubscribers();
 
 	if(g_Config.m_EcPort == 0 || g_Config.m_EcPassword[0] == 0)
 		return;
@@ -85,6 +177,8 @@ void CEcon::Init(CConfig *pConfig, IConsole *pConsole, CNetBan *pNetBan)
 		str_format(aBuf, sizeof(aBuf), "bound to %s:%d", g_Config.m_EcBindaddr, g_Config.m_EcPort);
 		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "econ", aBuf);
 		Console()->Register("logout", "", CFGFLAG_ECON, ConLogout, this, "Logout of econ");
+		Console()->Register("econ_format", "s[text|json]", CFGFLAG_ECON, ConFormat, this, "Set the output format of this econ connection");
+		Console()->Register("econ_events", "r[events]", CFGFLAG_ECON, ConEvents, this, "Set the events sent in the json format (all, none or a list of log, join, leave, chat, kill, finish, tick)");
 	}
 	else
 		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "econ", "couldn't open socket. port might already be in use");
@@ -108,6 +202,7 @@ void CEcon::Update()
 			if(str_comp(aBuf, g_Config.m_EcPassword) == 0)
 			{
 				m_aClients[ClientID].m_State = CClient::STATE_AUTHED;
+				UpdateSubscribers();
 				m_NetConsole.Send(ClientID, "Authentication successful. External console access granted.");
 
 				str_format(aBuf, sizeof(aBuf), "cid=%d authed", ClientID);
@@ -164,6 +259,67 @@ void CEcon::Send(int ClientID, const char *pLine)
 		m_NetConsole.Send(ClientID, pLine);
 }
 
+void CEcon::SendLog(const CLogMessage *pMessage)
+{
+	if(!m_Ready)
+		return;
+
+	for(int i = 0; i < NET_MAX_CONSOLE_CLIENTS; i++)
+	{
+		if(m_aClients[i].m_State == CClient::STATE_AUTHED && m_aClients[i].m_Format == FORMAT_TEXT)
+			m_NetConsole.Send(i, pMessage->m_aLine);
+	}
+
+	if(CJsonWriter *pJson = BeginEvent(ECON_EVENT_LOG))
+	{
+		pJson->WriteAttribute("time");
+		pJson->WriteStrValue(pMessage->m_aTimestamp);
+		pJson->WriteAttribute("level");
+		pJson->WriteStrValue(gs_apLevelNames[clamp((int)pMessage->m_Level, 0, (int)std::size(gs_apLevelNames) - 1)]);
+		pJson->WriteAttribute("system");
+		pJson->WriteStrValue(pMessage->m_aSystem);
+		pJson->WriteAttribute("message");
+		pJson->WriteStrValue(pMessage->Message());
+		EndEvent();
+	}
+}
+
+CJsonWriter *CEcon::BeginEvent(int Event)
+{
+	dbg_assert(!m_EventWriter.has_value(), "econ event already begun");
+	if(!m_Ready || m_aNumSubscribers[Event] == 0)
+		return nullptr;
+
+	m_Event = Event;
+	m_EventWriter.emplace();
+	m_EventWriter->SetCompact(true);
+	m_EventWriter->BeginObject();
+	m_EventWriter->WriteAttribute("event");
+	m_EventWriter->WriteStrValue(gs_apEventNames[Event]);
+	return &*m_EventWriter;
+}
+
+void CEcon::EndEvent()
+{
+	dbg_assert(m_EventWriter.has_value(), "econ event not begun");
+	m_EventWriter->EndObject();
+	std::string Line = m_EventWriter->GetOutputString();
+	m_EventWriter.reset();
+	if(!Line.empty() && Line.back() == '\n')
+		Line.pop_back();
+	SendEvent(m_Event, Line.c_str());
+}
+
+void CEcon::SendEvent(int Event, const char *pLine)
+{
+	for(int i = 0; i < NET_MAX_CONSOLE_CLIENTS; i++)
+	{
+		const CClient &Client = m_aClients[i];
+		if(Client.m_State == CClient::STATE_AUTHED && Client.m_Format == FORMAT_JSON && Client.m_Events & (1u << Event))
+			m_NetConsole.Send(i, pLine);
+	}
+}
+
 void CEcon::Shutdown()
 {
 	if(!m_Ready)
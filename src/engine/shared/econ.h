@@ -4,16 +4,36 @@
 #include "network.h"
 
 #include <engine/console.h>
+#include <engine/shared/jsonwriter.h>
+
+#include <optional>
 
 class CConfig;
+class CLogMessage;
 class CNetBan;
 class ColorRGBA;
 
+// events econ clients can subscribe to with econ_events
+enum
+{
+	ECON_EVENT_LOG = 0,
+	ECON_EVENT_JOIN,
+	ECON_EVENT_LEAVE,
+	ECON_EVENT_CHAT,
+	ECON_EVENT_KILL,
+	ECON_EVENT_FINISH,
+	ECON_EVENT_TICK,
+	NUM_ECON_EVENTS
+};
+
 class CEcon
 {
 	enum
 	{
 		MAX_AUTH_TRIES = 3,
+
+		FORMAT_TEXT = 0,
+		FORMAT_JSON,
 	};
 
 	class CClient
@@ -29,8 +49,16 @@ class CEcon
 		int m_State;
 		int64_t m_TimeConnected;
 		int m_AuthTries;
+		int m_Format;
+		// bit mask of ECON_EVENT_*, only used in the json format
+		unsigned m_Events;
 	};
 	CClient m_aClients[NET_MAX_CONSOLE_CLIENTS];
+	// clients in the json format subscribed to each event
+	int m_aNumSubscribers[NUM_ECON_EVENTS];
+
+	std::optional<CJsonStringWriter> m_EventWriter;
+	int m_Event;
 
 	CConfig *m_pConfig;
 	IConsole *m_pConsole;
@@ -42,6 +70,12 @@ class CEcon
 
 	static void SendLineCB(const char *pLine, void *pUserData, ColorRGBA PrintColor = {1, 1, 1, 1});
 	static void ConLogout(IConsole::IResult *pResult, void *pUserData);
+	static void ConFormat(IConsole::IResult *pResult, void *pUserData);
+	static void ConEvents(IConsole::IResult *pResult, void *pUserData);
+
+	CClient *UserClient();
+	void UpdateSubscribers();
+	void SendEvent(int Event, const char *pLine);
 
 	static int NewClientCallback(int ClientID, void *pUser);
 	static int DelClientCallback(int ClientID, const char *pReason, void *pUser);
@@ -53,7 +87,18 @@ public:
 	void Init(CConfig *pConfig, IConsole *pConsole, CNetBan *pNetBan);
 	void Update();
 	void Send(int ClientID, const char *pLine);
+	// Sends a log line to all clients, as text or as log event.
+	void SendLog(const CLogMessage *pMessage);
 	void Shutdown();
+
+	bool Subscribed(int Event) const { return m_Ready && m_aNumSubscribers[Event] > 0; }
+	// Returns a writer for the attributes of the event, or nullptr if no
+	// client is subscribed to it. Must be followed by EndEvent.
+	CJsonWriter *BeginEvent(int Event);
+	void EndEvent();
+
+	// Parses a list like "join,leave chat", "all" or "none".
+	static bool ParseEvents(const char *pList, unsigned *pEvents);
 };
 
 #endif
@@ -315,7 +315,12 @@ size_t CHttpRequest::OnData(char *pData, size_t DataSize)
 	{
 		return 0;
 	}
-	if(!m_WriteToFile)
+	if(m_StreamResponse)
+	{
+		m_ResponseLength += DataSize;
+		return OnResponseData(pData, DataSize) ? DataSize : 0;
+	}
+	else if(!m_WriteToFile)
 	{
 		if(DataSize == 0)
 		{
@@ -399,7 +404,7 @@ void CHttpRequest::Header(const char *pNameColonValue)
 
 void CHttpRequest::Result(unsigned char **ppResult, size_t *pResultLength) const
 {
-	if(m_WriteToFile || State() != HTTP_DONE)
+	if(m_WriteToFile || m_StreamResponse || State() != HTTP_DONE)
 	{
 		*ppResult = nullptr;
 		*pResultLength = 0;
@@ -59,10 +59,11 @@ class CHttpRequest : public IJob
 	REQUEST m_Type = REQUEST::GET;
 
 	bool m_WriteToFile = false;
+	bool m_StreamResponse = false;
 
 	uint64_t m_ResponseLength = 0;
 
-	// If `m_WriteToFile` is false.
+	// If `m_WriteToFile` and `m_StreamResponse` are false.
 	size_t m_BufferSize = 0;
 	unsigned char *m_pBuffer = nullptr;
 
@@ -95,6 +96,11 @@ class CHttpRequest : public IJob
 protected:
 	virtual void OnProgress() {}
 	virtual int OnCompletion(int State);
+	// Called on the request thread with each chunk of the response instead
+	// of buffering it if `StreamResponse()` was used. Abort the request if
+	// it returns false.
+	virtual bool OnResponseData(const char *pData, size_t DataSize) { return true; }
+	void StreamResponse() { m_StreamResponse = true; }
 
 public:
 	CHttpRequest(const char *pUrl);
@@ -113,3 +113,219 @@ const char *JsonBool(bool Bool)
 		return "false";
 	}
 }
+
+static bool IsJsonSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool IsJsonScalar(char c)
+{
+	return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || c == '-' || c == '+' || c == '.' || c == 'E';
+}
+
+CJsonArrayStream::CJsonArrayStream(FElementCallback pfnCallback, void *pUser) :
+	m_pfnCallback(pfnCallback), m_pUser(pUser)
+{
+}
+
+bool CJsonArrayStream::Feed(const char *pData, size_t DataSize)
+{
+	for(size_t i = 0; i < DataSize && !m_Error; i++)
+		m_Error = FeedChar(pData[i]);
+	return m_Error;
+}
+
+bool CJsonArrayStream::Finish()
+{
+	return m_Error || !m_Done;
+}
+
+bool CJsonArrayStream::HasKey(const char *pKey) const
+{
+	for(const auto &Key : m_vKeys)
+	{
+		if(Key.first == pKey)
+			return true;
+	}
+	return false;
+}
+
+bool CJsonArrayStream::IsArray(const char *pKey) const
+{
+	for(const auto &Key : m_vKeys)
+	{
+		if(Key.first == pKey)
+			return Key.second;
+	}
+	return false;
+}
+
+void CJsonArrayStream::EndElement()
+{
+	m_InElement = false;
+	m_State = STATE_AFTER_ELEMENT;
+	m_pfnCallback(m_Key.c_str(), m_Element.data(), m_Element.size(), m_pUser);
+}
+
+bool CJsonArrayStream::FeedChar(char c)
+{
+	if(m_InString)
+	{
+		if(m_InElement)
+			m_Element += c;
+		if(m_Escape)
+			m_Escape = false;
+		else if(c == '\\')
+			m_Escape = true;
+		else if(c == '"')
+		{
+			m_InString = false;
+			if(m_ReadingKey)
+			{
+				m_ReadingKey = false;
+				m_State = STATE_COLON;
+			}
+			else if(m_InElement && m_vClosers.size() == 1)
+				EndElement();
+			return false;
+		}
+		else if((unsigned char)c < 0x20)
+			return true;
+		if(m_ReadingKey)
+			m_Key += c;
+		return false;
+	}
+
+	if(m_InScalar)
+	{
+		if(IsJsonScalar(c))
+		{
+			if(m_InElement)
+				m_Element += c;
+			return false;
+		}
+		m_InScalar = false;
+		if(m_InElement && m_vClosers.size() == 1)
+			EndElement();
+	}
+
+	if(IsJsonSpace(c))
+	{
+		if(m_InElement)
+			m_Element += c;
+		return false;
+	}
+
+	if(m_Done)
+		return true;
+	if(!m_Started)
+	{
+		m_Started = true;
+		return c != '{';
+	}
+
+	// directly inside the top level object
+	if(m_vClosers.empty())
+	{
+		switch(m_State)
+		{
+		case STATE_KEY_OR_END:
+			if(c == '}')
+			{
+				m_Done = true;
+				return false;
+			}
+			[[fallthrough]];
+		case STATE_KEY:
+			if(c != '"')
+				return true;
+			m_InString = true;
+			m_ReadingKey = true;
+			m_Key.clear();
+			return false;
+		case STATE_COLON:
+			if(c != ':')
+				return true;
+			m_State = STATE_VALUE;
+			return false;
+		case STATE_VALUE:
+			m_vKeys.emplace_back(m_Key, c == '[');
+			m_State = STATE_AFTER_VALUE;
+			if(c == '[')
+			{
+				m_vClosers.push_back(']');
+				m_State = STATE_ELEMENT_OR_END;
+			}
+			else if(c == '{')
+				m_vClosers.push_back('}');
+			else if(c == '"')
+				m_InString = true;
+			else if(IsJsonScalar(c))
+				m_InScalar = true;
+			else
+				return true;
+			return false;
+		case STATE_AFTER_VALUE:
+			if(c == ',')
+				m_State = STATE_KEY;
+			else if(c == '}')
+				m_Done = true;
+			else
+				return true;
+			return false;
+		default:
+			return true;
+		}
+	}
+
+	// directly inside a top level array
+	if(m_vClosers.size() == 1 && !m_InElement && m_State >= STATE_ELEMENT_OR_END)
+	{
+		if(c == ']' && m_State != STATE_ELEMENT)
+		{
+			m_vClosers.pop_back();
+			m_State = STATE_AFTER_VALUE;
+			return false;
+		}
+		if(m_State == STATE_AFTER_ELEMENT)
+		{
+			if(c != ',')
+				return true;
+			m_State = STATE_ELEMENT;
+			return false;
+		}
+		m_InElement = true;
+		m_Element.assign(1, c);
+		if(c == '{')
+			m_vClosers.push_back('}');
+		else if(c == '[')
+			m_vClosers.push_back(']');
+		else if(c == '"')
+			m_InString = true;
+		else if(IsJsonScalar(c))
+			m_InScalar = true;
+		else
+			return true;
+		return false;
+	}
+
+	// inside an element or a skipped value
+	if(m_InElement)
+		m_Element += c;
+	if(c == '{')
+		m_vClosers.push_back('}');
+	else if(c == '[')
+		m_vClosers.push_back(']');
+	else if(c == '}' || c == ']')
+	{
+		if(m_vClosers.back() != c)
+			return true;
+		m_vClosers.pop_back();
+		if(m_InElement && m_vClosers.size() == 1)
+			EndElement();
+	}
+	else if(c == '"')
+		m_InString = true;
+	return false;
+}
@@ -3,6 +3,9 @@
 
 #include <engine/external/json-parser/json.h>
 
+#include <string>
+#include <vector>
+
 const struct _json_value *json_object_get(const json_value *object, const char *index);
 const struct _json_value *json_array_get(const json_value *array, int index);
 int json_array_length(const json_value *array);
@@ -13,4 +16,64 @@ int json_boolean_get(const json_value *boolean);
 char *EscapeJson(char *pBuffer, int BufferSize, const char *pString);
 const char *JsonBool(bool Bool);
 
+// Splits a JSON object that is received in chunks into the elements of its
+// top level arrays, without keeping the whole document in memory. Each
+// element is handed out as a standalone JSON text for json_parse. Only the
+// structure around the elements is checked, the elements themselves are
+// left to the parser.
+class CJsonArrayStream
+{
+public:
+	typedef void (*FElementCallback)(const char *pKey, const char *pJson, size_t Length, void *pUser);
+
+	CJsonArrayStream(FElementCallback pfnCallback, void *pUser);
+
+	// return true on error
+	bool Feed(const char *pData, size_t DataSize);
+	bool Finish();
+
+	// whether the top level object has the key, and if its value is an array
+	bool HasKey(const char *pKey) const;
+	bool IsArray(const char *pKey) const;
+
+private:
+	enum
+	{
+		// inside the top level object
+		STATE_KEY,
+		STATE_KEY_OR_END,
+		STATE_COLON,
+		STATE_VALUE,
+		STATE_AFTER_VALUE,
+		// inside a top level array
+		STATE_ELEMENT_OR_END,
+		STATE_ELEMENT,
+		STATE_AFTER_ELEMENT,
+	};
+
+	bool FeedChar(char c);
+	void EndElement();
+
+	FElementCallback m_pfnCallback;
+	void *m_pUser;
+
+	bool m_Started = false;
+	bool m_Done = false;
+	bool m_Error = false;
+	int m_State = STATE_KEY_OR_END;
+
+	// brackets that still have to be closed, the top level object not included
+	std::vector<char> m_vClosers;
+	bool m_InString = false;
+	bool m_Escape = false;
+	bool m_InScalar = false;
+
+	bool m_ReadingKey = false;
+	std::string m_Key;
+	std::vector<std::pair<std::string, bool>> m_vKeys;
+
+	bool m_InElement = false;
+	std::string m_Element;
+};
+
 #endif // ENGINE_SHARED_JSON_H
@@ -21,6 +21,7 @@ static char EscapeJsonChar(char c)
 CJsonWriter::CJsonWriter()
 {
 	m_Indentation = 0;
+	m_Compact = false;
 }
 
 void CJsonWriter::BeginObject()
@@ -62,7 +63,7 @@ void CJsonWriter::WriteAttribute(const char *pName)
 	dbg_assert(TopState()->m_Kind == STATE_OBJECT, "Cannot write attribute here");
 	WriteIndent(false);
 	WriteInternalEscaped(pName);
-	WriteInternal(": ");
+	WriteInternal(m_Compact ? ":" : ": ");
 	PushState(STATE_ATTRIBUTE);
 }
 
@@ -153,6 +154,9 @@ void CJsonWriter::WriteIndent(bool EndElement)
 	if(NotRootOrAttribute && !TopState()->m_Empty && !EndElement)
 		WriteInternal(",");
 
+	if(m_Compact)
+		return;
+
 	if(NotRootOrAttribute || EndElement)
 		WriteInternal("\n");
 
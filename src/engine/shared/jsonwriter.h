@@ -32,6 +32,7 @@ class CJsonWriter
 
 	std::stack<SState> m_States;
 	int m_Indentation;
+	bool m_Compact;
 
 	bool CanWriteDatatype();
 	void WriteInternalEscaped(const char *pStr);
@@ -49,6 +50,10 @@ public:
 	CJsonWriter();
 	virtual ~CJsonWriter() = default;
 
+	// Write everything on one line, e.g. for line based protocols.
+	// Must be set before writing anything.
+	void SetCompact(bool Compact) { m_Compact = Compact; }
+
 	// The root is created by beginning the first datatype (object, array, value).
 	// The writer must not be used after ending the root, which must be unique.
 
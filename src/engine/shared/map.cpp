@@ -65,6 +65,18 @@ bool CMap::Load(const char *pMapName)
 		return false;
 	if(!m_DataFile.Open(pStorage, pMapName, IStorage::TYPE_ALL))
 		return false;
+	return OnLoad();
+}
+
+bool CMap::LoadData(void *pData, unsigned Size)
+{
+	if(!m_DataFile.OpenData(pData, Size))
+		return false;
+	return OnLoad();
+}
+
+bool CMap::OnLoad()
+{
 	// check version
 	const CMapItemVersion *pItem = (CMapItemVersion *)m_DataFile.FindItem(MAPITEMTYPE_VERSION, 0);
 	if(!pItem || pItem->m_Version != CMapItemVersion::CURRENT_VERSION)
@@ -12,6 +12,8 @@ class CMap : public IEngineMap
 {
 	CDataFileReader m_DataFile;
 
+	bool OnLoad();
+
 public:
 	CMap();
 
@@ -30,6 +32,7 @@ public:
 	int NumItems() const override;
 
 	bool Load(const char *pMapName) override;
+	bool LoadData(void *pData, unsigned Size) override;
 	void Unload() override;
 	bool IsLoaded() const override;
 	IOHANDLE File() const override;
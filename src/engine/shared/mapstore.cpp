@@ -0,0 +1,311 @@
+#include "mapstore.h"
+
+#include <base/log.h>
+#include <base/math.h>
+
+#include <engine/shared/datafile.h>
+#include <engine/storage.h>
+
+#include <algorithm>
+#include <string>
+
+static const unsigned char gs_aManifestMarker[8] = {'M', 'A', 'P', 'S', 'T', 'O', 'R', 'E'};
+static const unsigned char gs_ManifestVersion = 1;
+
+CMapStore::CMapStore(IStorage *pStorage, const char *pRoot, int StorageType) :
+	m_pStorage(pStorage), m_StorageType(StorageType)
+{
+	str_copy(m_aRoot, pRoot);
+}
+
+void CMapStore::ManifestPath(const char *pName, char *pBuf, int BufSize) const
+{
+	str_format(pBuf, BufSize, "%s%smaps/%s.mst", m_aRoot, m_aRoot[0] ? "/" : "", pName);
+}
+
+void CMapStore::BlockPath(const SHA256_DIGEST &Sha256, char *pBuf, int BufSize) const
+{
+	char aSha256[SHA256_MAXSTRSIZE];
+	sha256_str(Sha256, aSha256, sizeof(aSha256));
+	// two hex digits of fan-out keep the directories small for big map pools
+	str_format(pBuf, BufSize, "%s%sblocks/%.2s/%s.blk", m_aRoot, m_aRoot[0] ? "/" : "", aSha256, aSha256);
+}
+
+static bool WriteFileAtomic(IStorage *pStorage, const char *pFilename, const void *pData, unsigned Size)
+{
+	char aCompletePath[IO_MAX_PATH_LENGTH];
+	pStorage->GetCompletePath(IStorage::TYPE_SAVE, pFilename, aCompletePath, sizeof(aCompletePath));
+	if(fs_makedir_rec_for(aCompletePath) < 0)
+		return false;
+
+	char aTmpPath[IO_MAX_PATH_LENGTH];
+	IStorage::FormatTmpPath(aTmpPath, sizeof(aTmpPath), pFilename);
+	IOHANDLE File = pStorage->OpenFile(aTmpPath, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	if(!File)
+		return false;
+	const bool Written = io_write(File, pData, Size) == Size;
+	io_close(File);
+	if(!Written || !pStorage->RenameFile(aTmpPath, pFilename, IStorage::TYPE_SAVE))
+	{
+		pStorage->RemoveFile(aTmpPath, IStorage::TYPE_SAVE);
+		return false;
+	}
+	return true;
+}
+
+bool CMapStore::WriteBlock(const unsigned char *pData, unsigned Size, CBlock *pBlock, bool *pNew)
+{
+	pBlock->m_Sha256 = sha256(pData, Size);
+	pBlock->m_Size = Size;
+
+	char aPath[IO_MAX_PATH_LENGTH];
+	BlockPath(pBlock->m_Sha256, aPath, sizeof(aPath));
+	*pNew = !m_pStorage->FileExists(aPath, IStorage::TYPE_SAVE);
+	return !*pNew || WriteFileAtomic(m_pStorage, aPath, pData, Size);
+}
+
+bool CMapStore::AddMap(const char *pName, const char *pFilename, int StorageType, CAddResult *pResult)
+{
+	void *pFileData;
+	unsigned FileSize;
+	if(!m_pStorage->ReadFile(pFilename, StorageType, &pFileData, &FileSize))
+	{
+		log_error("mapstore", "could not read map '%s'", pFilename);
+		return false;
+	}
+
+	CDataFileReader Reader;
+	if(!Reader.Open(m_pStorage, pFilename, StorageType))
+	{
+		free(pFileData);
+		return false;
+	}
+
+	// the stored data blocks become blocks of their own, everything in between is kept as is
+	std::vector<std::pair<unsigned, unsigned>> vRanges;
+	for(int i = 0; i < Reader.NumData(); i++)
+	{
+		int Offset, Size;
+		if(Reader.GetDataFileRange(i, &Offset, &Size) && Offset >= 0 && Size > 0 && (unsigned)Offset + Size <= FileSize)
+			vRanges.emplace_back(Offset, Size);
+	}
+	Reader.Close();
+	std::sort(vRanges.begin(), vRanges.end());
+
+	std::vector<std::pair<unsigned, unsigned>> vSegments;
+	unsigned Pos = 0;
+	for(const auto &Range : vRanges)
+	{
+		if(Range.first < Pos)
+			continue;
+		if(Range.first > Pos)
+			vSegments.emplace_back(Pos, Range.first - Pos);
+		vSegments.push_back(Range);
+		Pos = Range.first + Range.second;
+	}
+	if(Pos < FileSize)
+		vSegments.emplace_back(Pos, FileSize - Pos);
+
+	CAddResult Result;
+	std::vector<CBlock> vBlocks;
+	bool Success = true;
+	for(const auto &Segment : vSegments)
+	{
+		CBlock Block;
+		bool New;
+		if(!WriteBlock((const unsigned char *)pFileData + Segment.first, Segment.second, &Block, &New))
+		{
+			Success = false;
+			break;
+		}
+		vBlocks.push_back(Block);
+		Result.m_NumBlocks++;
+		Result.m_Size += Block.m_Size;
+		if(New)
+		{
+			Result.m_NumNewBlocks++;
+			Result.m_NewSize += Block.m_Size;
+		}
+	}
+	const SHA256_DIGEST Sha256 = sha256(pFileData, FileSize);
+	free(pFileData);
+	if(!Success)
+	{
+		log_error("mapstore", "could not write blocks of map '%s'", pFilename);
+		return false;
+	}
+
+	std::vector<unsigned char> vManifest;
+	auto &&AddInt = [&](unsigned Value) {
+		unsigned char aBuf[sizeof(int32_t)];
+		uint_to_bytes_be(aBuf, Value);
+		vManifest.insert(vManifest.end(), aBuf, aBuf + sizeof(aBuf));
+	};
+	vManifest.insert(vManifest.end(), gs_aManifestMarker, gs_aManifestMarker + sizeof(gs_aManifestMarker));
+	vManifest.push_back(gs_ManifestVersion);
+	vManifest.insert(vManifest.end(), Sha256.data, Sha256.data + sizeof(Sha256.data));
+	AddInt(FileSize);
+	AddInt(vBlocks.size());
+	for(const CBlock &Block : vBlocks)
+	{
+		vManifest.insert(vManifest.end(), Block.m_Sha256.data, Block.m_Sha256.data + sizeof(Block.m_Sha256.data));
+		AddInt(Block.m_Size);
+	}
+
+	char aPath[IO_MAX_PATH_LENGTH];
+	ManifestPath(pName, aPath, sizeof(aPath));
+	if(!WriteFileAtomic(m_pStorage, aPath, vManifest.data(), vManifest.size()))
+	{
+		log_error("mapstore", "could not write manifest '%s'", aPath);
+		return false;
+	}
+
+	if(pResult)
+		*pResult = Result;
+	return true;
+}
+
+bool CMapStore::ReadManifest(const char *pName, SHA256_DIGEST *pSha256, unsigned *pSize, std::vector<CBlock> *pvBlocks) const
+{
+	char aPath[IO_MAX_PATH_LENGTH];
+	ManifestPath(pName, aPath, sizeof(aPath));
+	void *pData;
+	unsigned Size;
+	if(!m_pStorage->ReadFile(aPath, m_StorageType, &pData, &Size))
+		return false;
+
+	const unsigned char *pManifest = (const unsigned char *)pData;
+	const unsigned HeaderSize = sizeof(gs_aManifestMarker) + 1 + sizeof(pSha256->data) + 2 * sizeof(int32_t);
+	const unsigned BlockSize = sizeof(pSha256->data) + sizeof(int32_t);
+	bool Valid = Size >= HeaderSize && mem_comp(pManifest, gs_aManifestMarker, sizeof(gs_aManifestMarker)) == 0 && pManifest[sizeof(gs_aManifestMarker)] == gs_ManifestVersion;
+	if(Valid)
+	{
+		pManifest += sizeof(gs_aManifestMarker) + 1;
+		mem_copy(pSha256->data, pManifest, sizeof(pSha256->data));
+		pManifest += sizeof(pSha256->data);
+		*pSize = bytes_be_to_uint(pManifest);
+		const unsigned NumBlocks = bytes_be_to_uint(pManifest + sizeof(int32_t));
+		pManifest += 2 * sizeof(int32_t);
+
+		Valid = NumBlocks <= (Size - HeaderSize) / BlockSize && Size == HeaderSize + NumBlocks * BlockSize;
+		uint64_t Total = 0;
+		pvBlocks->clear();
+		for(unsigned i = 0; Valid && i < NumBlocks; i++)
+		{
+			CBlock Block;
+			mem_copy(Block.m_Sha256.data, pManifest, sizeof(Block.m_Sha256.data));
+			Block.m_Size = bytes_be_to_uint(pManifest + sizeof(Block.m_Sha256.data));
+			pManifest += BlockSize;
+			Total += Block.m_Size;
+			pvBlocks->push_back(Block);
+		}
+		Valid = Valid && Total == *pSize;
+	}
+	free(pData);
+	if(!Valid)
+		log_error("mapstore", "invalid manifest '%s'", aPath);
+	return Valid;
+}
+
+bool CMapStore::HasMap(const char *pName) const
+{
+	char aPath[IO_MAX_PATH_LENGTH];
+	ManifestPath(pName, aPath, sizeof(aPath));
+	return m_pStorage->FileExists(aPath, m_StorageType);
+}
+
+bool CMapStore::ReadMap(const char *pName, void **ppData, unsigned *pSize) const
+{
+	SHA256_DIGEST Sha256;
+	unsigned Size;
+	std::vector<CBlock> vBlocks;
+	if(!ReadManifest(pName, &Sha256, &Size, &vBlocks))
+		return false;
+
+	unsigned char *pData = (unsigned char *)malloc(maximum(Size, 1u));
+	unsigned Pos = 0;
+	for(const CBlock &Block : vBlocks)
+	{
+		char aPath[IO_MAX_PATH_LENGTH];
+		BlockPath(Block.m_Sha256, aPath, sizeof(aPath));
+		IOHANDLE File = m_pStorage->OpenFile(aPath, IOFLAG_READ, m_StorageType);
+		const bool Read = File && io_read(File, pData + Pos, Block.m_Size) == Block.m_Size;
+		if(File)
+			io_close(File);
+		if(!Read)
+		{
+			log_error("mapstore", "missing block '%s' of map '%s'", aPath, pName);
+			free(pData);
+			return false;
+		}
+		Pos += Block.m_Size;
+	}
+
+	if(sha256(pData, Size) != Sha256)
+	{
+		log_error("mapstore", "sha256 mismatch for map '%s'", pName);
+		free(pData);
+		return false;
+	}
+
+	*ppData = pData;
+	*pSize = Size;
+	return true;
+}
+
+struct SListManifestsContext
+{
+	IStorage *m_pStorage;
+	std::string m_Path;
+	// the path below the maps directory, empty or ending with a slash
+	std::string m_Prefix;
+	std::vector<std::string> *m_pvNames;
+};
+
+static int ListManifestCallback(const char *pName, int IsDir, int StorageType, void *pUser)
+{
+	SListManifestsContext *pContext = (SListManifestsContext *)pUser;
+	if(IsDir)
+	{
+		if(pName[0] == '.')
+			return 0;
+		SListManifestsContext SubContext = {pContext->m_pStorage, pContext->m_Path + "/" + pName, pContext->m_Prefix + pName + "/", pContext->m_pvNames};
+		pContext->m_pStorage->ListDirectory(StorageType, SubContext.m_Path.c_str(), ListManifestCallback, &SubContext);
+	}
+	else if(str_endswith(pName, ".mst"))
+		pContext->m_pvNames->push_back(pContext->m_Prefix + std::string(pName, str_length(pName) - str_length(".mst")));
+	return 0;
+}
+
+void CMapStore::GetStats(CStats *pStats) const
+{
+	*pStats = CStats();
+
+	char aPath[IO_MAX_PATH_LENGTH];
+	str_format(aPath, sizeof(aPath), "%s%smaps", m_aRoot, m_aRoot[0] ? "/" : "");
+	std::vector<std::string> vNames;
+	SListManifestsContext Context = {m_pStorage, aPath, "", &vNames};
+	m_pStorage->ListDirectory(m_StorageType, aPath, ListManifestCallback, &Context);
+
+	std::vector<CBlock> vAllBlocks;
+	for(const auto &Name : vNames)
+	{
+		SHA256_DIGEST Sha256;
+		unsigned Size;
+		std::vector<CBlock> vBlocks;
+		if(!ReadManifest(Name.c_str(), &Sha256, &Size, &vBlocks))
+			continue;
+		pStats->m_NumMaps++;
+		pStats->m_MapSize += Size;
+		vAllBlocks.insert(vAllBlocks.end(), vBlocks.begin(), vBlocks.end());
+	}
+
+	std::sort(vAllBlocks.begin(), vAllBlocks.end(), [](const CBlock &a, const CBlock &b) { return mem_comp(a.m_Sha256.data, b.m_Sha256.data, sizeof(a.m_Sha256.data)) < 0; });
+	for(size_t i = 0; i < vAllBlocks.size(); i++)
+	{
+		if(i > 0 && vAllBlocks[i].m_Sha256 == vAllBlocks[i - 1].m_Sha256)
+			continue;
+		pStats->m_NumBlocks++;
+		pStats->m_BlockSize += vAllBlocks[i].m_Size;
+	}
+}
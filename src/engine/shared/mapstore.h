@@ -0,0 +1,61 @@
+#ifndef ENGINE_SHARED_MAPSTORE_H
+#define ENGINE_SHARED_MAPSTORE_H
+
+#include <base/hash.h>
+#include <base/system.h>
+
+#include <vector>
+
+class IStorage;
+
+// Content addressed store for maps. A map is split into its header and item
+// part and its data blocks, every block is saved once under its sha256 and a
+// manifest per map lists the blocks, so tilesets embedded in many maps are
+// only stored once. The manifest also keeps the sha256 of the whole map, the
+// map read back from the store is byte identical.
+class CMapStore
+{
+public:
+	struct CBlock
+	{
+		SHA256_DIGEST m_Sha256;
+		unsigned m_Size;
+	};
+
+	struct CAddResult
+	{
+		int m_NumBlocks = 0;
+		int m_NumNewBlocks = 0;
+		int64_t m_Size = 0;
+		int64_t m_NewSize = 0;
+	};
+
+	struct CStats
+	{
+		int m_NumMaps = 0;
+		int m_NumBlocks = 0;
+		int64_t m_MapSize = 0;
+		int64_t m_BlockSize = 0;
+	};
+
+	// pRoot is the store directory, it is written with TYPE_SAVE and read with StorageType
+	CMapStore(IStorage *pStorage, const char *pRoot, int StorageType);
+
+	bool AddMap(const char *pName, const char *pFilename, int StorageType, CAddResult *pResult = nullptr);
+	bool HasMap(const char *pName) const;
+	// the data must be freed by the caller
+	bool ReadMap(const char *pName, void **ppData, unsigned *pSize) const;
+	void GetStats(CStats *pStats) const;
+
+private:
+	IStorage *m_pStorage;
+	char m_aRoot[IO_MAX_PATH_LENGTH];
+	int m_StorageType;
+
+	void ManifestPath(const char *pName, char *pBuf, int BufSize) const;
+	void BlockPath(const SHA256_DIGEST &Sha256, char *pBuf, int BufSize) const;
+	bool ReadManifest(const char *pName, SHA256_DIGEST *pSha256, unsigned *pSize, std::vector<CBlock> *pvBlocks) const;
+	bool WriteBlock(const unsigned char *pData, unsigned Size, CBlock *pBlock, bool *pNew);
+};
+
+#endif
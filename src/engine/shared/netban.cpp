@@ -2,10 +2,13 @@
 
 #include <engine/console.h>
 #include <engine/shared/config.h>
+#include <engine/shared/linereader.h>
 #include <engine/storage.h>
 
 #include "netban.h"
 
+#include <algorithm>
+
 CNetBan::CNetHash::CNetHash(const NETADDR *pAddr)
 {
 	if(pAddr->type == NETTYPE_IPV4)
@@ -19,72 +22,291 @@ CNetBan::CNetHash::CNetHash(const NETADDR *pAddr)
 
 CNetBan::CNetHash::CNetHash(const CNetRange *pRange)
 {
-	m_Hash = 0;
-	m_HashIndex = 0;
-	for(int i = 0; pRange->m_LB.ip[i] == pRange->m_UB.ip[i]; ++i)
-	{
-		m_Hash += pRange->m_LB.ip[i];
-		++m_HashIndex;
-	}
-	m_Hash &= 0xFF;
+	// lookups go through the trie, this only has to spread the ranges for exact matches
+	const int Length = pRange->m_LB.type == NETTYPE_IPV4 ? 4 : 16;
+	unsigned Hash = 2166136261u;
+	for(int i = 0; i < Length; ++i)
+		Hash = ((Hash ^ pRange->m_LB.ip[i]) * 16777619u ^ pRange->m_UB.ip[i]) * 16777619u;
+	m_Hash = Hash & 0xFF;
+	m_HashIndex = (Hash >> 8) % 16;
 }
 
-int CNetBan::CNetHash::MakeHashArray(const NETADDR *pAddr, CNetHash aHash[17])
+static inline int GetBit(const unsigned char *pData, int Bit)
 {
-	int Length = pAddr->type == NETTYPE_IPV4 ? 4 : 16;
-	aHash[0].m_Hash = 0;
-	aHash[0].m_HashIndex = 0;
-	for(int i = 1, Sum = 0; i <= Length; ++i)
+	return (pData[Bit / 8] >> (7 - Bit % 8)) & 1;
+}
+
+// number of equal leading bits, at most MaxBits, the bits before StartBit are known to match
+static int CommonBits(const unsigned char *pData1, const unsigned char *pData2, int StartBit, int MaxBits)
+{
+	for(int i = StartBit / 8; i * 8 < MaxBits; ++i)
 	{
-		Sum += pAddr->ip[i - 1];
-		aHash[i].m_Hash = Sum & 0xFF;
-		aHash[i].m_HashIndex = i % Length;
+		unsigned char Diff = pData1[i] ^ pData2[i];
+		if(i == StartBit / 8)
+			Diff &= 0xff >> (StartBit % 8);
+		if(Diff)
+		{
+			int Bits = i * 8;
+			while(!(Diff & 0x80))
+			{
+				Diff <<= 1;
+				Bits++;
+			}
+			return minimum(Bits, MaxBits);
+		}
 	}
-	return Length;
+	return MaxBits;
 }
 
-template<class T, int HashCount>
-void CNetBan::CBanPool<T, HashCount>::InsertUsed(CBan<T> *pBan)
+// splits the range into the smallest list of CIDR prefixes covering it
+template<class F>
+static void ForEachPrefix(const CNetRange *pRange, F &&Callback)
 {
-	if(m_pFirstUsed)
+	const int Bytes = pRange->m_LB.type == NETTYPE_IPV4 ? 4 : 16;
+	const int Bits = Bytes * 8;
+	unsigned char aCur[16] = {0};
+	unsigned char aUB[16] = {0};
+	mem_copy(aCur, pRange->m_LB.ip, Bytes);
+	mem_copy(aUB, pRange->m_UB.ip, Bytes);
+
+	while(true)
 	{
-		for(CBan<T> *p = m_pFirstUsed;; p = p->m_pNext)
+		// grow the block while it stays aligned and ends before the upper bound
+		unsigned char aEnd[16];
+		mem_copy(aEnd, aCur, sizeof(aEnd));
+		int HostBits = 0;
+		while(HostBits < Bits && GetBit(aCur, Bits - 1 - HostBits) == 0)
 		{
-			if(p->m_Info.m_Expires == CBanInfo::EXPIRES_NEVER || (pBan->m_Info.m_Expires != CBanInfo::EXPIRES_NEVER && pBan->m_Info.m_Expires <= p->m_Info.m_Expires))
+			const int Bit = Bits - 1 - HostBits;
+			aEnd[Bit / 8] |= 1 << (7 - Bit % 8);
+			if(mem_comp(aEnd, aUB, Bytes) > 0)
 			{
-				// insert before
-				pBan->m_pNext = p;
-				pBan->m_pPrev = p->m_pPrev;
-				if(p->m_pPrev)
-					p->m_pPrev->m_pNext = pBan;
-				else
-					m_pFirstUsed = pBan;
-				p->m_pPrev = pBan;
+				aEnd[Bit / 8] &= ~(1 << (7 - Bit % 8));
 				break;
 			}
+			HostBits++;
+		}
+		Callback(aCur, Bits - HostBits);
+
+		// continue after the block
+		if(mem_comp(aEnd, aUB, Bytes) >= 0)
+			break;
+		mem_copy(aCur, aEnd, sizeof(aCur));
+		for(int i = Bytes - 1; i >= 0 && ++aCur[i] == 0; i--)
+		{
+		}
+	}
+}
+
+void CNetBan::CRangeTrie::Reset()
+{
+	m_vNodes.clear();
+	m_vFreeNodes.clear();
+	const unsigned char aEmpty[16] = {0};
+	NewNode(aEmpty, 0); // ROOT_IPV4
+	NewNode(aEmpty, 0); // ROOT_IPV6
+}
+
+int CNetBan::CRangeTrie::NewNode(const unsigned char *pPrefix, int PrefixLength)
+{
+	int Index;
+	if(!m_vFreeNodes.empty())
+	{
+		Index = m_vFreeNodes.back();
+		m_vFreeNodes.pop_back();
+	}
+	else
+	{
+		Index = m_vNodes.size();
+		m_vNodes.emplace_back();
+	}
 
-			if(!p->m_pNext)
+	CNode &Node = m_vNodes[Index];
+	mem_zero(Node.m_aPrefix, sizeof(Node.m_aPrefix));
+	mem_copy(Node.m_aPrefix, pPrefix, (PrefixLength + 7) / 8);
+	if(PrefixLength % 8)
+		Node.m_aPrefix[PrefixLength / 8] &= 0xff << (8 - PrefixLength % 8);
+	Node.m_PrefixLength = PrefixLength;
+	Node.m_aChildren[0] = Node.m_aChildren[1] = -1;
+	Node.m_vpBans.clear();
+	return Index;
+}
+
+void CNetBan::CRangeTrie::Insert(int Root, const unsigned char *pPrefix, int PrefixLength, CBan<CNetRange> *pBan)
+{
+	int Node = Root;
+	while(m_vNodes[Node].m_PrefixLength < PrefixLength)
+	{
+		const int Bit = GetBit(pPrefix, m_vNodes[Node].m_PrefixLength);
+		int Child = m_vNodes[Node].m_aChildren[Bit];
+		if(Child < 0)
+		{
+			Child = NewNode(pPrefix, PrefixLength);
+			m_vNodes[Node].m_aChildren[Bit] = Child;
+		}
+		else
+		{
+			// split the edge where the prefixes differ
+			const int Common = CommonBits(m_vNodes[Child].m_aPrefix, pPrefix, m_vNodes[Node].m_PrefixLength, minimum(m_vNodes[Child].m_PrefixLength, PrefixLength));
+			if(Common < m_vNodes[Child].m_PrefixLength)
 			{
-				// last entry
-				p->m_pNext = pBan;
-				pBan->m_pPrev = p;
-				pBan->m_pNext = 0;
-				break;
+				const int Split = NewNode(pPrefix, Common);
+				m_vNodes[Split].m_aChildren[GetBit(m_vNodes[Child].m_aPrefix, Common)] = Child;
+				m_vNodes[Node].m_aChildren[Bit] = Split;
+				Child = Split;
 			}
 		}
+		Node = Child;
 	}
-	else
+	m_vNodes[Node].m_vpBans.push_back(pBan);
+}
+
+void CNetBan::CRangeTrie::Erase(int Root, const unsigned char *pPrefix, int PrefixLength, CBan<CNetRange> *pBan)
+{
+	int aPath[129];
+	int PathLength = 0;
+	int Node = Root;
+	aPath[PathLength++] = Node;
+	while(m_vNodes[Node].m_PrefixLength < PrefixLength)
 	{
+		Node = m_vNodes[Node].m_aChildren[GetBit(pPrefix, m_vNodes[Node].m_PrefixLength)];
+		if(Node < 0)
+			return;
+		aPath[PathLength++] = Node;
+	}
+	if(m_vNodes[Node].m_PrefixLength != PrefixLength)
+		return;
+
+	std::vector<CBan<CNetRange> *> &vpBans = m_vNodes[Node].m_vpBans;
+	vpBans.erase(std::remove(vpBans.begin(), vpBans.end(), pBan), vpBans.end());
+
+	// drop nodes that neither hold bans nor branch
+	for(int i = PathLength - 1; i > 0; i--)
+	{
+		CNode &Current = m_vNodes[aPath[i]];
+		if(!Current.m_vpBans.empty() || (Current.m_aChildren[0] >= 0 && Current.m_aChildren[1] >= 0))
+			break;
+		CNode &Parent = m_vNodes[aPath[i - 1]];
+		const int Replacement = Current.m_aChildren[0] >= 0 ? Current.m_aChildren[0] : Current.m_aChildren[1];
+		Parent.m_aChildren[Parent.m_aChildren[0] == aPath[i] ? 0 : 1] = Replacement;
+		m_vFreeNodes.push_back(aPath[i]);
+		if(Replacement >= 0)
+			break;
+	}
+}
+
+void CNetBan::CRangeTrie::Add(CBan<CNetRange> *pBan)
+{
+	const int Root = pBan->m_Data.m_LB.type == NETTYPE_IPV4 ? ROOT_IPV4 : ROOT_IPV6;
+	ForEachPrefix(&pBan->m_Data, [&](const unsigned char *pPrefix, int PrefixLength) { Insert(Root, pPrefix, PrefixLength, pBan); });
+}
+
+void CNetBan::CRangeTrie::Remove(CBan<CNetRange> *pBan)
+{
+	const int Root = pBan->m_Data.m_LB.type == NETTYPE_IPV4 ? ROOT_IPV4 : ROOT_IPV6;
+	ForEachPrefix(&pBan->m_Data, [&](const unsigned char *pPrefix, int PrefixLength) { Erase(Root, pPrefix, PrefixLength, pBan); });
+}
+
+CNetBan::CBan<CNetRange> *CNetBan::CRangeTrie::Find(const NETADDR *pAddr) const
+{
+	const int Bits = pAddr->type == NETTYPE_IPV4 ? 32 : 128;
+	int Node = pAddr->type == NETTYPE_IPV4 ? ROOT_IPV4 : ROOT_IPV6;
+	int MatchedBits = 0;
+	// the longest matching prefix is the most specific ban
+	CBan<CNetRange> *pBest = nullptr;
+	while(Node >= 0)
+	{
+		// the edge to the node can skip bits, compare them
+		const CNode &Current = m_vNodes[Node];
+		if(Current.m_PrefixLength > MatchedBits)
+		{
+			if(CommonBits(Current.m_aPrefix, pAddr->ip, MatchedBits, Current.m_PrefixLength) < Current.m_PrefixLength)
+				break;
+			MatchedBits = Current.m_PrefixLength;
+		}
+		if(!Current.m_vpBans.empty())
+			pBest = Current.m_vpBans.front();
+		if(MatchedBits >= Bits)
+			break;
+		Node = Current.m_aChildren[GetBit(pAddr->ip, MatchedBits)];
+	}
+	return pBest;
+}
+
+template<class T, int HashCount, class TIndex>
+void CNetBan::CBanPool<T, HashCount, TIndex>::LinkUsed(CBan<T> *pBan, CBan<T> *pPrev)
+{
+	pBan->m_pPrev = pPrev;
+	pBan->m_pNext = pPrev ? pPrev->m_pNext : m_pFirstUsed;
+	if(pBan->m_pNext)
+		pBan->m_pNext->m_pPrev = pBan;
+	else
+		m_pLastUsed = pBan;
+	if(pPrev)
+		pPrev->m_pNext = pBan;
+	else
 		m_pFirstUsed = pBan;
-		pBan->m_pNext = pBan->m_pPrev = 0;
+}
+
+template<class T, int HashCount, class TIndex>
+void CNetBan::CBanPool<T, HashCount, TIndex>::UnlinkUsed(CBan<T> *pBan)
+{
+	if(pBan == m_pLastExpiring)
+		m_pLastExpiring = pBan->m_pPrev;
+	if(pBan->m_pNext)
+		pBan->m_pNext->m_pPrev = pBan->m_pPrev;
+	else
+		m_pLastUsed = pBan->m_pPrev;
+	if(pBan->m_pPrev)
+		pBan->m_pPrev->m_pNext = pBan->m_pNext;
+	else
+		m_pFirstUsed = pBan->m_pNext;
+}
+
+template<class T, int HashCount, class TIndex>
+void CNetBan::CBanPool<T, HashCount, TIndex>::InsertUsed(CBan<T> *pBan)
+{
+	// bans that never expire go after the expiring ones in the order they were added
+	if(pBan->m_Info.m_Expires == CBanInfo::EXPIRES_NEVER)
+	{
+		LinkUsed(pBan, m_pLastUsed);
+		return;
 	}
+
+	// the expiring ones are sorted. Bans are mostly added in this order, check
+	// the end of the expiring ones first.
+	if(!m_pLastExpiring || m_pLastExpiring->m_Info.m_Expires < pBan->m_Info.m_Expires)
+	{
+		LinkUsed(pBan, m_pLastExpiring);
+		m_pLastExpiring = pBan;
+		return;
+	}
+
+	// insert before the first ban that expires later, there is one
+	CBan<T> *p = m_pFirstUsed;
+	while(p->m_Info.m_Expires < pBan->m_Info.m_Expires)
+		p = p->m_pNext;
+	LinkUsed(pBan, p->m_pPrev);
 }
 
-template<class T, int HashCount>
-typename CNetBan::CBan<T> *CNetBan::CBanPool<T, HashCount>::Add(const T *pData, const CBanInfo *pInfo, const CNetHash *pNetHash)
+template<class T, int HashCount, class TIndex>
+typename CNetBan::CBan<T> *CNetBan::CBanPool<T, HashCount, TIndex>::Add(const T *pData, const CBanInfo *pInfo, const CNetHash *pNetHash)
 {
 	if(!m_pFirstFree)
-		return 0;
+	{
+		if(IsFull())
+			return 0;
+
+		// grow the pool by another block
+		m_vpBanBlocks.push_back(std::make_unique<CBan<T>[]>(BANS_PER_BLOCK));
+		CBan<T> *pBlock = m_vpBanBlocks.back().get();
+		for(int i = 0; i < BANS_PER_BLOCK; ++i)
+		{
+			pBlock[i].m_pPrev = i > 0 ? &pBlock[i - 1] : 0;
+			pBlock[i].m_pNext = i < BANS_PER_BLOCK - 1 ? &pBlock[i + 1] : 0;
+		}
+		m_pFirstFree = pBlock;
+	}
 
 	// create new ban
 	CBan<T> *pBan = m_pFirstFree;
@@ -107,6 +329,7 @@ typename CNetBan::CBan<T> *CNetBan::CBanPool<T, HashCount>::Add(const T *pData,
 
 	// insert it into the used list
 	InsertUsed(pBan);
+	m_Index.Add(pBan);
 
 	// update ban count
 	++m_CountUsed;
@@ -114,12 +337,14 @@ typename CNetBan::CBan<T> *CNetBan::CBanPool<T, HashCount>::Add(const T *pData,
 	return pBan;
 }
 
-template<class T, int HashCount>
-int CNetBan::CBanPool<T, HashCount>::Remove(CBan<T> *pBan)
+template<class T, int HashCount, class TIndex>
+int CNetBan::CBanPool<T, HashCount, TIndex>::Remove(CBan<T> *pBan)
 {
 	if(pBan == 0)
 		return -1;
 
+	m_Index.Remove(pBan);
+
 	// remove from hash list
 	if(pBan->m_pHashNext)
 		pBan->m_pHashNext->m_pHashPrev = pBan->m_pHashPrev;
@@ -130,12 +355,7 @@ int CNetBan::CBanPool<T, HashCount>::Remove(CBan<T> *pBan)
 	pBan->m_pHashNext = pBan->m_pHashPrev = 0;
 
 	// remove from used list
-	if(pBan->m_pNext)
-		pBan->m_pNext->m_pPrev = pBan->m_pPrev;
-	if(pBan->m_pPrev)
-		pBan->m_pPrev->m_pNext = pBan->m_pNext;
-	else
-		m_pFirstUsed = pBan->m_pNext;
+	UnlinkUsed(pBan);
 
 	// add to recycle list
 	if(m_pFirstFree)
@@ -150,18 +370,13 @@ int CNetBan::CBanPool<T, HashCount>::Remove(CBan<T> *pBan)
 	return 0;
 }
 
-template<class T, int HashCount>
-void CNetBan::CBanPool<T, HashCount>::Update(CBan<CDataType> *pBan, const CBanInfo *pInfo)
+template<class T, int HashCount, class TIndex>
+void CNetBan::CBanPool<T, HashCount, TIndex>::Update(CBan<CDataType> *pBan, const CBanInfo *pInfo)
 {
 	pBan->m_Info = *pInfo;
 
 	// remove from used list
-	if(pBan->m_pNext)
-		pBan->m_pNext->m_pPrev = pBan->m_pPrev;
-	if(pBan->m_pPrev)
-		pBan->m_pPrev->m_pNext = pBan->m_pNext;
-	else
-		m_pFirstUsed = pBan->m_pNext;
+	UnlinkUsed(pBan);
 
 	// insert it into the used list
 	InsertUsed(pBan);
@@ -173,27 +388,21 @@ void CNetBan::UnbanAll()
 	m_BanRangePool.Reset();
 }
 
-template<class T, int HashCount>
-void CNetBan::CBanPool<T, HashCount>::Reset()
+template<class T, int HashCount, class TIndex>
+void CNetBan::CBanPool<T, HashCount, TIndex>::Reset()
 {
 	mem_zero(m_aapHashList, sizeof(m_aapHashList));
-	mem_zero(m_aBans, sizeof(m_aBans));
+	m_vpBanBlocks.clear();
+	m_pFirstFree = 0;
 	m_pFirstUsed = 0;
+	m_pLastUsed = 0;
+	m_pLastExpiring = 0;
 	m_CountUsed = 0;
-
-	for(int i = 1; i < MAX_BANS - 1; ++i)
-	{
-		m_aBans[i].m_pNext = &m_aBans[i + 1];
-		m_aBans[i].m_pPrev = &m_aBans[i - 1];
-	}
-
-	m_aBans[0].m_pNext = &m_aBans[1];
-	m_aBans[MAX_BANS - 1].m_pPrev = &m_aBans[MAX_BANS - 2];
-	m_pFirstFree = &m_aBans[0];
+	m_Index.Reset();
 }
 
-template<class T, int HashCount>
-typename CNetBan::CBan<T> *CNetBan::CBanPool<T, HashCount>::Get(int Index) const
+template<class T, int HashCount, class TIndex>
+typename CNetBan::CBan<T> *CNetBan::CBanPool<T, HashCount, TIndex>::Get(int Index) const
 {
 	if(Index < 0 || Index >= Num())
 		return 0;
@@ -208,12 +417,13 @@ typename CNetBan::CBan<T> *CNetBan::CBanPool<T, HashCount>::Get(int Index) const
 }
 
 template<class T>
-int CNetBan::Ban(T *pBanPool, const typename T::CDataType *pData, int Seconds, const char *pReason)
+int CNetBan::Ban(T *pBanPool, const typename T::CDataType *pData, int Seconds, const char *pReason, bool Verbose)
 {
 	// do not ban localhost
 	if(NetMatch(pData, &m_LocalhostIPV4) || NetMatch(pData, &m_LocalhostIPV6))
 	{
-		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", "ban failed (localhost)");
+		if(Verbose)
+			Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", "ban failed (localhost)");
 		return -1;
 	}
 
@@ -231,9 +441,12 @@ int CNetBan::Ban(T *pBanPool, const typename T::CDataType *pData, int Seconds, c
 	{
 		// adjust the ban
 		pBanPool->Update(pBan, &Info);
-		char aBuf[128];
-		MakeBanInfo(pBan, aBuf, sizeof(aBuf), MSGTYPE_LIST);
-		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
+		if(Verbose)
+		{
+			char aBuf[128];
+			MakeBanInfo(pBan, aBuf, sizeof(aBuf), MSGTYPE_LIST);
+			Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
+		}
 		return 1;
 	}
 
@@ -241,12 +454,15 @@ int CNetBan::Ban(T *pBanPool, const typename T::CDataType *pData, int Seconds, c
 	pBan = pBanPool->Add(pData, &Info, &NetHash);
 	if(pBan)
 	{
-		char aBuf[128];
-		MakeBanInfo(pBan, aBuf, sizeof(aBuf), MSGTYPE_BANADD);
-		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
+		if(Verbose)
+		{
+			char aBuf[128];
+			MakeBanInfo(pBan, aBuf, sizeof(aBuf), MSGTYPE_BANADD);
+			Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
+		}
 		return 0;
 	}
-	else
+	else if(Verbose)
 		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", "ban failed (full banlist)");
 	return -1;
 }
@@ -286,6 +502,7 @@ void CNetBan::Init(IConsole *pConsole, IStorage *pStorage)
 	Console()->Register("unban_all", "", CFGFLAG_SERVER | CFGFLAG_MASTER | CFGFLAG_STORE, ConUnbanAll, this, "Unban all entries");
 	Console()->Register("bans", "?i[page]", CFGFLAG_SERVER | CFGFLAG_MASTER, ConBans, this, "Show banlist (page 0 by default, 20 entries per page)");
 	Console()->Register("bans_save", "s[file]", CFGFLAG_SERVER | CFGFLAG_MASTER | CFGFLAG_STORE, ConBansSave, this, "Save banlist in a file");
+	Console()->Register("bans_load", "s[file] ?i[minutes] ?r[reason]", CFGFLAG_SERVER | CFGFLAG_MASTER | CFGFLAG_STORE, ConBansLoad, this, "Load bans from a bans_save file or a list of addresses and CIDR ranges (minutes and reason for the plain entries)");
 }
 
 void CNetBan::Update()
@@ -308,17 +525,18 @@ void CNetBan::Update()
 	}
 }
 
-int CNetBan::BanAddr(const NETADDR *pAddr, int Seconds, const char *pReason)
+int CNetBan::BanAddr(const NETADDR *pAddr, int Seconds, const char *pReason, bool Verbose)
 {
-	return Ban(&m_BanAddrPool, pAddr, Seconds, pReason);
+	return Ban(&m_BanAddrPool, pAddr, Seconds, pReason, Verbose);
 }
 
-int CNetBan::BanRange(const CNetRange *pRange, int Seconds, const char *pReason)
+int CNetBan::BanRange(const CNetRange *pRange, int Seconds, const char *pReason, bool Verbose)
 {
 	if(pRange->IsValid())
-		return Ban(&m_BanRangePool, pRange, Seconds, pReason);
+		return Ban(&m_BanRangePool, pRange, Seconds, pReason, Verbose);
 
-	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", "ban failed (invalid range)");
+	if(Verbose)
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", "ban failed (invalid range)");
 	return -1;
 }
 
@@ -377,11 +595,10 @@ bool CNetBan::IsBanned(const NETADDR *pOrigAddr, char *pBuf, unsigned BufferSize
 		pAddr = &Addr;
 		Addr.type = NETTYPE_IPV4;
 	}
-	CNetHash aHash[17];
-	int Length = CNetHash::MakeHashArray(pAddr, aHash);
 
 	// check ban addresses
-	CBanAddr *pBan = m_BanAddrPool.Find(pAddr, &aHash[Length]);
+	CNetHash NetHash(pAddr);
+	CBanAddr *pBan = m_BanAddrPool.Find(pAddr, &NetHash);
 	if(pBan)
 	{
 		MakeBanInfo(pBan, pBuf, BufferSize, MSGTYPE_PLAYER);
@@ -389,19 +606,113 @@ bool CNetBan::IsBanned(const NETADDR *pOrigAddr, char *pBuf, unsigned BufferSize
 	}
 
 	// check ban ranges
-	for(int i = Length - 1; i >= 0; --i)
+	CBanRange *pBanRange = m_BanRangePool.Index().Find(pAddr);
+	if(pBanRange)
+	{
+		MakeBanInfo(pBanRange, pBuf, BufferSize, MSGTYPE_PLAYER);
+		return true;
+	}
+
+	return false;
+}
+
+// parses "addr" or "addr/bits", returns the number of addresses parsed (1 or 2)
+static int ParseCidr(const char *pStr, NETADDR *pLB, NETADDR *pUB)
+{
+	char aAddr[NETADDR_MAXSTRSIZE];
+	const char *pSlash = str_find(pStr, "/");
+	str_copy(aAddr, pStr, pSlash ? minimum<int>(sizeof(aAddr), pSlash - pStr + 1) : (int)sizeof(aAddr));
+	if(net_addr_from_str(pLB, aAddr) != 0)
+		return 0;
+	pLB->port = 0;
+	if(!pSlash)
+		return 1;
+
+	const int Bits = pLB->type == NETTYPE_IPV4 ? 32 : 128;
+	if(!str_isallnum(pSlash + 1))
+		return 0;
+	const int PrefixLength = str_toint(pSlash + 1);
+	if(PrefixLength < 0 || PrefixLength > Bits)
+		return 0;
+	if(PrefixLength == Bits)
+		return 1;
+
+	*pUB = *pLB;
+	for(int Bit = 0; Bit < Bits; ++Bit)
 	{
-		for(CBanRange *pBanRange = m_BanRangePool.First(&aHash[i]); pBanRange; pBanRange = pBanRange->m_pHashNext)
+		const unsigned char Mask = 1 << (7 - Bit % 8);
+		if(Bit < PrefixLength)
+			continue;
+		pLB->ip[Bit / 8] &= ~Mask;
+		pUB->ip[Bit / 8] |= Mask;
+	}
+	return 2;
+}
+
+int CNetBan::LoadBans(const char *pFilename, int Seconds, const char *pReason)
+{
+	IOHANDLE File = Storage()->OpenFile(pFilename, IOFLAG_READ, IStorage::TYPE_ALL);
+	if(!File)
+		return -1;
+
+	CLineReader LineReader;
+	LineReader.Init(File);
+	int Count = 0;
+	while(char *pLine = LineReader.Get())
+	{
+		const char *pStr = str_skip_whitespaces_const(pLine);
+		if(pStr[0] == '\0' || pStr[0] == '#')
+			continue;
+
+		char aToken1[NETADDR_MAXSTRSIZE], aToken2[NETADDR_MAXSTRSIZE], aToken3[16];
+		CNetRange Range;
+		if(str_startswith(pStr, "ban ") || str_startswith(pStr, "ban_range "))
 		{
-			if(NetMatch(&pBanRange->m_Data, pAddr, i, Length))
+			// written by bans_save: "ban <addr> <minutes> <reason>" or "ban_range <first> <last> <minutes> <reason>"
+			const bool IsRange = str_startswith(pStr, "ban_range ") != nullptr;
+			pStr = str_next_token(pStr, " ", aToken3, sizeof(aToken3));
+			pStr = str_next_token(pStr, " ", aToken1, sizeof(aToken1));
+			if(IsRange && pStr)
+				pStr = str_next_token(pStr, " ", aToken2, sizeof(aToken2));
+			if(!pStr)
+				continue;
+			pStr = str_next_token(pStr, " ", aToken3, sizeof(aToken3));
+			if(!pStr)
+				continue;
+			const int Minutes = str_toint(aToken3);
+			const int BanSeconds = Minutes < 0 ? 0 : maximum(Minutes, 1) * 60;
+			const char *pBanReason = str_skip_whitespaces_const(pStr);
+			if(net_addr_from_str(&Range.m_LB, aToken1) != 0)
+				continue;
+			if(!IsRange)
 			{
-				MakeBanInfo(pBanRange, pBuf, BufferSize, MSGTYPE_PLAYER);
-				return true;
+				if(BanAddr(&Range.m_LB, BanSeconds, pBanReason, false) >= 0)
+					Count++;
 			}
+			else if(net_addr_from_str(&Range.m_UB, aToken2) == 0 && Range.IsValid())
+			{
+				if(BanRange(&Range, BanSeconds, pBanReason, false) >= 0)
+					Count++;
+			}
+			continue;
 		}
-	}
 
-	return false;
+		// plain list, one address or CIDR range per line
+		str_next_token(pStr, " \t", aToken1, sizeof(aToken1));
+		const int Parsed = ParseCidr(aToken1, &Range.m_LB, &Range.m_UB);
+		if(Parsed == 1)
+		{
+			if(BanAddr(&Range.m_LB, Seconds, pReason, false) >= 0)
+				Count++;
+		}
+		else if(Parsed == 2)
+		{
+			if(BanRange(&Range, Seconds, pReason, false) >= 0)
+				Count++;
+		}
+	}
+	io_close(File);
+	return Count;
 }
 
 void CNetBan::ConBan(IConsole::IResult *pResult, void *pUser)
@@ -546,3 +857,21 @@ void CNetBan::ConBansSave(IConsole::IResult *pResult, void *pUser)
 	str_format(aBuf, sizeof(aBuf), "saved banlist to '%s'", pResult->GetString(0));
 	pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
 }
+
+void CNetBan::ConBansLoad(IConsole::IResult *pResult, void *pUser)
+{
+	CNetBan *pThis = static_cast<CNetBan *>(pUser);
+
+	const char *pFilename = pResult->GetString(0);
+	int Minutes = pResult->NumArguments() > 1 ? clamp(pResult->GetInteger(1), 0, 525600) : 0;
+	const char *pReason = pResult->NumArguments() > 2 ? pResult->GetString(2) : "No reason given";
+
+	char aBuf[256];
+	const int64_t Start = time_get_nanoseconds().count();
+	const int Count = pThis->LoadBans(pFilename, Minutes * 60, pReason);
+	if(Count < 0)
+		str_format(aBuf, sizeof(aBuf), "failed to load banlist from '%s'", pFilename);
+	else
+		str_format(aBuf, sizeof(aBuf), "loaded %d bans from '%s' in %.2fms (%d addresses, %d ranges)", Count, pFilename, (time_get_nanoseconds().count() - Start) / 1e6, pThis->m_BanAddrPool.Num(), pThis->m_BanRangePool.Num());
+	pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
+}
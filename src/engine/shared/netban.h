@@ -5,6 +5,9 @@
 
 #include <base/system.h>
 
+#include <memory>
+#include <vector>
+
 inline int NetComp(const NETADDR *pAddr1, const NETADDR *pAddr2)
 {
 	return mem_comp(pAddr1, pAddr2, pAddr1->type == NETTYPE_IPV4 ? 8 : 20);
@@ -64,13 +67,11 @@ protected:
 	{
 	public:
 		int m_Hash;
-		int m_HashIndex; // matching parts for ranges, 0 for addr
+		int m_HashIndex; // hash list for ranges, 0 for addr
 
 		CNetHash() {}
 		CNetHash(const NETADDR *pAddr);
 		CNetHash(const CNetRange *pRange);
-
-		static int MakeHashArray(const NETADDR *pAddr, CNetHash aHash[17]);
 	};
 
 	struct CBanInfo
@@ -100,7 +101,59 @@ protected:
 		CBan *m_pPrev;
 	};
 
-	template<class T, int HashCount>
+	// exact addresses are found through the hash lists alone
+	class CNoIndex
+	{
+	public:
+		template<class T>
+		void Add(CBan<T> *pBan)
+		{
+		}
+		template<class T>
+		void Remove(CBan<T> *pBan)
+		{
+		}
+		void Reset() {}
+	};
+
+	// Compressed binary trie over the address bits. Every range is split into
+	// CIDR prefixes, a lookup visits at most one node per address bit no matter
+	// how many ranges are banned.
+	class CRangeTrie
+	{
+	public:
+		CRangeTrie() { Reset(); }
+
+		void Add(CBan<CNetRange> *pBan);
+		void Remove(CBan<CNetRange> *pBan);
+		void Reset();
+		CBan<CNetRange> *Find(const NETADDR *pAddr) const;
+		int NumNodes() const { return m_vNodes.size() - m_vFreeNodes.size(); }
+
+	private:
+		enum
+		{
+			ROOT_IPV4 = 0,
+			ROOT_IPV6,
+		};
+
+		struct CNode
+		{
+			unsigned char m_aPrefix[16];
+			int m_PrefixLength; // in bits
+			int m_aChildren[2];
+			std::vector<CBan<CNetRange> *> m_vpBans;
+		};
+
+		std::vector<CNode> m_vNodes;
+		std::vector<int> m_vFreeNodes;
+
+		int NewNode(const unsigned char *pPrefix, int PrefixLength);
+		void Insert(int Root, const unsigned char *pPrefix, int PrefixLength, CBan<CNetRange> *pBan);
+		void Erase(int Root, const unsigned char *pPrefix, int PrefixLength, CBan<CNetRange> *pBan);
+	};
+
+	template<class T, int HashCount, class TIndex>
 	class CBanPool
 	{
 	public:
@@ -127,31 +180,39 @@ protected:
 			return 0;
 		}
 		CBan<CDataType> *Get(int Index) const;
+		const TIndex &Index() const { return m_Index; }
 
 	private:
 		enum
 		{
-			MAX_BANS = 1024,
+			MAX_BANS = 1 << 20,
+			BANS_PER_BLOCK = 1024,
 		};
 
 		CBan<CDataType> *m_aapHashList[HashCount][256];
-		CBan<CDataType> m_aBans[MAX_BANS];
+		// allocated in blocks as needed, the bans must not move
+		std::vector<std::unique_ptr<CBan<CDataType>[]>> m_vpBanBlocks;
 		CBan<CDataType> *m_pFirstFree;
 		CBan<CDataType> *m_pFirstUsed;
+		CBan<CDataType> *m_pLastUsed;
+		CBan<CDataType> *m_pLastExpiring; // last ban of the used list that expires
 		int m_CountUsed;
+		TIndex m_Index;
 
+		void LinkUsed(CBan<CDataType> *pBan, CBan<CDataType> *pPrev);
+		void UnlinkUsed(CBan<CDataType> *pBan);
 		void InsertUsed(CBan<CDataType> *pBan);
 	};
 
-	typedef CBanPool<NETADDR, 1> CBanAddrPool;
-	typedef CBanPool<CNetRange, 16> CBanRangePool;
+	typedef CBanPool<NETADDR, 1, CNoIndex> CBanAddrPool;
+	typedef CBanPool<CNetRange, 16, CRangeTrie> CBanRangePool;
 	typedef CBan<NETADDR> CBanAddr;
 	typedef CBan<CNetRange> CBanRange;
 
 	template<class T>
 	void MakeBanInfo(const CBan<T> *pBan, char *pBuf, unsigned BuffSize, int Type) const;
 	template<class T>
-	int Ban(T *pBanPool, const typename T::CDataType *pData, int Seconds, const char *pReason);
+	int Ban(T *pBanPool, const typename T::CDataType *pData, int Seconds, const char *pReason, bool Verbose = true);
 	template<class T>
 	int Unban(T *pBanPool, const typename T::CDataType *pData);
 
@@ -177,13 +238,14 @@ public:
 	void Init(class IConsole *pConsole, class IStorage *pStorage);
 	void Update();
 
-	virtual int BanAddr(const NETADDR *pAddr, int Seconds, const char *pReason);
-	virtual int BanRange(const CNetRange *pRange, int Seconds, const char *pReason);
+	virtual int BanAddr(const NETADDR *pAddr, int Seconds, const char *pReason, bool Verbose = true);
+	virtual int BanRange(const CNetRange *pRange, int Seconds, const char *pReason, bool Verbose = true);
 	int UnbanByAddr(const NETADDR *pAddr);
 	int UnbanByRange(const CNetRange *pRange);
 	int UnbanByIndex(int Index);
 	void UnbanAll();
 	bool IsBanned(const NETADDR *pOrigAddr, char *pBuf, unsigned BufferSize) const;
+	int LoadBans(const char *pFilename, int Seconds, const char *pReason);
 
 	static void ConBan(class IConsole::IResult *pResult, void *pUser);
 	static void ConBanRange(class IConsole::IResult *pResult, void *pUser);
@@ -192,6 +254,7 @@ public:
 	static void ConUnbanAll(class IConsole::IResult *pResult, void *pUser);
 	static void ConBans(class IConsole::IResult *pResult, void *pUser);
 	static void ConBansSave(class IConsole::IResult *pResult, void *pUser);
+	static void ConBansLoad(class IConsole::IResult *pResult, void *pUser);
 };
 
 template<class T>
@@ -61,6 +61,7 @@ enum
 	NET_PACKETHEADERSIZE = 3,
 	NET_MAX_CLIENTS = 64,
 	NET_MAX_CONSOLE_CLIENTS = 4,
+	NET_CONSOLE_SEND_BUFFER_SIZE = 128 * 1024,
 	NET_MAX_SEQUENCE = 1 << 10,
 	NET_SEQUENCE_MASK = NET_MAX_SEQUENCE - 1,
 
@@ -307,11 +308,19 @@ private:
 	char m_aBuffer[NET_MAX_PACKETSIZE];
 	int m_BufferOffset;
 
+	// lines the socket didn't take yet, from m_SendBufferStart to
+	// m_SendBufferSize
+	char m_aSendBuffer[NET_CONSOLE_SEND_BUFFER_SIZE];
+	int m_SendBufferStart;
+	int m_SendBufferSize;
+
 	char m_aErrorString[256];
 
 	bool m_LineEndingDetected;
 	char m_aLineEnding[3];
 
+	int FlushSendBuffer();
+
 public:
 	void Init(NETSOCKET Socket, const NETADDR *pAddr);
 	void Disconnect(const char *pReason);
@@ -322,8 +331,10 @@ public:
 
 	void Reset();
 	int Update();
+	// Never blocks, the line is buffered if the socket is busy.
 	int Send(const char *pLine);
 	int Recv(char *pLine, int MaxLength);
+	int SendBufferSize() const { return m_SendBufferSize - m_SendBufferStart; }
 };
 
 class CNetRecvUnpacker
@@ -12,6 +12,8 @@ void CConsoleNetConnection::Reset()
 	m_Socket = nullptr;
 	m_aBuffer[0] = 0;
 	m_BufferOffset = 0;
+	m_SendBufferStart = 0;
+	m_SendBufferSize = 0;
 
 	m_LineEndingDetected = false;
 #if defined(CONF_FAMILY_WINDOWS)
@@ -53,6 +55,9 @@ int CConsoleNetConnection::Update()
 {
 	if(State() == NET_CONNSTATE_ONLINE)
 	{
+		if(FlushSendBuffer() != 0)
+			return -1;
+
 		if((int)(sizeof(m_aBuffer)) <= m_BufferOffset)
 		{
 			m_State = NET_CONNSTATE_ERROR;
@@ -161,24 +166,48 @@ int CConsoleNetConnection::Send(const char *pLine)
 	aBuf[Length + 1] = m_aLineEnding[1];
 	aBuf[Length + 2] = m_aLineEnding[2];
 	Length += 3;
-	const char *pData = aBuf;
 
-	while(true)
+	// the sent part is only reclaimed when the line doesn't fit behind
+	if(m_SendBufferSize + Length > (int)sizeof(m_aSendBuffer) && m_SendBufferStart > 0)
+	{
+		mem_move(m_aSendBuffer, m_aSendBuffer + m_SendBufferStart, m_SendBufferSize - m_SendBufferStart);
+		m_SendBufferSize -= m_SendBufferStart;
+		m_SendBufferStart = 0;
+	}
+	if(m_SendBufferSize + Length > (int)sizeof(m_aSendBuffer))
 	{
-		int Send = net_tcp_send(m_Socket, pData, Length);
-		if(Send < 0)
+		m_State = NET_CONNSTATE_ERROR;
+		str_copy(m_aErrorString, "too weak connection (out of send buffer)");
+		return -1;
+	}
+	mem_copy(m_aSendBuffer + m_SendBufferSize, aBuf, Length);
+	m_SendBufferSize += Length;
+	return FlushSendBuffer();
+}
+
+int CConsoleNetConnection::FlushSendBuffer()
+{
+	while(m_SendBufferStart < m_SendBufferSize)
+	{
+		int Bytes = net_tcp_send(m_Socket, m_aSendBuffer + m_SendBufferStart, m_SendBufferSize - m_SendBufferStart);
+		if(Bytes < 0)
 		{
+			if(net_would_block())
+				break;
+
 			m_State = NET_CONNSTATE_ERROR;
 			str_copy(m_aErrorString, "failed to send packet");
 			return -1;
 		}
-
-		if(Send >= Length)
+		if(Bytes == 0)
 			break;
-
-		pData += Send;
-		Length -= Send;
+		m_SendBufferStart += Bytes;
 	}
 
+	if(m_SendBufferStart == m_SendBufferSize)
+	{
+		m_SendBufferStart = 0;
+		m_SendBufferSize = 0;
+	}
 	return 0;
 }
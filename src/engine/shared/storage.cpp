@@ -93,6 +93,7 @@ public:
 			CreateFolder("demos/auto", TYPE_SAVE);
 			CreateFolder("demos/auto/race", TYPE_SAVE);
 			CreateFolder("demos/replays", TYPE_SAVE);
+			CreateFolder("demoindex", TYPE_SAVE);
 			CreateFolder("editor", TYPE_SAVE);
 			CreateFolder("ghosts", TYPE_SAVE);
 			CreateFolder("teehistorian", TYPE_SAVE);
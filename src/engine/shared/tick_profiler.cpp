@@ -0,0 +1,163 @@
+#include "tick_profiler.h"
+
+#include <base/math.h>
+
+#include <engine/shared/csv.h>
+#include <engine/storage.h>
+
+static const char *const gs_apPhaseNames[NUM_PROFILE_PHASES] = {
+	"network",
+	"dnsbl",
+	"tick",
+	"game",
+	"game_world",
+	"game_controller",
+	"game_players",
+	"game_votes",
+	"database",
+	"snapshot",
+};
+
+CTickProfiler::CTickProfiler() :
+	m_Enabled(false), m_Freq(time_freq()), m_CsvFile(0), m_CsvRows(0)
+{
+	m_aCsvFilename[0] = '\0';
+	Reset();
+	ResetInterval();
+}
+
+CTickProfiler::~CTickProfiler()
+{
+	CloseCsv();
+}
+
+void CTickProfiler::Add(int Phase, int64_t Time)
+{
+	const int64_t Us = Time * 1000000 / m_Freq;
+	int Bucket = 0;
+	while(Bucket < NUM_BUCKETS - 1 && Us >= (int64_t)1 << Bucket)
+		Bucket++;
+
+	CPhase &Stats = m_aPhases[Phase];
+	Stats.m_Count++;
+	Stats.m_TimeSum += Us;
+	Stats.m_TimeMax = maximum(Stats.m_TimeMax, Us);
+	Stats.m_aBuckets[Bucket]++;
+
+	CInterval &Interval = m_aInterval[Phase];
+	Interval.m_Count++;
+	Interval.m_TimeSum += Us;
+	Interval.m_TimeMax = maximum(Interval.m_TimeMax, Us);
+}
+
+void CTickProfiler::Reset()
+{
+	mem_zero(m_aPhases, sizeof(m_aPhases));
+}
+
+void CTickProfiler::ResetInterval()
+{
+	mem_zero(m_aInterval, sizeof(m_aInterval));
+}
+
+const char *CTickProfiler::PhaseName(int Phase)
+{
+	return gs_apPhaseNames[Phase];
+}
+
+int64_t CTickProfiler::Percentile(int Phase, int Percentile) const
+{
+	const CPhase &Stats = m_aPhases[Phase];
+	if(Stats.m_Count == 0)
+		return 0;
+
+	const int64_t Wanted = maximum((Stats.m_Count * Percentile + 99) / 100, (int64_t)1);
+	int64_t Count = 0;
+	for(int Bucket = 0; Bucket < NUM_BUCKETS; Bucket++)
+	{
+		Count += Stats.m_aBuckets[Bucket];
+		if(Count >= Wanted)
+			return minimum((int64_t)1 << Bucket, Stats.m_TimeMax);
+	}
+	return Stats.m_TimeMax;
+}
+
+void CTickProfiler::WriteCsvRow(IStorage *pStorage, const char *pFilename, int MaxRows, int Tick)
+{
+	if(!pFilename[0])
+	{
+		CloseCsv();
+		ResetInterval();
+		return;
+	}
+
+	if(m_CsvFile && (str_comp(m_aCsvFilename, pFilename) != 0 || m_CsvRows >= MaxRows))
+	{
+		const bool Roll = str_comp(m_aCsvFilename, pFilename) == 0;
+		CloseCsv();
+		if(Roll)
+		{
+			char aOldFilename[IO_MAX_PATH_LENGTH];
+			str_format(aOldFilename, sizeof(aOldFilename), "%s.old", pFilename);
+			pStorage->RemoveFile(aOldFilename, IStorage::TYPE_SAVE);
+			pStorage->RenameFile(pFilename, aOldFilename, IStorage::TYPE_SAVE);
+		}
+	}
+
+	// after a failed open, only try again once the filename changes
+	if(!m_CsvFile && str_comp(m_aCsvFilename, pFilename) != 0)
+	{
+		m_CsvFile = pStorage->OpenFile(pFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+		if(!m_CsvFile)
+			dbg_msg("profile", "failed to open '%s' for writing", pFilename);
+		str_copy(m_aCsvFilename, pFilename);
+		m_CsvRows = 0;
+
+		if(m_CsvFile)
+		{
+			char aaHeader[2 + 3 * NUM_PROFILE_PHASES][32];
+			const char *apHeader[2 + 3 * NUM_PROFILE_PHASES];
+			str_copy(aaHeader[0], "time");
+			str_copy(aaHeader[1], "tick");
+			for(int Phase = 0; Phase < NUM_PROFILE_PHASES; Phase++)
+			{
+				str_format(aaHeader[2 + 3 * Phase], sizeof(aaHeader[0]), "%s_count", gs_apPhaseNames[Phase]);
+				str_format(aaHeader[3 + 3 * Phase], sizeof(aaHeader[0]), "%s_avg_us", gs_apPhaseNames[Phase]);
+				str_format(aaHeader[4 + 3 * Phase], sizeof(aaHeader[0]), "%s_max_us", gs_apPhaseNames[Phase]);
+			}
+			for(int i = 0; i < 2 + 3 * NUM_PROFILE_PHASES; i++)
+				apHeader[i] = aaHeader[i];
+			CsvWrite(m_CsvFile, 2 + 3 * NUM_PROFILE_PHASES, apHeader);
+		}
+	}
+
+	if(m_CsvFile)
+	{
+		char aaRow[2 + 3 * NUM_PROFILE_PHASES][24];
+		const char *apRow[2 + 3 * NUM_PROFILE_PHASES];
+		str_format(aaRow[0], sizeof(aaRow[0]), "%d", time_timestamp());
+		str_format(aaRow[1], sizeof(aaRow[1]), "%d", Tick);
+		for(int Phase = 0; Phase < NUM_PROFILE_PHASES; Phase++)
+		{
+			const CInterval &Interval = m_aInterval[Phase];
+			str_format(aaRow[2 + 3 * Phase], sizeof(aaRow[0]), "%" PRId64, Interval.m_Count);
+			str_format(aaRow[3 + 3 * Phase], sizeof(aaRow[0]), "%" PRId64, Interval.m_Count ? Interval.m_TimeSum / Interval.m_Count : 0);
+			str_format(aaRow[4 + 3 * Phase], sizeof(aaRow[0]), "%" PRId64, Interval.m_TimeMax);
+		}
+		for(int i = 0; i < 2 + 3 * NUM_PROFILE_PHASES; i++)
+			apRow[i] = aaRow[i];
+		CsvWrite(m_CsvFile, 2 + 3 * NUM_PROFILE_PHASES, apRow);
+		io_flush(m_CsvFile);
+		m_CsvRows++;
+	}
+	ResetInterval();
+}
+
+void CTickProfiler::CloseCsv()
+{
+	if(m_CsvFile)
+		io_close(m_CsvFile);
+	m_CsvFile = 0;
+	m_aCsvFilename[0] = '\0';
+	m_CsvRows = 0;
+}
@@ -0,0 +1,115 @@
+#ifndef ENGINE_SHARED_TICK_PROFILER_H
+#define ENGINE_SHARED_TICK_PROFILER_H
+
+#include <base/system.h>
+
+class IStorage;
+
+// phases of a server tick, they may be nested
+enum
+{
+	PROFILE_NETWORK = 0,
+	PROFILE_DNSBL,
+	PROFILE_TICK,
+	PROFILE_GAME,
+	PROFILE_GAME_WORLD,
+	PROFILE_GAME_CONTROLLER,
+	PROFILE_GAME_PLAYERS,
+	PROFILE_GAME_VOTES,
+	PROFILE_DATABASE,
+	PROFILE_SNAPSHOT,
+	NUM_PROFILE_PHASES
+};
+
+// Collects the time spent in the phases of server ticks. Durations are kept
+// in histograms with power of two buckets, so percentiles are estimates.
+class CTickProfiler
+{
+public:
+	enum
+	{
+		// bucket i holds durations below 2^i microseconds
+		NUM_BUCKETS = 24,
+	};
+
+	struct CPhase
+	{
+		int64_t m_Count;
+		// in microseconds
+		int64_t m_TimeSum;
+		int64_t m_TimeMax;
+		int64_t m_aBuckets[NUM_BUCKETS];
+	};
+
+	struct CInterval
+	{
+		int64_t m_Count;
+		// in microseconds
+		int64_t m_TimeSum;
+		int64_t m_TimeMax;
+	};
+
+	CTickProfiler();
+	~CTickProfiler();
+
+	bool Enabled() const { return m_Enabled; }
+	// Disabling also closes the csv file.
+	void SetEnabled(bool Enabled)
+	{
+		if(m_Enabled && !Enabled)
+			CloseCsv();
+		m_Enabled = Enabled;
+	}
+
+	// Time is in time_get() units.
+	void Add(int Phase, int64_t Time);
+	// Resets the totals, but not the interval.
+	void Reset();
+
+	const CPhase &Phase(int Phase) const { return m_aPhases[Phase]; }
+	// Since the last csv row or ResetInterval.
+	const CInterval &Interval(int Phase) const { return m_aInterval[Phase]; }
+	void ResetInterval();
+	static const char *PhaseName(int Phase);
+	// Returns the upper bound in microseconds of the bucket that contains the
+	// given percentile (0 to 100).
+	int64_t Percentile(int Phase, int Percentile) const;
+
+	// Appends the interval to the csv file, which is moved to "<file>.old"
+	// once it has MaxRows rows, and resets it. Nothing is written for an
+	// empty filename.
+	void WriteCsvRow(IStorage *pStorage, const char *pFilename, int MaxRows, int Tick);
+	void CloseCsv();
+
+private:
+	bool m_Enabled;
+	int64_t m_Freq;
+	CPhase m_aPhases[NUM_PROFILE_PHASES];
+	CInterval m_aInterval[NUM_PROFILE_PHASES];
+
+	IOHANDLE m_CsvFile;
+	char m_aCsvFilename[IO_MAX_PATH_LENGTH];
+	int m_CsvRows;
+};
+
+// Adds the time until the end of the scope to a phase, if the profiler is
+// enabled.
+class CProfileScope
+{
+	CTickProfiler *m_pProfiler;
+	int m_Phase;
+	int64_t m_Start;
+
+public:
+	CProfileScope(CTickProfiler *pProfiler, int Phase) :
+		m_pProfiler(pProfiler->Enabled() ? pProfiler : nullptr), m_Phase(Phase), m_Start(m_pProfiler ? time_get() : 0)
+	{
+	}
+	~CProfileScope()
+	{
+		if(m_pProfiler)
+			m_pProfiler->Add(m_Phase, time_get() - m_Start);
+	}
+};
+
+#endif
@@ -236,6 +236,13 @@ struct STextContainerIndex
 	void Reset() { m_Index = -1; }
 };
 
+struct STextLayoutCacheStats
+{
+	uint64_t m_Hits;
+	uint64_t m_Misses;
+	size_t m_Entries;
+};
+
 struct STextSizeProperties
 {
 	float *m_pHeight = nullptr;
@@ -305,6 +312,8 @@ public:
 	virtual ColorRGBA GetTextOutlineColor() const = 0;
 	virtual ColorRGBA GetTextSelectionColor() const = 0;
 
+	virtual const STextLayoutCacheStats &LayoutCacheStats() const = 0;
+
 	virtual void OnPreWindowResize() = 0;
 	virtual void OnWindowResize() = 0;
 };
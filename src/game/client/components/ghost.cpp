@@ -13,8 +13,37 @@
 
 #include <game/client/gameclient.h>
 
+#include <algorithm>
+
 const char *CGhost::ms_pGhostDir = "ghosts";
 
+CGhostPathJob::CGhostPathJob(std::unique_ptr<IGhostLoader> &&pLoader, const char *pFilename, const char *pMap, SHA256_DIGEST MapSha256, unsigned MapCrc, int Chunk, int FirstItem, int NumItems) :
+	m_pLoader(std::move(pLoader)), m_MapSha256(MapSha256), m_MapCrc(MapCrc), m_FirstItem(FirstItem), m_NumItems(NumItems), m_Chunk(Chunk), m_Error(false)
+{
+	str_copy(m_aFilename, pFilename);
+	str_copy(m_aMap, pMap);
+	m_aError[0] = '\0';
+}
+
+void CGhostPathJob::Run()
+{
+	if(m_pLoader->Load(m_aFilename, m_aMap, m_MapSha256, m_MapCrc) != 0)
+	{
+		m_Error = true;
+		str_copy(m_aError, m_pLoader->Error());
+		return;
+	}
+
+	m_vPath.resize(m_NumItems);
+	m_Error = !m_pLoader->SeekToItem(m_FirstItem);
+	int Type;
+	for(int i = 0; i < m_NumItems && !m_Error; i++)
+		m_Error = !m_pLoader->ReadNextType(&Type) || Type != GHOSTDATA_TYPE_CHARACTER || !m_pLoader->ReadData(Type, &m_vPath[i], sizeof(CGhostCharacter));
+	if(m_Error)
+		str_copy(m_aError, m_pLoader->Error());
+	m_pLoader->Close();
+}
+
 CGhost::CGhost() :
 	m_NewRenderTick(-1), m_StartRenderTick(-1), m_LastDeathTick(-1), m_LastRaceTick(-1), m_Recording(false), m_Rendering(false) {}
 
@@ -66,10 +95,11 @@ void CGhost::GetNetObjCharacter(CNetObj_Character *pChar, const CGhostCharacter
 }
 
 CGhost::CGhostPath::CGhostPath(CGhostPath &&Other) noexcept :
-	m_ChunkSize(Other.m_ChunkSize), m_NumItems(Other.m_NumItems), m_vpChunks(std::move(Other.m_vpChunks))
+	m_ChunkSize(Other.m_ChunkSize), m_NumItems(Other.m_NumItems), m_vpChunks(std::move(Other.m_vpChunks)), m_vCachedChunks(std::move(Other.m_vCachedChunks))
 {
 	Other.m_NumItems = 0;
 	Other.m_vpChunks.clear();
+	Other.m_vCachedChunks.clear();
 }
 
 CGhost::CGhostPath &CGhost::CGhostPath::operator=(CGhostPath &&Other) noexcept
@@ -77,8 +107,10 @@ CGhost::CGhostPath &CGhost::CGhostPath::operator=(CGhostPath &&Other) noexcept
 	Reset(Other.m_ChunkSize);
 	m_NumItems = Other.m_NumItems;
 	m_vpChunks = std::move(Other.m_vpChunks);
+	m_vCachedChunks = std::move(Other.m_vCachedChunks);
 	Other.m_NumItems = 0;
 	Other.m_vpChunks.clear();
+	Other.m_vCachedChunks.clear();
 	return *this;
 }
 
@@ -87,25 +119,58 @@ void CGhost::CGhostPath::Reset(int ChunkSize)
 	for(auto &pChunk : m_vpChunks)
 		free(pChunk);
 	m_vpChunks.clear();
+	m_vCachedChunks.clear();
 	m_ChunkSize = ChunkSize;
 	m_NumItems = 0;
 }
 
-void CGhost::CGhostPath::SetSize(int Items)
+void CGhost::CGhostPath::SetSize(int Items, bool Lazy)
 {
 	int Chunks = m_vpChunks.size();
 	int NeededChunks = (Items + m_ChunkSize - 1) / m_ChunkSize;
 
 	if(NeededChunks > Chunks)
 	{
-		m_vpChunks.resize(NeededChunks);
-		for(int i = Chunks; i < NeededChunks; i++)
-			m_vpChunks[i] = (CGhostCharacter *)calloc(m_ChunkSize, sizeof(CGhostCharacter));
+		m_vpChunks.resize(NeededChunks, nullptr);
+		if(!Lazy)
+		{
+			for(int i = Chunks; i < NeededChunks; i++)
+				AllocChunk(i);
+		}
 	}
 
 	m_NumItems = Items;
 }
 
+CGhostCharacter *CGhost::CGhostPath::AllocChunk(int Chunk)
+{
+	if(!m_vpChunks[Chunk])
+		m_vpChunks[Chunk] = (CGhostCharacter *)calloc(m_ChunkSize, sizeof(CGhostCharacter));
+	return m_vpChunks[Chunk];
+}
+
+void CGhost::CGhostPath::FreeChunk(int Chunk)
+{
+	free(m_vpChunks[Chunk]);
+	m_vpChunks[Chunk] = nullptr;
+}
+
+void CGhost::CGhostPath::UseChunk(int Chunk)
+{
+	if(Chunk == 0)
+		return;
+
+	auto It = std::find(m_vCachedChunks.begin(), m_vCachedChunks.end(), Chunk);
+	if(It != m_vCachedChunks.end())
+		m_vCachedChunks.erase(It);
+	m_vCachedChunks.insert(m_vCachedChunks.begin(), Chunk);
+	if((int)m_vCachedChunks.size() > MAX_CACHED_CHUNKS)
+	{
+		FreeChunk(m_vCachedChunks.back());
+		m_vCachedChunks.pop_back();
+	}
+}
+
 void CGhost::CGhostPath::Add(const CGhostCharacter &Char)
 {
 	SetSize(m_NumItems + 1);
@@ -119,6 +184,8 @@ CGhostCharacter *CGhost::CGhostPath::Get(int Index)
 
 	int Chunk = Index / m_ChunkSize;
 	int Pos = Index % m_ChunkSize;
+	if(!m_vpChunks[Chunk])
+		return 0;
 	return &m_vpChunks[Chunk][Pos];
 }
 
@@ -320,9 +387,14 @@ void CGhost::OnRender()
 			continue;
 
 		int GhostTick = Ghost.m_StartTick + PlaybackTick;
-		while(Ghost.m_PlaybackPos >= 0 && Ghost.m_Path.Get(Ghost.m_PlaybackPos)->m_Tick < GhostTick)
+		while(Ghost.m_PlaybackPos >= 0)
 		{
-			if(Ghost.m_PlaybackPos < Ghost.m_Path.Size() - 1)
+			const CGhostCharacter *pChar = PathCharacter(&Ghost, Ghost.m_PlaybackPos);
+			if(!pChar && Ghost.m_pPathJob)
+				break; // wait for the chunk
+			if(pChar && pChar->m_Tick >= GhostTick)
+				break;
+			if(pChar && Ghost.m_PlaybackPos < Ghost.m_Path.Size() - 1)
 				Ghost.m_PlaybackPos++;
 			else
 				Ghost.m_PlaybackPos = -1;
@@ -333,12 +405,14 @@ void CGhost::OnRender()
 
 		int CurPos = Ghost.m_PlaybackPos;
 		int PrevPos = maximum(0, CurPos - 1);
-		if(Ghost.m_Path.Get(PrevPos)->m_Tick > GhostTick)
+		const CGhostCharacter *pCurChar = PathCharacter(&Ghost, CurPos);
+		const CGhostCharacter *pPrevChar = PathCharacter(&Ghost, PrevPos);
+		if(!pCurChar || !pPrevChar || pPrevChar->m_Tick > GhostTick)
 			continue;
 
 		CNetObj_Character Player, Prev;
-		GetNetObjCharacter(&Player, Ghost.m_Path.Get(CurPos));
-		GetNetObjCharacter(&Prev, Ghost.m_Path.Get(PrevPos));
+		GetNetObjCharacter(&Player, pCurChar);
+		GetNetObjCharacter(&Prev, pPrevChar);
 
 		int TickDiff = Player.m_Tick - Prev.m_Tick;
 		float IntraTick = 0.f;
@@ -406,6 +480,58 @@ void CGhost::InitRenderInfos(CGhostItem *pGhost)
 	pRenderInfo->m_Size = 64;
 }
 
+CGhostCharacter *CGhost::PathCharacter(CGhostItem *pGhost, int Index)
+{
+	if(Index < 0 || Index >= pGhost->m_Path.Size())
+		return 0;
+	const int Chunk = Index / pGhost->m_Path.ChunkSize();
+
+	if(pGhost->m_aFilename[0] != '\0')
+	{
+		if(pGhost->m_pPathJob && pGhost->m_pPathJob->Status() == IJob::STATE_DONE)
+			FinishPathJob(pGhost);
+		if(!pGhost->m_Path.HasChunk(Chunk))
+		{
+			if(!pGhost->m_pPathJob && pGhost->m_aFilename[0] != '\0')
+				StartPathJob(pGhost, Chunk);
+			return 0;
+		}
+		pGhost->m_Path.UseChunk(Chunk);
+
+		// read the next chunk before it is needed
+		if(!pGhost->m_pPathJob && Chunk + 1 < pGhost->m_Path.NumChunks() && !pGhost->m_Path.HasChunk(Chunk + 1))
+			StartPathJob(pGhost, Chunk + 1);
+	}
+	return pGhost->m_Path.Get(Index);
+}
+
+void CGhost::StartPathJob(CGhostItem *pGhost, int Chunk)
+{
+	const int First = Chunk * pGhost->m_Path.ChunkSize();
+	const int Num = minimum(pGhost->m_Path.ChunkSize(), pGhost->m_Path.Size() - First);
+	pGhost->m_pPathJob = std::make_shared<CGhostPathJob>(GhostLoader()->CreateLoader(), pGhost->m_aFilename, Client()->GetCurrentMap(), Client()->GetCurrentMapSha256(), Client()->GetCurrentMapCrc(), Chunk, pGhost->m_FirstCharacterItem + First, Num);
+	m_pClient->Engine()->AddJob(pGhost->m_pPathJob);
+}
+
+void CGhost::FinishPathJob(CGhostItem *pGhost)
+{
+	std::shared_ptr<CGhostPathJob> pJob = std::move(pGhost->m_pPathJob);
+	pGhost->m_pPathJob = nullptr;
+	if(pJob->m_Error)
+	{
+		// printed here, the job thread must not use the console
+		if(pJob->m_aError[0])
+			Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "ghost_loader", pJob->m_aError);
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "ghost", "invalid ghost data");
+		pGhost->m_aFilename[0] = '\0';
+		return;
+	}
+
+	CGhostCharacter *pChunk = pGhost->m_Path.AllocChunk(pJob->m_Chunk);
+	mem_copy(pChunk, pJob->m_vPath.data(), pJob->m_vPath.size() * sizeof(CGhostCharacter));
+	pGhost->m_Path.UseChunk(pJob->m_Chunk);
+}
+
 void CGhost::StartRecord(int Tick)
 {
 	m_Recording = true;
@@ -495,7 +621,6 @@ int CGhost::Load(const char *pFilename)
 	// select ghost
 	CGhostItem *pGhost = &m_aActiveGhosts[Slot];
 	pGhost->Reset();
-	pGhost->m_Path.SetSize(pInfo->m_NumTicks);
 
 	str_copy(pGhost->m_aPlayer, pInfo->m_aOwner);
 
@@ -505,7 +630,47 @@ int CGhost::Load(const char *pFilename)
 	bool Error = false;
 
 	int Type;
-	while(!Error && GhostLoader()->ReadNextType(&Type))
+	if(GhostLoader()->HasItemIndex())
+	{
+		// only read the items before the path, it is read in chunks while playing
+		pGhost->m_Path.SetSize(pInfo->m_NumTicks, true);
+		int ItemIndex = 0;
+		bool FoundPath = false;
+		while(!Error && GhostLoader()->ReadNextType(&Type))
+		{
+			if(Type == GHOSTDATA_TYPE_CHARACTER)
+			{
+				FoundPath = true;
+				break;
+			}
+			if(Type == GHOSTDATA_TYPE_SKIN && !FoundSkin)
+			{
+				FoundSkin = true;
+				Error = !GhostLoader()->ReadData(Type, &pGhost->m_Skin, sizeof(CGhostSkin));
+			}
+			else if(Type == GHOSTDATA_TYPE_START_TICK)
+				Error = !GhostLoader()->ReadData(Type, &pGhost->m_StartTick, sizeof(int));
+			else
+				Error = true;
+			ItemIndex++;
+		}
+		Error = Error || !FoundPath;
+
+		// the first chunk is read now and always kept, playback restarts from it
+		const int Num = minimum(pGhost->m_Path.ChunkSize(), pInfo->m_NumTicks);
+		CGhostCharacter *pChunk = pGhost->m_Path.AllocChunk(0);
+		for(int i = 0; i < Num && !Error; i++)
+			Error = (i > 0 && (!GhostLoader()->ReadNextType(&Type) || Type != GHOSTDATA_TYPE_CHARACTER)) || !GhostLoader()->ReadData(Type, &pChunk[i], sizeof(CGhostCharacter));
+		GhostLoader()->Close();
+
+		str_copy(pGhost->m_aFilename, pFilename);
+		pGhost->m_FirstCharacterItem = ItemIndex;
+		Index = pInfo->m_NumTicks;
+	}
+	else
+		pGhost->m_Path.SetSize(pInfo->m_NumTicks);
+
+	while(!Error && pGhost->m_aFilename[0] == '\0' && GhostLoader()->ReadNextType(&Type))
 	{
 		if(Index == pInfo->m_NumTicks && (Type == GHOSTDATA_TYPE_CHARACTER || Type == GHOSTDATA_TYPE_CHARACTER_NO_TICK))
 		{
@@ -557,7 +722,15 @@ int CGhost::Load(const char *pFilename)
 	}
 
 	if(pGhost->m_StartTick == -1)
-		pGhost->m_StartTick = pGhost->m_Path.Get(0)->m_Tick;
+	{
+		const CGhostCharacter *pFirst = PathCharacter(pGhost, 0);
+		if(!pFirst)
+		{
+			pGhost->Reset();
+			return -1;
+		}
+		pGhost->m_StartTick = pFirst->m_Tick;
+	}
 
 	if(!FoundSkin)
 		GetGhostSkin(&pGhost->m_Skin, "default", 0, 0, 0);
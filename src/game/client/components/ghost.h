@@ -3,6 +3,9 @@
 #ifndef GAME_CLIENT_COMPONENTS_GHOST_H
 #define GAME_CLIENT_COMPONENTS_GHOST_H
 
+#include <engine/ghost.h>
+#include <engine/shared/jobs.h>
+
 #include <game/client/component.h>
 #include <game/client/components/menus.h>
 #include <game/generated/protocol.h>
@@ -52,6 +55,28 @@ struct CGhostCharacter : public CGhostCharacter_NoTick
 	int m_Tick;
 };
 
+// Reads one chunk of a ghost path on a job thread.
+class CGhostPathJob : public IJob
+{
+	std::unique_ptr<IGhostLoader> m_pLoader;
+	char m_aFilename[IO_MAX_PATH_LENGTH];
+	char m_aMap[128];
+	SHA256_DIGEST m_MapSha256;
+	unsigned m_MapCrc;
+	int m_FirstItem;
+	int m_NumItems;
+
+	void Run() override;
+
+public:
+	CGhostPathJob(std::unique_ptr<IGhostLoader> &&pLoader, const char *pFilename, const char *pMap, SHA256_DIGEST MapSha256, unsigned MapCrc, int Chunk, int FirstItem, int NumItems);
+
+	int m_Chunk;
+	bool m_Error;
+	char m_aError[256];
+	std::vector<CGhostCharacter> m_vPath;
+};
+
 class CGhost : public CComponent
 {
 private:
@@ -62,10 +87,17 @@ private:
 
 	class CGhostPath
 	{
+		enum
+		{
+			// chunks of streamed paths kept besides the first one
+			MAX_CACHED_CHUNKS = 3,
+		};
+
 		int m_ChunkSize;
 		int m_NumItems;
 
 		std::vector<CGhostCharacter *> m_vpChunks;
+		std::vector<int> m_vCachedChunks; // most recently used first
 
 	public:
 		CGhostPath() { Reset(); }
@@ -77,8 +109,16 @@ private:
 		CGhostPath &operator=(CGhostPath &&Other) noexcept;
 
 		void Reset(int ChunkSize = 25 * 60); // one minute with default snap rate
-		void SetSize(int Items);
+		void SetSize(int Items, bool Lazy = false); // lazy chunks are allocated by AllocChunk
 		int Size() const { return m_NumItems; }
+		int ChunkSize() const { return m_ChunkSize; }
+		int NumChunks() const { return m_vpChunks.size(); }
+
+		bool HasChunk(int Chunk) const { return m_vpChunks[Chunk] != nullptr; }
+		CGhostCharacter *AllocChunk(int Chunk);
+		void FreeChunk(int Chunk);
+		// marks a chunk as used and frees the least recently used ones, the first chunk is always kept
+		void UseChunk(int Chunk);
 
 		void Add(const CGhostCharacter &Char);
 		CGhostCharacter *Get(int Index);
@@ -94,6 +134,11 @@ private:
 		char m_aPlayer[MAX_NAME_LENGTH];
 		int m_PlaybackPos;
 
+		// set for ghosts whose path is read from the file in chunks while playing
+		char m_aFilename[IO_MAX_PATH_LENGTH];
+		int m_FirstCharacterItem;
+		std::shared_ptr<CGhostPathJob> m_pPathJob;
+
 		CGhostItem() { Reset(); }
 
 		bool Empty() const { return m_Path.Size() == 0; }
@@ -102,6 +147,9 @@ private:
 			m_Path.Reset();
 			m_StartTick = -1;
 			m_PlaybackPos = -1;
+			m_aFilename[0] = '\0';
+			m_FirstCharacterItem = -1;
+			m_pPathJob = nullptr;
 		}
 	};
 
@@ -144,6 +192,11 @@ private:
 
 	void InitRenderInfos(CGhostItem *pGhost);
 
+	// returns nullptr while the chunk of a streamed path is still being read
+	CGhostCharacter *PathCharacter(CGhostItem *pGhost, int Index);
+	void StartPathJob(CGhostItem *pGhost, int Chunk);
+	void FinishPathJob(CGhostItem *pGhost);
+
 	static void ConGPlay(IConsole::IResult *pResult, void *pUserData);
 
 public:
@@ -31,6 +31,7 @@ CMapLayers::CMapLayers(int t, bool OnlineOnly)
 	m_CurrentLocalTick = 0;
 	m_LastLocalTick = 0;
 	m_EnvelopeUpdate = false;
+	m_EnvelopeCacheActive = false;
 	m_OnlineOnly = OnlineOnly;
 }
 
@@ -56,7 +57,122 @@ void CMapLayers::EnvelopeUpdate()
 	}
 }
 
+// envelope render time, shared by all map layer components
+static std::chrono::nanoseconds s_Time{0};
+static auto s_LastLocalTime = time_get_nanoseconds();
+
+std::vector<CEnvelopeCache::SEntry> *CEnvelopeCache::Entries(const CLayers *pLayers, int Env)
+{
+	if(m_pLayers != pLayers)
+	{
+		int EnvStart, EnvNum;
+		pLayers->Map()->GetType(MAPITEMTYPE_ENVELOPE, &EnvStart, &EnvNum);
+		m_vvEntries.resize(maximum(EnvNum, 0));
+		for(auto &vEntries : m_vvEntries)
+			vEntries.clear();
+		m_pLayers = pLayers;
+	}
+	if(Env < 0 || (size_t)Env >= m_vvEntries.size())
+		return nullptr;
+	return &m_vvEntries[Env];
+}
+
 void CMapLayers::EnvelopeEval(int TimeOffsetMillis, int Env, ColorRGBA &Channels, void *pUser)
+{
+	CMapLayers *pThis = (CMapLayers *)pUser;
+	std::vector<CEnvelopeCache::SEntry> *pEntries = pThis->m_EnvelopeCacheActive ? pThis->m_pClient->m_EnvelopeCache.Entries(pThis->m_pLayers, Env) : nullptr;
+	if(!pEntries)
+	{
+		EnvelopeEvalImpl(TimeOffsetMillis, Env, Channels, pUser);
+		return;
+	}
+
+	// the envelope time is the same for the whole frame, so every envelope and offset pair is only evaluated once
+	for(const CEnvelopeCache::SEntry &Entry : *pEntries)
+	{
+		if(Entry.m_TimeOffsetMillis == TimeOffsetMillis)
+		{
+			Channels = Entry.m_Channels;
+			return;
+		}
+	}
+
+	EnvelopeEvalImpl(TimeOffsetMillis, Env, Channels, pUser);
+	pEntries->push_back({TimeOffsetMillis, Channels});
+}
+
+void CMapLayers::BenchmarkEnvelopes(int Iterations)
+{
+	// collect every envelope reference of the visible layers, like a single render pass would evaluate them
+	std::vector<std::pair<int, int>> vEnvelopeRefs;
+	for(int g = 0; g < m_pLayers->NumGroups(); g++)
+	{
+		CMapItemGroup *pGroup = m_pLayers->GetGroup(g);
+		if(!pGroup)
+			continue;
+		for(int l = 0; l < pGroup->m_NumLayers; l++)
+		{
+			CMapItemLayer *pLayer = m_pLayers->GetLayer(pGroup->m_StartLayer + l);
+			if(pLayer->m_Type == LAYERTYPE_TILES)
+			{
+				CMapItemLayerTilemap *pTMap = (CMapItemLayerTilemap *)pLayer;
+				if(pTMap->m_ColorEnv >= 0)
+					vEnvelopeRefs.emplace_back(pTMap->m_ColorEnv, pTMap->m_ColorEnvOffset);
+			}
+			else if(pLayer->m_Type == LAYERTYPE_QUADS)
+			{
+				CMapItemLayerQuads *pQLayer = (CMapItemLayerQuads *)pLayer;
+				CQuad *pQuads = (CQuad *)m_pLayers->Map()->GetDataSwapped(pQLayer->m_Data);
+				for(int i = 0; i < pQLayer->m_NumQuads; i++)
+				{
+					if(pQuads[i].m_PosEnv >= 0)
+						vEnvelopeRefs.emplace_back(pQuads[i].m_PosEnv, pQuads[i].m_PosEnvOffset);
+					if(pQuads[i].m_ColorEnv >= 0)
+						vEnvelopeRefs.emplace_back(pQuads[i].m_ColorEnv, pQuads[i].m_ColorEnvOffset);
+				}
+			}
+		}
+	}
+
+	// the benchmark must not advance the envelope time of the next frame
+	const auto SavedTime = s_Time;
+	const auto SavedLastLocalTime = s_LastLocalTime;
+	const int SavedCurrentLocalTick = m_CurrentLocalTick;
+	const int SavedLastLocalTick = m_LastLocalTick;
+
+	ColorRGBA Channels;
+	const auto UncachedStart = time_get_nanoseconds();
+	for(int i = 0; i < Iterations; i++)
+		for(const auto &[Env, Offset] : vEnvelopeRefs)
+			EnvelopeEvalImpl(Offset, Env, Channels, this);
+	const auto UncachedTime = time_get_nanoseconds() - UncachedStart;
+
+	const auto CachedStart = time_get_nanoseconds();
+	m_EnvelopeCacheActive = true;
+	for(int i = 0; i < Iterations; i++)
+	{
+		m_pClient->m_EnvelopeCache.Reset();
+		for(const auto &[Env, Offset] : vEnvelopeRefs)
+			EnvelopeEval(Offset, Env, Channels, this);
+	}
+	m_EnvelopeCacheActive = false;
+	const auto CachedTime = time_get_nanoseconds() - CachedStart;
+
+	m_pClient->m_EnvelopeCache.Reset();
+	s_Time = SavedTime;
+	s_LastLocalTime = SavedLastLocalTime;
+	m_CurrentLocalTick = SavedCurrentLocalTick;
+	m_LastLocalTick = SavedLastLocalTick;
+
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "%d envelope evaluations per frame, %d frames: uncached %.3f ms/frame, cached %.3f ms/frame",
+		(int)vEnvelopeRefs.size(), Iterations,
+		UncachedTime.count() / (double)Iterations / 1000000.0,
+		CachedTime.count() / (double)Iterations / 1000000.0);
+	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "maplayers", aBuf);
+}
+
+void CMapLayers::EnvelopeEvalImpl(int TimeOffsetMillis, int Env, ColorRGBA &Channels, void *pUser)
 {
 	CMapLayers *pThis = (CMapLayers *)pUser;
 	Channels = ColorRGBA();
@@ -76,8 +192,6 @@ void CMapLayers::EnvelopeEval(int TimeOffsetMillis, int Env, ColorRGBA &Channels
 
 	const auto TickToNanoSeconds = std::chrono::nanoseconds(1s) / (int64_t)pThis->Client()->GameTickSpeed();
 
-	static std::chrono::nanoseconds s_Time{0};
-	static auto s_LastLocalTime = time_get_nanoseconds();
 	if(pThis->Client()->State() == IClient::STATE_DEMOPLAYBACK)
 	{
 		const IDemoPlayer::CInfo *pInfo = pThis->DemoPlayer()->BaseInfo();
@@ -410,6 +524,9 @@ CMapLayers::~CMapLayers()
 
 void CMapLayers::OnMapLoad()
 {
+	// the layers may have been reused for another map
+	m_pClient->m_EnvelopeCache.Reset();
+
 	if(!Graphics()->IsTileBufferingEnabled() && !Graphics()->IsQuadBufferingEnabled())
 		return;
 
@@ -905,6 +1022,8 @@ void CMapLayers::OnMapLoad()
 				for(int i = 0; i < pQLayer->m_NumQuads; ++i)
 				{
 					CQuad *pQuad = &pQuads[i];
+					if(pQuad->m_PosEnv >= 0 || pQuad->m_ColorEnv >= 0)
+						pQLayerVisuals->m_HasEnvelopes = true;
 					for(int j = 0; j < 4; ++j)
 					{
 						int QuadIDX = j;
@@ -1381,10 +1500,32 @@ void CMapLayers::RenderQuadLayer(int LayerIndex, CMapItemLayerQuads *pQuadLayer,
 	if(!Force && (!g_Config.m_ClShowQuads || g_Config.m_ClOverlayEntities == 100))
 		return;
 
-	CQuad *pQuads = (CQuad *)m_pLayers->Map()->GetDataSwapped(pQuadLayer->m_Data);
-
 	static std::vector<SQuadRenderInfo> s_vQuadRenderInfo;
 
+	if(!Visuals.m_HasEnvelopes)
+	{
+		// the quads are never moved or recolored, so the layer is drawn with the identity transform
+		// without evaluating the quads, the info is still uploaded because the quad shaders read it per quad
+		static std::vector<SQuadRenderInfo> s_vIdentityQuadRenderInfo;
+		if(s_vIdentityQuadRenderInfo.empty())
+		{
+			SQuadRenderInfo Identity;
+			Identity.m_Color = ColorRGBA(1.0f, 1.0f, 1.0f, 1.0f);
+			Identity.m_Offsets = vec2(0.0f, 0.0f);
+			Identity.m_Rotation = 0.0f;
+			Identity.m_Padding = 0.0f;
+			s_vIdentityQuadRenderInfo.resize(gs_GraphicsMaxQuadsRenderCount, Identity);
+		}
+		for(size_t QuadOffset = 0; QuadOffset < (size_t)pQuadLayer->m_NumQuads; QuadOffset += gs_GraphicsMaxQuadsRenderCount)
+		{
+			const size_t QuadNum = minimum((size_t)pQuadLayer->m_NumQuads - QuadOffset, gs_GraphicsMaxQuadsRenderCount);
+			Graphics()->RenderQuadLayer(Visuals.m_BufferContainerIndex, s_vIdentityQuadRenderInfo.data(), QuadNum, QuadOffset);
+		}
+		return;
+	}
+
+	CQuad *pQuads = (CQuad *)m_pLayers->Map()->GetDataSwapped(pQuadLayer->m_Data);
+
 	s_vQuadRenderInfo.resize(pQuadLayer->m_NumQuads);
 	size_t QuadsRenderCount = 0;
 	size_t CurQuadOffset = 0;
@@ -1547,6 +1688,13 @@ void CMapLayers::OnRender()
 	if(m_OnlineOnly && Client()->State() != IClient::STATE_ONLINE && Client()->State() != IClient::STATE_DEMOPLAYBACK)
 		return;
 
+	m_EnvelopeCacheActive = true;
+	RenderLayers();
+	m_EnvelopeCacheActive = false;
+}
+
+void CMapLayers::RenderLayers()
+{
 	CUIRect Screen;
 	Graphics()->GetScreen(&Screen.x, &Screen.y, &Screen.w, &Screen.h);
 
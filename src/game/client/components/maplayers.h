@@ -2,6 +2,8 @@
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #ifndef GAME_CLIENT_COMPONENTS_MAPLAYERS_H
 #define GAME_CLIENT_COMPONENTS_MAPLAYERS_H
+#include <base/color.h>
+
 #include <game/client/component.h>
 
 #include <cstdint>
@@ -18,11 +20,33 @@ typedef unsigned int offset_ptr32;
 class CCamera;
 class CLayers;
 class CMapImages;
-class ColorRGBA;
 struct CMapItemGroup;
 struct CMapItemLayerTilemap;
 struct CMapItemLayerQuads;
 
+// Envelope values of the current frame. It is shared by the map layer
+// components, so the background and foreground passes evaluate every envelope
+// and offset pair only once.
+class CEnvelopeCache
+{
+public:
+	struct SEntry
+	{
+		int m_TimeOffsetMillis;
+		ColorRGBA m_Channels;
+	};
+
+	// Called once per frame, the values depend on the render time.
+	void Reset() { m_pLayers = nullptr; }
+	// Returns the cached values of an envelope, or nullptr if it doesn't exist.
+	// Switching to another map clears the cache.
+	std::vector<SEntry> *Entries(const CLayers *pLayers, int Env);
+
+private:
+	const CLayers *m_pLayers = nullptr;
+	std::vector<std::vector<SEntry>> m_vvEntries;
+};
+
 class CMapLayers : public CComponent
 {
 	friend class CBackground;
@@ -37,6 +61,12 @@ class CMapLayers : public CComponent
 
 	bool m_OnlineOnly;
 
+	// whether envelope values are taken from the frame's envelope cache
+	bool m_EnvelopeCacheActive;
+
+	void RenderLayers();
+	static void EnvelopeEvalImpl(int TimeOffsetMillis, int Env, ColorRGBA &Channels, void *pUser);
+
 	struct STileLayerVisuals
 	{
 		STileLayerVisuals() :
@@ -110,7 +140,7 @@ class CMapLayers : public CComponent
 	struct SQuadLayerVisuals
 	{
 		SQuadLayerVisuals() :
-			m_QuadNum(0), m_pQuadsOfLayer(nullptr), m_BufferContainerIndex(-1), m_IsTextured(false) {}
+			m_QuadNum(0), m_pQuadsOfLayer(nullptr), m_BufferContainerIndex(-1), m_IsTextured(false), m_HasEnvelopes(false) {}
 
 		struct SQuadVisual
 		{
@@ -125,6 +155,8 @@ class CMapLayers : public CComponent
 
 		int m_BufferContainerIndex;
 		bool m_IsTextured;
+		// layers without position or color envelopes are drawn without per quad CPU work
+		bool m_HasEnvelopes;
 	};
 	std::vector<SQuadLayerVisuals *> m_vpQuadLayerVisuals;
 
@@ -160,6 +192,7 @@ public:
 	void RenderQuadLayer(int LayerIndex, CMapItemLayerQuads *pQuadLayer, CMapItemGroup *pGroup, bool ForceRender = false);
 
 	void EnvelopeUpdate();
+	void BenchmarkEnvelopes(int Iterations);
 
 	static void EnvelopeEval(int TimeOffsetMillis, int Env, ColorRGBA &Channels, void *pUser);
 };
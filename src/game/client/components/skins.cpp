@@ -3,11 +3,15 @@
 
 #include <base/math.h>
 #include <base/system.h>
+#include <base/tl/threading.h>
 #include <ctime>
+#include <string>
+#include <unordered_set>
 
 #include <engine/engine.h>
 #include <engine/graphics.h>
 #include <engine/shared/config.h>
+#include <engine/shared/jobs.h>
 #include <engine/storage.h>
 
 #include <game/generated/client_data.h>
@@ -26,7 +30,7 @@ int CSkins::CGetPngFile::OnCompletion(int State)
 {
 	State = CHttpRequest::OnCompletion(State);
 
-	if(State != HTTP_ERROR && State != HTTP_ABORTED && !m_pSkins->LoadSkinPNG(m_Info, Dest(), Dest(), IStorage::TYPE_SAVE))
+	if(State != HTTP_ERROR && State != HTTP_ABORTED && !m_pSkins->LoadSkinPNG(m_Info, Dest(), IStorage::TYPE_SAVE, m_PngliteIncompatible))
 	{
 		State = HTTP_ERROR;
 	}
@@ -42,10 +46,43 @@ CSkins::CGetPngFile::CGetPngFile(CSkins *pSkins, const char *pUrl, IStorage *pSt
 	LogProgress(HTTPLOG::NONE);
 }
 
+// decodes the skin image on the job pool, the textures are created on the main thread
+class CSkins::CSkinLoadJob : public IJob
+{
+	CSkins *m_pSkins;
+	CSemaphore *m_pDoneSemaphore;
+	int m_DirType;
+
+	void Run() override
+	{
+		m_Success = m_pSkins->LoadSkinPNG(m_Info, m_aPath, m_DirType, m_PngliteIncompatible);
+		m_Done = true;
+		m_pDoneSemaphore->Signal();
+	}
+
+public:
+	char m_aName[128];
+	char m_aPath[IO_MAX_PATH_LENGTH];
+	CImageInfo m_Info;
+	bool m_Success = false;
+	int m_PngliteIncompatible = 0;
+	std::atomic_bool m_Done{false};
+
+	CSkinLoadJob(CSkins *pSkins, CSemaphore *pDoneSemaphore, const char *pName, const char *pPath, int DirType) :
+		m_pSkins(pSkins), m_pDoneSemaphore(pDoneSemaphore), m_DirType(DirType)
+	{
+		str_copy(m_aName, pName);
+		str_copy(m_aPath, pPath);
+	}
+};
+
 struct SSkinScanUser
 {
 	CSkins *m_pThis;
-	CSkins::TSkinLoadedCBFunc m_SkinLoadedFunc;
+	std::vector<std::shared_ptr<CSkins::CSkinLoadJob>> m_vpJobs;
+	std::unordered_set<std::string> m_Names;
+	// signaled once by every job
+	CSemaphore m_DoneSemaphore;
 };
 
 int CSkins::SkinScan(const char *pName, int IsDir, int DirType, void *pUser)
@@ -65,13 +102,13 @@ int CSkins::SkinScan(const char *pName, int IsDir, int DirType, void *pUser)
 
 	// Don't add duplicate skins (one from user's config directory, other from
 	// client itself)
-	if(pSelf->m_Skins.find(aNameWithoutPng) != pSelf->m_Skins.end())
+	if(!pUserReal->m_Names.insert(aNameWithoutPng).second)
 		return 0;
 
 	char aBuf[IO_MAX_PATH_LENGTH];
 	str_format(aBuf, sizeof(aBuf), "skins/%s", pName);
-	pSelf->LoadSkin(aNameWithoutPng, aBuf, DirType);
-	pUserReal->m_SkinLoadedFunc((int)pSelf->m_Skins.size());
+	pUserReal->m_vpJobs.push_back(std::make_shared<CSkinLoadJob>(pSelf, &pUserReal->m_DoneSemaphore, aNameWithoutPng, aBuf, DirType));
+	pSelf->m_pClient->Engine()->AddJob(pUserReal->m_vpJobs.back());
 	return 0;
 }
 
@@ -110,24 +147,9 @@ static void CheckMetrics(CSkin::SSkinMetricVariable &Metrics, const uint8_t *pIm
 	Metrics.m_MaxHeight = CheckHeight;
 }
 
-const CSkin *CSkins::LoadSkin(const char *pName, const char *pPath, int DirType)
-{
-	CImageInfo Info;
-	if(!LoadSkinPNG(Info, pName, pPath, DirType))
-		return 0;
-	return LoadSkin(pName, Info);
-}
-
-bool CSkins::LoadSkinPNG(CImageInfo &Info, const char *pName, const char *pPath, int DirType)
+bool CSkins::LoadSkinPNG(CImageInfo &Info, const char *pPath, int DirType, int &PngliteIncompatible)
 {
-	char aBuf[512];
-	if(!Graphics()->LoadPNG(&Info, pPath, DirType))
-	{
-		str_format(aBuf, sizeof(aBuf), "failed to load skin from %s", pName);
-		Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "game", aBuf);
-		return false;
-	}
-	return true;
+	return Graphics()->DecodePNG(&Info, pPath, DirType, PngliteIncompatible);
 }
 
 const CSkin *CSkins::LoadSkin(const char *pName, CImageInfo &Info)
@@ -344,8 +366,27 @@ void CSkins::Refresh(TSkinLoadedCBFunc &&SkinLoadedFunc)
 	m_DownloadingSkins = 0;
 	SSkinScanUser SkinScanUser;
 	SkinScanUser.m_pThis = this;
-	SkinScanUser.m_SkinLoadedFunc = SkinLoadedFunc;
 	Storage()->ListDirectory(IStorage::TYPE_ALL, "skins", SkinScan, &SkinScanUser);
+
+	// the images are decoded in parallel, create the textures in the scan order
+	for(const auto &pJob : SkinScanUser.m_vpJobs)
+	{
+		// every wait consumes the signal of a finished job, at least this one is still to come
+		while(!pJob->m_Done)
+			SkinScanUser.m_DoneSemaphore.Wait();
+		if(pJob->m_Success)
+		{
+			Graphics()->ReportPngliteIncompatible(pJob->m_aPath, pJob->m_PngliteIncompatible);
+			LoadSkin(pJob->m_aName, pJob->m_Info);
+		}
+		else
+		{
+			char aBuf[512];
+			str_format(aBuf, sizeof(aBuf), "failed to load skin from %s", pJob->m_aName);
+			Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "game", aBuf);
+		}
+		SkinLoadedFunc((int)m_Skins.size());
+	}
 	if(m_Skins.empty())
 	{
 		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "gameclient", "failed to load skins. folder='skins/'");
@@ -422,6 +463,7 @@ const CSkin *CSkins::FindImpl(const char *pName)
 			char aPath[IO_MAX_PATH_LENGTH];
 			str_format(aPath, sizeof(aPath), "downloadedskins/%s.png", SkinDownloadIt->second->GetName());
 			Storage()->RenameFile(SkinDownloadIt->second->m_aPath, aPath, IStorage::TYPE_SAVE);
+			Graphics()->ReportPngliteIncompatible(aPath, SkinDownloadIt->second->m_pTask->m_PngliteIncompatible);
 			const auto *pSkin = LoadSkin(SkinDownloadIt->second->GetName(), SkinDownloadIt->second->m_pTask->m_Info);
 			SkinDownloadIt->second->m_pTask = nullptr;
 			--m_DownloadingSkins;
@@ -25,8 +25,11 @@ public:
 	public:
 		CGetPngFile(CSkins *pSkins, const char *pUrl, IStorage *pStorage, const char *pDest);
 		CImageInfo m_Info;
+		int m_PngliteIncompatible = 0;
 	};
 
+	class CSkinLoadJob;
+
 	struct CDownloadSkin
 	{
 	private:
@@ -82,8 +85,8 @@ private:
 	size_t m_DownloadingSkins = 0;
 	char m_aEventSkinPrefix[24];
 
-	bool LoadSkinPNG(CImageInfo &Info, const char *pName, const char *pPath, int DirType);
-	const CSkin *LoadSkin(const char *pName, const char *pPath, int DirType);
+	// thread safe, the pnglite incompatibilities are reported by the caller
+	bool LoadSkinPNG(CImageInfo &Info, const char *pPath, int DirType, int &PngliteIncompatible);
 	const CSkin *LoadSkin(const char *pName, CImageInfo &Info);
 	const CSkin *FindImpl(const char *pName);
 	static int SkinScan(const char *pName, int IsDir, int DirType, void *pUser);
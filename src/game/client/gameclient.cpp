@@ -164,6 +164,7 @@ void CGameClient::OnConsoleInit()
 	// add the some console commands
 	Console()->Register("team", "i[team-id]", CFGFLAG_CLIENT, ConTeam, this, "Switch team");
 	Console()->Register("kill", "", CFGFLAG_CLIENT, ConKill, this, "Kill yourself to restart");
+	Console()->Register("benchmark_envelopes", "?i[frames]", CFGFLAG_CLIENT, ConBenchmarkEnvelopes, this, "Benchmark the envelope evaluation of the current map");
 
 	// register server dummy commands for tab completion
 	Console()->Register("tune", "s[tuning] ?i[value]", CFGFLAG_SERVER, 0, 0, "Tune variable to value or show current value");
@@ -669,6 +670,9 @@ void CGameClient::OnRender()
 	// update the local character and spectate position
 	UpdatePositions();
 
+	// envelopes are evaluated again for the new render time
+	m_EnvelopeCache.Reset();
+
 	// display gfx & client warnings
 	for(SWarning *pWarning : {Graphics()->GetCurWarning(), Client()->GetCurWarning()})
 	{
@@ -2306,6 +2310,17 @@ void CGameClient::ConKill(IConsole::IResult *pResult, void *pUserData)
 	((CGameClient *)pUserData)->SendKill(-1);
 }
 
+void CGameClient::ConBenchmarkEnvelopes(IConsole::IResult *pResult, void *pUserData)
+{
+	CGameClient *pSelf = (CGameClient *)pUserData;
+	if(pSelf->Client()->State() != IClient::STATE_ONLINE && pSelf->Client()->State() != IClient::STATE_DEMOPLAYBACK)
+	{
+		pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "maplayers", "no map loaded");
+		return;
+	}
+	pSelf->m_MapLayersBackGround.BenchmarkEnvelopes(pResult->NumArguments() ? maximum(pResult->GetInteger(0), 1) : 1000);
+}
+
 void CGameClient::ConchainLanguageUpdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData)
 {
 	pfnCallback(pResult, pCallbackUserData);
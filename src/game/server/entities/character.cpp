@@ -9,6 +9,8 @@
 
 #include <engine/antibot.h>
 #include <engine/shared/config.h>
+#include <engine/shared/econ.h>
+#include <engine/shared/jsonwriter.h>
 
 #include <game/generated/protocol.h>
 #include <game/generated/server_data.h>
@@ -923,6 +925,21 @@ void CCharacter::Die(int Killer, int Weapon, bool SendKillMsg)
 		m_pPlayer->GetCID(), Server()->ClientName(m_pPlayer->GetCID()), Weapon, ModeSpecial);
 	GameServer()->Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "game", aBuf);
 
+	if(CJsonWriter *pJson = Server()->EconBeginEvent(ECON_EVENT_KILL))
+	{
+		pJson->WriteAttribute("killer");
+		pJson->WriteIntValue(Killer);
+		pJson->WriteAttribute("killer_name");
+		pJson->WriteStrValue(Server()->ClientName(Killer));
+		pJson->WriteAttribute("victim");
+		pJson->WriteIntValue(m_pPlayer->GetCID());
+		pJson->WriteAttribute("victim_name");
+		pJson->WriteStrValue(Server()->ClientName(m_pPlayer->GetCID()));
+		pJson->WriteAttribute("weapon");
+		pJson->WriteIntValue(Weapon);
+		Server()->EconEndEvent();
+	}
+
 	// send the kill message
 	if(SendKillMsg && (Team() == TEAM_FLOCK || Teams()->Count(Team()) == 1 || Teams()->GetTeamState(Team()) == CGameTeams::TEAMSTATE_OPEN || Teams()->TeamLocked(Team()) == false))
 	{
@@ -15,9 +15,12 @@
 #include <engine/server/server.h>
 #include <engine/shared/config.h>
 #include <engine/shared/datafile.h>
+#include <engine/shared/econ.h>
 #include <engine/shared/json.h>
+#include <engine/shared/jsonwriter.h>
 #include <engine/shared/linereader.h>
 #include <engine/shared/memheap.h>
+#include <engine/shared/tick_profiler.h>
 #include <engine/storage.h>
 
 #include <game/collision.h>
@@ -47,9 +50,15 @@ public:
 		m_pOuterLogger(pOuterLogger)
 	{
 	}
+	bool Filters(LEVEL Level) override;
 	void Log(const CLogMessage *pMessage) override;
 };
 
+bool CClientChatLogger::Filters(LEVEL Level)
+{
+	return m_Filter.Filters(Level) && m_pOuterLogger->Filters(Level);
+}
+
 void CClientChatLogger::Log(const CLogMessage *pMessage)
 {
 	if(str_comp(pMessage->m_aSystem, "chatresp") == 0)
@@ -545,6 +554,22 @@ void CGameContext::SendChat(int ChatterClientID, int Team, const char *pText, in
 		str_format(aBuf, sizeof(aBuf), "*** %s", aText);
 	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, Team != CHAT_ALL ? "teamchat" : "chat", aBuf);
 
+	if(CJsonWriter *pJson = Server()->EconBeginEvent(ECON_EVENT_CHAT))
+	{
+		pJson->WriteAttribute("client_id");
+		pJson->WriteIntValue(ChatterClientID);
+		pJson->WriteAttribute("team");
+		pJson->WriteIntValue(Team);
+		if(ChatterClientID >= 0)
+		{
+			pJson->WriteAttribute("name");
+			pJson->WriteStrValue(Server()->ClientName(ChatterClientID));
+		}
+		pJson->WriteAttribute("message");
+		pJson->WriteStrValue(aText);
+		Server()->EconEndEvent();
+	}
+
 	if(Team == CHAT_ALL)
 	{
 		CNetMsg_Sv_Chat Msg;
@@ -946,34 +971,46 @@ void CGameContext::OnTick()
 		m_TeeHistorian.BeginPlayers();
 	}
 
+	CTickProfiler *pProfiler = Server()->TickProfiler();
+
 	// copy tuning
 	m_World.m_Core.m_aTuning[0] = m_Tuning;
-	m_World.Tick();
+	{
+		CProfileScope Profile(pProfiler, PROFILE_GAME_WORLD);
+		m_World.Tick();
+	}
 
 	//if(world.paused) // make sure that the game object always updates
-	m_pController->Tick();
+	{
+		CProfileScope Profile(pProfiler, PROFILE_GAME_CONTROLLER);
+		m_pController->Tick();
+	}
 
-	for(int i = 0; i < MAX_CLIENTS; i++)
 	{
-		if(m_apPlayers[i])
+		CProfileScope Profile(pProfiler, PROFILE_GAME_PLAYERS);
+		for(int i = 0; i < MAX_CLIENTS; i++)
 		{
-			// send vote options
-			ProgressVoteOptions(i);
+			if(m_apPlayers[i])
+			{
+				// send vote options
+				ProgressVoteOptions(i);
 
-			m_apPlayers[i]->Tick();
-			m_apPlayers[i]->PostTick();
+				m_apPlayers[i]->Tick();
+				m_apPlayers[i]->PostTick();
+			}
 		}
-	}
 
-	for(auto &pPlayer : m_apPlayers)
-	{
-		if(pPlayer)
-			pPlayer->PostPostTick();
+		for(auto &pPlayer : m_apPlayers)
+		{
+			if(pPlayer)
+				pPlayer->PostPostTick();
+		}
 	}
 
 	// update voting
 	if(m_VoteCloseTime)
 	{
+		CProfileScope Profile(pProfiler, PROFILE_GAME_VOTES);
 		// abort the kick-vote on player-leave
 		if(m_VoteEnforce == VOTE_ENFORCE_ABORT)
 		{
@@ -1183,6 +1220,7 @@ void CGameContext::OnTick()
 
 	if(m_SqlRandomMapResult != nullptr && m_SqlRandomMapResult->m_Completed)
 	{
+		CProfileScope Profile(pProfiler, PROFILE_DATABASE);
 		if(m_SqlRandomMapResult->m_Success)
 		{
 			if(PlayerExists(m_SqlRandomMapResult->m_ClientID) && m_SqlRandomMapResult->m_aMessage[0] != '\0')
@@ -1407,6 +1445,17 @@ void CGameContext::OnClientEnter(int ClientID)
 	}
 	m_pController->OnPlayerConnect(m_apPlayers[ClientID]);
 
+	if(CJsonWriter *pJson = Server()->EconBeginEvent(ECON_EVENT_JOIN))
+	{
+		pJson->WriteAttribute("client_id");
+		pJson->WriteIntValue(ClientID);
+		pJson->WriteAttribute("name");
+		pJson->WriteStrValue(Server()->ClientName(ClientID));
+		pJson->WriteAttribute("team");
+		pJson->WriteIntValue(m_apPlayers[ClientID]->GetTeam());
+		Server()->EconEndEvent();
+	}
+
 	if(Server()->IsSixup(ClientID))
 	{
 		{
@@ -1630,6 +1679,17 @@ void CGameContext::OnClientDrop(int ClientID, const char *pReason)
 {
 	LogEvent("Disconnect", ClientID);
 
+	if(CJsonWriter *pJson = Server()->EconBeginEvent(ECON_EVENT_LEAVE))
+	{
+		pJson->WriteAttribute("client_id");
+		pJson->WriteIntValue(ClientID);
+		pJson->WriteAttribute("name");
+		pJson->WriteStrValue(Server()->ClientName(ClientID));
+		pJson->WriteAttribute("reason");
+		pJson->WriteStrValue(pReason ? pReason : "");
+		Server()->EconEndEvent();
+	}
+
 	AbortVoteKickOnDisconnect(ClientID);
 	m_pController->OnPlayerDisconnect(m_apPlayers[ClientID], pReason);
 	delete m_apPlayers[ClientID];
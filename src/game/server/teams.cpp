@@ -8,6 +8,8 @@
 #include <base/system.h>
 
 #include <engine/shared/config.h>
+#include <engine/shared/econ.h>
+#include <engine/shared/jsonwriter.h>
 
 #include <game/mapitems.h>
 
@@ -690,6 +692,19 @@ void CGameTeams::OnFinish(CPlayer *Player, float Time, const char *pTimestamp)
 	else
 		GameServer()->SendChat(-1, CGameContext::CHAT_ALL, aBuf, -1., CGameContext::CHAT_SIX);
 
+	if(CJsonWriter *pJson = Server()->EconBeginEvent(ECON_EVENT_FINISH))
+	{
+		pJson->WriteAttribute("client_id");
+		pJson->WriteIntValue(ClientID);
+		pJson->WriteAttribute("name");
+		pJson->WriteStrValue(Server()->ClientName(ClientID));
+		pJson->WriteAttribute("team");
+		pJson->WriteIntValue(m_Core.Team(ClientID));
+		pJson->WriteAttribute("time_ms");
+		pJson->WriteIntValue(round_to_int(Time * 1000.0f));
+		Server()->EconEndEvent();
+	}
+
 	float Diff = absolute(Time - pData->m_BestTime);
 
 	if(Time - pData->m_BestTime < 0)
@@ -0,0 +1,142 @@
+#include "test.h"
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/config.h>
+#include <engine/console.h>
+#include <engine/kernel.h>
+#include <engine/shared/config.h>
+#include <engine/storage.h>
+
+#include <memory>
+
+static void CountCallback(IConsole::IResult *pResult, void *pUserData)
+{
+	*(int *)pUserData += pResult->GetInteger(0);
+}
+
+static void WriteLineCallback(IConfigManager *pConfigManager, void *pUserData)
+{
+	pConfigManager->WriteLine("snapshot_test_line 7");
+}
+
+static void CountChain(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData)
+{
+	(*(int *)pUserData)++;
+	pfnCallback(pResult, pCallbackUserData);
+}
+
+// changes every saved client setting that can be restored exactly
+static void ChangeSettings()
+{
+#define MACRO_CONFIG_INT(Name, ScriptName, Def, Min, Max, Flags, Desc) \
+	if((Flags)&CFGFLAG_SAVE && (Flags)&CFGFLAG_CLIENT) \
+		g_Config.m_##Name = (Min) == (Max) ? (Def) + 1 : (Def) != (Min) ? (Min) : (Min) + 1;
+#define MACRO_CONFIG_COL(Name, ScriptName, Def, Flags, Desc)
+#define MACRO_CONFIG_STR(Name, ScriptName, Len, Def, Flags, Desc) \
+	if((Flags)&CFGFLAG_SAVE && (Flags)&CFGFLAG_CLIENT) \
+		str_copy(g_Config.m_##Name, "snap \"test\"", Len);
+#include <engine/shared/config_variables.h>
+#undef MACRO_CONFIG_INT
+#undef MACRO_CONFIG_COL
+#undef MACRO_CONFIG_STR
+}
+
+static int NumDifferentSettings(const CConfig &Other)
+{
+	int Different = 0;
+#define MACRO_CONFIG_INT(Name, ScriptName, Def, Min, Max, Flags, Desc) Different += g_Config.m_##Name != Other.m_##Name;
+#define MACRO_CONFIG_COL(Name, ScriptName, Def, Flags, Desc) Different += g_Config.m_##Name != Other.m_##Name;
+#define MACRO_CONFIG_STR(Name, ScriptName, Len, Def, Flags, Desc) Different += str_comp(g_Config.m_##Name, Other.m_##Name) != 0;
+#include <engine/shared/config_variables.h>
+#undef MACRO_CONFIG_INT
+#undef MACRO_CONFIG_COL
+#undef MACRO_CONFIG_STR
+	return Different;
+}
+
+TEST(ConfigSnapshot, SaveAndRestore)
+{
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	std::unique_ptr<IKernel> pKernel(IKernel::Create());
+	IStorage *pStorage = Info.CreateTestStorage();
+	ASSERT_TRUE(pStorage);
+	IConfigManager *pConfigManager = CreateConfigManager();
+	auto pConsole = CreateConsole(CFGFLAG_CLIENT);
+	EXPECT_TRUE(pKernel->RegisterInterface(pStorage));
+	EXPECT_TRUE(pKernel->RegisterInterface(pConfigManager));
+	EXPECT_TRUE(pKernel->RegisterInterface(pConsole.get(), false));
+	pConfigManager->Init();
+	pConsole->Init();
+
+	int LineCount = 0;
+	int ChainCount = 0;
+	pConsole->Register("snapshot_test_line", "i", CFGFLAG_CLIENT, CountCallback, &LineCount, "");
+	pConsole->Chain("player_name", CountChain, &ChainCount);
+	pConfigManager->RegisterCallback(WriteLineCallback, nullptr);
+
+	ChangeSettings();
+	g_Config.m_ClPlayerColorBody = 0x123456;
+	const CConfig Saved = g_Config;
+	ASSERT_TRUE(pConfigManager->Save());
+
+	// the snapshot restores the same settings as the text
+	pConfigManager->Reset();
+	EXPECT_TRUE(pConsole->ExecuteConfigSnapshot(CONFIG_SNAPSHOT_FILE, CONFIG_FILE));
+	EXPECT_EQ(NumDifferentSettings(Saved), 0);
+	EXPECT_EQ(LineCount, 7);
+	EXPECT_EQ(ChainCount, 1);
+
+	pConfigManager->Reset();
+	EXPECT_TRUE(pConsole->ExecuteFile(CONFIG_FILE));
+	EXPECT_EQ(NumDifferentSettings(Saved), 0);
+	EXPECT_EQ(LineCount, 14);
+
+	// a changed text config makes the snapshot stale
+	IOHANDLE File = pStorage->OpenFile(CONFIG_FILE, IOFLAG_APPEND, IStorage::TYPE_SAVE);
+	ASSERT_TRUE(File);
+	const char aLine[] = "cl_autoswitch_weapons 0\n";
+	io_write(File, aLine, str_length(aLine));
+	io_close(File);
+	pConfigManager->Reset();
+	EXPECT_FALSE(pConsole->ExecuteConfigSnapshot(CONFIG_SNAPSHOT_FILE, CONFIG_FILE));
+	EXPECT_EQ(LineCount, 14);
+	EXPECT_EQ(g_Config.m_PlayerName[0], '\0');
+
+	pConfigManager->Reset();
+}
+
+// run with --gtest_also_run_disabled_tests --gtest_filter=ConfigSnapshot.DISABLED_Benchmark
+TEST(ConfigSnapshot, DISABLED_Benchmark)
+{
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	std::unique_ptr<IKernel> pKernel(IKernel::Create());
+	IStorage *pStorage = Info.CreateTestStorage();
+	ASSERT_TRUE(pStorage);
+	IConfigManager *pConfigManager = CreateConfigManager();
+	auto pConsole = CreateConsole(CFGFLAG_CLIENT);
+	pKernel->RegisterInterface(pStorage);
+	pKernel->RegisterInterface(pConfigManager);
+	pKernel->RegisterInterface(pConsole.get(), false);
+	pConfigManager->Init();
+	pConsole->Init();
+
+	ChangeSettings();
+	ASSERT_TRUE(pConfigManager->Save());
+	pConfigManager->Reset();
+
+	const int NumRuns = 20;
+	int64_t Start = time_get_nanoseconds().count();
+	for(int i = 0; i < NumRuns; i++)
+		pConsole->ExecuteFile(CONFIG_FILE);
+	const int64_t TextTime = time_get_nanoseconds().count() - Start;
+	Start = time_get_nanoseconds().count();
+	for(int i = 0; i < NumRuns; i++)
+		EXPECT_TRUE(pConsole->ExecuteConfigSnapshot(CONFIG_SNAPSHOT_FILE, CONFIG_FILE));
+	const int64_t SnapshotTime = time_get_nanoseconds().count() - Start;
+
+	dbg_msg("config_snapshot", "text %.2fms, snapshot %.2fms per load", TextTime / 1e6 / NumRuns, SnapshotTime / 1e6 / NumRuns);
+	pConfigManager->Reset();
+}
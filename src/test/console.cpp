@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/console.h>
+#include <engine/shared/config.h>
+
+#include <string>
+
+static void CountCallback(IConsole::IResult *pResult, void *pUserData)
+{
+	int *pCount = (int *)pUserData;
+	*pCount += pResult->NumArguments() ? pResult->GetInteger(0) : 1;
+}
+
+static void CollectPossible(int Index, const char *pStr, void *pUser)
+{
+	std::string *pResult = (std::string *)pUser;
+	*pResult += pStr;
+	*pResult += ";";
+}
+
+TEST(Console, CommandLookup)
+{
+	auto pConsole = CreateConsole(CFGFLAG_SERVER);
+	int ServerCount = 0;
+	int ClientCount = 0;
+	pConsole->Register("b_cmd", "?i", CFGFLAG_SERVER, CountCallback, &ServerCount, "");
+	pConsole->Register("a_cmd", "?i", CFGFLAG_SERVER, CountCallback, &ServerCount, "");
+	pConsole->Register("a_cmd", "?i", CFGFLAG_CLIENT, CountCallback, &ClientCount, "");
+
+	// names are case insensitive, the flags pick the command
+	pConsole->ExecuteLine("A_CMD 2; b_cmd");
+	EXPECT_EQ(ServerCount, 3);
+	EXPECT_EQ(ClientCount, 0);
+	pConsole->ExecuteLineFlag("a_cmd 5", CFGFLAG_CLIENT, -1);
+	EXPECT_EQ(ClientCount, 5);
+	EXPECT_TRUE(pConsole->GetCommandInfo("B_Cmd", CFGFLAG_SERVER, false));
+	EXPECT_FALSE(pConsole->GetCommandInfo("b_cmd", CFGFLAG_CLIENT, false));
+	EXPECT_FALSE(pConsole->GetCommandInfo("c_cmd", CFGFLAG_SERVER, false));
+
+	// the command list stays sorted
+	const IConsole::CCommandInfo *pInfo = pConsole->FirstCommandInfo(IConsole::ACCESS_LEVEL_ADMIN, CFGFLAG_SERVER);
+	ASSERT_TRUE(pInfo);
+	EXPECT_STREQ(pInfo->m_pName, "a_cmd");
+
+	// temporary commands are added and removed
+	pConsole->RegisterTemp("temp_cmd", "", CFGFLAG_SERVER, "");
+	pConsole->RegisterTemp("temp_other", "", CFGFLAG_SERVER, "");
+	EXPECT_TRUE(pConsole->GetCommandInfo("temp_cmd", CFGFLAG_SERVER, true));
+	EXPECT_FALSE(pConsole->GetCommandInfo("temp_cmd", CFGFLAG_SERVER, false));
+	std::string Possible;
+	EXPECT_EQ(pConsole->PossibleCommands("temp", CFGFLAG_SERVER, true, CollectPossible, &Possible), 2);
+	EXPECT_EQ(Possible, "temp_cmd;temp_other;");
+	pConsole->DeregisterTemp("temp_cmd");
+	EXPECT_FALSE(pConsole->GetCommandInfo("temp_cmd", CFGFLAG_SERVER, true));
+	EXPECT_TRUE(pConsole->GetCommandInfo("temp_other", CFGFLAG_SERVER, true));
+	pConsole->DeregisterTempAll();
+	EXPECT_FALSE(pConsole->GetCommandInfo("temp_other", CFGFLAG_SERVER, true));
+	EXPECT_TRUE(pConsole->GetCommandInfo("a_cmd", CFGFLAG_SERVER, false));
+}
+
+// run with --gtest_also_run_disabled_tests --gtest_filter=Console.DISABLED_ExecuteBenchmark
+TEST(Console, DISABLED_ExecuteBenchmark)
+{
+	auto pConsole = CreateConsole(CFGFLAG_SERVER);
+
+	// about as many commands as a server with all config variables registered
+	const int NumCommands = 2000;
+	static char s_aaNames[NumCommands][32];
+	int Count = 0;
+	for(int i = 0; i < NumCommands; i++)
+	{
+		str_format(s_aaNames[i], sizeof(s_aaNames[i]), "sv_bench_setting_%d", i);
+		pConsole->Register(s_aaNames[i], "?i", CFGFLAG_SERVER, CountCallback, &Count, "");
+	}
+
+	// a large config, every command once per round
+	const int NumRounds = 50;
+	const int64_t Start = time_get_nanoseconds().count();
+	char aLine[64];
+	for(int Round = 0; Round < NumRounds; Round++)
+	{
+		for(int i = 0; i < NumCommands; i++)
+		{
+			str_format(aLine, sizeof(aLine), "%s 1", s_aaNames[(i * 7919) % NumCommands]);
+			pConsole->ExecuteLine(aLine);
+		}
+	}
+	const int64_t Time = time_get_nanoseconds().count() - Start;
+	EXPECT_EQ(Count, NumRounds * NumCommands);
+
+	dbg_msg("console", "executed %d lines with %d commands registered in %.1fms (%.0f ns per line)", NumRounds * NumCommands, NumCommands, Time / 1e6, (double)Time / (NumRounds * NumCommands));
+}
@@ -58,3 +58,46 @@ TEST(Datafile, ExtendedType)
 		pStorage->RemoveFile(Info.m_aFilename, IStorage::TYPE_SAVE);
 	}
 }
+
+TEST(Datafile, OpenData)
+{
+	auto pStorage = std::unique_ptr<IStorage>(CreateLocalStorage());
+	CTestInfo Info;
+
+	const char aData[] = "some data block";
+	{
+		CDataFileWriter Writer;
+		Writer.Open(pStorage.get(), Info.m_aFilename);
+		int aItem[2] = {1, 2};
+		Writer.AddItem(MAPITEMTYPE_TEST, 0, sizeof(aItem), aItem);
+		Writer.AddData(sizeof(aData), aData);
+		Writer.Finish();
+	}
+
+	void *pFileData;
+	unsigned FileSize;
+	ASSERT_TRUE(pStorage->ReadFile(Info.m_aFilename, IStorage::TYPE_SAVE, &pFileData, &FileSize));
+
+	CDataFileReader FileReader;
+	ASSERT_TRUE(FileReader.Open(pStorage.get(), Info.m_aFilename, IStorage::TYPE_ALL));
+	CDataFileReader Reader;
+	ASSERT_TRUE(Reader.OpenData(pFileData, FileSize));
+
+	EXPECT_EQ(Reader.Sha256(), FileReader.Sha256());
+	EXPECT_EQ(Reader.Crc(), FileReader.Crc());
+	EXPECT_EQ(Reader.NumItems(), FileReader.NumItems());
+	ASSERT_EQ(Reader.NumData(), 1);
+	ASSERT_EQ(Reader.GetDataSize(0), (int)sizeof(aData));
+	EXPECT_STREQ((const char *)Reader.GetData(0), aData);
+	EXPECT_FALSE(Reader.File());
+
+	// the data is owned by the reader, even if it is not a datafile
+	CDataFileReader InvalidReader;
+	EXPECT_FALSE(InvalidReader.OpenData(calloc(8, 1), 8));
+
+	FileReader.Close();
+	if(!HasFailure())
+	{
+		pStorage->RemoveFile(Info.m_aFilename, IStorage::TYPE_SAVE);
+	}
+}
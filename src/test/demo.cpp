@@ -0,0 +1,178 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <memory>
+
+#include <engine/shared/config.h>
+#include <engine/shared/demo.h>
+#include <engine/shared/network.h>
+#include <engine/shared/snapshot.h>
+#include <engine/storage.h>
+#include <test/test.h>
+
+static int CollectIndexFile(const char *pName, int IsDir, int StorageType, void *pUser)
+{
+	if(!IsDir && str_endswith(pName, ".idx"))
+		((std::vector<std::string> *)pUser)->push_back(pName);
+	return 0;
+}
+
+static void RecordTestDemo(IStorage *pStorage, CSnapshotDelta *pSnapshotDelta, int TickStep)
+{
+	unsigned char aMapData[1] = {0};
+	SHA256_DIGEST Sha256 = SHA256_ZEROED;
+	CDemoRecorder Recorder(pSnapshotDelta, true);
+	ASSERT_EQ(Recorder.Start(pStorage, nullptr, "test.demo", "0.6 626fce9a778df4d4", "test", &Sha256, 0, "client", sizeof(aMapData), aMapData), 0);
+
+	// 30 seconds of snapshots with one item holding the tick
+	for(int Tick = 100; Tick < 100 + 30 * SERVER_TICK_SPEED; Tick += TickStep)
+	{
+		CSnapshotBuilder Builder;
+		Builder.Init();
+		int *pItem = (int *)Builder.NewItem(1, 0, sizeof(int));
+		ASSERT_TRUE(pItem);
+		*pItem = Tick;
+		char aData[CSnapshot::MAX_SIZE];
+		Recorder.RecordSnapshot(Tick, aData, Builder.Finish(aData));
+	}
+	ASSERT_EQ(Recorder.Stop(), 0);
+}
+
+class CTestDemoListener : public CDemoPlayer::IListener
+{
+public:
+	int m_LastSnapshotTick = -1;
+
+	void OnDemoPlayerSnapshot(void *pData, int Size) override
+	{
+		const CSnapshot *pSnap = (CSnapshot *)pData;
+		ASSERT_EQ(pSnap->NumItems(), 1);
+		m_LastSnapshotTick = pSnap->GetItem(0)->Data()[0];
+	}
+	void OnDemoPlayerMessage(void *pData, int Size) override {}
+};
+
+TEST(Demo, KeyFrameIndex)
+{
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	auto pStorage = std::unique_ptr<IStorage>(Info.CreateTestStorage());
+	ASSERT_TRUE(pStorage->CreateFolder("demoindex", IStorage::TYPE_SAVE));
+
+	CNetBase::Init();
+	CSnapshotDelta SnapshotDelta;
+	RecordTestDemo(pStorage.get(), &SnapshotDelta, 2);
+
+	// only demo players that enable it write an index
+	std::vector<std::string> vIndexFiles;
+	pStorage->ListDirectory(IStorage::TYPE_SAVE, "demoindex", CollectIndexFile, &vIndexFiles);
+	EXPECT_TRUE(vIndexFiles.empty());
+
+	CDemoPlayer ScannedPlayer(&SnapshotDelta);
+	ScannedPlayer.SetListener(nullptr);
+	ASSERT_EQ(ScannedPlayer.Load(pStorage.get(), nullptr, "test.demo", IStorage::TYPE_SAVE), 0);
+	const CDemoPlayer::CPlaybackInfo ScannedInfo = *ScannedPlayer.Info();
+	EXPECT_EQ(ScannedInfo.m_Info.m_FirstTick, 100);
+	EXPECT_EQ(ScannedInfo.m_Info.m_LastTick, 100 + 30 * SERVER_TICK_SPEED - 2);
+	EXPECT_EQ(ScannedInfo.m_SeekablePoints, 6);
+	ScannedPlayer.Stop();
+	pStorage->ListDirectory(IStorage::TYPE_SAVE, "demoindex", CollectIndexFile, &vIndexFiles);
+	EXPECT_TRUE(vIndexFiles.empty());
+
+	CDemoPlayer WritingPlayer(&SnapshotDelta);
+	WritingPlayer.SetListener(nullptr);
+	WritingPlayer.SetWriteIndex(true);
+	ASSERT_EQ(WritingPlayer.Load(pStorage.get(), nullptr, "test.demo", IStorage::TYPE_SAVE), 0);
+	WritingPlayer.Stop();
+	pStorage->ListDirectory(IStorage::TYPE_SAVE, "demoindex", CollectIndexFile, &vIndexFiles);
+	ASSERT_EQ(vIndexFiles.size(), 1u);
+
+	// load using the index written before
+	CDemoPlayer IndexedPlayer(&SnapshotDelta);
+	IndexedPlayer.SetListener(nullptr);
+	ASSERT_EQ(IndexedPlayer.Load(pStorage.get(), nullptr, "test.demo", IStorage::TYPE_SAVE), 0);
+	const CDemoPlayer::CPlaybackInfo IndexedInfo = *IndexedPlayer.Info();
+	EXPECT_EQ(IndexedInfo.m_Info.m_FirstTick, ScannedInfo.m_Info.m_FirstTick);
+	EXPECT_EQ(IndexedInfo.m_Info.m_LastTick, ScannedInfo.m_Info.m_LastTick);
+	EXPECT_EQ(IndexedInfo.m_SeekablePoints, ScannedInfo.m_SeekablePoints);
+	EXPECT_EQ(IndexedPlayer.SetPos(100 + 12 * SERVER_TICK_SPEED), 0);
+	EXPECT_EQ(IndexedPlayer.Info()->m_NextTick, 100 + 12 * SERVER_TICK_SPEED);
+	IndexedPlayer.Stop();
+}
+
+TEST(Demo, KeyFrameIndexPrune)
+{
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	auto pStorage = std::unique_ptr<IStorage>(Info.CreateTestStorage());
+	ASSERT_TRUE(pStorage->CreateFolder("demoindex", IStorage::TYPE_SAVE));
+
+	// stale index files of other demos
+	for(int i = 0; i < 300; i++)
+	{
+		char aFilename[IO_MAX_PATH_LENGTH];
+		str_format(aFilename, sizeof(aFilename), "demoindex/%03d.idx", i);
+		IOHANDLE File = pStorage->OpenFile(aFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+		ASSERT_TRUE(File);
+		io_close(File);
+	}
+
+	CNetBase::Init();
+	CSnapshotDelta SnapshotDelta;
+	RecordTestDemo(pStorage.get(), &SnapshotDelta, 2);
+
+	CDemoPlayer Player(&SnapshotDelta);
+	Player.SetListener(nullptr);
+	Player.SetWriteIndex(true);
+	ASSERT_EQ(Player.Load(pStorage.get(), nullptr, "test.demo", IStorage::TYPE_SAVE), 0);
+	Player.Stop();
+
+	std::vector<std::string> vIndexFiles;
+	pStorage->ListDirectory(IStorage::TYPE_SAVE, "demoindex", CollectIndexFile, &vIndexFiles);
+	EXPECT_EQ(vIndexFiles.size(), 256u);
+	// the index of the loaded demo is kept
+	EXPECT_EQ(std::count_if(vIndexFiles.begin(), vIndexFiles.end(), [](const std::string &Name) { return Name.size() > str_length("000.idx"); }), 1);
+
+	// too many files for the test storage cleanup
+	for(const std::string &Name : vIndexFiles)
+	{
+		char aFilename[IO_MAX_PATH_LENGTH];
+		str_format(aFilename, sizeof(aFilename), "demoindex/%s", Name.c_str());
+		EXPECT_TRUE(pStorage->RemoveFile(aFilename, IStorage::TYPE_SAVE));
+	}
+}
+
+TEST(Demo, SeekCache)
+{
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	auto pStorage = std::unique_ptr<IStorage>(Info.CreateTestStorage());
+	ASSERT_TRUE(pStorage->CreateFolder("demoindex", IStorage::TYPE_SAVE));
+
+	CNetBase::Init();
+	CSnapshotDelta SnapshotDelta;
+	RecordTestDemo(pStorage.get(), &SnapshotDelta, 1);
+
+	const int SeekCacheSize = g_Config.m_ClDemoSeekCacheSize;
+	g_Config.m_ClDemoSeekCacheSize = 64;
+
+	CTestDemoListener Listener;
+	CDemoPlayer Player(&SnapshotDelta);
+	Player.SetListener(&Listener);
+	ASSERT_EQ(Player.Load(pStorage.get(), nullptr, "test.demo", IStorage::TYPE_SAVE), 0);
+
+	// the first pass fills the cache, seeking back again resumes from it
+	const int aWantedTicks[] = {180, 1000, 1217, 1580, 1217, 530, 531, 529, 1003, 103};
+	for(int Pass = 0; Pass < 2; Pass++)
+	{
+		for(int WantedTick : aWantedTicks)
+		{
+			ASSERT_EQ(Player.SetPos(WantedTick), 0);
+			EXPECT_EQ(Player.Info()->m_NextTick, WantedTick);
+			EXPECT_EQ(Listener.m_LastSnapshotTick, Player.Info()->m_Info.m_CurrentTick);
+			EXPECT_EQ(Player.Info()->m_Info.m_CurrentTick, Player.Info()->m_NextTick - 1);
+		}
+	}
+	Player.Stop();
+
+	g_Config.m_ClDemoSeekCacheSize = SeekCacheSize;
+}
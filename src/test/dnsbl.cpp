@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/server/dnsbl.h>
+
+#include <atomic>
+
+static std::atomic<int> s_NumLookups;
+
+// addresses ending in .66 are listed
+static bool TestLookup(const char *pHostname)
+{
+	s_NumLookups++;
+	return str_startswith(pHostname, "66.") != nullptr;
+}
+
+static NETADDR Addr(const char *pStr)
+{
+	NETADDR Result;
+	EXPECT_EQ(net_addr_from_str(&Result, pStr), 0);
+	return Result;
+}
+
+static bool WaitForResults(CDnsbl *pDnsbl, int64_t Now)
+{
+	const int64_t Timeout = time_get() + time_freq() * 10;
+	while(pDnsbl->NumPending() && time_get() < Timeout)
+	{
+		pDnsbl->Update(Now, 100, 10);
+		thread_yield();
+	}
+	return pDnsbl->NumPending() == 0;
+}
+
+TEST(Dnsbl, CacheAndCoalesce)
+{
+	s_NumLookups = 0;
+	CDnsbl Dnsbl(TestLookup);
+
+	// a connect wave, many clients from few addresses
+	for(int i = 0; i < 100; i++)
+	{
+		char aAddr[32];
+		str_format(aAddr, sizeof(aAddr), "1.2.3.%d:%d", 60 + i % 10, 8303 + i);
+		NETADDR Client = Addr(aAddr);
+		EXPECT_EQ(Dnsbl.Query(&Client, "dnsbl.example", ""), CDnsbl::STATE_PENDING);
+	}
+	EXPECT_EQ(Dnsbl.NumPending(), 10);
+	EXPECT_TRUE(WaitForResults(&Dnsbl, 0));
+	EXPECT_EQ(s_NumLookups, 10);
+
+	NETADDR Listed = Addr("1.2.3.66:1234");
+	NETADDR NotListed = Addr("1.2.3.65:1234");
+	EXPECT_EQ(Dnsbl.State(&Listed), CDnsbl::STATE_LISTED);
+	EXPECT_EQ(Dnsbl.State(&NotListed), CDnsbl::STATE_NOT_LISTED);
+	EXPECT_EQ(Dnsbl.Query(&Listed, "dnsbl.example", ""), CDnsbl::STATE_LISTED);
+	EXPECT_EQ(Dnsbl.Stats().m_Coalesced, 90);
+	EXPECT_EQ(Dnsbl.Stats().m_CacheHits, 1);
+	EXPECT_EQ(Dnsbl.Stats().m_Lookups, 10);
+	EXPECT_EQ(Dnsbl.Stats().m_Batches, 1);
+
+	// not listed results expire first
+	Dnsbl.Update(50, 100, 10);
+	EXPECT_EQ(Dnsbl.State(&Listed), CDnsbl::STATE_LISTED);
+	EXPECT_EQ(Dnsbl.State(&NotListed), CDnsbl::STATE_NONE);
+	Dnsbl.Update(150, 100, 10);
+	EXPECT_EQ(Dnsbl.State(&Listed), CDnsbl::STATE_NONE);
+	EXPECT_EQ(Dnsbl.NumEntries(), 0);
+
+	// ipv6 is not supported
+	NETADDR Ipv6 = Addr("[::1]:8303");
+	EXPECT_EQ(Dnsbl.Query(&Ipv6, "dnsbl.example", ""), CDnsbl::STATE_NONE);
+}
+
+static std::atomic<int> s_NumRunning;
+static std::atomic<int> s_MaxRunning;
+
+// blocks like a slow resolver until a few lookups run at the same time
+static bool SlowLookup(const char *pHostname)
+{
+	const int Running = ++s_NumRunning;
+	int Max = s_MaxRunning;
+	while(Running > Max && !s_MaxRunning.compare_exchange_weak(Max, Running))
+	{
+	}
+	const int64_t Timeout = time_get() + time_freq() * 5;
+	while(s_MaxRunning < 4 && time_get() < Timeout)
+		thread_yield();
+	s_NumRunning--;
+	return false;
+}
+
+TEST(Dnsbl, ConcurrentLookups)
+{
+	s_NumRunning = 0;
+	s_MaxRunning = 0;
+	CDnsbl Dnsbl(SlowLookup);
+	for(int i = 0; i < 8; i++)
+	{
+		char aAddr[32];
+		str_format(aAddr, sizeof(aAddr), "1.2.3.%d:8303", i);
+		NETADDR Client = Addr(aAddr);
+		EXPECT_EQ(Dnsbl.Query(&Client, "dnsbl.example", ""), CDnsbl::STATE_PENDING);
+	}
+	EXPECT_TRUE(WaitForResults(&Dnsbl, 0));
+	EXPECT_GE(s_MaxRunning, 4);
+	EXPECT_EQ(Dnsbl.Stats().m_Batches, 1);
+}
+
+TEST(Dnsbl, ProviderChange)
+{
+	s_NumLookups = 0;
+	CDnsbl Dnsbl(TestLookup);
+
+	NETADDR Listed = Addr("1.2.3.66:1234");
+	EXPECT_EQ(Dnsbl.Query(&Listed, "dnsbl.example", ""), CDnsbl::STATE_PENDING);
+	EXPECT_TRUE(WaitForResults(&Dnsbl, 0));
+	EXPECT_EQ(Dnsbl.State(&Listed), CDnsbl::STATE_LISTED);
+
+	// another key means another answer, the cache is dropped
+	EXPECT_EQ(Dnsbl.Query(&Listed, "dnsbl.example", "key"), CDnsbl::STATE_PENDING);
+	EXPECT_TRUE(Dnsbl.Update(0, 100, 10));
+	EXPECT_TRUE(WaitForResults(&Dnsbl, 0));
+	EXPECT_EQ(Dnsbl.State(&Listed), CDnsbl::STATE_NOT_LISTED);
+	EXPECT_EQ(s_NumLookups, 2);
+}
@@ -0,0 +1,21 @@
+#include <gtest/gtest.h>
+
+#include <engine/shared/econ.h>
+
+TEST(Econ, ParseEvents)
+{
+	unsigned Events = 0;
+	EXPECT_TRUE(CEcon::ParseEvents("join,leave chat", &Events));
+	EXPECT_EQ(Events, (1u << ECON_EVENT_JOIN) | (1u << ECON_EVENT_LEAVE) | (1u << ECON_EVENT_CHAT));
+	EXPECT_TRUE(CEcon::ParseEvents("all", &Events));
+	EXPECT_EQ(Events, (1u << NUM_ECON_EVENTS) - 1);
+	EXPECT_TRUE(CEcon::ParseEvents("none tick", &Events));
+	EXPECT_EQ(Events, 1u << ECON_EVENT_TICK);
+	EXPECT_TRUE(CEcon::ParseEvents("", &Events));
+	EXPECT_EQ(Events, 0u);
+
+	// unknown events leave the subscription unchanged
+	Events = 1u << ECON_EVENT_LOG;
+	EXPECT_FALSE(CEcon::ParseEvents("join,teleport", &Events));
+	EXPECT_EQ(Events, 1u << ECON_EVENT_LOG);
+}
@@ -1,7 +1,12 @@
 #include <gtest/gtest.h>
 
+#include <base/math.h>
+#include <base/system.h>
 #include <engine/shared/json.h>
 
+#include <string>
+#include <vector>
+
 TEST(Json, Escape)
 {
 	char aBuf[128];
@@ -20,3 +25,53 @@ TEST(Json, Escape)
 	EXPECT_STREQ(EscapeJson(aSix, sizeof(aSix), "\x01"), "");
 	EXPECT_STREQ(EscapeJson(aSix, sizeof(aSix), "aaaaaa"), "aaaaa");
 }
+
+static void CollectElement(const char *pKey, const char *pJson, size_t Length, void *pUser)
+{
+	std::vector<std::string> *pvElements = (std::vector<std::string> *)pUser;
+	pvElements->push_back(std::string(pKey) + "=" + std::string(pJson, Length));
+}
+
+static bool SplitJson(const char *pJson, size_t ChunkSize, std::vector<std::string> *pvElements)
+{
+	CJsonArrayStream Stream(CollectElement, pvElements);
+	const size_t Length = str_length(pJson);
+	for(size_t i = 0; i < Length; i += ChunkSize)
+	{
+		if(Stream.Feed(pJson + i, minimum(ChunkSize, Length - i)))
+			return true;
+	}
+	return Stream.Finish();
+}
+
+TEST(Json, ArrayStream)
+{
+	const char *pJson = "{\"a\": [{\"x\": [1, \"]\"]}, \"s\\\"\" , -1.5e3,true,[]], \"skip\": {\"b\": [2]}, \"n\": null, \"e\": []}";
+	const std::vector<std::string> vExpected = {"a={\"x\": [1, \"]\"]}", "a=\"s\\\"\"", "a=-1.5e3", "a=true", "a=[]"};
+	for(size_t ChunkSize = 1; ChunkSize <= (size_t)str_length(pJson); ChunkSize++)
+	{
+		std::vector<std::string> vElements;
+		EXPECT_FALSE(SplitJson(pJson, ChunkSize, &vElements));
+		EXPECT_EQ(vElements, vExpected);
+	}
+
+	CJsonArrayStream Stream(CollectElement, nullptr);
+	const char *pKeys = "{\"a\": [], \"b\": 1}";
+	EXPECT_FALSE(Stream.Feed(pKeys, str_length(pKeys)));
+	EXPECT_FALSE(Stream.Finish());
+	EXPECT_TRUE(Stream.IsArray("a"));
+	EXPECT_TRUE(Stream.HasKey("b"));
+	EXPECT_FALSE(Stream.IsArray("b"));
+	EXPECT_FALSE(Stream.HasKey("c"));
+
+	std::vector<std::string> vElements;
+	EXPECT_FALSE(SplitJson("{}", 1, &vElements));
+	EXPECT_TRUE(SplitJson("", 1, &vElements));
+	EXPECT_TRUE(SplitJson("[]", 1, &vElements));
+	EXPECT_TRUE(SplitJson("{\"a\": [1,]}", 1, &vElements));
+	EXPECT_TRUE(SplitJson("{\"a\": [1 2]}", 1, &vElements));
+	EXPECT_TRUE(SplitJson("{\"a\": [{]]}", 1, &vElements));
+	EXPECT_TRUE(SplitJson("{\"a\" 1}", 1, &vElements));
+	EXPECT_TRUE(SplitJson("{\"a\": 1", 1, &vElements));
+	EXPECT_TRUE(SplitJson("{\"a\": 1} x", 1, &vElements));
+}
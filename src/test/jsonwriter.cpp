@@ -120,6 +120,22 @@ TYPED_TEST(JsonWriters, SpecialCharacters)
 		"}\n");
 }
 
+TYPED_TEST(JsonWriters, Compact)
+{
+	this->Impl.m_pJson->SetCompact(true);
+	this->Impl.m_pJson->BeginObject();
+	this->Impl.m_pJson->WriteAttribute("a");
+	this->Impl.m_pJson->BeginArray();
+	this->Impl.m_pJson->WriteIntValue(1);
+	this->Impl.m_pJson->WriteStrValue("\n");
+	this->Impl.m_pJson->EndArray();
+	this->Impl.m_pJson->WriteAttribute("b");
+	this->Impl.m_pJson->BeginObject();
+	this->Impl.m_pJson->EndObject();
+	this->Impl.m_pJson->EndObject();
+	this->Impl.Expect("{\"a\":[1,\"\\n\"],\"b\":{}}\n");
+}
+
 TYPED_TEST(JsonWriters, HelloWorld)
 {
 	this->Impl.m_pJson->WriteStrValue("hello world");
@@ -0,0 +1,165 @@
+#include <gtest/gtest.h>
+
+#include <base/logger.h>
+#include <base/system.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class CCollectLogger : public ILogger
+{
+public:
+	std::mutex m_Lock;
+	std::vector<std::string> m_vLines;
+	std::vector<std::string> m_vSystems;
+	std::atomic_bool m_Block{false};
+
+	CCollectLogger()
+	{
+		m_Filter.m_MaxLevel.store(LEVEL_DEBUG);
+	}
+	void Log(const CLogMessage *pMessage) override
+	{
+		if(m_Filter.Filters(pMessage))
+			return;
+		while(m_Block)
+			thread_yield();
+		std::unique_lock<std::mutex> Lock(m_Lock);
+		m_vLines.emplace_back(pMessage->Message());
+		m_vSystems.emplace_back(pMessage->m_aSystem);
+	}
+};
+
+TEST(Log, Filters)
+{
+	auto pDebug = std::make_shared<CCollectLogger>();
+	auto pInfo = std::make_shared<CCollectLogger>();
+	pInfo->SetFilter(CLogFilter{LEVEL_INFO});
+	std::unique_ptr<ILogger> pCollection = log_logger_collection({pDebug, pInfo});
+	EXPECT_FALSE(pCollection->Filters(LEVEL_DEBUG));
+	EXPECT_TRUE(pCollection->Filters(LEVEL_TRACE));
+	pDebug->SetFilter(CLogFilter{LEVEL_WARN});
+	EXPECT_TRUE(pCollection->Filters(LEVEL_DEBUG));
+	EXPECT_FALSE(pCollection->Filters(LEVEL_INFO));
+
+	// filtered messages don't reach any logger
+	CLogScope Scope(pCollection.get());
+	log_debug("test", "hidden");
+	log_info("test", "shown");
+	EXPECT_EQ(pInfo->m_vLines, std::vector<std::string>{"shown"});
+	EXPECT_TRUE(pDebug->m_vLines.empty());
+}
+
+TEST(Log, ThreadedOrder)
+{
+	auto pCollect = std::make_shared<CCollectLogger>();
+	{
+		std::unique_ptr<ILogger> pThreaded = log_logger_threaded(pCollect);
+		EXPECT_TRUE(pThreaded->Filters(LEVEL_TRACE));
+		EXPECT_FALSE(pThreaded->Filters(LEVEL_DEBUG));
+
+		const int NumThreads = 4;
+		const int NumMessages = 1000;
+		std::vector<std::thread> vThreads;
+		for(int t = 0; t < NumThreads; t++)
+		{
+			vThreads.emplace_back([t, &pThreaded]() {
+				CLogScope Scope(pThreaded.get());
+				for(int i = 0; i < NumMessages; i++)
+					log_info("thread", "%d %d", t, i);
+				log_trace("thread", "filtered");
+			});
+		}
+		for(auto &Thread : vThreads)
+			Thread.join();
+		// destroying the logger forwards everything left
+	}
+
+	ASSERT_EQ(pCollect->m_vLines.size(), 4000u);
+	int aNext[4] = {0, 0, 0, 0};
+	for(size_t i = 0; i < pCollect->m_vLines.size(); i++)
+	{
+		EXPECT_EQ(pCollect->m_vSystems[i], "thread");
+		int Thread, Message;
+		ASSERT_EQ(sscanf(pCollect->m_vLines[i].c_str(), "%d %d", &Thread, &Message), 2);
+		ASSERT_TRUE(Thread >= 0 && Thread < 4);
+		EXPECT_EQ(Message, aNext[Thread]);
+		aNext[Thread] = Message + 1;
+	}
+}
+
+TEST(Log, ThreadedGlobalOrder)
+{
+	auto pCollect = std::make_shared<CCollectLogger>();
+	{
+		std::unique_ptr<ILogger> pThreaded = log_logger_threaded(pCollect);
+		// the threads take turns, so the counter gives the logging order
+		std::mutex Lock;
+		int Counter = 0;
+		std::vector<std::thread> vThreads;
+		for(int t = 0; t < 4; t++)
+		{
+			vThreads.emplace_back([&]() {
+				CLogScope Scope(pThreaded.get());
+				for(int i = 0; i < 1000; i++)
+				{
+					std::unique_lock<std::mutex> CounterLock(Lock);
+					log_info("thread", "%d", Counter++);
+				}
+			});
+		}
+		for(auto &Thread : vThreads)
+			Thread.join();
+	}
+
+	ASSERT_EQ(pCollect->m_vLines.size(), 4000u);
+	for(size_t i = 0; i < pCollect->m_vLines.size(); i++)
+		EXPECT_EQ(pCollect->m_vLines[i], std::to_string(i));
+}
+
+TEST(Log, ThreadedForwardsErrors)
+{
+	auto pCollect = std::make_shared<CCollectLogger>();
+	std::unique_ptr<ILogger> pThreaded = log_logger_threaded(pCollect);
+	CLogScope Scope(pThreaded.get());
+	for(int i = 0; i < 100; i++)
+		log_info("test", "message %d", i);
+	log_error("test", "error");
+
+	// the error and everything before it is out once log_error returns
+	std::unique_lock<std::mutex> Lock(pCollect->m_Lock);
+	ASSERT_EQ(pCollect->m_vLines.size(), 101u);
+	EXPECT_EQ(pCollect->m_vLines[0], "message 0");
+	EXPECT_EQ(pCollect->m_vLines[100], "error");
+}
+
+TEST(Log, ThreadedDropsWhenFull)
+{
+	auto pCollect = std::make_shared<CCollectLogger>();
+	const int NumMessages = 50000;
+	{
+		std::unique_ptr<ILogger> pThreaded = log_logger_threaded(pCollect);
+		CLogScope Scope(pThreaded.get());
+		// the output hangs, logging must not
+		pCollect->m_Block = true;
+		for(int i = 0; i < NumMessages; i++)
+			log_info("test", "message %d with some text to fill the buffer", i);
+		pCollect->m_Block = false;
+	}
+
+	ASSERT_FALSE(pCollect->m_vLines.empty());
+	EXPECT_LT(pCollect->m_vLines.size(), (size_t)NumMessages);
+	int NumDropped = 0;
+	for(size_t i = 0; i < pCollect->m_vLines.size(); i++)
+	{
+		int Dropped;
+		if(pCollect->m_vSystems[i] == "log" && sscanf(pCollect->m_vLines[i].c_str(), "dropped %d", &Dropped) == 1)
+			NumDropped += Dropped;
+	}
+	EXPECT_GT(NumDropped, 0);
+	// everything is either forwarded or counted as dropped
+	EXPECT_EQ(pCollect->m_vLines.size() - 1 + NumDropped, (size_t)NumMessages);
+}
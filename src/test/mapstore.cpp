@@ -0,0 +1,111 @@
+#include "test.h"
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+
+#include <engine/shared/datafile.h>
+#include <engine/shared/mapstore.h>
+#include <engine/storage.h>
+
+static void WriteTestMap(IStorage *pStorage, const char *pFilename, const std::vector<unsigned char> &vShared, int UniqueSeed)
+{
+	std::vector<unsigned char> vUnique(1000 + UniqueSeed);
+	unsigned Seed = UniqueSeed;
+	for(auto &Value : vUnique)
+	{
+		Seed = Seed * 1103515245 + 12345;
+		Value = Seed >> 24;
+	}
+
+	CDataFileWriter Writer;
+	ASSERT_TRUE(Writer.Open(pStorage, pFilename));
+	int aItem[2] = {UniqueSeed, 0};
+	Writer.AddItem(1, 0, sizeof(aItem), aItem);
+	Writer.AddData(vShared.size(), vShared.data());
+	Writer.AddData(vUnique.size(), vUnique.data());
+	Writer.Finish();
+}
+
+struct SRemoveContext
+{
+	IStorage *m_pStorage;
+	char m_aDir[IO_MAX_PATH_LENGTH];
+};
+
+static int RemoveCallback(const char *pName, int IsDir, int StorageType, void *pUser)
+{
+	SRemoveContext *pContext = (SRemoveContext *)pUser;
+	if(str_comp(pName, ".") == 0 || str_comp(pName, "..") == 0)
+		return 0;
+	SRemoveContext Context = *pContext;
+	str_format(Context.m_aDir, sizeof(Context.m_aDir), "%s/%s", pContext->m_aDir, pName);
+	if(IsDir)
+	{
+		Context.m_pStorage->ListDirectory(IStorage::TYPE_SAVE, Context.m_aDir, RemoveCallback, &Context);
+		Context.m_pStorage->RemoveFolder(Context.m_aDir, IStorage::TYPE_SAVE);
+	}
+	else
+		Context.m_pStorage->RemoveFile(Context.m_aDir, IStorage::TYPE_SAVE);
+	return 0;
+}
+
+TEST(MapStore, Deduplication)
+{
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	auto pStorage = std::unique_ptr<IStorage>(Info.CreateTestStorage());
+	ASSERT_TRUE(pStorage);
+
+	// a tileset shared by both maps
+	std::vector<unsigned char> vShared(64 * 1024);
+	unsigned Seed = 1;
+	for(auto &Value : vShared)
+	{
+		Seed = Seed * 1103515245 + 12345;
+		Value = Seed >> 24;
+	}
+	WriteTestMap(pStorage.get(), "a.map", vShared, 1);
+	WriteTestMap(pStorage.get(), "b.map", vShared, 2);
+
+	CMapStore Store(pStorage.get(), "store", IStorage::TYPE_SAVE);
+	CMapStore::CAddResult ResultA, ResultB, ResultAgain;
+	ASSERT_TRUE(Store.AddMap("a", "a.map", IStorage::TYPE_SAVE, &ResultA));
+	// maps in subdirectories keep their path, like sv_map "dir/b"
+	ASSERT_TRUE(Store.AddMap("dir/b", "b.map", IStorage::TYPE_SAVE, &ResultB));
+	EXPECT_EQ(ResultA.m_NumNewBlocks, ResultA.m_NumBlocks);
+	EXPECT_LT(ResultB.m_NumNewBlocks, ResultB.m_NumBlocks);
+	EXPECT_LT(ResultB.m_NewSize + (int64_t)vShared.size() / 2, ResultB.m_Size);
+	ASSERT_TRUE(Store.AddMap("a", "a.map", IStorage::TYPE_SAVE, &ResultAgain));
+	EXPECT_EQ(ResultAgain.m_NumNewBlocks, 0);
+
+	// restored maps are byte identical
+	for(const char *pName : {"a", "dir/b"})
+	{
+		char aFilename[16];
+		str_format(aFilename, sizeof(aFilename), "%s.map", pName + (str_startswith(pName, "dir/") ? 4 : 0));
+		void *pOriginal;
+		unsigned OriginalSize;
+		ASSERT_TRUE(pStorage->ReadFile(aFilename, IStorage::TYPE_SAVE, &pOriginal, &OriginalSize));
+		void *pRestored;
+		unsigned RestoredSize;
+		EXPECT_TRUE(Store.HasMap(pName));
+		ASSERT_TRUE(Store.ReadMap(pName, &pRestored, &RestoredSize));
+		ASSERT_EQ(RestoredSize, OriginalSize);
+		EXPECT_EQ(mem_comp(pRestored, pOriginal, OriginalSize), 0);
+		free(pRestored);
+		free(pOriginal);
+	}
+	EXPECT_FALSE(Store.HasMap("c"));
+	EXPECT_FALSE(Store.HasMap("b"));
+
+	CMapStore::CStats Stats;
+	Store.GetStats(&Stats);
+	EXPECT_EQ(Stats.m_NumMaps, 2);
+	EXPECT_EQ(Stats.m_MapSize, ResultA.m_Size + ResultB.m_Size);
+	EXPECT_EQ(Stats.m_BlockSize, ResultA.m_NewSize + ResultB.m_NewSize);
+
+	// the store has more files than the test storage cleanup removes
+	SRemoveContext Context = {pStorage.get(), "store"};
+	pStorage->ListDirectory(IStorage::TYPE_SAVE, "store", RemoveCallback, &Context);
+	EXPECT_TRUE(pStorage->RemoveFolder("store", IStorage::TYPE_SAVE));
+}
@@ -0,0 +1,307 @@
+#include "test.h"
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/console.h>
+#include <engine/shared/config.h>
+#include <engine/shared/netban.h>
+#include <engine/storage.h>
+
+#include <memory>
+#include <random>
+#include <vector>
+
+static NETADDR Addr(const char *pStr)
+{
+	NETADDR Result;
+	EXPECT_EQ(net_addr_from_str(&Result, pStr), 0) << pStr;
+	return Result;
+}
+
+static CNetRange Range(const char *pFirst, const char *pLast)
+{
+	CNetRange Result;
+	Result.m_LB = Addr(pFirst);
+	Result.m_UB = Addr(pLast);
+	return Result;
+}
+
+TEST(NetBan, Ranges)
+{
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	auto pStorage = std::unique_ptr<IStorage>(Info.CreateTestStorage());
+	auto pConsole = CreateConsole(CFGFLAG_SERVER);
+	CNetBan NetBan;
+	NetBan.Init(pConsole.get(), pStorage.get());
+
+	char aBuf[256];
+	CNetRange Range1 = Range("10.0.0.5", "10.0.1.200");
+	CNetRange Range2 = Range("[2001:db8::]", "[2001:db8::ffff:ffff]");
+	EXPECT_EQ(NetBan.BanRange(&Range1, 0, "range"), 0);
+	EXPECT_EQ(NetBan.BanRange(&Range2, 60, "range6"), 0);
+	NETADDR Addr1 = Addr("192.168.1.1");
+	EXPECT_EQ(NetBan.BanAddr(&Addr1, 0, "addr"), 0);
+
+	NETADDR Address = Addr("10.0.0.4");
+	EXPECT_FALSE(NetBan.IsBanned(&Address, aBuf, sizeof(aBuf)));
+	Address = Addr("10.0.0.5");
+	EXPECT_TRUE(NetBan.IsBanned(&Address, aBuf, sizeof(aBuf)));
+	Address = Addr("10.0.0.255");
+	EXPECT_TRUE(NetBan.IsBanned(&Address, aBuf, sizeof(aBuf)));
+	Address = Addr("10.0.1.200");
+	EXPECT_TRUE(NetBan.IsBanned(&Address, aBuf, sizeof(aBuf)));
+	Address = Addr("10.0.1.201");
+	EXPECT_FALSE(NetBan.IsBanned(&Address, aBuf, sizeof(aBuf)));
+	Address = Addr("[2001:db8::1234:5678]");
+	EXPECT_TRUE(NetBan.IsBanned(&Address, aBuf, sizeof(aBuf)));
+	Address = Addr("[2001:db8::1:0:0]");
+	EXPECT_FALSE(NetBan.IsBanned(&Address, aBuf, sizeof(aBuf)));
+	EXPECT_TRUE(NetBan.IsBanned(&Addr1, aBuf, sizeof(aBuf)));
+
+	// websocket addresses are checked as ipv4
+	Address = Addr("10.0.0.100");
+	Address.type = NETTYPE_WEBSOCKET_IPV4;
+	EXPECT_TRUE(NetBan.IsBanned(&Address, aBuf, sizeof(aBuf)));
+
+	// overlapping ranges stay banned until the last one is removed
+	CNetRange Range3 = Range("10.0.0.0", "10.0.0.127");
+	EXPECT_EQ(NetBan.BanRange(&Range3, 0, "overlap"), 0);
+	EXPECT_EQ(NetBan.UnbanByRange(&Range1), 0);
+	Address = Addr("10.0.0.100");
+	EXPECT_TRUE(NetBan.IsBanned(&Address, aBuf, sizeof(aBuf)));
+	Address = Addr("10.0.0.200");
+	EXPECT_FALSE(NetBan.IsBanned(&Address, aBuf, sizeof(aBuf)));
+	EXPECT_EQ(NetBan.UnbanByRange(&Range3), 0);
+	Address = Addr("10.0.0.100");
+	EXPECT_FALSE(NetBan.IsBanned(&Address, aBuf, sizeof(aBuf)));
+
+	NetBan.UnbanAll();
+	EXPECT_FALSE(NetBan.IsBanned(&Addr1, aBuf, sizeof(aBuf)));
+}
+
+TEST(NetBan, MostSpecificRange)
+{
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	auto pStorage = std::unique_ptr<IStorage>(Info.CreateTestStorage());
+	auto pConsole = CreateConsole(CFGFLAG_SERVER);
+	CNetBan NetBan;
+	NetBan.Init(pConsole.get(), pStorage.get());
+
+	char aBuf[256];
+	CNetRange Wide = Range("10.0.0.0", "10.255.255.255");
+	CNetRange Narrow = Range("10.1.2.0", "10.1.2.255");
+	EXPECT_EQ(NetBan.BanRange(&Wide, 0, "wide"), 0);
+	EXPECT_EQ(NetBan.BanRange(&Narrow, 0, "narrow"), 0);
+
+	NETADDR Address = Addr("10.1.2.3");
+	ASSERT_TRUE(NetBan.IsBanned(&Address, aBuf, sizeof(aBuf)));
+	EXPECT_TRUE(str_find(aBuf, "narrow")) << aBuf;
+	Address = Addr("10.1.3.3");
+	ASSERT_TRUE(NetBan.IsBanned(&Address, aBuf, sizeof(aBuf)));
+	EXPECT_TRUE(str_find(aBuf, "wide")) << aBuf;
+}
+
+TEST(NetBan, RandomRanges)
+{
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	auto pStorage = std::unique_ptr<IStorage>(Info.CreateTestStorage());
+	auto pConsole = CreateConsole(CFGFLAG_SERVER);
+	CNetBan NetBan;
+	NetBan.Init(pConsole.get(), pStorage.get());
+
+	// compare against a linear scan, addresses are kept in 10.x.x.x so ranges overlap
+	std::mt19937 Rng(1234);
+	auto RandomAddr = [&]() {
+		NETADDR Result = {};
+		Result.type = NETTYPE_IPV4;
+		Result.ip[0] = 10;
+		Result.ip[1] = Rng() % 4;
+		Result.ip[2] = Rng() % 256;
+		Result.ip[3] = Rng() % 256;
+		return Result;
+	};
+
+	std::vector<CNetRange> vRanges;
+	while(vRanges.size() < 300)
+	{
+		CNetRange New;
+		New.m_LB = RandomAddr();
+		New.m_UB = RandomAddr();
+		if(NetComp(&New.m_LB, &New.m_UB) > 0)
+			std::swap(New.m_LB, New.m_UB);
+		if(!New.IsValid())
+			continue;
+		if(NetBan.BanRange(&New, 0, "random") == 0)
+			vRanges.push_back(New);
+	}
+	// drop some to exercise the removal path
+	for(size_t i = 0; i < vRanges.size(); i += 3)
+		EXPECT_EQ(NetBan.UnbanByRange(&vRanges[i]), 0);
+
+	char aBuf[256];
+	for(int i = 0; i < 20000; i++)
+	{
+		NETADDR Address = RandomAddr();
+		bool Expected = false;
+		for(size_t j = 0; j < vRanges.size() && !Expected; j++)
+		{
+			if(j % 3 == 0)
+				continue;
+			Expected = mem_comp(vRanges[j].m_LB.ip, Address.ip, 4) <= 0 && mem_comp(vRanges[j].m_UB.ip, Address.ip, 4) >= 0;
+		}
+		ASSERT_EQ(NetBan.IsBanned(&Address, aBuf, sizeof(aBuf)), Expected);
+	}
+}
+
+// NumRanges disjoint ranges as a plain CIDR list and in the bans_save format
+static void WriteBlocklist(IStorage *pStorage, const char *pFilename, int NumRanges)
+{
+	IOHANDLE File = pStorage->OpenFile(pFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	ASSERT_TRUE(File);
+	char aLine[128];
+	io_write(File, "# blocklist", 11);
+	io_write_newline(File);
+	for(int i = 0; i < NumRanges; i++)
+	{
+		if(i % 2 == 0)
+			str_format(aLine, sizeof(aLine), "%d.%d.%d.0/24", 20 + i / 65536, (i / 256) % 256, i % 256);
+		else
+			str_format(aLine, sizeof(aLine), "ban_range %d.%d.%d.16 %d.%d.%d.99 -1 proxy", 20 + i / 65536, (i / 256) % 256, i % 256, 20 + i / 65536, (i / 256) % 256, i % 256);
+		io_write(File, aLine, str_length(aLine));
+		io_write_newline(File);
+	}
+	io_write(File, "[2001:db8::]/32", 15);
+	io_write_newline(File);
+	io_write(File, "ban 1.2.3.4 -1 spam", 19);
+	io_write_newline(File);
+	io_close(File);
+}
+
+TEST(NetBan, Load)
+{
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	auto pStorage = std::unique_ptr<IStorage>(Info.CreateTestStorage());
+	auto pConsole = CreateConsole(CFGFLAG_SERVER);
+	CNetBan NetBan;
+	NetBan.Init(pConsole.get(), pStorage.get());
+
+	const int NumRanges = 1000;
+	WriteBlocklist(pStorage.get(), "bans.txt", NumRanges);
+	EXPECT_EQ(NetBan.LoadBans("bans.txt", 0, "blocklist"), NumRanges + 2);
+	EXPECT_TRUE(pStorage->RemoveFile("bans.txt", IStorage::TYPE_SAVE));
+
+	char aBuf[256];
+	NETADDR Address = Addr("1.2.3.4");
+	EXPECT_TRUE(NetBan.IsBanned(&Address, aBuf, sizeof(aBuf)));
+	Address = Addr("[2001:db8:1234::1]");
+	EXPECT_TRUE(NetBan.IsBanned(&Address, aBuf, sizeof(aBuf)));
+	Address = Addr("20.0.0.200");
+	EXPECT_TRUE(NetBan.IsBanned(&Address, aBuf, sizeof(aBuf)));
+	Address = Addr("20.0.1.100");
+	EXPECT_FALSE(NetBan.IsBanned(&Address, aBuf, sizeof(aBuf)));
+	Address = Addr("20.0.1.50");
+	EXPECT_TRUE(NetBan.IsBanned(&Address, aBuf, sizeof(aBuf)));
+}
+
+class CRefusingNetBan : public CNetBan
+{
+public:
+	NETADDR m_Refused;
+	int m_NumQuiet = 0;
+
+	int BanAddr(const NETADDR *pAddr, int Seconds, const char *pReason, bool Verbose = true) override
+	{
+		m_NumQuiet += !Verbose;
+		if(net_addr_comp(pAddr, &m_Refused) == 0)
+			return -1;
+		return CNetBan::BanAddr(pAddr, Seconds, pReason, Verbose);
+	}
+};
+
+TEST(NetBan, LoadUsesBanAddr)
+{
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	auto pStorage = std::unique_ptr<IStorage>(Info.CreateTestStorage());
+	auto pConsole = CreateConsole(CFGFLAG_SERVER);
+	CRefusingNetBan NetBan;
+	NetBan.Init(pConsole.get(), pStorage.get());
+	NetBan.m_Refused = Addr("1.2.3.4");
+
+	IOHANDLE File = pStorage->OpenFile("bans.txt", IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	ASSERT_TRUE(File);
+	const char aList[] = "1.2.3.4\n5.6.7.8\n";
+	io_write(File, aList, str_length(aList));
+	io_close(File);
+	EXPECT_EQ(NetBan.LoadBans("bans.txt", 0, "blocklist"), 1);
+	EXPECT_TRUE(pStorage->RemoveFile("bans.txt", IStorage::TYPE_SAVE));
+	EXPECT_EQ(NetBan.m_NumQuiet, 2);
+
+	char aBuf[256];
+	EXPECT_FALSE(NetBan.IsBanned(&NetBan.m_Refused, aBuf, sizeof(aBuf)));
+	NETADDR Address = Addr("5.6.7.8");
+	EXPECT_TRUE(NetBan.IsBanned(&Address, aBuf, sizeof(aBuf)));
+}
+
+TEST(NetBan, PermanentOrder)
+{
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	auto pStorage = std::unique_ptr<IStorage>(Info.CreateTestStorage());
+	auto pConsole = CreateConsole(CFGFLAG_SERVER);
+	CNetBan NetBan;
+	NetBan.Init(pConsole.get(), pStorage.get());
+
+	char aBuf[256];
+	NETADDR First = Addr("1.1.1.1");
+	NETADDR Second = Addr("2.2.2.2");
+	EXPECT_EQ(NetBan.BanAddr(&First, 0, "first"), 0);
+	EXPECT_EQ(NetBan.BanAddr(&Second, 0, "second"), 0);
+	EXPECT_EQ(NetBan.UnbanByIndex(0), 0);
+	EXPECT_FALSE(NetBan.IsBanned(&First, aBuf, sizeof(aBuf)));
+	EXPECT_TRUE(NetBan.IsBanned(&Second, aBuf, sizeof(aBuf)));
+}
+
+// run with --gtest_also_run_disabled_tests --gtest_filter=NetBan.DISABLED_LoadBenchmark
+TEST(NetBan, DISABLED_LoadBenchmark)
+{
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	auto pStorage = std::unique_ptr<IStorage>(Info.CreateTestStorage());
+	auto pConsole = CreateConsole(CFGFLAG_SERVER);
+	CNetBan NetBan;
+	NetBan.Init(pConsole.get(), pStorage.get());
+
+	const int NumRanges = 100000;
+	WriteBlocklist(pStorage.get(), "bans.txt", NumRanges);
+
+	int64_t Start = time_get_nanoseconds().count();
+	EXPECT_EQ(NetBan.LoadBans("bans.txt", 0, "blocklist"), NumRanges + 2);
+	const int64_t LoadTime = time_get_nanoseconds().count() - Start;
+	EXPECT_TRUE(pStorage->RemoveFile("bans.txt", IStorage::TYPE_SAVE));
+
+	char aBuf[256];
+	const int NumLookups = 1000000;
+	std::mt19937 Rng(5678);
+	int Banned = 0;
+	NETADDR Address = Addr("20.0.0.0");
+	Start = time_get_nanoseconds().count();
+	for(int i = 0; i < NumLookups; i++)
+	{
+		const unsigned Value = Rng();
+		Address.ip[0] = 20 + (Value >> 24) % 2;
+		Address.ip[1] = Value >> 16;
+		Address.ip[2] = Value >> 8;
+		Address.ip[3] = Value;
+		Banned += NetBan.IsBanned(&Address, aBuf, sizeof(aBuf));
+	}
+	const int64_t LookupTime = time_get_nanoseconds().count() - Start;
+	EXPECT_GT(Banned, 0);
+	EXPECT_LT(Banned, NumLookups);
+
+	dbg_msg("netban", "loaded %d ranges in %.1fms, %d lookups in %.1fms (%.0f ns per lookup)", NumRanges, LoadTime / 1e6, NumLookups, LookupTime / 1e6, (double)LookupTime / NumLookups);
+}
@@ -1,7 +1,14 @@
 #include <gtest/gtest.h>
+#include <algorithm>
 #include <memory>
+#include <random>
+#include <vector>
 
+#include <base/math.h>
+#include <engine/client/serverbrowser.h>
+#include <engine/client/serverbrowser_http.h>
 #include <engine/client/serverbrowser_ping_cache.h>
+#include <engine/client/serverbrowser_ping_scheduler.h>
 #include <engine/console.h>
 #include <engine/engine.h>
 #include <engine/shared/config.h>
@@ -97,3 +104,347 @@ TEST(ServerBrowser, PingCache)
 	EXPECT_EQ(pPingCache->GetPing(&OtherLocalhost4, 1), 1337);
 	EXPECT_EQ(pPingCache->GetPing(&OtherLocalhost6, 1), 345);
 }
+
+static const char *const SERVER_LIST = R"({"servers": [
+	{"addresses": ["tw-0.6+udp://1.2.3.4:8303", "tw-0.6+udp://[::1]:8303", "unknown://x"], "location": "eu",
+	 "info": {"max_clients": 64, "max_players": 64, "passworded": false, "game_type": "DDraceNetwork", "name": "Server \"1\"",
+	          "map": {"name": "Kobra 4"}, "version": "0.6.4", "clients": [
+	          {"name": "nameless tee", "clan": "", "country": -1, "score": 10, "is_player": true}]}},
+	{"addresses": ["tw-0.6+udp://1.2.3.5:8303"], "info": {"name": "broken info"}},
+	{"addresses": ["tw-0.6+udp://1.2.3.6:8303"], "info": {"max_clients": 16, "max_players": 8, "passworded": true,
+	 "game_type": "DM", "name": "[]{},", "map": {"name": "dm1"}, "version": "0.6.4", "clients": []}}
+], "servers_legacy": ["1.2.3.7:8303"]})";
+
+TEST(ServerBrowser, ServerListParser)
+{
+	const size_t Length = str_length(SERVER_LIST);
+	for(size_t ChunkSize : {(size_t)1, (size_t)7, Length})
+	{
+		CServerListParser Parser;
+		for(size_t i = 0; i < Length; i += ChunkSize)
+			ASSERT_FALSE(Parser.Feed(SERVER_LIST + i, minimum(ChunkSize, Length - i)));
+		ASSERT_FALSE(Parser.Finish());
+
+		// the server with the broken info is skipped
+		ASSERT_EQ(Parser.m_vServers.size(), 2u);
+		const CServerInfo &Server1 = Parser.m_vServers[0];
+		EXPECT_STREQ(Server1.m_aName, "Server \"1\"");
+		EXPECT_STREQ(Server1.m_aMap, "Kobra 4");
+		EXPECT_EQ(Server1.m_Location, CServerInfo::LOC_EUROPE);
+		EXPECT_EQ(Server1.m_NumAddresses, 2);
+		EXPECT_EQ(Server1.m_NumClients, 1);
+		EXPECT_STREQ(Server1.m_aClients[0].m_aName, "nameless tee");
+		const CServerInfo &Server2 = Parser.m_vServers[1];
+		EXPECT_STREQ(Server2.m_aName, "[]{},");
+		EXPECT_EQ(Server2.m_Location, CServerInfo::LOC_UNKNOWN);
+		EXPECT_EQ(Server2.m_Flags & SERVER_FLAG_PASSWORD, SERVER_FLAG_PASSWORD);
+
+		ASSERT_EQ(Parser.m_vLegacyServers.size(), 1u);
+		NETADDR Legacy;
+		ASSERT_FALSE(net_addr_from_str(&Legacy, "1.2.3.7:8303"));
+		EXPECT_EQ(net_addr_comp(&Parser.m_vLegacyServers[0], &Legacy), 0);
+	}
+
+	// malformed lists are rejected as a whole
+	const char *apBroken[] = {
+		R"({"servers": {}})",
+		R"({"servers_legacy": []})",
+		R"({"servers": [], "servers_legacy": "1.2.3.4:8303"})",
+		R"({"servers": [], "servers_legacy": ["not an address"]})",
+		R"({"servers": [{"addresses": "tw-0.6+udp://1.2.3.4:8303"}]})",
+		R"({"servers": [{"addresses": [], "location": "xx"}]})",
+		R"({"servers": [{"addresses": [], "info": {]}}]})",
+		R"({"servers": [])",
+	};
+	for(const char *pBroken : apBroken)
+	{
+		CServerListParser Parser;
+		EXPECT_TRUE(Parser.Feed(pBroken, str_length(pBroken)) || Parser.Finish()) << pBroken;
+	}
+}
+
+// mock servers for the ping scheduler, times are in milliseconds
+struct CMockServers
+{
+	enum
+	{
+		NUM_SERVERS = 2000,
+		// packets beyond this per tick are dropped by the link
+		LINK_BURST = 50,
+	};
+
+	struct CAnswer
+	{
+		int m_Id;
+		int64_t m_Time;
+	};
+
+	std::mt19937 m_Rng{42};
+	std::vector<int> m_vRtt; // -1 for servers that never answer
+	std::vector<CAnswer> m_vAnswers;
+	std::vector<int> m_vFirstSends;
+	std::vector<bool> m_vSent;
+	int64_t m_Now = 0;
+	int m_SentThisTick = 0;
+
+	CMockServers()
+	{
+		for(int i = 0; i < NUM_SERVERS; i++)
+			m_vRtt.push_back(m_Rng() % 10 == 0 ? -1 : 20 + m_Rng() % 280);
+		m_vSent.resize(NUM_SERVERS);
+	}
+
+	static bool Send(int Id, void *pUser)
+	{
+		CMockServers *pThis = (CMockServers *)pUser;
+		if(!pThis->m_vSent[Id])
+		{
+			pThis->m_vSent[Id] = true;
+			pThis->m_vFirstSends.push_back(Id);
+		}
+		if(pThis->m_vRtt[Id] >= 0 && pThis->m_SentThisTick++ < LINK_BURST)
+			pThis->m_vAnswers.push_back({Id, pThis->m_Now + pThis->m_vRtt[Id]});
+		return true;
+	}
+
+	// returns the time it took to get all answers
+	int64_t Run(CServerBrowserPingScheduler *pScheduler)
+	{
+		while(pScheduler->NumPending() && m_Now < 120000)
+		{
+			m_Now += 10;
+			m_SentThisTick = 0;
+			for(size_t i = 0; i < m_vAnswers.size();)
+			{
+				if(m_vAnswers[i].m_Time > m_Now)
+				{
+					i++;
+					continue;
+				}
+				pScheduler->Answered(m_vAnswers[i].m_Id);
+				m_vAnswers[i] = m_vAnswers.back();
+				m_vAnswers.pop_back();
+			}
+			pScheduler->Update(m_Now, 1000, Send, this);
+		}
+		return m_Now;
+	}
+};
+
+TEST(ServerBrowser, PingScheduler)
+{
+	CMockServers Servers;
+	CServerBrowserPingScheduler Scheduler;
+	Scheduler.Reset(100);
+	int NumDead = 0;
+	for(int i = 0; i < CMockServers::NUM_SERVERS; i++)
+	{
+		Scheduler.Queue(i, i % 20 == 0 ? CServerBrowserPingScheduler::PRIORITY_HIGH : CServerBrowserPingScheduler::PRIORITY_NORMAL);
+		NumDead += Servers.m_vRtt[i] < 0;
+	}
+	// queueing twice doesn't add another request
+	Scheduler.Queue(0);
+	EXPECT_EQ(Scheduler.NumPending(), CMockServers::NUM_SERVERS);
+	// only unsent requests can be moved ahead
+	Scheduler.SetPriority(1, CServerBrowserPingScheduler::PRIORITY_HIGH);
+
+	const int64_t Time = Servers.Run(&Scheduler);
+	EXPECT_EQ(Scheduler.NumPending(), 0);
+	EXPECT_EQ(Scheduler.NumInFlight(), 0);
+	EXPECT_EQ(Scheduler.NumLost(), NumDead);
+	EXPECT_LT(Time, 60000);
+
+	// high priority servers are requested first
+	ASSERT_EQ(Servers.m_vFirstSends.size(), (size_t)CMockServers::NUM_SERVERS);
+	for(int i = 0; i < CMockServers::NUM_SERVERS / 20 + 1; i++)
+		EXPECT_TRUE(Servers.m_vFirstSends[i] % 20 == 0 || Servers.m_vFirstSends[i] == 1) << i;
+
+	// answers for unknown or finished requests are ignored
+	EXPECT_FALSE(Scheduler.Answered(0));
+	EXPECT_FALSE(Scheduler.Answered(CMockServers::NUM_SERVERS + 1));
+}
+
+static bool RecordSend(int Id, void *pUser)
+{
+	((std::vector<int> *)pUser)->push_back(Id);
+	return true;
+}
+
+TEST(ServerBrowser, PingSchedulerGroups)
+{
+	CServerBrowserPingScheduler Scheduler;
+	std::vector<int> vSent;
+
+	// one request per group is sent, the answer finishes the others
+	Scheduler.Reset(10);
+	Scheduler.Queue(0, CServerBrowserPingScheduler::PRIORITY_NORMAL, 7);
+	Scheduler.Queue(1, CServerBrowserPingScheduler::PRIORITY_NORMAL, 7);
+	Scheduler.Queue(2, CServerBrowserPingScheduler::PRIORITY_HIGH, 7);
+	Scheduler.Queue(3);
+	Scheduler.Update(0, 1000, RecordSend, &vSent);
+	EXPECT_EQ(vSent, std::vector<int>({2, 3}));
+	EXPECT_EQ(Scheduler.NumPending(), 4);
+	EXPECT_TRUE(Scheduler.Answered(2));
+	EXPECT_EQ(Scheduler.NumPending(), 1);
+	Scheduler.Update(10, 1000, RecordSend, &vSent);
+	EXPECT_EQ(vSent.size(), 2u);
+	EXPECT_FALSE(Scheduler.Answered(0));
+
+	// a request that is given up passes the group on
+	vSent.clear();
+	Scheduler.Reset(10);
+	Scheduler.Queue(0, CServerBrowserPingScheduler::PRIORITY_NORMAL, 5);
+	Scheduler.Queue(1, CServerBrowserPingScheduler::PRIORITY_NORMAL, 5);
+	for(int64_t Now = 0; Now <= 5000; Now += 500)
+	{
+		Scheduler.Update(Now, 1000, RecordSend, &vSent);
+		if(vSent.size() == 2)
+		{
+			EXPECT_EQ(Scheduler.Attempts(0), 2);
+		}
+	}
+	EXPECT_EQ(vSent, std::vector<int>({0, 0, 0, 1}));
+	EXPECT_EQ(Scheduler.NumLost(), 1);
+	EXPECT_EQ(Scheduler.Attempts(1), 1);
+	EXPECT_TRUE(Scheduler.Answered(1));
+	EXPECT_EQ(Scheduler.NumPending(), 0);
+
+	// queueing again after the answer asks for a new one
+	vSent.clear();
+	Scheduler.Queue(0, CServerBrowserPingScheduler::PRIORITY_NORMAL, 5);
+	Scheduler.Update(7000, 1000, RecordSend, &vSent);
+	EXPECT_EQ(vSent, std::vector<int>({0}));
+}
+
+TEST(ServerBrowser, PingCacheFlush)
+{
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+
+	auto pConsole = CreateConsole(CFGFLAG_CLIENT);
+	auto pStorage = std::unique_ptr<IStorage>(Info.CreateTestStorage());
+	auto pPingCache = std::unique_ptr<IServerBrowserPingCache>(CreateServerBrowserPingCache(pConsole.get(), pStorage.get()));
+
+	const int NumPings = 1000;
+	for(int i = 0; i < NumPings; i++)
+	{
+		NETADDR Addr;
+		char aAddr[32];
+		str_format(aAddr, sizeof(aAddr), "10.0.%d.%d:8303", i / 256, i % 256);
+		ASSERT_FALSE(net_addr_from_str(&Addr, aAddr));
+		pPingCache->CachePing(Addr, i % 999);
+	}
+	EXPECT_EQ(pPingCache->NumEntries(), NumPings);
+
+	// nothing is on disk before the flush
+	{
+		auto pOther = std::unique_ptr<IServerBrowserPingCache>(CreateServerBrowserPingCache(pConsole.get(), pStorage.get()));
+		pOther->Load();
+		EXPECT_EQ(pOther->NumEntries(), 0);
+	}
+
+	// all pings are written at once
+	pPingCache->Flush();
+	auto pOther = std::unique_ptr<IServerBrowserPingCache>(CreateServerBrowserPingCache(pConsole.get(), pStorage.get()));
+	pOther->Load();
+	EXPECT_EQ(pOther->NumEntries(), NumPings);
+	NETADDR Last;
+	ASSERT_FALSE(net_addr_from_str(&Last, "10.0.3.231:8303"));
+	EXPECT_EQ(pOther->GetPing(&Last, 1), (NumPings - 1) % 999);
+}
+
+TEST(ServerBrowser, QuickSearch)
+{
+	CServerInfo Info = {};
+	str_copy(Info.m_aName, "My DDNet Server");
+	str_copy(Info.m_aMap, "Tutorial");
+	str_copy(Info.m_aGameType, "DDraceNetwork");
+	Info.m_NumClients = 2;
+	str_copy(Info.m_aClients[0].m_aName, "nameless tee");
+	str_copy(Info.m_aClients[0].m_aClan, "Clan");
+	str_copy(Info.m_aClients[1].m_aName, "(connecting)");
+	CServerBrowser::CSearchKeys Keys;
+	CServerBrowser::FillSearchKeys(Info, Keys);
+
+	// case is ignored unless the token is quoted
+	CServerBrowser::CFilterContext Context;
+	Context.Init("ddnet", "", "");
+	EXPECT_TRUE(Context.m_HasFilter);
+	EXPECT_EQ(CServerBrowser::QuickSearchHit(Info, Keys, Context, false), IServerBrowser::QUICK_SERVERNAME);
+	Context.Init("TUTORIAL;clan", "", "");
+	EXPECT_EQ(CServerBrowser::QuickSearchHit(Info, Keys, Context, false), IServerBrowser::QUICK_MAPNAME | IServerBrowser::QUICK_PLAYER);
+	Context.Init("\"Tutorial\"", "", "");
+	EXPECT_EQ(CServerBrowser::QuickSearchHit(Info, Keys, Context, false), IServerBrowser::QUICK_MAPNAME);
+	Context.Init("\"tutorial\"", "", "");
+	EXPECT_EQ(CServerBrowser::QuickSearchHit(Info, Keys, Context, false), 0);
+	Context.Init("\"Clan\"", "", "");
+	EXPECT_EQ(CServerBrowser::QuickSearchHit(Info, Keys, Context, false), IServerBrowser::QUICK_PLAYER);
+
+	// connecting players only match if they are not filtered
+	Context.Init("connecting", "", "");
+	EXPECT_EQ(CServerBrowser::QuickSearchHit(Info, Keys, Context, false), IServerBrowser::QUICK_PLAYER);
+	EXPECT_EQ(CServerBrowser::QuickSearchHit(Info, Keys, Context, true), 0);
+
+	// excludes match the name, map and gametype
+	Context.Init("", "race", "");
+	EXPECT_FALSE(Context.m_HasFilter);
+	EXPECT_TRUE(CServerBrowser::Excluded(Info, Keys, Context));
+	Context.Init("", "\"DDNet\";nameless", "");
+	EXPECT_FALSE(CServerBrowser::Excluded(Info, Keys, Context));
+	Context.Init("", "other;\"Tutorial\"", "");
+	EXPECT_TRUE(CServerBrowser::Excluded(Info, Keys, Context));
+
+	Context.Init("", "", "DDRace");
+	EXPECT_EQ(Context.m_GameType, "ddrace");
+}
+
+static std::vector<int> SortedIndices(const std::vector<CServerBrowser::CSortKey> &vKeys)
+{
+	std::vector<int> vIndices;
+	for(const auto &Key : vKeys)
+		vIndices.push_back(Key.m_Index);
+	return vIndices;
+}
+
+TEST(ServerBrowser, SortKeys)
+{
+	// by ping, equal pings keep their order
+	std::mt19937 Rng(1234);
+	std::vector<CServerBrowser::CSortKey> vKeys(1000);
+	for(int i = 0; i < (int)vKeys.size(); i++)
+		vKeys[i] = {i, (int)(Rng() % 300), 0, nullptr};
+	auto Expected = [](std::vector<CServerBrowser::CSortKey> vSorted, bool Descending) {
+		std::stable_sort(vSorted.begin(), vSorted.end(), [&](const CServerBrowser::CSortKey &Key1, const CServerBrowser::CSortKey &Key2) {
+			return Descending ? Key2.m_Key1 < Key1.m_Key1 : Key1.m_Key1 < Key2.m_Key1;
+		});
+		return SortedIndices(vSorted);
+	};
+
+	std::vector<int> vExpected = Expected(vKeys, false);
+	CServerBrowser::SortKeys(vKeys, IServerBrowser::SORT_PING, 0, -1);
+	EXPECT_EQ(SortedIndices(vKeys), vExpected);
+
+	// a few and many changed pings, sorted incrementally and fully
+	for(int NumChanged : {5, 500})
+	{
+		for(int i = 0; i < NumChanged; i++)
+			vKeys[Rng() % vKeys.size()].m_Key1 = Rng() % 300;
+		vExpected = Expected(vKeys, false);
+		CServerBrowser::SortKeys(vKeys, IServerBrowser::SORT_PING, 0, NumChanged);
+		EXPECT_EQ(SortedIndices(vKeys), vExpected) << NumChanged;
+	}
+
+	vExpected = Expected(vKeys, true);
+	CServerBrowser::SortKeys(vKeys, IServerBrowser::SORT_PING, 1, -1);
+	EXPECT_EQ(SortedIndices(vKeys), vExpected);
+
+	// by name, case sensitive, servers without info last
+	std::vector<CServerBrowser::CSortKey> vNames = {{0, 1, 0, "a"}, {1, 0, 0, "b"}, {2, 0, 0, "B"}, {3, 0, 0, "a"}};
+	CServerBrowser::SortKeys(vNames, IServerBrowser::SORT_NAME, 0, -1);
+	EXPECT_EQ(SortedIndices(vNames), std::vector<int>({2, 3, 1, 0}));
+
+	// players within a ping range of 100ms, lower ranges first, empty servers last
+	std::vector<CServerBrowser::CSortKey> vPlayers = {{0, 0, 10, nullptr}, {1, 8, 250, nullptr}, {2, 3, 40, nullptr}, {3, 5, 50, nullptr}};
+	CServerBrowser::SortKeys(vPlayers, IServerBrowser::SORT_NUMPLAYERS, 2, -1);
+	EXPECT_EQ(SortedIndices(vPlayers), std::vector<int>({3, 2, 1, 0}));
+}
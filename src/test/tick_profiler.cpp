@@ -0,0 +1,112 @@
+#include "test.h"
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/shared/tick_profiler.h>
+#include <engine/storage.h>
+
+#include <cstdlib>
+#include <memory>
+
+static int64_t Microseconds(int64_t Us)
+{
+	return Us * time_freq() / 1000000;
+}
+
+static int CountLines(IStorage *pStorage, const char *pFilename)
+{
+	char *pData = pStorage->ReadFileStr(pFilename, IStorage::TYPE_SAVE);
+	if(!pData)
+		return -1;
+	int Lines = 0;
+	for(const char *p = pData; *p; p++)
+		Lines += *p == '\n';
+	free(pData);
+	return Lines;
+}
+
+TEST(TickProfiler, Histogram)
+{
+	CTickProfiler Profiler;
+	for(int i = 0; i < 98; i++)
+		Profiler.Add(PROFILE_GAME, Microseconds(1));
+	Profiler.Add(PROFILE_GAME, Microseconds(1000));
+	Profiler.Add(PROFILE_GAME, Microseconds(1000));
+
+	const CTickProfiler::CPhase &Stats = Profiler.Phase(PROFILE_GAME);
+	EXPECT_EQ(Stats.m_Count, 100);
+	EXPECT_EQ(Stats.m_TimeSum, 98 + 2000);
+	EXPECT_EQ(Stats.m_TimeMax, 1000);
+	EXPECT_EQ(Profiler.Percentile(PROFILE_GAME, 50), 2);
+	EXPECT_EQ(Profiler.Percentile(PROFILE_GAME, 99), 1000);
+	EXPECT_EQ(Profiler.Percentile(PROFILE_SNAPSHOT, 99), 0);
+	EXPECT_STREQ(CTickProfiler::PhaseName(PROFILE_GAME), "game");
+
+	Profiler.Reset();
+	EXPECT_EQ(Profiler.Phase(PROFILE_GAME).m_Count, 0);
+}
+
+TEST(TickProfiler, Interval)
+{
+	CTickProfiler Profiler;
+	Profiler.Add(PROFILE_TICK, Microseconds(10));
+	Profiler.Add(PROFILE_TICK, Microseconds(30));
+
+	const CTickProfiler::CInterval &Ticks = Profiler.Interval(PROFILE_TICK);
+	EXPECT_EQ(Ticks.m_Count, 2);
+	EXPECT_EQ(Ticks.m_TimeSum, 40);
+	EXPECT_EQ(Ticks.m_TimeMax, 30);
+
+	// the totals are reset separately
+	Profiler.Reset();
+	EXPECT_EQ(Profiler.Interval(PROFILE_TICK).m_Count, 2);
+	Profiler.Add(PROFILE_TICK, Microseconds(5));
+	Profiler.ResetInterval();
+	EXPECT_EQ(Profiler.Interval(PROFILE_TICK).m_Count, 0);
+	EXPECT_EQ(Profiler.Phase(PROFILE_TICK).m_Count, 1);
+}
+
+TEST(TickProfiler, Scope)
+{
+	CTickProfiler Profiler;
+	{
+		CProfileScope Profile(&Profiler, PROFILE_TICK);
+	}
+	EXPECT_EQ(Profiler.Phase(PROFILE_TICK).m_Count, 0);
+
+	Profiler.SetEnabled(true);
+	{
+		CProfileScope Profile(&Profiler, PROFILE_TICK);
+		CProfileScope Nested(&Profiler, PROFILE_GAME);
+	}
+	EXPECT_EQ(Profiler.Phase(PROFILE_TICK).m_Count, 1);
+	EXPECT_EQ(Profiler.Phase(PROFILE_GAME).m_Count, 1);
+}
+
+TEST(TickProfiler, CsvRolls)
+{
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	std::unique_ptr<IStorage> pStorage(Info.CreateTestStorage());
+	ASSERT_TRUE(pStorage);
+	{
+		CTickProfiler Profiler;
+		Profiler.SetEnabled(true);
+		for(int Tick = 1; Tick <= 3; Tick++)
+		{
+			Profiler.Add(PROFILE_NETWORK, Microseconds(Tick));
+			Profiler.WriteCsvRow(pStorage.get(), "profile.csv", 2, Tick);
+		}
+		// the file is closed when disabling
+		Profiler.SetEnabled(false);
+	}
+
+	// header and rows
+	EXPECT_EQ(CountLines(pStorage.get(), "profile.csv.old"), 3);
+	EXPECT_EQ(CountLines(pStorage.get(), "profile.csv"), 2);
+	char *pData = pStorage->ReadFileStr("profile.csv", IStorage::TYPE_SAVE);
+	ASSERT_TRUE(pData);
+	EXPECT_TRUE(str_startswith(pData, "time,tick,network_count,network_avg_us,network_max_us,"));
+	EXPECT_TRUE(str_find(pData, ",3,1,3,3,"));
+	free(pData);
+}
@@ -1,207 +1,624 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #include <base/logger.h>
+#include <base/math.h>
 #include <base/system.h>
 
+#include <engine/shared/linereader.h>
+
+#include <chrono>
 #include <cstdlib>
-#include <iterator> // std::size
+#include <limits>
+#include <map>
+#include <random>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+enum
+{
+	DIR_UP = 0, // client to server
+	DIR_DOWN, // server to client
+	NUM_DIRS,
+};
+
+static const char *const gs_apDirNames[NUM_DIRS] = {"up", "down"};
+
+enum
+{
+	DISTRIBUTION_UNIFORM = 0,
+	DISTRIBUTION_NORMAL,
+	DISTRIBUTION_PARETO,
+};
+
+// impairment of one direction, times in milliseconds and chances in percent
+struct SImpairment
+{
+	int m_Latency = 0;
+	int m_Jitter = 0;
+	int m_Distribution = DISTRIBUTION_UNIFORM;
+	int m_Spike = 0;
+	float m_SpikeChance = 0.0f;
+	float m_Loss = 0.0f;
+	float m_BurstChance = 0.0f;
+	int m_BurstLength = 5;
+	float m_Reorder = 0.0f;
+	int m_Bandwidth = 0; // kbit/s, 0 for unlimited
+	int m_Queue = 1000; // packets that would wait longer for the bandwidth are dropped
+};
 
-#include <thread>
+struct SPhase
+{
+	int m_Seconds = 0;
+	SImpairment m_aDirs[NUM_DIRS];
+};
 
 struct SPacket
 {
-	SPacket *m_pPrev;
 	SPacket *m_pNext;
 
 	NETADDR m_SendTo;
-	int64_t m_Timestamp;
+	NETADDR m_Client; // the client whose session the packet belongs to
+	int64_t m_ReceiveTime; // microseconds
+	int64_t m_DueTime;
 	int m_ID;
+	int m_Dir;
 	int m_DataSize;
-	char m_aData[1];
+	unsigned char m_aData[1];
 };
 
-static SPacket *g_pFirst = (SPacket *)0;
-static SPacket *g_pLast = (SPacket *)0;
-static int g_CurrentLatency = 0;
-
-struct SPingConfig
+// Packets sorted into 1 ms slots by their due time, so queueing and sending
+// are O(1) no matter how many packets are delayed. Packets more than a wheel
+// turn ahead stay in their slot until their turn comes.
+class CTimeWheel
 {
-	int m_Base;
-	int m_Flux;
-	int m_Spike;
-	int m_Loss;
-	int m_Delay;
-	int m_DelayFreq;
+	enum
+	{
+		NUM_SLOTS = 4096,
+	};
+
+	struct SSlot
+	{
+		SPacket *m_pFirst = nullptr;
+		SPacket *m_pLast = nullptr;
+	};
+
+	SSlot m_aSlots[NUM_SLOTS];
+	int64_t m_CurrentSlot = -1;
+	int64_t m_FirstSlot = std::numeric_limits<int64_t>::max();
+	int m_NumPackets = 0;
+
+	void Append(SPacket *pPacket)
+	{
+		SSlot &Slot = m_aSlots[(pPacket->m_DueTime / 1000) % NUM_SLOTS];
+		pPacket->m_pNext = nullptr;
+		if(Slot.m_pLast)
+			Slot.m_pLast->m_pNext = pPacket;
+		else
+			Slot.m_pFirst = pPacket;
+		Slot.m_pLast = pPacket;
+	}
+
+public:
+	int NumPackets() const { return m_NumPackets; }
+
+	void Insert(SPacket *pPacket)
+	{
+		// late packets go to the next slot that is processed
+		if(m_CurrentSlot >= 0)
+			pPacket->m_DueTime = maximum(pPacket->m_DueTime, m_CurrentSlot * 1000);
+		else
+			m_FirstSlot = minimum(m_FirstSlot, pPacket->m_DueTime / 1000);
+		Append(pPacket);
+		m_NumPackets++;
+	}
+
+	template<typename F>
+	void Advance(int64_t Now, F &&Send)
+	{
+		const int64_t NowSlot = Now / 1000;
+		if(m_CurrentSlot < 0)
+			m_CurrentSlot = minimum(NowSlot, m_FirstSlot);
+		else if(NowSlot - m_CurrentSlot >= NUM_SLOTS)
+			m_CurrentSlot = NowSlot - NUM_SLOTS + 1;
+		for(; m_CurrentSlot <= NowSlot; m_CurrentSlot++)
+		{
+			SSlot &Slot = m_aSlots[m_CurrentSlot % NUM_SLOTS];
+			SPacket *pPacket = Slot.m_pFirst;
+			Slot = SSlot();
+			while(pPacket)
+			{
+				SPacket *pNext = pPacket->m_pNext;
+				if(pPacket->m_DueTime / 1000 <= NowSlot)
+				{
+					m_NumPackets--;
+					Send(pPacket);
+				}
+				else
+					Append(pPacket);
+				pPacket = pNext;
+			}
+		}
+	}
 };
 
-static SPingConfig g_aConfigPings[] = {
-	// base flux spike loss delay delayfreq
-	{0, 0, 0, 0, 0, 0},
-	{40, 20, 100, 0, 0, 0},
-	{140, 40, 200, 0, 0, 0},
+struct SStats
+{
+	int m_Received = 0;
+	int m_Sent = 0;
+	int64_t m_SentBytes = 0;
+	int m_Lost = 0;
+	int m_BurstLost = 0;
+	int m_QueueDropped = 0;
+	int m_Reordered = 0;
+	int64_t m_LatencySum = 0;
+	int64_t m_LatencyMin = -1;
+	int64_t m_LatencyMax = 0;
 };
 
-static int g_ConfigNumpingconfs = std::size(g_aConfigPings);
-static int g_ConfigInterval = 10; // seconds between different pingconfigs
-static int g_ConfigLog = 0;
-static int g_ConfigReorder = 0;
+struct SDirectionState
+{
+	int64_t m_LastDueTime = 0;
+	int64_t m_NextFreeTime = 0;
+	int m_BurstLeft = 0;
+	SStats m_Stats;
+};
 
-void Run(unsigned short Port, NETADDR Dest)
+class CCrapnet
 {
-	NETADDR Src = {NETTYPE_IPV4, {0, 0, 0, 0}, Port};
-	NETSOCKET Socket = net_udp_create(Src);
+	enum
+	{
+		SESSION_TIMEOUT = 60, // seconds
+	};
 
-	int ID = 0;
-	int Delaycounter = 0;
+	// every client talks to the server through a socket of its own, so
+	// replies can be routed back by the socket they arrive on
+	struct SSession
+	{
+		NETSOCKET m_Socket;
+		int64_t m_LastActive;
+	};
 
-	while(true)
+	struct SAddrLess
 	{
-		static int s_Lastcfg = 0;
-		int n = ((time_get() / time_freq()) / g_ConfigInterval) % g_ConfigNumpingconfs;
-		SPingConfig Ping = g_aConfigPings[n];
+		bool operator()(const NETADDR &A, const NETADDR &B) const { return net_addr_comp(&A, &B) < 0; }
+	};
 
-		if(n != s_Lastcfg)
-			dbg_msg("crapnet", "cfg = %d", n);
-		s_Lastcfg = n;
+	std::vector<SPhase> m_vPhases;
+	int m_StatsInterval;
+	bool m_Verbose;
 
-		// handle incoming packets
-		while(true)
-		{
-			// fetch data
-			int DataTrash = 0;
-			NETADDR From;
-			unsigned char *pData;
-			int Bytes = net_udp_recv(Socket, &From, &pData);
-			if(Bytes <= 0)
-				break;
+	std::mt19937 m_Random;
+	SDirectionState m_aDirs[NUM_DIRS];
+	CTimeWheel m_Wheel;
+	std::map<NETADDR, SSession, SAddrLess> m_Sessions;
+
+	bool Chance(float Percent)
+	{
+		return Percent > 0.0f && std::uniform_real_distribution<float>(0.0f, 100.0f)(m_Random) < Percent;
+	}
 
-			if((rand() % 100) < Ping.m_Loss) // drop the packet
+	int64_t SampleDelay(const SImpairment &Impairment)
+	{
+		double Delay = Impairment.m_Latency;
+		if(Impairment.m_Jitter > 0)
+		{
+			if(Impairment.m_Distribution == DISTRIBUTION_NORMAL)
+				Delay += std::normal_distribution<double>(0.0, Impairment.m_Jitter)(m_Random);
+			else if(Impairment.m_Distribution == DISTRIBUTION_PARETO)
 			{
-				if(g_ConfigLog)
-					dbg_msg("crapnet", "dropped packet");
-				continue;
+				// heavy tail with the jitter as mean, capped to keep single packets from stalling forever
+				const double Uniform = std::uniform_real_distribution<double>(0.0001, 1.0)(m_Random);
+				Delay += minimum(Impairment.m_Jitter * (1.0 / std::sqrt(Uniform) - 1.0), Impairment.m_Jitter * 20.0);
 			}
+			else
+				Delay += std::uniform_real_distribution<double>(0.0, Impairment.m_Jitter)(m_Random);
+		}
+		if(Chance(Impairment.m_SpikeChance))
+			Delay += Impairment.m_Spike;
+		return (int64_t)(maximum(Delay, 0.0) * 1000.0);
+	}
 
-			// create new packet
-			SPacket *p = (SPacket *)malloc(sizeof(SPacket) + Bytes);
+	// returns false if the packet is dropped
+	bool Schedule(SPacket *pPacket, const SImpairment &Impairment)
+	{
+		SDirectionState &Dir = m_aDirs[pPacket->m_Dir];
+		const int64_t Now = pPacket->m_ReceiveTime;
 
-			if(net_addr_comp(&From, &Dest) == 0)
-				p->m_SendTo = Src; // from the server
-			else
-			{
-				Src = From; // from the client
-				p->m_SendTo = Dest;
-			}
+		if(Dir.m_BurstLeft > 0)
+		{
+			Dir.m_BurstLeft--;
+			Dir.m_Stats.m_BurstLost++;
+			return false;
+		}
+		if(Chance(Impairment.m_BurstChance))
+		{
+			Dir.m_BurstLeft = std::geometric_distribution<int>(1.0 / maximum(Impairment.m_BurstLength, 1))(m_Random);
+			Dir.m_Stats.m_BurstLost++;
+			return false;
+		}
+		if(Chance(Impairment.m_Loss))
+		{
+			Dir.m_Stats.m_Lost++;
+			return false;
+		}
 
-			// queue packet
-			p->m_pPrev = g_pLast;
-			p->m_pNext = 0;
-			if(g_pLast)
-				g_pLast->m_pNext = p;
-			else
+		// serialize the packet on the capped link first
+		int64_t SendStart = Now;
+		if(Impairment.m_Bandwidth > 0)
+		{
+			SendStart = maximum(Now, Dir.m_NextFreeTime);
+			if(SendStart - Now > Impairment.m_Queue * (int64_t)1000)
 			{
-				g_pFirst = p;
-				g_pLast = p;
+				Dir.m_Stats.m_QueueDropped++;
+				return false;
 			}
-			g_pLast = p;
+			Dir.m_NextFreeTime = SendStart + pPacket->m_DataSize * (int64_t)8000 / Impairment.m_Bandwidth;
+			SendStart = Dir.m_NextFreeTime;
+		}
 
-			// set data in packet
-			p->m_Timestamp = time_get();
-			p->m_DataSize = Bytes;
-			p->m_ID = ID++;
-			mem_copy(p->m_aData, pData, Bytes);
+		if(Chance(Impairment.m_Reorder))
+		{
+			// skip the delay and overtake the queued packets
+			pPacket->m_DueTime = SendStart;
+			if(pPacket->m_DueTime < Dir.m_LastDueTime)
+				Dir.m_Stats.m_Reordered++;
+		}
+		else
+		{
+			// jitter alone keeps the packet order
+			pPacket->m_DueTime = maximum(SendStart + SampleDelay(Impairment), Dir.m_LastDueTime);
+			Dir.m_LastDueTime = pPacket->m_DueTime;
+		}
+		return true;
+	}
 
-			if(ID > 20 && Bytes > 6 && DataTrash)
-			{
-				p->m_aData[6 + (rand() % (Bytes - 6))] = rand() & 255; // modify a byte
-				if((rand() % 10) == 0)
-				{
-					p->m_DataSize -= rand() % 32;
-					if(p->m_DataSize < 6)
-						p->m_DataSize = 6;
-				}
-			}
+	void PrintStats(double Seconds)
+	{
+		for(int i = 0; i < NUM_DIRS; i++)
+		{
+			SStats &Stats = m_aDirs[i].m_Stats;
+			log_info("crapnet", "%-4s %6d received %6d sent %8.1f kB/s  lost %d (%d in bursts)  queue drops %d  reordered %d  latency avg %.1f min %.1f max %.1f ms",
+				gs_apDirNames[i], Stats.m_Received, Stats.m_Sent, Stats.m_SentBytes / 1024.0 / Seconds,
+				Stats.m_Lost + Stats.m_BurstLost, Stats.m_BurstLost, Stats.m_QueueDropped, Stats.m_Reordered,
+				Stats.m_Sent ? Stats.m_LatencySum / 1000.0 / Stats.m_Sent : 0.0, maximum(Stats.m_LatencyMin, (int64_t)0) / 1000.0, Stats.m_LatencyMax / 1000.0);
+			Stats = SStats();
+		}
+		log_info("crapnet", "%d packets queued, %d clients", m_Wheel.NumPackets(), (int)m_Sessions.size());
+	}
 
-			if(Delaycounter <= 0)
+	SSession *Session(const NETADDR &Client, unsigned ServerType, int64_t Now)
+	{
+		auto It = m_Sessions.find(Client);
+		if(It == m_Sessions.end())
+		{
+			NETADDR BindAddr = {ServerType, {0}, 0};
+			NETSOCKET Socket = net_udp_create(BindAddr);
+			if(!Socket)
 			{
-				if(Ping.m_Delay)
-					p->m_Timestamp += (time_freq() * 1000) / Ping.m_Delay;
-				Delaycounter = Ping.m_DelayFreq;
+				log_error("crapnet", "could not create a socket for a client");
+				return nullptr;
 			}
-			Delaycounter--;
+			char aAddrStr[NETADDR_MAXSTRSIZE];
+			net_addr_str(&Client, aAddrStr, sizeof(aAddrStr), true);
+			log_info("crapnet", "new client %s", aAddrStr);
+			It = m_Sessions.emplace(Client, SSession{Socket, Now}).first;
+		}
+		It->second.m_LastActive = Now;
+		return &It->second;
+	}
 
-			if(g_ConfigLog)
+	void RemoveIdleSessions(int64_t Now)
+	{
+		for(auto It = m_Sessions.begin(); It != m_Sessions.end();)
+		{
+			if(Now - It->second.m_LastActive < SESSION_TIMEOUT * (int64_t)1000000)
 			{
-				char aAddrStr[NETADDR_MAXSTRSIZE];
-				net_addr_str(&From, aAddrStr, sizeof(aAddrStr), true);
-				dbg_msg("crapnet", "<< %08d %s (%d)", p->m_ID, aAddrStr, p->m_DataSize);
+				++It;
+				continue;
 			}
+			char aAddrStr[NETADDR_MAXSTRSIZE];
+			net_addr_str(&It->first, aAddrStr, sizeof(aAddrStr), true);
+			log_info("crapnet", "client %s timed out", aAddrStr);
+			net_udp_close(It->second.m_Socket);
+			It = m_Sessions.erase(It);
 		}
+	}
 
-		SPacket *pNext = g_pFirst;
-		while(true)
+	void Receive(int Dir, const NETADDR &From, const NETADDR &SendTo, const NETADDR &Client, const unsigned char *pData, int Bytes, int64_t Now, int ID, const SPhase &Phase)
+	{
+		SPacket *pPacket = (SPacket *)malloc(sizeof(SPacket) + Bytes);
+		pPacket->m_SendTo = SendTo;
+		pPacket->m_Client = Client;
+		pPacket->m_Dir = Dir;
+		pPacket->m_ReceiveTime = Now;
+		pPacket->m_DataSize = Bytes;
+		pPacket->m_ID = ID;
+		mem_copy(pPacket->m_aData, pData, Bytes);
+		m_aDirs[Dir].m_Stats.m_Received++;
+
+		if(!Schedule(pPacket, Phase.m_aDirs[Dir]))
 		{
-			SPacket *p = pNext;
-			if(!p)
-				break;
-			pNext = p->m_pNext;
+			if(m_Verbose)
+				log_info("crapnet", "dropped %08d", pPacket->m_ID);
+			free(pPacket);
+			return;
+		}
 
-			if((time_get() - p->m_Timestamp) > g_CurrentLatency)
-			{
-				char aFlags[] = "  ";
+		if(m_Verbose)
+		{
+			char aAddrStr[NETADDR_MAXSTRSIZE];
+			net_addr_str(&From, aAddrStr, sizeof(aAddrStr), true);
+			log_info("crapnet", "<< %08d %s (%d) +%.1f ms", pPacket->m_ID, aAddrStr, pPacket->m_DataSize, (pPacket->m_DueTime - Now) / 1000.0);
+		}
+		m_Wheel.Insert(pPacket);
+	}
 
-				if(g_ConfigReorder && (rand() % 2) == 0 && p->m_pNext)
-				{
-					aFlags[0] = 'R';
-					p = g_pFirst->m_pNext;
-				}
+public:
+	CCrapnet(std::vector<SPhase> &&vPhases, int StatsInterval, bool Verbose) :
+		m_vPhases(std::move(vPhases)), m_StatsInterval(StatsInterval), m_Verbose(Verbose), m_Random(time_get())
+	{
+	}
 
-				if(p->m_pNext)
-					p->m_pNext->m_pPrev = p->m_pPrev;
-				else
-					g_pLast = p->m_pPrev;
+	void Run(unsigned short Port, NETADDR Dest)
+	{
+		NETADDR BindAddr = {NETTYPE_IPV4, {0, 0, 0, 0}, Port};
+		NETSOCKET Socket = net_udp_create(BindAddr);
+		if(!Socket)
+		{
+			log_error("crapnet", "could not bind to port %d", Port);
+			return;
+		}
 
-				if(p->m_pPrev)
-					p->m_pPrev->m_pNext = p->m_pNext;
-				else
-					g_pFirst = p->m_pNext;
+		int TotalSeconds = 0;
+		for(const auto &Phase : m_vPhases)
+			TotalSeconds += Phase.m_Seconds;
 
-				// send and remove packet
-				net_udp_send(Socket, &p->m_SendTo, p->m_aData, p->m_DataSize);
+		const int64_t StartTime = time_get_nanoseconds().count() / 1000;
+		int64_t LastStats = StartTime;
+		int64_t LastSessionCheck = StartTime;
+		int LastPhase = -1;
+		int ID = 0;
 
-				// update lag
-				double Flux = rand() / (double)RAND_MAX;
-				int MsSpike = Ping.m_Spike;
-				int MsFlux = Ping.m_Flux;
-				int MsPing = Ping.m_Base;
-				g_CurrentLatency = ((time_freq() * MsPing) / 1000) + (int64_t)(((time_freq() * MsFlux) / 1000) * Flux); // 50ms
+		while(true)
+		{
+			const int64_t Now = time_get_nanoseconds().count() / 1000;
+
+			// phases repeat, a single phase applies forever
+			int PhaseIndex = 0;
+			if(TotalSeconds > 0)
+			{
+				int Second = ((Now - StartTime) / 1000000) % TotalSeconds;
+				while(Second >= m_vPhases[PhaseIndex].m_Seconds)
+					Second -= m_vPhases[PhaseIndex++].m_Seconds;
+			}
+			const SPhase &Phase = m_vPhases[PhaseIndex];
+			if(PhaseIndex != LastPhase && m_vPhases.size() > 1)
+				log_info("crapnet", "phase %d", PhaseIndex);
+			LastPhase = PhaseIndex;
 
-				if(MsSpike && (p->m_ID % 100) == 0)
+			// packets from clients
+			while(true)
+			{
+				NETADDR From;
+				unsigned char *pData;
+				int Bytes = net_udp_recv(Socket, &From, &pData);
+				if(Bytes <= 0)
+					break;
+				if(Session(From, Dest.type, Now))
+					Receive(DIR_UP, From, Dest, From, pData, Bytes, Now, ID++, Phase);
+			}
+
+			// packets from the server, to the client of the session they arrive on
+			for(auto &[Client, ClientSession] : m_Sessions)
+			{
+				while(true)
 				{
-					g_CurrentLatency += (time_freq() * MsSpike) / 1000;
-					aFlags[1] = 'S';
+					NETADDR From;
+					unsigned char *pData;
+					int Bytes = net_udp_recv(ClientSession.m_Socket, &From, &pData);
+					if(Bytes <= 0)
+						break;
+					if(net_addr_comp(&From, &Dest) != 0)
+						continue;
+					ClientSession.m_LastActive = Now;
+					Receive(DIR_DOWN, From, Client, Client, pData, Bytes, Now, ID++, Phase);
 				}
+			}
 
-				if(g_ConfigLog)
+			m_Wheel.Advance(Now, [&](SPacket *pPacket) {
+				NETSOCKET SendSocket = Socket;
+				if(pPacket->m_Dir == DIR_UP)
+				{
+					auto It = m_Sessions.find(pPacket->m_Client);
+					SendSocket = It != m_Sessions.end() ? It->second.m_Socket : nullptr;
+				}
+				if(!SendSocket)
+				{
+					free(pPacket);
+					return;
+				}
+				net_udp_send(SendSocket, &pPacket->m_SendTo, pPacket->m_aData, pPacket->m_DataSize);
+
+				SStats &Stats = m_aDirs[pPacket->m_Dir].m_Stats;
+				const int64_t Latency = Now - pPacket->m_ReceiveTime;
+				Stats.m_Sent++;
+				Stats.m_SentBytes += pPacket->m_DataSize;
+				Stats.m_LatencySum += Latency;
+				Stats.m_LatencyMin = Stats.m_LatencyMin < 0 ? Latency : minimum(Stats.m_LatencyMin, Latency);
+				Stats.m_LatencyMax = maximum(Stats.m_LatencyMax, Latency);
+
+				if(m_Verbose)
 				{
 					char aAddrStr[NETADDR_MAXSTRSIZE];
-					net_addr_str(&p->m_SendTo, aAddrStr, sizeof(aAddrStr), true);
-					dbg_msg("crapnet", ">> %08d %s (%d) %s", p->m_ID, aAddrStr, p->m_DataSize, aFlags);
+					net_addr_str(&pPacket->m_SendTo, aAddrStr, sizeof(aAddrStr), true);
+					log_info("crapnet", ">> %08d %s (%d)", pPacket->m_ID, aAddrStr, pPacket->m_DataSize);
 				}
+				free(pPacket);
+			});
+
+			if(Now - LastSessionCheck >= 1000000)
+			{
+				RemoveIdleSessions(Now);
+				LastSessionCheck = Now;
+			}
 
-				free(p);
+			if(m_StatsInterval > 0 && Now - LastStats >= m_StatsInterval * (int64_t)1000000)
+			{
+				PrintStats((Now - LastStats) / 1000000.0);
+				LastStats = Now;
 			}
+
+			net_socket_read_wait(Socket, 1ms);
 		}
+	}
+};
+
+static bool ParseSetting(SImpairment *pImpairment, const char *pSetting, const char *pValue)
+{
+	if(str_comp(pSetting, "latency") == 0)
+		pImpairment->m_Latency = str_toint(pValue);
+	else if(str_comp(pSetting, "jitter") == 0)
+		pImpairment->m_Jitter = str_toint(pValue);
+	else if(str_comp(pSetting, "distribution") == 0)
+	{
+		if(str_comp(pValue, "uniform") == 0)
+			pImpairment->m_Distribution = DISTRIBUTION_UNIFORM;
+		else if(str_comp(pValue, "normal") == 0)
+			pImpairment->m_Distribution = DISTRIBUTION_NORMAL;
+		else if(str_comp(pValue, "pareto") == 0)
+			pImpairment->m_Distribution = DISTRIBUTION_PARETO;
+		else
+			return false;
+	}
+	else if(str_comp(pSetting, "spike") == 0)
+		pImpairment->m_Spike = str_toint(pValue);
+	else if(str_comp(pSetting, "spike_chance") == 0)
+		pImpairment->m_SpikeChance = str_tofloat(pValue);
+	else if(str_comp(pSetting, "loss") == 0)
+		pImpairment->m_Loss = str_tofloat(pValue);
+	else if(str_comp(pSetting, "burst_chance") == 0)
+		pImpairment->m_BurstChance = str_tofloat(pValue);
+	else if(str_comp(pSetting, "burst_length") == 0)
+		pImpairment->m_BurstLength = str_toint(pValue);
+	else if(str_comp(pSetting, "reorder") == 0)
+		pImpairment->m_Reorder = str_tofloat(pValue);
+	else if(str_comp(pSetting, "bandwidth") == 0)
+		pImpairment->m_Bandwidth = str_toint(pValue);
+	else if(str_comp(pSetting, "queue") == 0)
+		pImpairment->m_Queue = str_toint(pValue);
+	else
+		return false;
+	return true;
+}
+
+// "phase <seconds>" starts a new phase with the settings of the previous one,
+// "[up|down] <setting> <value>" changes a setting for one or both directions
+static bool ParseLine(std::vector<SPhase> *pvPhases, const char *pLine)
+{
+	char aaTokens[3][64];
+	int NumTokens = 0;
+	const char *pToken = pLine;
+	while(NumTokens < 3 && (pToken = str_next_token(pToken, " \t", aaTokens[NumTokens], sizeof(aaTokens[NumTokens]))))
+		NumTokens++;
+	if(NumTokens == 0 || aaTokens[0][0] == '#')
+		return true;
+
+	if(str_comp(aaTokens[0], "phase") == 0 && NumTokens == 2)
+	{
+		if(pvPhases->empty() || pvPhases->back().m_Seconds > 0)
+			pvPhases->push_back(pvPhases->empty() ? SPhase() : pvPhases->back());
+		pvPhases->back().m_Seconds = maximum(str_toint(aaTokens[1]), 1);
+		return true;
+	}
+
+	if(pvPhases->empty())
+		pvPhases->emplace_back();
+	SPhase &Phase = pvPhases->back();
+	if(NumTokens == 3 && (str_comp(aaTokens[0], "up") == 0 || str_comp(aaTokens[0], "down") == 0))
+		return ParseSetting(&Phase.m_aDirs[str_comp(aaTokens[0], "up") == 0 ? DIR_UP : DIR_DOWN], aaTokens[1], aaTokens[2]);
+	if(NumTokens == 2)
+		return ParseSetting(&Phase.m_aDirs[DIR_UP], aaTokens[0], aaTokens[1]) && ParseSetting(&Phase.m_aDirs[DIR_DOWN], aaTokens[0], aaTokens[1]);
+	return false;
+}
 
-		std::this_thread::sleep_for(std::chrono::microseconds(1000));
+static bool LoadScript(std::vector<SPhase> *pvPhases, const char *pFilename)
+{
+	IOHANDLE File = io_open(pFilename, IOFLAG_READ | IOFLAG_SKIP_BOM);
+	if(!File)
+	{
+		log_error("crapnet", "could not open script '%s'", pFilename);
+		return false;
+	}
+	CLineReader LineReader;
+	LineReader.Init(File);
+	int LineNumber = 0;
+	bool Success = true;
+	while(const char *pLine = LineReader.Get())
+	{
+		LineNumber++;
+		if(!ParseLine(pvPhases, pLine))
+		{
+			log_error("crapnet", "%s:%d: invalid line '%s'", pFilename, LineNumber, pLine);
+			Success = false;
+		}
 	}
+	io_close(File);
+	return Success;
+}
+
+static void Usage()
+{
+	log_info("crapnet", "Usage: crapnet [-p <listen port>] [-s <server address>] [-f <script>] [-e <script line>]... [-i <stats interval>] [-v]");
+	log_info("crapnet", "Forwards udp packets between clients and a server with the impairment of the script.");
+	log_info("crapnet", "Script lines: 'phase <seconds>' starts a new phase, phases repeat");
+	log_info("crapnet", "              '[up|down] <setting> <value>' sets a setting for one or both directions");
+	log_info("crapnet", "Settings: latency, jitter, spike (ms), distribution (uniform, normal, pareto), spike_chance,");
+	log_info("crapnet", "          loss, burst_chance, reorder (%%), burst_length (packets), bandwidth (kbit/s), queue (ms)");
 }
 
 int main(int argc, const char **argv)
 {
 	CCmdlineFix CmdlineFix(&argc, &argv);
 	log_set_global_logger_default();
-	NETADDR Addr = {NETTYPE_IPV4, {127, 0, 0, 1}, 8303};
-	Run(8302, Addr);
+
+	unsigned short Port = 8302;
+	NETADDR Dest = {NETTYPE_IPV4, {127, 0, 0, 1}, 8303};
+	int StatsInterval = 5;
+	bool Verbose = false;
+	std::vector<SPhase> vPhases;
+	for(int i = 1; i < argc; i++)
+	{
+		bool Valid = true;
+		if(str_comp(argv[i], "-v") == 0)
+			Verbose = true;
+		else if(i + 1 < argc && str_comp(argv[i], "-p") == 0)
+			Port = str_toint(argv[++i]);
+		else if(i + 1 < argc && str_comp(argv[i], "-s") == 0)
+			Valid = net_addr_from_str(&Dest, argv[++i]) == 0;
+		else if(i + 1 < argc && str_comp(argv[i], "-f") == 0)
+			Valid = LoadScript(&vPhases, argv[++i]);
+		else if(i + 1 < argc && str_comp(argv[i], "-e") == 0)
+			Valid = ParseLine(&vPhases, argv[++i]);
+		else if(i + 1 < argc && str_comp(argv[i], "-i") == 0)
+			StatsInterval = str_toint(argv[++i]);
+		else
+			Valid = false;
+		if(!Valid)
+		{
+			Usage();
+			return -1;
+		}
+	}
+
+	if(vPhases.empty())
+	{
+		// cycle through no lag, some lag and heavy lag like crapnet always did
+		for(const char *pLine : {"phase 10", "phase 10", "latency 40", "jitter 20", "spike 100", "spike_chance 1", "phase 10", "latency 140", "jitter 40", "spike 200"})
+			ParseLine(&vPhases, pLine);
+	}
+
+	CCrapnet Crapnet(std::move(vPhases), StatsInterval, Verbose);
+	Crapnet.Run(Port, Dest);
 	return 0;
 }
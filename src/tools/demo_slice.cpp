@@ -0,0 +1,323 @@
+#include <base/logger.h>
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/shared/demo.h>
+#include <engine/shared/network.h>
+#include <engine/shared/packer.h>
+#include <engine/shared/snapshot.h>
+#include <engine/storage.h>
+
+#include <game/generated/protocol.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "jobs_common.h"
+
+struct SSliceOptions
+{
+	float m_StartSeconds = -1.0f;
+	float m_EndSeconds = -1.0f;
+	bool m_StripChat = false;
+	IStorage *m_pStorage = nullptr;
+};
+
+class CDemoSliceJob : public IJob, public CDemoPlayer::IListener
+{
+	const SSliceOptions *m_pOptions;
+	CSemaphore *m_pDone;
+	char m_aInput[IO_MAX_PATH_LENGTH];
+	char m_aOutput[IO_MAX_PATH_LENGTH];
+
+	CSnapshotDelta m_SnapshotDelta;
+	std::unique_ptr<CDemoPlayer> m_pDemoPlayer;
+	std::unique_ptr<CDemoRecorder> m_pDemoRecorder;
+	int m_SliceFrom = -1;
+	int m_SliceTo = -1;
+
+	static bool FilterChat(const void *pData, int DataSize, void *pUser)
+	{
+		CUnpacker Unpacker;
+		Unpacker.Reset(pData, DataSize);
+
+		int Msg = Unpacker.GetInt();
+		int Sys = Msg & 1;
+		Msg >>= 1;
+
+		return !Unpacker.Error() && !Sys && Msg == NETMSGTYPE_SV_CHAT;
+	}
+
+	void Run() override
+	{
+		const int64_t StartTime = time_get();
+		m_Success = Slice();
+		m_Seconds = (time_get() - StartTime) / (double)time_freq();
+		m_pDemoPlayer = nullptr;
+		m_pDemoRecorder = nullptr;
+		m_pDone->Signal();
+	}
+
+	bool Slice()
+	{
+		m_pDemoPlayer = std::make_unique<CDemoPlayer>(&m_SnapshotDelta);
+		m_pDemoPlayer->SetListener(this);
+		if(m_pDemoPlayer->Load(m_pOptions->m_pStorage, nullptr, m_aInput, IStorage::TYPE_ALL_OR_ABSOLUTE) == -1)
+		{
+			log_error("demo_slice", "failed to load demo '%s'", m_aInput);
+			return false;
+		}
+
+		const CMapInfo *pMapInfo = m_pDemoPlayer->GetMapInfo();
+		const CDemoPlayer::CPlaybackInfo *pInfo = m_pDemoPlayer->Info();
+		const int FirstTick = pInfo->m_Info.m_FirstTick;
+		if(m_pOptions->m_StartSeconds >= 0.0f)
+			m_SliceFrom = FirstTick + round_truncate(m_pOptions->m_StartSeconds * SERVER_TICK_SPEED);
+		if(m_pOptions->m_EndSeconds >= 0.0f)
+			m_SliceTo = FirstTick + round_truncate(m_pOptions->m_EndSeconds * SERVER_TICK_SPEED);
+
+		// keep demos without map data that way
+		m_pDemoRecorder = std::make_unique<CDemoRecorder>(&m_SnapshotDelta, pMapInfo->m_Size == 0);
+		unsigned char *pMapData = m_pDemoPlayer->GetMapData(m_pOptions->m_pStorage);
+		SHA256_DIGEST Sha256 = pMapInfo->m_Sha256;
+		if(pMapData && Sha256 == SHA256_ZEROED)
+			Sha256 = sha256(pMapData, pMapInfo->m_Size);
+		const int Result = m_pDemoRecorder->Start(m_pOptions->m_pStorage, nullptr, m_aOutput, pInfo->m_Header.m_aNetversion, pMapInfo->m_aName, &Sha256, pMapInfo->m_Crc, pInfo->m_Header.m_aType, pMapInfo->m_Size, pMapData, nullptr, m_pOptions->m_StripChat ? FilterChat : nullptr, nullptr);
+		free(pMapData);
+		if(Result != 0)
+		{
+			log_error("demo_slice", "failed to create demo '%s'", m_aOutput);
+			m_pDemoPlayer->Stop();
+			return false;
+		}
+
+		m_pDemoPlayer->Play();
+		while(m_pDemoPlayer->IsPlaying())
+		{
+			m_pDemoPlayer->Update(false);
+			if(pInfo->m_Info.m_Paused)
+				break;
+		}
+		m_NumTicks = pInfo->m_Info.m_CurrentTick - maximum(FirstTick, m_SliceFrom);
+
+		for(int i = 0; i < pInfo->m_Info.m_NumTimelineMarkers; i++)
+		{
+			const int Marker = pInfo->m_Info.m_aTimelineMarkers[i];
+			if((m_SliceFrom == -1 || Marker >= m_SliceFrom) && (m_SliceTo == -1 || Marker <= m_SliceTo))
+				m_pDemoRecorder->AddDemoMarker(Marker);
+		}
+
+		m_pDemoPlayer->Stop();
+		m_pDemoRecorder->Stop();
+		return true;
+	}
+
+public:
+	bool m_Success = false;
+	int m_NumTicks = 0;
+	double m_Seconds = 0.0;
+
+	CDemoSliceJob(const SSliceOptions *pOptions, CSemaphore *pDone, const char *pInput, const char *pOutput) :
+		m_pOptions(pOptions), m_pDone(pDone)
+	{
+		str_copy(m_aInput, pInput);
+		str_copy(m_aOutput, pOutput);
+	}
+
+	const char *Input() const { return m_aInput; }
+
+	void OnDemoPlayerSnapshot(void *pData, int Size) override
+	{
+		const int Tick = m_pDemoPlayer->Info()->m_Info.m_CurrentTick;
+		if(m_SliceTo != -1 && Tick > m_SliceTo)
+			m_pDemoPlayer->Pause();
+		else if(m_SliceFrom == -1 || Tick >= m_SliceFrom)
+			m_pDemoRecorder->RecordSnapshot(Tick, pData, Size);
+	}
+
+	void OnDemoPlayerMessage(void *pData, int Size) override
+	{
+		const int Tick = m_pDemoPlayer->Info()->m_Info.m_CurrentTick;
+		if(m_SliceTo != -1 && Tick > m_SliceTo)
+			m_pDemoPlayer->Pause();
+		else if(m_SliceFrom == -1 || Tick >= m_SliceFrom)
+			m_pDemoRecorder->RecordMessage(pData, Size);
+	}
+};
+
+static int AddDemo(const char *pName, int IsDir, int StorageType, void *pUser)
+{
+	std::vector<std::string> *pvDemos = (std::vector<std::string> *)pUser;
+	if(!IsDir && str_endswith(pName, ".demo"))
+		pvDemos->push_back(pName);
+	return 0;
+}
+
+// The output keeps the path of the demo relative to the current directory, so demos with the
+// same name from different directories don't overwrite each other. Demos given by an absolute
+// path or outside of the current directory only keep their name.
+static void OutputName(const char *pArgument, const char *pDemo, char *pBuf, int BufSize)
+{
+	char aDir[IO_MAX_PATH_LENGTH] = "";
+	if(fs_is_relative_path(pArgument) && !str_find(pArgument, ".."))
+	{
+		const char *pRelative = pArgument;
+		while(str_startswith(pRelative, "./"))
+			pRelative += 2;
+		str_copy(aDir, pRelative);
+		// the directory of a single demo is the part before its name
+		if(!pDemo)
+		{
+			char *pSlash = (char *)str_rchr(aDir, '/');
+			if(pSlash)
+				*pSlash = '\0';
+			else
+				aDir[0] = '\0';
+		}
+		while(str_endswith(aDir, "/"))
+			aDir[str_length(aDir) - 1] = '\0';
+	}
+
+	char aName[IO_MAX_PATH_LENGTH];
+	IStorage::StripPathAndExtension(pDemo ? pDemo : pArgument, aName, sizeof(aName));
+	if(aDir[0] && str_comp(aDir, ".") != 0)
+		str_format(pBuf, BufSize, "%s/%s.demo", aDir, aName);
+	else
+		str_format(pBuf, BufSize, "%s.demo", aName);
+}
+
+static void Usage()
+{
+	log_info("demo_slice", "Usage: demo_slice [-j <threads>] [-s <start seconds>] [-e <end seconds>] [-c] <output directory> <demo or directory>...");
+	log_info("demo_slice", "  -j  number of demos processed in parallel (default: number of cores)");
+	log_info("demo_slice", "  -s  cut everything before this time, relative to the start of each demo");
+	log_info("demo_slice", "  -e  cut everything after this time, relative to the start of each demo");
+	log_info("demo_slice", "  -c  remove chat messages");
+	log_info("demo_slice", "Demos are re-encoded with the current demo version and keep their file name and relative path.");
+}
+
+int main(int argc, const char **argv)
+{
+	CCmdlineFix CmdlineFix(&argc, &argv);
+	log_set_global_logger_default();
+
+	SSliceOptions Options;
+	int NumThreads = std::thread::hardware_concurrency();
+	int Arg = 1;
+	for(; Arg < argc && argv[Arg][0] == '-'; Arg++)
+	{
+		if(str_comp(argv[Arg], "-c") == 0)
+			Options.m_StripChat = true;
+		else if(Arg + 1 < argc && str_comp(argv[Arg], "-j") == 0)
+			NumThreads = str_toint(argv[++Arg]);
+		else if(Arg + 1 < argc && str_comp(argv[Arg], "-s") == 0)
+			Options.m_StartSeconds = str_tofloat(argv[++Arg]);
+		else if(Arg + 1 < argc && str_comp(argv[Arg], "-e") == 0)
+			Options.m_EndSeconds = str_tofloat(argv[++Arg]);
+		else
+		{
+			Usage();
+			return -1;
+		}
+	}
+	if(argc - Arg < 2)
+	{
+		Usage();
+		return -1;
+	}
+
+	const char *pOutputDir = argv[Arg++];
+	if(fs_makedir_rec_for(pOutputDir) < 0 || fs_makedir(pOutputDir) < 0)
+	{
+		log_error("demo_slice", "failed to create output directory '%s'", pOutputDir);
+		return -1;
+	}
+
+	// the output directory is the save path, inputs are opened with absolute paths
+	std::unique_ptr<IStorage> pStorage(CreateTempStorage(pOutputDir));
+	if(!pStorage)
+		return -1;
+	Options.m_pStorage = pStorage.get();
+
+	char aCurrentDir[IO_MAX_PATH_LENGTH];
+	if(!fs_getcwd(aCurrentDir, sizeof(aCurrentDir)))
+		return -1;
+
+	// input path and output name
+	std::vector<std::pair<std::string, std::string>> vInputs;
+	for(; Arg < argc; Arg++)
+	{
+		char aPath[IO_MAX_PATH_LENGTH];
+		if(fs_is_relative_path(argv[Arg]))
+			str_format(aPath, sizeof(aPath), "%s/%s", aCurrentDir, argv[Arg]);
+		else
+			str_copy(aPath, argv[Arg]);
+
+		char aOutput[IO_MAX_PATH_LENGTH];
+		if(fs_is_dir(aPath))
+		{
+			std::vector<std::string> vDemos;
+			fs_listdir(aPath, AddDemo, 0, &vDemos);
+			for(const auto &Demo : vDemos)
+			{
+				OutputName(argv[Arg], Demo.c_str(), aOutput, sizeof(aOutput));
+				vInputs.emplace_back(std::string(aPath) + "/" + Demo, aOutput);
+			}
+		}
+		else
+		{
+			OutputName(argv[Arg], nullptr, aOutput, sizeof(aOutput));
+			vInputs.emplace_back(aPath, aOutput);
+		}
+	}
+
+	std::map<std::string, std::string> OutputInputs;
+	for(const auto &[Input, Output] : vInputs)
+	{
+		auto [It, Inserted] = OutputInputs.emplace(Output, Input);
+		if(!Inserted)
+		{
+			log_error("demo_slice", "'%s' and '%s' would both be written to '%s'", It->second.c_str(), Input.c_str(), Output.c_str());
+			return -1;
+		}
+
+		char aOutputPath[IO_MAX_PATH_LENGTH];
+		str_format(aOutputPath, sizeof(aOutputPath), "%s/%s", pOutputDir, Output.c_str());
+		if(fs_makedir_rec_for(aOutputPath) < 0)
+		{
+			log_error("demo_slice", "failed to create directory for '%s'", aOutputPath);
+			return -1;
+		}
+	}
+
+	CNetBase::Init();
+
+	CSemaphore JobsDone;
+	std::vector<std::shared_ptr<CDemoSliceJob>> vpJobs;
+	for(const auto &[Input, Output] : vInputs)
+		vpJobs.push_back(std::make_shared<CDemoSliceJob>(&Options, &JobsDone, Input.c_str(), Output.c_str()));
+
+	const int64_t StartTime = time_get();
+	{
+		RunJobs(vpJobs, NumThreads, &JobsDone);
+	}
+	const double Seconds = (time_get() - StartTime) / (double)time_freq();
+
+	int NumFailed = 0;
+	int64_t NumTicks = 0;
+	for(auto &pJob : vpJobs)
+	{
+		if(!pJob->m_Success)
+		{
+			NumFailed++;
+			continue;
+		}
+		NumTicks += pJob->m_NumTicks;
+		log_info("demo_slice", "%s: %d ticks in %.3f s (%.0f ticks/s)", pJob->Input(), pJob->m_NumTicks, pJob->m_Seconds, pJob->m_NumTicks / maximum(pJob->m_Seconds, 0.001));
+	}
+	log_info("demo_slice", "sliced %d of %d demos, %" PRId64 " ticks in %.3f s (%.0f ticks/s)", (int)vpJobs.size() - NumFailed, (int)vpJobs.size(), NumTicks, Seconds, NumTicks / maximum(Seconds, 0.001));
+	return NumFailed ? -1 : 0;
+}
@@ -0,0 +1,39 @@
+#include <base/math.h>
+#include <base/system.h>
+#include <base/tl/threading.h>
+#include <engine/shared/jobs.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+inline int AddMap(const char *pName, int IsDir, int StorageType, void *pUser)
+{
+	std::vector<std::string> *pvMaps = (std::vector<std::string> *)pUser;
+	if(!IsDir && str_endswith(pName, ".map"))
+		pvMaps->push_back(pName);
+	return 0;
+}
+
+// Returns the names of the maps in the directory, sorted.
+inline std::vector<std::string> ListMaps(const char *pDir)
+{
+	std::vector<std::string> vMaps;
+	fs_listdir(pDir, AddMap, 0, &vMaps);
+	std::sort(vMaps.begin(), vMaps.end());
+	return vMaps;
+}
+
+// Runs the jobs on up to 32 threads. Each job must signal pDone at the end of
+// its Run, this returns once all of them did.
+template<class TJob>
+void RunJobs(const std::vector<std::shared_ptr<TJob>> &vpJobs, int NumThreads, CSemaphore *pDone)
+{
+	CJobPool Pool;
+	Pool.Init(clamp(NumThreads, 1, 32));
+	for(const auto &pJob : vpJobs)
+		Pool.Add(pJob);
+	for(size_t i = 0; i < vpJobs.size(); i++)
+		pDone->Wait();
+}
@@ -1,42 +1,74 @@
 #include <algorithm>
 #include <base/logger.h>
+#include <base/math.h>
 #include <base/system.h>
 #include <cstdint>
 #include <engine/gfx/image_manipulation.h>
 #include <engine/shared/datafile.h>
 #include <engine/storage.h>
 #include <game/mapitems.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
+#include "jobs_common.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MAP_OPTIMIZE_USE_SSE2
+#include <emmintrin.h>
+#endif
+
 void ClearTransparentPixels(uint8_t *pImg, int Width, int Height)
 {
-	for(int y = 0; y < Height; ++y)
+	const int NumPixels = Width * Height;
+	int i = 0;
+#if defined(MAP_OPTIMIZE_USE_SSE2)
+	// 4 pixels at once, the color of pixels with zero alpha is masked out
+	const __m128i AlphaMask = _mm_set1_epi32((int)0xff000000);
+	const __m128i ColorMask = _mm_set1_epi32(0x00ffffff);
+	for(; i + 4 <= NumPixels; i += 4)
 	{
-		for(int x = 0; x < Width; ++x)
+		__m128i Pixels = _mm_loadu_si128((const __m128i *)(pImg + i * 4));
+		__m128i Transparent = _mm_cmpeq_epi32(_mm_and_si128(Pixels, AlphaMask), _mm_setzero_si128());
+		Pixels = _mm_andnot_si128(_mm_and_si128(Transparent, ColorMask), Pixels);
+		_mm_storeu_si128((__m128i *)(pImg + i * 4), Pixels);
+	}
+#endif
+	for(; i < NumPixels; i++)
+	{
+		if(pImg[i * 4 + 3] == 0)
 		{
-			int Index = y * Width * 4 + x * 4;
-			if(pImg[Index + 3] == 0)
-			{
-				pImg[Index + 0] = 0;
-				pImg[Index + 1] = 0;
-				pImg[Index + 2] = 0;
-			}
+			pImg[i * 4 + 0] = 0;
+			pImg[i * 4 + 1] = 0;
+			pImg[i * 4 + 2] = 0;
 		}
 	}
 }
 
 void CopyOpaquePixels(uint8_t *pDestImg, uint8_t *pSrcImg, int Width, int Height)
 {
-	for(int y = 0; y < Height; ++y)
+	const int NumPixels = Width * Height;
+	int i = 0;
+#if defined(MAP_OPTIMIZE_USE_SSE2)
+	const __m128i AlphaMask = _mm_set1_epi32((int)0xff000000);
+	for(; i + 4 <= NumPixels; i += 4)
 	{
-		for(int x = 0; x < Width; ++x)
-		{
-			int Index = y * Width * 4 + x * 4;
-			if(pSrcImg[Index + 3] > 0)
-				mem_copy(&pDestImg[Index], &pSrcImg[Index], sizeof(uint8_t) * 4);
-			else
-				mem_zero(&pDestImg[Index], sizeof(uint8_t) * 4);
-		}
+		__m128i Pixels = _mm_loadu_si128((const __m128i *)(pSrcImg + i * 4));
+		__m128i Transparent = _mm_cmpeq_epi32(_mm_and_si128(Pixels, AlphaMask), _mm_setzero_si128());
+		_mm_storeu_si128((__m128i *)(pDestImg + i * 4), _mm_andnot_si128(Transparent, Pixels));
+	}
+#endif
+	for(; i < NumPixels; i++)
+	{
+		if(pSrcImg[i * 4 + 3] > 0)
+			mem_copy(&pDestImg[i * 4], &pSrcImg[i * 4], sizeof(uint8_t) * 4);
+		else
+			mem_zero(&pDestImg[i * 4], sizeof(uint8_t) * 4);
 	}
 }
 
@@ -73,47 +105,68 @@ void GetImageSHA256(uint8_t *pImgBuff, int ImgSize, int Width, int Height, char
 	free(pNewImgBuff);
 }
 
-int main(int argc, const char **argv)
+// optimized images are shared between maps, they only depend on the
+// opaque pixels (see GetImageSHA256) and on how the map uses the image
+class CImageCache
 {
-	CCmdlineFix CmdlineFix(&argc, &argv);
-	log_set_global_logger_default();
+	std::mutex m_Mutex;
+	std::unordered_map<std::string, std::shared_ptr<const std::vector<uint8_t>>> m_Images;
+	size_t m_Size = 0;
+	size_t m_MaxSize;
 
-	IStorage *pStorage = CreateStorage(IStorage::STORAGETYPE_BASIC, argc, argv);
-	if(!pStorage || argc <= 1 || argc > 3)
-	{
-		dbg_msg("map_optimize", "Invalid parameters or other unknown error.");
-		dbg_msg("map_optimize", "Usage: map_optimize <source map filepath> [<dest map filepath>]");
-		return -1;
-	}
+public:
+	std::atomic<int> m_Hits{0};
+	std::atomic<int64_t> m_HitBytes{0};
 
-	char aFileName[IO_MAX_PATH_LENGTH];
-	if(argc == 3)
-	{
-		str_format(aFileName, sizeof(aFileName), "out/%s", argv[2]);
+	CImageCache(size_t MaxSize) :
+		m_MaxSize(MaxSize) {}
 
-		fs_makedir_rec_for(aFileName);
+	std::shared_ptr<const std::vector<uint8_t>> Find(const std::string &Key)
+	{
+		std::unique_lock<std::mutex> Lock(m_Mutex);
+		auto It = m_Images.find(Key);
+		if(It == m_Images.end())
+			return nullptr;
+		m_Hits++;
+		m_HitBytes += It->second->size();
+		return It->second;
 	}
-	else
+
+	void Add(const std::string &Key, std::shared_ptr<const std::vector<uint8_t>> pImage)
 	{
-		fs_makedir("out");
-		char aBuff[IO_MAX_PATH_LENGTH];
-		IStorage::StripPathAndExtension(argv[1], aBuff, sizeof(aBuff));
-		str_format(aFileName, sizeof(aFileName), "out/%s.map", aBuff);
+		std::unique_lock<std::mutex> Lock(m_Mutex);
+		if(m_Size + pImage->size() > m_MaxSize)
+			return;
+		if(m_Images.emplace(Key, pImage).second)
+			m_Size += pImage->size();
 	}
+};
 
+struct SMapOptimizeResult
+{
+	int m_SourceSize = 0;
+	int m_DestSize = 0;
+	int m_NumImages = 0;
+	int m_NumCachedImages = 0;
+	double m_Seconds = 0.0;
+};
+
+static bool OptimizeMap(IStorage *pStorage, const char *pSourceFile, const char *pDestFile, CImageCache *pCache, SMapOptimizeResult *pResult)
+{
 	CDataFileReader Reader;
-	if(!Reader.Open(pStorage, argv[1], IStorage::TYPE_ABSOLUTE))
+	if(!Reader.Open(pStorage, pSourceFile, IStorage::TYPE_ABSOLUTE))
 	{
-		dbg_msg("map_optimize", "Failed to open source file.");
-		return -1;
+		dbg_msg("map_optimize", "Failed to open source file '%s'.", pSourceFile);
+		return false;
 	}
 
 	CDataFileWriter Writer;
-	if(!Writer.Open(pStorage, aFileName, IStorage::TYPE_ABSOLUTE))
+	if(!Writer.Open(pStorage, pDestFile, IStorage::TYPE_ABSOLUTE))
 	{
-		dbg_msg("map_optimize", "Failed to open target file.");
-		return -1;
+		dbg_msg("map_optimize", "Failed to open target file '%s'.", pDestFile);
+		return false;
 	}
+	pResult->m_SourceSize = Reader.MapSize();
 
 	int aImageFlags[64] = {
 		0,
@@ -134,6 +187,7 @@ int main(int argc, const char **argv)
 	};
 
 	std::vector<SMapOptimizeItem> vDataFindHelper;
+	std::vector<std::string> vImageSHA256;
 
 	// add all items
 	for(int Index = 0, i = 0; Index < Reader.NumItems(); Index++)
@@ -197,6 +251,7 @@ int main(int argc, const char **argv)
 				Item.m_Data = pImg->m_ImageData;
 				Item.m_Text = pImg->m_ImageName;
 				vDataFindHelper.push_back(Item);
+				vImageSHA256.emplace_back();
 			}
 
 			// found an image
@@ -206,6 +261,20 @@ int main(int argc, const char **argv)
 		Writer.AddItem(Type, ID, Size, pPtr);
 	}
 
+	// the sha256 names the new image and identifies it in the cache
+	auto &&ImageSHA256 = [&](int Item) -> const std::string & {
+		const SMapOptimizeItem &Image = vDataFindHelper[Item];
+		if(vImageSHA256[Item].empty())
+		{
+			char aSHA256Str[SHA256_MAXSTRSIZE];
+			// This is the important function, that calculates the SHA256 in a special way
+			// Please read the comments inside the functions to understand it
+			GetImageSHA256((uint8_t *)Reader.GetData(Image.m_Data), Reader.GetDataSize(Image.m_Data), Image.m_pImage->m_Width, Image.m_pImage->m_Height, aSHA256Str, sizeof(aSHA256Str));
+			vImageSHA256[Item] = aSHA256Str;
+		}
+		return vImageSHA256[Item];
+	};
+
 	// add all data
 	for(int Index = 0; Index < Reader.NumData(); Index++)
 	{
@@ -219,7 +288,30 @@ int main(int argc, const char **argv)
 			int Height = it->m_pImage->m_Height;
 
 			int ImageIndex = it->m_Index;
-			if(it->m_Data == Index)
+			std::string CacheKey;
+			std::shared_ptr<const std::vector<uint8_t>> pCachedImage;
+			if(it->m_Data == Index && pCache)
+			{
+				char aUsage[64 + 16];
+				str_format(aUsage, sizeof(aUsage), "_%dx%d_%d_", Width, Height, aImageFlags[ImageIndex]);
+				CacheKey = ImageSHA256(it - vDataFindHelper.begin()) + aUsage;
+				if(aImageFlags[ImageIndex] == 1)
+				{
+					for(int i = 0; i < 256; i += 4)
+						CacheKey += (char)('a' + (aaImageTiles[ImageIndex][i] | aaImageTiles[ImageIndex][i + 1] << 1 | aaImageTiles[ImageIndex][i + 2] << 2 | aaImageTiles[ImageIndex][i + 3] << 3));
+				}
+				pCachedImage = pCache->Find(CacheKey);
+				if(pCachedImage && pCachedImage->size() != (size_t)Size)
+					pCachedImage = nullptr;
+				pResult->m_NumImages++;
+			}
+
+			if(pCachedImage)
+			{
+				pPtr = const_cast<uint8_t *>(pCachedImage->data());
+				pResult->m_NumCachedImages++;
+			}
+			else if(it->m_Data == Index)
 			{
 				DeletePtr = true;
 				// optimize embedded images
@@ -282,20 +374,16 @@ int main(int argc, const char **argv)
 						DilateImage(pImgBuff, Width, Height, 4);
 					}
 				}
+
+				if(pCache)
+					pCache->Add(CacheKey, std::make_shared<const std::vector<uint8_t>>(pImgBuff, pImgBuff + Size));
 			}
 			else if(it->m_Text == Index)
 			{
 				char *pImgName = (char *)pPtr;
-				uint8_t *pImgBuff = (uint8_t *)Reader.GetData(it->m_Data);
-				int ImgSize = Reader.GetDataSize(it->m_Data);
-
-				char aSHA256Str[SHA256_MAXSTRSIZE];
-				// This is the important function, that calculates the SHA256 in a special way
-				// Please read the comments inside the functions to understand it
-				GetImageSHA256(pImgBuff, ImgSize, Width, Height, aSHA256Str, sizeof(aSHA256Str));
 
 				char aNewName[IO_MAX_PATH_LENGTH];
-				int StrLen = str_format(aNewName, std::size(aNewName), "%s_cut_%s", pImgName, aSHA256Str);
+				int StrLen = str_format(aNewName, std::size(aNewName), "%s_cut_%s", pImgName, ImageSHA256(it - vDataFindHelper.begin()).c_str());
 
 				DeletePtr = true;
 				// make the new name ready
@@ -315,5 +403,135 @@ int main(int argc, const char **argv)
 	Reader.Close();
 	Writer.Finish();
 
-	return 0;
+	IOHANDLE File = pStorage->OpenFile(pDestFile, IOFLAG_READ, IStorage::TYPE_ABSOLUTE);
+	if(File)
+	{
+		pResult->m_DestSize = io_length(File);
+		io_close(File);
+	}
+	return true;
+}
+
+class CMapOptimizeJob : public IJob
+{
+	IStorage *m_pStorage;
+	CSemaphore *m_pDone;
+	CImageCache *m_pCache;
+	std::string m_Source;
+	std::string m_Dest;
+
+	void Run() override
+	{
+		const int64_t StartTime = time_get();
+		m_Success = OptimizeMap(m_pStorage, m_Source.c_str(), m_Dest.c_str(), m_pCache, &m_Result);
+		m_Result.m_Seconds = (time_get() - StartTime) / (double)time_freq();
+		m_pDone->Signal();
+	}
+
+public:
+	bool m_Success = false;
+	SMapOptimizeResult m_Result;
+
+	CMapOptimizeJob(IStorage *pStorage, CSemaphore *pDone, CImageCache *pCache, const char *pSource, const char *pDest) :
+		m_pStorage(pStorage), m_pDone(pDone), m_pCache(pCache), m_Source(pSource), m_Dest(pDest) {}
+
+	const char *Source() const { return m_Source.c_str(); }
+};
+
+static int OptimizeDirectory(IStorage *pStorage, const char *pSourceDir, const char *pDestDir, int NumThreads)
+{
+	const std::vector<std::string> vMaps = ListMaps(pSourceDir);
+
+	// 512 MiB of optimized images, enough for the common tilesets of a big map pool
+	CImageCache Cache(512 * 1024 * 1024);
+	CSemaphore JobsDone;
+	std::vector<std::shared_ptr<CMapOptimizeJob>> vpJobs;
+	for(const auto &Map : vMaps)
+	{
+		char aSource[IO_MAX_PATH_LENGTH];
+		str_format(aSource, sizeof(aSource), "%s/%s", pSourceDir, Map.c_str());
+		char aDest[IO_MAX_PATH_LENGTH];
+		str_format(aDest, sizeof(aDest), "%s/%s", pDestDir, Map.c_str());
+		vpJobs.push_back(std::make_shared<CMapOptimizeJob>(pStorage, &JobsDone, &Cache, aSource, aDest));
+	}
+
+	const int64_t StartTime = time_get();
+	RunJobs(vpJobs, NumThreads, &JobsDone);
+	const double Seconds = (time_get() - StartTime) / (double)time_freq();
+
+	int NumFailed = 0;
+	int64_t SourceSize = 0;
+	int64_t DestSize = 0;
+	for(auto &pJob : vpJobs)
+	{
+		if(!pJob->m_Success)
+		{
+			NumFailed++;
+			continue;
+		}
+		const SMapOptimizeResult &Result = pJob->m_Result;
+		SourceSize += Result.m_SourceSize;
+		DestSize += Result.m_DestSize;
+		dbg_msg("map_optimize", "%s: %d -> %d bytes, %d bytes saved, %d/%d images cached, %.3f s", pJob->Source(), Result.m_SourceSize, Result.m_DestSize, Result.m_SourceSize - Result.m_DestSize, Result.m_NumCachedImages, Result.m_NumImages, Result.m_Seconds);
+	}
+	dbg_msg("map_optimize", "optimized %d of %d maps in %.3f s, %" PRId64 " -> %" PRId64 " bytes, %" PRId64 " bytes saved", (int)vpJobs.size() - NumFailed, (int)vpJobs.size(), Seconds, SourceSize, DestSize, SourceSize - DestSize);
+	dbg_msg("map_optimize", "%d images (%" PRId64 " bytes) taken from the image cache", Cache.m_Hits.load(), Cache.m_HitBytes.load());
+	return NumFailed ? -1 : 0;
+}
+
+int main(int argc, const char **argv)
+{
+	CCmdlineFix CmdlineFix(&argc, &argv);
+	log_set_global_logger_default();
+
+	IStorage *pStorage = CreateStorage(IStorage::STORAGETYPE_BASIC, argc, argv);
+	int NumThreads = std::thread::hardware_concurrency();
+	int Arg = 1;
+	if(Arg + 1 < argc && str_comp(argv[Arg], "-j") == 0)
+	{
+		NumThreads = str_toint(argv[Arg + 1]);
+		Arg += 2;
+	}
+	if(!pStorage || argc - Arg < 1 || argc - Arg > 2)
+	{
+		dbg_msg("map_optimize", "Invalid parameters or other unknown error.");
+		dbg_msg("map_optimize", "Usage: map_optimize <source map filepath> [<dest map filepath>]");
+		dbg_msg("map_optimize", "       map_optimize [-j <threads>] <source map directory> [<dest map directory>]");
+		return -1;
+	}
+	const char *pSource = argv[Arg];
+	const char *pDest = argc - Arg == 2 ? argv[Arg + 1] : nullptr;
+
+	if(fs_is_dir(pSource))
+	{
+		char aDestDir[IO_MAX_PATH_LENGTH];
+		if(pDest)
+			str_format(aDestDir, sizeof(aDestDir), "out/%s", pDest);
+		else
+			str_copy(aDestDir, "out");
+		if(fs_makedir_rec_for(aDestDir) < 0 || fs_makedir(aDestDir) < 0)
+		{
+			dbg_msg("map_optimize", "Failed to create target directory.");
+			return -1;
+		}
+		return OptimizeDirectory(pStorage, pSource, aDestDir, NumThreads);
+	}
+
+	char aFileName[IO_MAX_PATH_LENGTH];
+	if(pDest)
+	{
+		str_format(aFileName, sizeof(aFileName), "out/%s", pDest);
+
+		fs_makedir_rec_for(aFileName);
+	}
+	else
+	{
+		fs_makedir("out");
+		char aBuff[IO_MAX_PATH_LENGTH];
+		IStorage::StripPathAndExtension(pSource, aBuff, sizeof(aBuff));
+		str_format(aFileName, sizeof(aFileName), "out/%s.map", aBuff);
+	}
+
+	SMapOptimizeResult Result;
+	return OptimizeMap(pStorage, pSource, aFileName, nullptr, &Result) ? 0 : -1;
 }
@@ -1,24 +1,26 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/logger.h>
 #include <base/system.h>
 #include <engine/shared/datafile.h>
 #include <engine/storage.h>
 
-int main(int argc, const char **argv)
-{
-	CCmdlineFix CmdlineFix(&argc, &argv);
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
 
-	IStorage *pStorage = CreateStorage(IStorage::STORAGETYPE_BASIC, argc, argv);
-	if(!pStorage || argc != 3)
-		return -1;
+#include "jobs_common.h"
 
+static bool ResaveMap(IStorage *pStorage, const char *pSourceFile, const char *pDestFile, int DestStorageType)
+{
 	CDataFileReader Reader;
-	if(!Reader.Open(pStorage, argv[1], IStorage::TYPE_ABSOLUTE))
-		return -1;
+	if(!Reader.Open(pStorage, pSourceFile, IStorage::TYPE_ABSOLUTE))
+		return false;
 
 	CDataFileWriter Writer;
-	if(!Writer.Open(pStorage, argv[2]))
-		return -1;
+	if(!Writer.Open(pStorage, pDestFile, DestStorageType))
+		return false;
 
 	// add all items
 	for(int Index = 0; Index < Reader.NumItems(); Index++)
@@ -44,5 +46,93 @@ int main(int argc, const char **argv)
 
 	Reader.Close();
 	Writer.Finish();
-	return 0;
+	return true;
+}
+
+class CMapResaveJob : public IJob
+{
+	IStorage *m_pStorage;
+	CSemaphore *m_pDone;
+	std::string m_Source;
+	std::string m_Dest;
+
+	void Run() override
+	{
+		const int64_t StartTime = time_get();
+		m_Success = ResaveMap(m_pStorage, m_Source.c_str(), m_Dest.c_str(), IStorage::TYPE_ABSOLUTE);
+		m_Seconds = (time_get() - StartTime) / (double)time_freq();
+		m_pDone->Signal();
+	}
+
+public:
+	bool m_Success = false;
+	double m_Seconds = 0.0;
+
+	CMapResaveJob(IStorage *pStorage, CSemaphore *pDone, const char *pSource, const char *pDest) :
+		m_pStorage(pStorage), m_pDone(pDone), m_Source(pSource), m_Dest(pDest) {}
+
+	const char *Source() const { return m_Source.c_str(); }
+};
+
+static int ResaveDirectory(IStorage *pStorage, const char *pSourceDir, const char *pDestDir, int NumThreads)
+{
+	const std::vector<std::string> vMaps = ListMaps(pSourceDir);
+
+	CSemaphore JobsDone;
+	std::vector<std::shared_ptr<CMapResaveJob>> vpJobs;
+	for(const auto &Map : vMaps)
+	{
+		char aSource[IO_MAX_PATH_LENGTH];
+		str_format(aSource, sizeof(aSource), "%s/%s", pSourceDir, Map.c_str());
+		char aDest[IO_MAX_PATH_LENGTH];
+		str_format(aDest, sizeof(aDest), "%s/%s", pDestDir, Map.c_str());
+		vpJobs.push_back(std::make_shared<CMapResaveJob>(pStorage, &JobsDone, aSource, aDest));
+	}
+
+	const int64_t StartTime = time_get();
+	RunJobs(vpJobs, NumThreads, &JobsDone);
+	const double Seconds = (time_get() - StartTime) / (double)time_freq();
+
+	int NumFailed = 0;
+	for(auto &pJob : vpJobs)
+	{
+		if(pJob->m_Success)
+			dbg_msg("map_resave", "%s: %.3f s", pJob->Source(), pJob->m_Seconds);
+		else
+		{
+			dbg_msg("map_resave", "%s: failed", pJob->Source());
+			NumFailed++;
+		}
+	}
+	dbg_msg("map_resave", "resaved %d of %d maps in %.3f s", (int)vpJobs.size() - NumFailed, (int)vpJobs.size(), Seconds);
+	return NumFailed ? -1 : 0;
+}
+
+int main(int argc, const char **argv)
+{
+	CCmdlineFix CmdlineFix(&argc, &argv);
+
+	IStorage *pStorage = CreateStorage(IStorage::STORAGETYPE_BASIC, argc, argv);
+	if(!pStorage)
+		return -1;
+
+	int NumThreads = std::thread::hardware_concurrency();
+	int Arg = 1;
+	if(Arg + 1 < argc && str_comp(argv[Arg], "-j") == 0)
+	{
+		NumThreads = str_toint(argv[Arg + 1]);
+		Arg += 2;
+	}
+	if(argc - Arg != 2)
+		return -1;
+
+	if(fs_is_dir(argv[Arg]))
+	{
+		log_set_global_logger_default();
+		if(fs_makedir_rec_for(argv[Arg + 1]) < 0 || fs_makedir(argv[Arg + 1]) < 0)
+			return -1;
+		return ResaveDirectory(pStorage, argv[Arg], argv[Arg + 1], NumThreads);
+	}
+
+	return ResaveMap(pStorage, argv[Arg], argv[Arg + 1], IStorage::TYPE_SAVE) ? 0 : -1;
 }
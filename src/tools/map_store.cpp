@@ -0,0 +1,146 @@
+#include <base/logger.h>
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/shared/mapstore.h>
+#include <engine/storage.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct SListMapsContext
+{
+	std::string m_Path;
+	// the path below the listed directory, empty or ending with a slash
+	std::string m_Prefix;
+	std::vector<std::string> *m_pvMaps;
+};
+
+static int AddMapFile(const char *pName, int IsDir, int StorageType, void *pUser)
+{
+	SListMapsContext *pContext = (SListMapsContext *)pUser;
+	if(IsDir)
+	{
+		if(pName[0] == '.')
+			return 0;
+		SListMapsContext SubContext = {pContext->m_Path + "/" + pName, pContext->m_Prefix + pName + "/", pContext->m_pvMaps};
+		fs_listdir(SubContext.m_Path.c_str(), AddMapFile, StorageType, &SubContext);
+	}
+	else if(str_endswith(pName, ".map"))
+		pContext->m_pvMaps->push_back(pContext->m_Prefix + pName);
+	return 0;
+}
+
+static void PrintStats(const CMapStore &Store)
+{
+	CMapStore::CStats Stats;
+	Store.GetStats(&Stats);
+	log_info("map_store", "store holds %d maps with %" PRId64 " bytes in %d blocks with %" PRId64 " bytes, deduplication ratio %.2f", Stats.m_NumMaps, Stats.m_MapSize, Stats.m_NumBlocks, Stats.m_BlockSize, Stats.m_MapSize / (double)maximum(Stats.m_BlockSize, (int64_t)1));
+}
+
+static void Usage()
+{
+	log_info("map_store", "Usage: map_store <store directory> <map or directory>...");
+	log_info("map_store", "       map_store -s <store directory>");
+	log_info("map_store", "       map_store -x <store directory> <map name> <output map>");
+	log_info("map_store", "Adds maps to a content addressed store, shows its statistics or restores a map from it.");
+	log_info("map_store", "Set sv_map_store to the store directory to let the server load maps from it.");
+}
+
+int main(int argc, const char **argv)
+{
+	CCmdlineFix CmdlineFix(&argc, &argv);
+	log_set_global_logger_default();
+
+	const bool Stats = argc == 3 && str_comp(argv[1], "-s") == 0;
+	const bool Extract = argc == 5 && str_comp(argv[1], "-x") == 0;
+	if(!Stats && !Extract && (argc < 3 || argv[1][0] == '-'))
+	{
+		Usage();
+		return -1;
+	}
+
+	const char *pStoreDir = argv[Stats || Extract ? 2 : 1];
+	if(fs_makedir_rec_for(pStoreDir) < 0 || fs_makedir(pStoreDir) < 0)
+	{
+		log_error("map_store", "failed to create store directory '%s'", pStoreDir);
+		return -1;
+	}
+
+	// the store directory is the save path, maps are read with absolute paths
+	std::unique_ptr<IStorage> pStorage(CreateTempStorage(pStoreDir));
+	if(!pStorage)
+		return -1;
+	CMapStore Store(pStorage.get(), "", IStorage::TYPE_SAVE);
+
+	if(Stats)
+	{
+		PrintStats(Store);
+		return 0;
+	}
+
+	if(Extract)
+	{
+		void *pData;
+		unsigned Size;
+		if(!Store.ReadMap(argv[3], &pData, &Size))
+		{
+			log_error("map_store", "failed to restore map '%s'", argv[3]);
+			return -1;
+		}
+		IOHANDLE File = io_open(argv[4], IOFLAG_WRITE);
+		const bool Written = File && io_write(File, pData, Size) == Size;
+		if(File)
+			io_close(File);
+		free(pData);
+		if(!Written)
+		{
+			log_error("map_store", "failed to write '%s'", argv[4]);
+			return -1;
+		}
+		return 0;
+	}
+
+	// maps in directories keep their path below it as name, like sv_map "dir/name"
+	std::vector<std::pair<std::string, std::string>> vInputs;
+	for(int Arg = 2; Arg < argc; Arg++)
+	{
+		if(fs_is_dir(argv[Arg]))
+		{
+			std::vector<std::string> vMaps;
+			SListMapsContext Context = {argv[Arg], "", &vMaps};
+			fs_listdir(argv[Arg], AddMapFile, 0, &Context);
+			std::sort(vMaps.begin(), vMaps.end());
+			for(const auto &Map : vMaps)
+				vInputs.emplace_back(std::string(argv[Arg]) + "/" + Map, Map.substr(0, Map.size() - str_length(".map")));
+		}
+		else
+		{
+			char aName[IO_MAX_PATH_LENGTH];
+			IStorage::StripPathAndExtension(argv[Arg], aName, sizeof(aName));
+			vInputs.emplace_back(argv[Arg], aName);
+		}
+	}
+
+	int NumFailed = 0;
+	CMapStore::CAddResult Total;
+	for(const auto &[Input, Name] : vInputs)
+	{
+		CMapStore::CAddResult Result;
+		if(!Store.AddMap(Name.c_str(), Input.c_str(), IStorage::TYPE_ABSOLUTE, &Result))
+		{
+			NumFailed++;
+			continue;
+		}
+		log_info("map_store", "%s: %d blocks, %d new, %" PRId64 " bytes, %" PRId64 " new", Name.c_str(), Result.m_NumBlocks, Result.m_NumNewBlocks, Result.m_Size, Result.m_NewSize);
+		Total.m_NumBlocks += Result.m_NumBlocks;
+		Total.m_NumNewBlocks += Result.m_NumNewBlocks;
+		Total.m_Size += Result.m_Size;
+		Total.m_NewSize += Result.m_NewSize;
+	}
+	log_info("map_store", "added %d of %d maps, %" PRId64 " bytes, %" PRId64 " new bytes in %d new blocks", (int)vInputs.size() - NumFailed, (int)vInputs.size(), Total.m_Size, Total.m_NewSize, Total.m_NumNewBlocks);
+	PrintStats(Store);
+	return NumFailed ? -1 : 0;
+}
@@ -0,0 +1,610 @@
+#include <base/logger.h>
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/shared/compression.h>
+#include <engine/shared/config.h>
+#include <engine/shared/network.h>
+#include <engine/shared/packer.h>
+#include <engine/shared/protocol.h>
+#include <engine/shared/protocol_ex.h>
+#include <engine/shared/snapshot.h>
+#include <engine/shared/uuid_manager.h>
+
+#include <game/generated/protocol.h>
+#include <game/version.h>
+
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+enum
+{
+	INPUT_IDLE = 0, // only ack snapshots
+	INPUT_WALK, // walk left and right and jump
+	INPUT_CHAOS, // random movement, hook and fire
+};
+
+struct SBotStats
+{
+	int m_Snapshots = 0;
+	int m_EmptySnapshots = 0;
+	int64_t m_SnapshotBytes = 0; // compressed, as sent by the server
+	int64_t m_UnpackedBytes = 0;
+	int64_t m_Items = 0;
+	int m_MaxSnapshotBytes = 0;
+	int m_CrcErrors = 0;
+	int m_Resyncs = 0;
+	int64_t m_TimeLeftSum = 0;
+	int m_TimeLeftMin = std::numeric_limits<int>::max();
+	int m_TimeLeftMax = std::numeric_limits<int>::min();
+	int m_NumTimings = 0;
+
+	void Add(const SBotStats &Other)
+	{
+		m_Snapshots += Other.m_Snapshots;
+		m_EmptySnapshots += Other.m_EmptySnapshots;
+		m_SnapshotBytes += Other.m_SnapshotBytes;
+		m_UnpackedBytes += Other.m_UnpackedBytes;
+		m_Items += Other.m_Items;
+		m_MaxSnapshotBytes = maximum(m_MaxSnapshotBytes, Other.m_MaxSnapshotBytes);
+		m_CrcErrors += Other.m_CrcErrors;
+		m_Resyncs += Other.m_Resyncs;
+		m_TimeLeftSum += Other.m_TimeLeftSum;
+		m_TimeLeftMin = minimum(m_TimeLeftMin, Other.m_TimeLeftMin);
+		m_TimeLeftMax = maximum(m_TimeLeftMax, Other.m_TimeLeftMax);
+		m_NumTimings += Other.m_NumTimings;
+	}
+};
+
+// One simulated player. It joins like a real client but skips the map
+// download, then sends inputs every tick and unpacks and acks the snapshots.
+class CBot
+{
+public:
+	enum
+	{
+		STATE_OFFLINE = 0,
+		STATE_CONNECTING,
+		STATE_LOADING,
+		STATE_INGAME,
+		STATE_FAILED,
+	};
+
+private:
+	int m_ID;
+	int m_InputMode;
+	std::mt19937 m_Random;
+	CNetClient m_NetClient;
+	CSnapshotDelta *m_pSnapshotDelta;
+	CSnapshotStorage m_SnapshotStorage;
+
+	int m_State = STATE_OFFLINE;
+	bool m_SentInfo = false;
+	int64_t m_ConnectTime = 0;
+	int64_t m_JoinTime = -1;
+
+	int m_AckGameTick = -1;
+	int m_CurrentRecvTick = 0;
+	uint64_t m_SnapshotParts = 0;
+	int m_SnapshotIncomingDataSize = 0;
+	unsigned char m_aSnapshotIncomingData[CSnapshot::MAX_SIZE];
+	int64_t m_LastSnapshotTime = 0;
+
+	CNetObj_PlayerInput m_Input = {};
+
+	void SendMsg(CMsgPacker *pMsg, int Flags)
+	{
+		CPacker Packer;
+		Packer.Reset();
+		if(pMsg->m_MsgID < OFFSET_UUID)
+			Packer.AddInt((pMsg->m_MsgID << 1) | (pMsg->m_System ? 1 : 0));
+		else
+		{
+			Packer.AddInt(pMsg->m_System ? 1 : 0); // NETMSG_EX, NETMSGTYPE_EX
+			g_UuidManager.PackUuid(pMsg->m_MsgID, &Packer);
+		}
+		Packer.AddRaw(pMsg->Data(), pMsg->Size());
+
+		CNetChunk Packet;
+		mem_zero(&Packet, sizeof(Packet));
+		Packet.m_ClientID = 0;
+		Packet.m_pData = Packer.Data();
+		Packet.m_DataSize = Packer.Size();
+		if(Flags & MSGFLAG_VITAL)
+			Packet.m_Flags |= NETSENDFLAG_VITAL;
+		if(Flags & MSGFLAG_FLUSH)
+			Packet.m_Flags |= NETSENDFLAG_FLUSH;
+		m_NetClient.Send(&Packet);
+	}
+
+	void SendInfo()
+	{
+		CUuid ConnectionID = RandomUuid();
+		CMsgPacker MsgVer(NETMSG_CLIENTVER, true);
+		MsgVer.AddRaw(&ConnectionID, sizeof(ConnectionID));
+		MsgVer.AddInt(CLIENT_VERSIONNR);
+		MsgVer.AddString(GAME_NAME " " GAME_RELEASE_VERSION " (stress_bots)", 0);
+		SendMsg(&MsgVer, MSGFLAG_VITAL);
+
+		CMsgPacker Msg(NETMSG_INFO, true);
+		Msg.AddString(GAME_NETVERSION, 128);
+		Msg.AddString(m_aPassword, 128);
+		SendMsg(&Msg, MSGFLAG_VITAL | MSGFLAG_FLUSH);
+	}
+
+	void SendStartInfo()
+	{
+		char aName[16];
+		str_format(aName, sizeof(aName), "bot %d", m_ID);
+		CNetMsg_Cl_StartInfo Msg;
+		Msg.m_pName = aName;
+		Msg.m_pClan = "stress";
+		Msg.m_Country = -1;
+		Msg.m_pSkin = "default";
+		Msg.m_UseCustomColor = 0;
+		Msg.m_ColorBody = 0;
+		Msg.m_ColorFeet = 0;
+		CMsgPacker Packer(&Msg);
+		Msg.Pack(&Packer);
+		SendMsg(&Packer, MSGFLAG_VITAL | MSGFLAG_FLUSH);
+	}
+
+	void UpdateInput(int Tick)
+	{
+		m_Input.m_PlayerFlags = PLAYERFLAG_PLAYING;
+		if(m_InputMode == INPUT_WALK)
+		{
+			// change direction every second and jump every half second, shifted per bot
+			const int Phase = Tick + m_ID * 7;
+			m_Input.m_Direction = (Phase / SERVER_TICK_SPEED) % 2 ? 1 : -1;
+			m_Input.m_Jump = (Phase % (SERVER_TICK_SPEED / 2)) < 2;
+			m_Input.m_TargetX = m_Input.m_Direction * 100;
+			m_Input.m_TargetY = 0;
+		}
+		else if(m_InputMode == INPUT_CHAOS)
+		{
+			if(Tick % 5 == 0)
+			{
+				m_Input.m_Direction = std::uniform_int_distribution<int>(-1, 1)(m_Random);
+				m_Input.m_Jump = std::uniform_int_distribution<int>(0, 3)(m_Random) == 0;
+				m_Input.m_Hook = std::uniform_int_distribution<int>(0, 2)(m_Random) == 0;
+				if(std::uniform_int_distribution<int>(0, 4)(m_Random) == 0)
+					m_Input.m_Fire++;
+				if(std::uniform_int_distribution<int>(0, 50)(m_Random) == 0)
+					m_Input.m_WantedWeapon = std::uniform_int_distribution<int>(1, NUM_WEAPONS)(m_Random);
+			}
+			const float Angle = (Tick + m_ID * 13) * 0.05f;
+			m_Input.m_TargetX = (int)(std::cos(Angle) * 200.0f);
+			m_Input.m_TargetY = (int)(std::sin(Angle) * 200.0f);
+		}
+	}
+
+	void SendInput(int64_t Now)
+	{
+		if(m_AckGameTick <= 0 && m_CurrentRecvTick <= 0)
+			return;
+
+		// predict a few ticks ahead of the last snapshot like a client with low ping
+		const int LastTick = maximum(m_AckGameTick, m_CurrentRecvTick);
+		const int PredTick = LastTick + 2 + (int)((Now - m_LastSnapshotTime) * SERVER_TICK_SPEED / time_freq());
+		UpdateInput(PredTick);
+
+		CMsgPacker Msg(NETMSG_INPUT, true);
+		Msg.AddInt(m_AckGameTick);
+		Msg.AddInt(PredTick);
+		Msg.AddInt(sizeof(m_Input));
+		const int *pData = (const int *)&m_Input;
+		for(unsigned i = 0; i < sizeof(m_Input) / sizeof(int); i++)
+			Msg.AddInt(pData[i]);
+		SendMsg(&Msg, MSGFLAG_FLUSH);
+	}
+
+	void OnSnapshot(int Msg, CUnpacker *pUnpacker, int64_t Now)
+	{
+		const int GameTick = pUnpacker->GetInt();
+		const int DeltaTick = GameTick - pUnpacker->GetInt();
+
+		int NumParts = 1;
+		int Part = 0;
+		if(Msg == NETMSG_SNAP)
+		{
+			NumParts = pUnpacker->GetInt();
+			Part = pUnpacker->GetInt();
+		}
+
+		unsigned int Crc = 0;
+		int PartSize = 0;
+		if(Msg != NETMSG_SNAPEMPTY)
+		{
+			Crc = pUnpacker->GetInt();
+			PartSize = pUnpacker->GetInt();
+		}
+
+		const char *pData = (const char *)pUnpacker->GetRaw(PartSize);
+		if(pUnpacker->Error() || NumParts < 1 || NumParts > CSnapshot::MAX_PARTS || Part < 0 || Part >= NumParts || PartSize < 0 || PartSize > MAX_SNAPSHOT_PACKSIZE)
+			return;
+		if(GameTick < m_CurrentRecvTick || GameTick <= m_AckGameTick)
+			return;
+
+		if(GameTick != m_CurrentRecvTick)
+		{
+			m_SnapshotParts = 0;
+			m_CurrentRecvTick = GameTick;
+			m_SnapshotIncomingDataSize = 0;
+		}
+		mem_copy(m_aSnapshotIncomingData + Part * MAX_SNAPSHOT_PACKSIZE, pData, clamp(PartSize, 0, (int)sizeof(m_aSnapshotIncomingData) - Part * MAX_SNAPSHOT_PACKSIZE));
+		m_SnapshotParts |= (uint64_t)1 << Part;
+		if(Part == NumParts - 1)
+			m_SnapshotIncomingDataSize = (NumParts - 1) * MAX_SNAPSHOT_PACKSIZE + PartSize;
+
+		const bool Complete = NumParts < CSnapshot::MAX_PARTS ? m_SnapshotParts == (((uint64_t)1 << NumParts) - 1) : m_SnapshotParts == std::numeric_limits<uint64_t>::max();
+		if(!Complete)
+			return;
+		m_SnapshotParts = 0;
+
+		static CSnapshot s_EmptySnap;
+		s_EmptySnap.Clear();
+		CSnapshot *pDeltaShot = &s_EmptySnap;
+		if(DeltaTick >= 0 && m_SnapshotStorage.Get(DeltaTick, nullptr, &pDeltaShot, nullptr) < 0)
+		{
+			// the server used a snapshot we do not have, make it resend a full one
+			m_Stats.m_Resyncs++;
+			m_AckGameTick = -1;
+			SendInput(Now);
+			return;
+		}
+
+		const void *pDeltaData = m_pSnapshotDelta->EmptyDelta();
+		int DeltaSize = sizeof(int) * 3;
+		unsigned char aDeltaBuffer[CSnapshot::MAX_SIZE];
+		if(m_SnapshotIncomingDataSize)
+		{
+			DeltaSize = CVariableInt::Decompress(m_aSnapshotIncomingData, m_SnapshotIncomingDataSize, aDeltaBuffer, sizeof(aDeltaBuffer));
+			if(DeltaSize < 0)
+				return;
+			pDeltaData = aDeltaBuffer;
+		}
+
+		unsigned char aSnapBuffer[CSnapshot::MAX_SIZE];
+		CSnapshot *pSnap = (CSnapshot *)aSnapBuffer;
+		const int SnapSize = m_pSnapshotDelta->UnpackDelta(pDeltaShot, pSnap, pDeltaData, DeltaSize);
+		if(SnapSize < 0 || !pSnap->IsValid(SnapSize))
+			return;
+		if(Msg != NETMSG_SNAPEMPTY && pSnap->Crc() != Crc)
+		{
+			m_Stats.m_CrcErrors++;
+			m_AckGameTick = -1;
+			return;
+		}
+
+		m_SnapshotStorage.PurgeUntil(DeltaTick);
+		m_SnapshotStorage.Add(GameTick, Now, SnapSize, pSnap, 0, nullptr);
+		m_AckGameTick = GameTick;
+		m_LastSnapshotTime = Now;
+
+		m_Stats.m_Snapshots++;
+		if(Msg == NETMSG_SNAPEMPTY)
+			m_Stats.m_EmptySnapshots++;
+		m_Stats.m_SnapshotBytes += m_SnapshotIncomingDataSize;
+		m_Stats.m_MaxSnapshotBytes = maximum(m_Stats.m_MaxSnapshotBytes, m_SnapshotIncomingDataSize);
+		m_Stats.m_UnpackedBytes += SnapSize;
+		m_Stats.m_Items += pSnap->NumItems();
+	}
+
+	void OnMessage(CNetChunk *pChunk, int64_t Now)
+	{
+		CUnpacker Unpacker;
+		Unpacker.Reset(pChunk->m_pData, pChunk->m_DataSize);
+		CMsgPacker Packer(NETMSG_EX, true);
+
+		int Msg;
+		bool Sys;
+		CUuid Uuid;
+		const int Result = UnpackMessageID(&Msg, &Sys, &Uuid, &Unpacker, &Packer);
+		if(Result == UNPACKMESSAGE_ERROR)
+			return;
+		if(Result == UNPACKMESSAGE_ANSWER)
+			SendMsg(&Packer, MSGFLAG_VITAL);
+
+		const bool Vital = (pChunk->m_Flags & NET_CHUNKFLAG_VITAL) != 0;
+		if(!Sys)
+		{
+			if(Vital && Msg == NETMSGTYPE_SV_READYTOENTER)
+			{
+				CMsgPacker MsgEnter(NETMSG_ENTERGAME, true);
+				SendMsg(&MsgEnter, MSGFLAG_VITAL | MSGFLAG_FLUSH);
+				m_State = STATE_INGAME;
+				m_JoinTime = Now;
+			}
+		}
+		else if(Vital && Msg == NETMSG_MAP_CHANGE)
+		{
+			// no need for the map, the server does not check it
+			m_State = STATE_LOADING;
+			m_AckGameTick = -1;
+			m_CurrentRecvTick = 0;
+			m_SnapshotStorage.PurgeAll();
+			CMsgPacker MsgReady(NETMSG_READY, true);
+			SendMsg(&MsgReady, MSGFLAG_VITAL | MSGFLAG_FLUSH);
+		}
+		else if(Vital && Msg == NETMSG_CON_READY)
+			SendStartInfo();
+		else if(Msg == NETMSG_PING)
+		{
+			CMsgPacker MsgPong(NETMSG_PING_REPLY, true);
+			SendMsg(&MsgPong, MSGFLAG_FLUSH);
+		}
+		else if(Msg == NETMSG_INPUTTIMING)
+		{
+			Unpacker.GetInt();
+			const int TimeLeft = Unpacker.GetInt();
+			if(!Unpacker.Error())
+			{
+				m_Stats.m_TimeLeftSum += TimeLeft;
+				m_Stats.m_TimeLeftMin = minimum(m_Stats.m_TimeLeftMin, TimeLeft);
+				m_Stats.m_TimeLeftMax = maximum(m_Stats.m_TimeLeftMax, TimeLeft);
+				m_Stats.m_NumTimings++;
+			}
+		}
+		else if(Msg == NETMSG_SNAP || Msg == NETMSG_SNAPSINGLE || Msg == NETMSG_SNAPEMPTY)
+		{
+			if(m_State >= STATE_LOADING)
+				OnSnapshot(Msg, &Unpacker, Now);
+		}
+	}
+
+public:
+	SBotStats m_Stats;
+	char m_aPassword[128];
+
+	CBot(int ID, int InputMode, CSnapshotDelta *pSnapshotDelta, const char *pPassword) :
+		m_ID(ID), m_InputMode(InputMode), m_Random(ID), m_pSnapshotDelta(pSnapshotDelta)
+	{
+		str_copy(m_aPassword, pPassword);
+	}
+
+	~CBot()
+	{
+		if(m_State != STATE_OFFLINE)
+		{
+			m_NetClient.Disconnect("stress test done");
+			m_NetClient.Close();
+		}
+	}
+
+	int State() const { return m_State; }
+	int64_t JoinTime() const { return m_JoinTime - m_ConnectTime; }
+	const char *ErrorString() const { return m_NetClient.ErrorString(); }
+
+	bool Connect(const NETADDR &Addr, int64_t Now)
+	{
+		NETADDR BindAddr;
+		mem_zero(&BindAddr, sizeof(BindAddr));
+		BindAddr.type = Addr.type;
+		if(!m_NetClient.Open(BindAddr))
+		{
+			m_State = STATE_FAILED;
+			return false;
+		}
+		m_NetClient.Connect(&Addr, 1);
+		m_State = STATE_CONNECTING;
+		m_ConnectTime = Now;
+		return true;
+	}
+
+	void Update(int64_t Now)
+	{
+		if(m_State == STATE_OFFLINE || m_State == STATE_FAILED)
+			return;
+
+		m_NetClient.Update();
+		if(m_NetClient.State() == NETSTATE_OFFLINE)
+		{
+			m_State = STATE_FAILED;
+			return;
+		}
+		if(!m_SentInfo && m_NetClient.State() == NETSTATE_ONLINE && !m_NetClient.SecurityTokenUnknown())
+		{
+			m_SentInfo = true;
+			SendInfo();
+		}
+
+		CNetChunk Chunk;
+		while(m_NetClient.Recv(&Chunk))
+		{
+			if(!(Chunk.m_Flags & NETSENDFLAG_CONNLESS))
+				OnMessage(&Chunk, Now);
+		}
+	}
+
+	void Tick(int64_t Now)
+	{
+		if(m_State == STATE_INGAME)
+			SendInput(Now);
+	}
+};
+
+static void Usage()
+{
+	log_info("stress_bots", "Usage: stress_bots [-n <bots>] [-r <joins per second>] [-m idle|walk|chaos] [-t <seconds>] [-i <stats interval>] [-p <password>] <server address>...");
+	log_info("stress_bots", "Connects simulated players to the servers (round robin) and reports snapshot sizes, bandwidth and server tick timing.");
+	log_info("stress_bots", "All bots connect from one address, raise sv_max_clients_per_ip on the server.");
+}
+
+int main(int argc, const char **argv)
+{
+	CCmdlineFix CmdlineFix(&argc, &argv);
+	log_set_global_logger_default();
+
+	int NumBots = 16;
+	int JoinRate = 10;
+	int InputMode = INPUT_WALK;
+	int Duration = 0;
+	int StatsInterval = 5;
+	const char *pPassword = "";
+	std::vector<NETADDR> vServers;
+	for(int i = 1; i < argc; i++)
+	{
+		bool Valid = true;
+		if(i + 1 < argc && str_comp(argv[i], "-n") == 0)
+			NumBots = str_toint(argv[++i]);
+		else if(i + 1 < argc && str_comp(argv[i], "-r") == 0)
+			JoinRate = maximum(str_toint(argv[++i]), 1);
+		else if(i + 1 < argc && str_comp(argv[i], "-t") == 0)
+			Duration = str_toint(argv[++i]);
+		else if(i + 1 < argc && str_comp(argv[i], "-i") == 0)
+			StatsInterval = maximum(str_toint(argv[++i]), 1);
+		else if(i + 1 < argc && str_comp(argv[i], "-p") == 0)
+			pPassword = argv[++i];
+		else if(i + 1 < argc && str_comp(argv[i], "-m") == 0)
+		{
+			i++;
+			if(str_comp(argv[i], "idle") == 0)
+				InputMode = INPUT_IDLE;
+			else if(str_comp(argv[i], "walk") == 0)
+				InputMode = INPUT_WALK;
+			else if(str_comp(argv[i], "chaos") == 0)
+				InputMode = INPUT_CHAOS;
+			else
+				Valid = false;
+		}
+		else if(argv[i][0] != '-')
+		{
+			NETADDR Addr;
+			Valid = net_host_lookup(argv[i], &Addr, NETTYPE_ALL) == 0;
+			if(Valid)
+			{
+				if(Addr.port == 0)
+					Addr.port = 8303;
+				vServers.push_back(Addr);
+			}
+			else
+				log_error("stress_bots", "host lookup for '%s' failed", argv[i]);
+		}
+		else
+			Valid = false;
+		if(!Valid)
+		{
+			Usage();
+			return -1;
+		}
+	}
+	if(vServers.empty() || NumBots <= 0)
+	{
+		Usage();
+		return -1;
+	}
+
+	secure_random_init();
+	net_init();
+	CNetBase::Init();
+
+	// the connections read their timeouts from the config
+	CConfigManager ConfigManager;
+	ConfigManager.Reset();
+
+	CSnapshotDelta SnapshotDelta;
+	CNetObjHandler NetObjHandler;
+	for(int i = 0; i < NUM_NETOBJTYPES; i++)
+		SnapshotDelta.SetStaticsize(i, NetObjHandler.GetObjSize(i));
+
+	std::vector<std::unique_ptr<CBot>> vpBots;
+	vpBots.reserve(NumBots);
+
+	const int64_t Freq = time_freq();
+	const int64_t StartTime = time_get();
+	int64_t NextTick = StartTime;
+	int64_t LastStats = StartTime;
+	int TickCount = 0;
+	NETSTATS LastNetStats;
+	net_stats(&LastNetStats);
+
+	while(Duration <= 0 || time_get() - StartTime < Duration * Freq)
+	{
+		const int64_t Now = time_get();
+
+		// ramp up the bots, joining all at once looks like a flood to the server
+		const int WantedBots = minimum(NumBots, 1 + (int)((Now - StartTime) * JoinRate / Freq));
+		while((int)vpBots.size() < WantedBots)
+		{
+			const int ID = vpBots.size();
+			vpBots.push_back(std::make_unique<CBot>(ID, InputMode, &SnapshotDelta, pPassword));
+			if(!vpBots.back()->Connect(vServers[ID % vServers.size()], Now))
+				log_error("stress_bots", "bot %d could not open a socket", ID);
+		}
+
+		for(auto &pBot : vpBots)
+			pBot->Update(Now);
+
+		if(Now >= NextTick)
+		{
+			for(auto &pBot : vpBots)
+				pBot->Tick(Now);
+			TickCount++;
+			NextTick = StartTime + TickCount * Freq / SERVER_TICK_SPEED;
+			if(NextTick < Now)
+			{
+				TickCount = (Now - StartTime) * SERVER_TICK_SPEED / Freq + 1;
+				NextTick = StartTime + TickCount * Freq / SERVER_TICK_SPEED;
+			}
+		}
+
+		if(Now - LastStats >= StatsInterval * Freq)
+		{
+			const double Seconds = (Now - LastStats) / (double)Freq;
+			LastStats = Now;
+
+			int aNumStates[CBot::STATE_FAILED + 1] = {0};
+			int64_t JoinTimeSum = 0;
+			SBotStats Total;
+			for(auto &pBot : vpBots)
+			{
+				aNumStates[pBot->State()]++;
+				if(pBot->State() == CBot::STATE_INGAME)
+					JoinTimeSum += pBot->JoinTime();
+				Total.Add(pBot->m_Stats);
+				pBot->m_Stats = SBotStats();
+			}
+			NETSTATS NetStats;
+			net_stats(&NetStats);
+
+			log_info("stress_bots", "bots: %d ingame, %d joining, %d failed, avg join time %.0f ms",
+				aNumStates[CBot::STATE_INGAME], aNumStates[CBot::STATE_CONNECTING] + aNumStates[CBot::STATE_LOADING], aNumStates[CBot::STATE_FAILED],
+				aNumStates[CBot::STATE_INGAME] ? JoinTimeSum * 1000.0 / Freq / aNumStates[CBot::STATE_INGAME] : 0.0);
+			log_info("stress_bots", "snapshots: %.1f/s per bot, avg %.0f bytes (max %d), unpacked %.0f bytes, %.1f items, %d empty, %d crc errors, %d resyncs",
+				aNumStates[CBot::STATE_INGAME] ? Total.m_Snapshots / Seconds / aNumStates[CBot::STATE_INGAME] : 0.0,
+				Total.m_Snapshots ? Total.m_SnapshotBytes / (double)Total.m_Snapshots : 0.0, Total.m_MaxSnapshotBytes,
+				Total.m_Snapshots ? Total.m_UnpackedBytes / (double)Total.m_Snapshots : 0.0,
+				Total.m_Snapshots ? Total.m_Items / (double)Total.m_Snapshots : 0.0,
+				Total.m_EmptySnapshots, Total.m_CrcErrors, Total.m_Resyncs);
+			log_info("stress_bots", "bandwidth: in %.1f kB/s (%.0f packets/s), out %.1f kB/s (%.0f packets/s)",
+				(NetStats.recv_bytes - LastNetStats.recv_bytes) / 1024.0 / Seconds, (NetStats.recv_packets - LastNetStats.recv_packets) / Seconds,
+				(NetStats.sent_bytes - LastNetStats.sent_bytes) / 1024.0 / Seconds, (NetStats.sent_packets - LastNetStats.sent_packets) / Seconds);
+			// the server answers every input with the time left until the input's tick,
+			// a shrinking or scattered value means the server ticks late
+			if(Total.m_NumTimings)
+				log_info("stress_bots", "server tick timing: input time left avg %.1f ms, min %d ms, max %d ms",
+					Total.m_TimeLeftSum / (double)Total.m_NumTimings, Total.m_TimeLeftMin, Total.m_TimeLeftMax);
+			LastNetStats = NetStats;
+		}
+
+		std::this_thread::sleep_for(1ms);
+	}
+
+	for(auto &pBot : vpBots)
+	{
+		if(pBot->State() == CBot::STATE_FAILED && pBot->ErrorString()[0])
+		{
+			log_info("stress_bots", "first connection error: %s", pBot->ErrorString());
+			break;
+		}
+	}
+	vpBots.clear();
+	return 0;
+}